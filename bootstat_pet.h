@@ -1,15 +0,0 @@
-#ifndef BOOTSTAT_PET
-#define BOOTSTAT_PET
-
-int dflt_bootStatNum = 0;
-
-int dflt_bootStatWhat[] = {
-};
-
-const char *dflt_bootStatFile[] = {
-};
-
-int dflt_bootStatSize[] = {
-};
-
-#endif
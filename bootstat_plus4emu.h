@@ -1,15 +0,0 @@
-#ifndef BOOTSTAT_PLUS4EMU
-#define BOOTSTAT_PLUS4EMU
-
-int dflt_bootStatNum = 0;
-
-int dflt_bootStatWhat[] = {
-};
-
-const char *dflt_bootStatFile[] = {
-};
-
-int dflt_bootStatSize[] = {
-};
-
-#endif
@@ -126,6 +126,7 @@ FrameBufferLayer::FrameBufferLayer() :
         dst_x_(0), dst_y_(0), dst_w_(0), dst_h_(0),
         showing_(false), allocated_(false),
         mode_(VC_IMAGE_8BPP), bytes_per_pixel_(1), uses_shader_(false),
+        pal_filter_enabled_(false),
         shader_init_(false),
         vshader_(-1), fshader_(-1), shader_program_(-1),
         vbo_(-1),
@@ -628,20 +629,27 @@ int FrameBufferLayer::Allocate(int pixelmode, uint8_t **pixels,
      *pixels = pixels_;
   }
 
-  // Allocate the VC resources along with the frame buffer
+  // Allocate the VC resources along with the frame buffer. With the
+  // PAL filter they hold the filtered RGB565 frame instead.
+  VC_IMAGE_TYPE_T resource_mode = mode_;
+  int resource_height = height;
+  if (PALFilterActive() && pal_filter_.Allocate(width, height) == 0) {
+     resource_mode = VC_IMAGE_RGB565;
+     resource_height = height * 2;
+  }
 
-  dispman_resource_[0] = vc_dispmanx_resource_create(mode_,
+  dispman_resource_[0] = vc_dispmanx_resource_create(resource_mode,
                                                      width,
-                                                     height,
+                                                     resource_height,
                                                      &vc_image_ptr );
-  dispman_resource_[1] = vc_dispmanx_resource_create(mode_,
+  dispman_resource_[1] = vc_dispmanx_resource_create(resource_mode,
                                                      width,
-                                                     height,
+                                                     resource_height,
                                                      &vc_image_ptr );
   assert(dispman_resource_[0]);
   assert(dispman_resource_[1]);
 
-  vc_dispmanx_rect_set(&copy_dst_rect_, 0, 0, width, height);
+  vc_dispmanx_rect_set(&copy_dst_rect_, 0, 0, width, resource_height);
 
   if (pixels) {
      // Don't clobber these on realloc.
@@ -708,6 +716,32 @@ int FrameBufferLayer::ReAllocate(bool shader_enable) {
   return Allocate(pixelmode, nullptr, fb_width_, fb_height_, nullptr);
 }
 
+int FrameBufferLayer::SetPALFilter(bool enable) {
+  if (pal_filter_enabled_ == enable) {
+     return 0;
+  }
+
+  pal_filter_enabled_ = enable;
+  if (!allocated_) {
+     return 0;
+  }
+
+  // Free layer but keep pixels, then reallocate with same params.
+  FreeInternal(true);
+
+  int pixelmode = 0;
+  if (mode_ == VC_IMAGE_RGB565) pixelmode = 1;
+
+  return Allocate(pixelmode, nullptr, fb_width_, fb_height_, nullptr);
+}
+
+// Whether frames go through the PAL filter. Only meaningful while
+// allocated.
+bool FrameBufferLayer::PALFilterActive() {
+  return pal_filter_enabled_ && mode_ == VC_IMAGE_8BPP && !transparency_ &&
+         !uses_shader_;
+}
+
 void FrameBufferLayer::Clear() {
   assert (allocated_);
 
@@ -746,6 +780,8 @@ void FrameBufferLayer::FreeInternal(bool keepPixels) {
   ret = vc_dispmanx_resource_delete(dispman_resource_[1]);
   assert(ret == 0);
 
+  pal_filter_.Free();
+
   allocated_ = false;
 }
 
@@ -858,6 +894,14 @@ void FrameBufferLayer::Show() {
                        dst_y_ << 16,
                        dst_w_ << 16,
                        dst_h_ << 16);
+  } else if (pal_filter_.GetPixels()) {
+     // The filtered resource has two lines for every line of
+     // pixels_.
+     vc_dispmanx_rect_set(&src_rect_,
+                       src_x_ << 16,
+                       src_y_ << 17,
+                       src_w_ << 16,
+                       src_h_ << 17);
   } else {
      // When we're using just dispmanx, we isolate and crop
      // the region in the layer we want to scale up to the
@@ -952,7 +996,14 @@ void FrameBufferLayer::FrameReady(int to_offscreen) {
 
   // Copy data into either the offscreen resource (if swap) or the
   // on screen resource (if !swap).
-  if (!uses_shader_) {
+  if (pal_filter_.GetPixels()) {
+      pal_filter_.Render(pixels_, fb_pitch_);
+      vc_dispmanx_resource_write_data(dispman_resource_[rnum],
+                                      VC_IMAGE_RGB565,
+                                      pal_filter_.GetPitch(),
+                                      pal_filter_.GetPixels(),
+                                      &copy_dst_rect_);
+  } else if (!uses_shader_) {
       vc_dispmanx_resource_write_data(dispman_resource_[rnum],
                                       mode_,
                                       fb_pitch_,
@@ -1083,6 +1134,12 @@ void FrameBufferLayer::UpdatePalette() {
   if (!allocated_) return;
   assert (mode_ == VC_IMAGE_8BPP);
 
+  if (pal_filter_.GetPixels()) {
+     // The resources are RGB565, the filter does the lookup.
+     pal_filter_.SetPalette(pal_565_);
+     return;
+  }
+
   int ret;
   if (transparency_) {
      ret = vc_dispmanx_resource_set_palette(dispman_resource_[0],
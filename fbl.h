@@ -22,6 +22,8 @@
 #include "EGL/egl.h"
 #include "EGL/eglext.h"
 
+#include "palfilter.h"
+
 // A wrapper that manages a single dispmanx layer and
 // indexed frame buffer.
 class FrameBufferLayer {
@@ -49,6 +51,11 @@ public:
   // on/off.
   int ReAllocate(bool shader_enable);
 
+  // Turns the software PAL filter on/off. Only takes effect for
+  // indexed layers without transparency that don't use the shader.
+  // Reallocates like ReAllocate if already allocated.
+  int SetPALFilter(bool enable);
+
   void Free();
   void Clear();
 
@@ -148,6 +155,7 @@ public:
 
 private:
   void FreeInternal(bool keepPixels);
+  bool PALFilterActive();
   void Swap(DISPMANX_UPDATE_HANDLE_T& dispman_update);
   void SwapGL(bool sync);
   void RenderGL();
@@ -242,6 +250,11 @@ private:
 
   bool uses_shader_;
 
+  // When active, pixels_ stays indexed but the resources are RGB565
+  // at twice the height and get the filter's output.
+  bool pal_filter_enabled_;
+  PALFilter pal_filter_;
+
   bool shader_init_;
   GLuint vshader_;
   GLuint fshader_;
@@ -0,0 +1,479 @@
+//
+// gpioscanner.cpp
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gpioscanner.h"
+
+extern "C" {
+#include "third_party/common/keycodes.h"
+}
+
+// These for translating row/col scans into equivalent keycodes.
+#if defined(RASPI_PLUS4) | defined(RASPI_PLUS4EMU)
+static const long kbdMatrixKeyCodes[8][8] = {
+ {KEYCODE_Backspace,  KEYCODE_3,         KEYCODE_5, KEYCODE_7, KEYCODE_9, KEYCODE_Left,         KEYCODE_Up,           KEYCODE_1},
+ {KEYCODE_Return,     KEYCODE_w,         KEYCODE_r, KEYCODE_y, KEYCODE_i, KEYCODE_p,            KEYCODE_Dash,         KEYCODE_BackQuote},
+ {KEYCODE_BackSlash,  KEYCODE_a,         KEYCODE_d, KEYCODE_g, KEYCODE_j, KEYCODE_l,            KEYCODE_SingleQuote,  KEYCODE_Tab},
+ {KEYCODE_F7,         KEYCODE_4,         KEYCODE_6, KEYCODE_8, KEYCODE_0, KEYCODE_Right,        KEYCODE_Down,         KEYCODE_2},
+ {KEYCODE_F1,         KEYCODE_z,         KEYCODE_c, KEYCODE_b, KEYCODE_m, KEYCODE_Period,       KEYCODE_RightShift,   KEYCODE_Space},
+ {KEYCODE_F3,         KEYCODE_s,         KEYCODE_f, KEYCODE_h, KEYCODE_k, KEYCODE_SemiColon,    KEYCODE_RightBracket, KEYCODE_LeftControl},
+ {KEYCODE_F5,         KEYCODE_e,         KEYCODE_t, KEYCODE_u, KEYCODE_o, KEYCODE_LeftBracket,  KEYCODE_Equals,       KEYCODE_q},
+ {KEYCODE_Insert,     KEYCODE_LeftShift, KEYCODE_x, KEYCODE_v, KEYCODE_n, KEYCODE_Comma,        KEYCODE_Slash,        KEYCODE_Escape},
+};
+#else
+static const long kbdMatrixKeyCodes[8][8] = {
+ {KEYCODE_Backspace, KEYCODE_3,         KEYCODE_5, KEYCODE_7, KEYCODE_9, KEYCODE_Dash,        KEYCODE_Insert,       KEYCODE_1},
+ {KEYCODE_Return,    KEYCODE_w,         KEYCODE_r, KEYCODE_y, KEYCODE_i, KEYCODE_p,           KEYCODE_RightBracket, KEYCODE_BackQuote},
+ {KEYCODE_Right,     KEYCODE_a,         KEYCODE_d, KEYCODE_g, KEYCODE_j, KEYCODE_l,           KEYCODE_SingleQuote,  KEYCODE_Tab},
+ {KEYCODE_F7,        KEYCODE_4,         KEYCODE_6, KEYCODE_8, KEYCODE_0, KEYCODE_Equals,      KEYCODE_Home,         KEYCODE_2},
+ {KEYCODE_F1,        KEYCODE_z,         KEYCODE_c, KEYCODE_b, KEYCODE_m, KEYCODE_Period,      KEYCODE_RightShift,   KEYCODE_Space},
+ {KEYCODE_F3,        KEYCODE_s,         KEYCODE_f, KEYCODE_h, KEYCODE_k, KEYCODE_SemiColon,   KEYCODE_BackSlash,    KEYCODE_LeftControl},
+ {KEYCODE_F5,        KEYCODE_e,         KEYCODE_t, KEYCODE_u, KEYCODE_o, KEYCODE_LeftBracket, KEYCODE_Delete,       KEYCODE_q},
+ {KEYCODE_Down,      KEYCODE_LeftShift, KEYCODE_x, KEYCODE_v, KEYCODE_n, KEYCODE_Comma,       KEYCODE_Slash,        KEYCODE_Escape},
+};
+#endif
+
+// Joystick pins indexed by JOY_UP..JOY_FIRE (and JOY_POTX/POTY for
+// the Waveshare HAT).
+static const int config0JoyPins[2][5] = {
+  {GPIO_CONFIG_0_JOY_1_UP_INDEX, GPIO_CONFIG_0_JOY_1_DOWN_INDEX,
+   GPIO_CONFIG_0_JOY_1_LEFT_INDEX, GPIO_CONFIG_0_JOY_1_RIGHT_INDEX,
+   GPIO_CONFIG_0_JOY_1_FIRE_INDEX},
+  {GPIO_CONFIG_0_JOY_2_UP_INDEX, GPIO_CONFIG_0_JOY_2_DOWN_INDEX,
+   GPIO_CONFIG_0_JOY_2_LEFT_INDEX, GPIO_CONFIG_0_JOY_2_RIGHT_INDEX,
+   GPIO_CONFIG_0_JOY_2_FIRE_INDEX},
+};
+
+static const int config1JoyPins[2][5] = {
+  {GPIO_CONFIG_1_JOY_1_UP_INDEX, GPIO_CONFIG_1_JOY_1_DOWN_INDEX,
+   GPIO_CONFIG_1_JOY_1_LEFT_INDEX, GPIO_CONFIG_1_JOY_1_RIGHT_INDEX,
+   GPIO_CONFIG_1_JOY_1_FIRE_INDEX},
+  {GPIO_CONFIG_1_JOY_2_UP_INDEX, GPIO_CONFIG_1_JOY_2_DOWN_INDEX,
+   GPIO_CONFIG_1_JOY_2_LEFT_INDEX, GPIO_CONFIG_1_JOY_2_RIGHT_INDEX,
+   GPIO_CONFIG_1_JOY_2_FIRE_INDEX},
+};
+
+static const int config1JoySelect[2] = {
+  GPIO_JS1_SELECT_INDEX, GPIO_JS2_SELECT_INDEX
+};
+
+static const int config2JoyPins[7] = {
+  GPIO_CONFIG_2_WAVESHARE_UP_INDEX, GPIO_CONFIG_2_WAVESHARE_DOWN_INDEX,
+  GPIO_CONFIG_2_WAVESHARE_LEFT_INDEX, GPIO_CONFIG_2_WAVESHARE_RIGHT_INDEX,
+  GPIO_CONFIG_2_WAVESHARE_B_INDEX, GPIO_CONFIG_2_WAVESHARE_A_INDEX,
+  GPIO_CONFIG_2_WAVESHARE_Y_INDEX,
+};
+
+static const int config3JoyPins[2][5] = {
+  {GPIO_CONFIG_3_JOY_1_UP_INDEX, GPIO_CONFIG_3_JOY_1_DOWN_INDEX,
+   GPIO_CONFIG_3_JOY_1_LEFT_INDEX, GPIO_CONFIG_3_JOY_1_RIGHT_INDEX,
+   GPIO_CONFIG_3_JOY_1_FIRE_INDEX},
+  {GPIO_CONFIG_3_JOY_2_UP_INDEX, GPIO_CONFIG_3_JOY_2_DOWN_INDEX,
+   GPIO_CONFIG_3_JOY_2_LEFT_INDEX, GPIO_CONFIG_3_JOY_2_RIGHT_INDEX,
+   GPIO_CONFIG_3_JOY_2_FIRE_INDEX},
+};
+
+// What joystick directions/fire mean while the ui is up.
+static const long joyUIKeyCodes[5] = {
+  KEYCODE_Up, KEYCODE_Down, KEYCODE_Left, KEYCODE_Right, KEYCODE_Return
+};
+
+void GPIODebouncer::Reset() {
+  mState = BTN_UP;
+  mEdgeTime = 0;
+  mSettling = false;
+}
+
+int GPIODebouncer::Update(int level, unsigned long now) {
+  if (mState == BTN_PRESS) {
+    mState = BTN_DOWN;
+  } else if (mState == BTN_RELEASE) {
+    mState = BTN_UP;
+  }
+
+  if (mSettling) {
+    if (now - mEdgeTime < GPIO_DEBOUNCE_US) {
+      return mState;
+    }
+    mSettling = false;
+  }
+
+  if (level == GPIO_PIN_LOW && mState == BTN_UP) {
+    mState = BTN_PRESS;
+    mEdgeTime = now;
+    mSettling = true;
+  } else if (level != GPIO_PIN_LOW && mState == BTN_DOWN) {
+    mState = BTN_RELEASE;
+    mEdgeTime = now;
+    mSettling = true;
+  }
+  return mState;
+}
+
+GPIOScanner::GPIOScanner(GPIOPinIO *pins)
+    : mPins(pins), mEventHead(0), mEventTail(0), mDispatchConfig(-1),
+      mUILeftShift(false), mUIRightShift(false) {
+  for (int i = 0; i < 2; i++) {
+    mJoyBits[i] = 0;
+    mJoyPort[i] = -1;
+    mJoyDev[i] = -1;
+    mJoySentBits[i] = 0;
+  }
+  Reset();
+}
+
+// Scan side only. Dispatch notices config changes on its own.
+void GPIOScanner::Reset() {
+  mLastConfig = -1;
+  for (int i = 0; i < NUM_GPIO_PINS; i++) {
+    mButtons[i].Reset();
+  }
+  for (int i = 0; i < 8; i++) {
+    for (int j = 0; j < 8; j++) {
+      mMatrix[i][j].Reset();
+    }
+  }
+  mRestore.Reset();
+  mJoyLines[0] = 0;
+  mJoyLines[1] = 0;
+}
+
+bool GPIOScanner::Handles(int gpioConfig) {
+  return gpioConfig == GPIO_CONFIG_NAV_JOY ||
+         gpioConfig == GPIO_CONFIG_KYB_JOY ||
+         gpioConfig == GPIO_CONFIG_WAVESHARE ||
+         gpioConfig == GPIO_CONFIG_USERPORT;
+}
+
+void GPIOScanner::Scan(int gpioConfig, unsigned long now) {
+  if (gpioConfig != mLastConfig) {
+    // Pins mean different things now. Start over.
+    Reset();
+    mLastConfig = gpioConfig;
+  }
+
+  switch (gpioConfig) {
+    case GPIO_CONFIG_NAV_JOY:
+      // Nav Buttons + Real Joys
+      ScanNavButtons(now);
+      ReadJoystick(0, GPIO_CONFIG_NAV_JOY, now);
+      ReadJoystick(1, GPIO_CONFIG_NAV_JOY, now);
+      break;
+    case GPIO_CONFIG_KYB_JOY:
+      // Real Kyb + Joys
+      ScanKeyboard(now);
+      ReadJoystick(0, GPIO_CONFIG_KYB_JOY, now);
+      ReadJoystick(1, GPIO_CONFIG_KYB_JOY, now);
+      break;
+    case GPIO_CONFIG_WAVESHARE:
+      // Waveshare Hat
+      ScanWaveshareButtons(now);
+      ReadJoystick(0, GPIO_CONFIG_WAVESHARE, now);
+      break;
+    case GPIO_CONFIG_USERPORT:
+      // The userport lines themselves are serviced by the emulation
+      // core. Only the joysticks are ours.
+      ReadJoystick(0, GPIO_CONFIG_USERPORT, now);
+      ReadJoystick(1, GPIO_CONFIG_USERPORT, now);
+      break;
+    default:
+      break;
+  }
+}
+
+void GPIOScanner::Post(int type, long code, int pressed, int device,
+                       int bits) {
+  unsigned head = mEventHead;
+  if (head - mEventTail >= GPIO_EVENT_QUEUE_SIZE) {
+    // Emulation core is not draining. Joystick events carry the whole
+    // state so the next one catches up.
+    return;
+  }
+  GPIOEvent *e = &mEvents[head & (GPIO_EVENT_QUEUE_SIZE - 1)];
+  e->type = type;
+  e->code = code;
+  e->pressed = pressed;
+  e->device = device;
+  e->bits = bits;
+  __sync_synchronize();
+  mEventHead = head + 1;
+}
+
+void GPIOScanner::PostKeyTap(long keycode) {
+  Post(GPIO_EVENT_KEY, keycode, 1);
+  Post(GPIO_EVENT_KEY, keycode, 0);
+}
+
+bool GPIOScanner::ButtonPressed(int pinIndex, unsigned long now) {
+  return mButtons[pinIndex].Update(mPins->Read(pinIndex), now) == BTN_PRESS;
+}
+
+void GPIOScanner::ScanNavButtons(unsigned long now) {
+  if (ButtonPressed(GPIO_CONFIG_0_MENU_INDEX, now)) {
+    PostKeyTap(KEYCODE_F12);
+  }
+  if (ButtonPressed(GPIO_CONFIG_0_MENU_BACK_INDEX, now)) {
+    PostKeyTap(KEYCODE_Escape);
+  }
+  if (ButtonPressed(GPIO_CONFIG_0_MENU_UP_INDEX, now)) {
+    PostKeyTap(KEYCODE_Up);
+  }
+  if (ButtonPressed(GPIO_CONFIG_0_MENU_DOWN_INDEX, now)) {
+    PostKeyTap(KEYCODE_Down);
+  }
+  if (ButtonPressed(GPIO_CONFIG_0_MENU_LEFT_INDEX, now)) {
+    PostKeyTap(KEYCODE_Left);
+  }
+  if (ButtonPressed(GPIO_CONFIG_0_MENU_RIGHT_INDEX, now)) {
+    PostKeyTap(KEYCODE_Right);
+  }
+  if (ButtonPressed(GPIO_CONFIG_0_MENU_ENTER_INDEX, now)) {
+    PostKeyTap(KEYCODE_Return);
+  }
+  if (ButtonPressed(GPIO_CONFIG_0_MENU_VKBD_INDEX, now)) {
+    Post(GPIO_EVENT_QUICK_FUNC, BTN_ASSIGN_VKBD_TOGGLE, 1);
+  }
+}
+
+void GPIOScanner::ScanWaveshareButtons(unsigned long now) {
+  if (ButtonPressed(GPIO_CONFIG_2_WAVESHARE_START_INDEX, now)) {
+    PostKeyTap(KEYCODE_F12);
+  }
+  if (ButtonPressed(GPIO_CONFIG_2_WAVESHARE_TL_INDEX, now)) {
+    PostKeyTap(KEYCODE_Escape);
+  }
+  if (ButtonPressed(GPIO_CONFIG_2_WAVESHARE_TR_INDEX, now)) {
+    Post(GPIO_EVENT_QUICK_FUNC, BTN_ASSIGN_WARP, 1);
+  }
+  if (ButtonPressed(GPIO_CONFIG_2_WAVESHARE_X_INDEX, now)) {
+    Post(GPIO_EVENT_QUICK_FUNC, BTN_ASSIGN_VKBD_TOGGLE, 1);
+  }
+  if (ButtonPressed(GPIO_CONFIG_2_WAVESHARE_SELECT_INDEX, now)) {
+    Post(GPIO_EVENT_QUICK_FUNC, BTN_ASSIGN_STATUS_TOGGLE, 1);
+  }
+}
+
+void GPIOScanner::ScanKeyboard(unsigned long now) {
+  int restore = mRestore.Update(mPins->Read(GPIO_KBD_RESTORE_INDEX), now);
+  if (restore == BTN_PRESS || restore == BTN_RELEASE) {
+    Post(GPIO_EVENT_RESTORE, 0, restore == BTN_PRESS);
+  }
+
+  for (int kbdPA = 0; kbdPA < 8; kbdPA++) {
+    mPins->DriveLow(kbdPA);
+    mPins->Settle(GPIO_SETTLE_US);
+    for (int kbdPB = 0; kbdPB < 8; kbdPB++) {
+      // PB lines are indices 8-15.
+      int state = mMatrix[kbdPA][kbdPB].Update(mPins->Read(kbdPB + 8), now);
+      if (state != BTN_PRESS && state != BTN_RELEASE) {
+        continue;
+      }
+
+      // My PA/PB to keycode matrix is transposed and I'm too lazy to fix
+      // it. Just swap PB and PA here for the keycode lookup.
+      Post(GPIO_EVENT_MATRIX_KEY, kbdMatrixKeyCodes[kbdPB][kbdPA],
+           state == BTN_PRESS);
+    }
+    mPins->Release(kbdPA);
+  }
+}
+
+// If gpioConfig is 0, the NavButtons+Joys config is used where pins can
+// be grounded.
+// If gpioConfig is 1, the Keyboard+Joys PCB config is used (where
+// selector is used to drive pins low instead of GND).
+// If gpioConfig is 2, the Waveshare HAT layout is used.
+// If gpioConfig is 3, the joysticks share the header with the userport.
+void GPIOScanner::ReadJoystick(int device, int gpioConfig,
+                               unsigned long now) {
+  const int *js_pins;
+  int js_selector = -1;
+  int num_pins = 5;
+  switch (gpioConfig) {
+    case GPIO_CONFIG_NAV_JOY:
+      js_pins = config0JoyPins[device];
+      break;
+    case GPIO_CONFIG_KYB_JOY:
+      js_pins = config1JoyPins[device];
+      js_selector = config1JoySelect[device];
+      break;
+    case GPIO_CONFIG_WAVESHARE:
+      js_pins = config2JoyPins;
+      num_pins = 7;
+      break;
+    case GPIO_CONFIG_USERPORT:
+      js_pins = config3JoyPins[device];
+      break;
+    default:
+      return;
+  }
+
+  if (js_selector >= 0) {
+    // Drive the select pin low. Don't leave this routine
+    // before setting it as input-pullup again.
+    mPins->DriveLow(js_selector);
+    mPins->Settle(GPIO_SETTLE_US);
+  }
+
+  // Whether the port is assigned to this joystick, and whether the ui
+  // wants it instead, is up to Dispatch. Every edge is posted.
+  for (int i = 0; i < num_pins; i++) {
+    GPIODebouncer *btn = &mButtons[js_pins[i]];
+    int state = btn->Update(mPins->Read(js_pins[i]), now);
+    if (state == BTN_PRESS) {
+      mJoyLines[device] |= 1 << i;
+      Post(GPIO_EVENT_JOY, i, 1, device, mJoyLines[device]);
+    } else if (state == BTN_RELEASE) {
+      mJoyLines[device] &= ~(1 << i);
+      Post(GPIO_EVENT_JOY, i, 0, device, mJoyLines[device]);
+    }
+  }
+
+  if (js_selector >= 0) {
+    mPins->Release(js_selector);
+  }
+}
+
+void GPIOScanner::Dispatch(int gpioConfig) {
+  if (gpioConfig != mDispatchConfig) {
+    mDispatchConfig = gpioConfig;
+    mUILeftShift = false;
+    mUIRightShift = false;
+    for (int i = 0; i < 2; i++) {
+      mJoyBits[i] = 0;
+      mJoyPort[i] = -1;
+    }
+  }
+
+  int ui_activated = emu_is_ui_activated();
+
+  unsigned head = mEventHead;
+  __sync_synchronize();
+  unsigned tail = mEventTail;
+  while (tail != head) {
+    GPIOEvent *e = &mEvents[tail & (GPIO_EVENT_QUEUE_SIZE - 1)];
+    long keycode = e->code;
+    switch (e->type) {
+      case GPIO_EVENT_MATRIX_KEY:
+        if (ui_activated) {
+          if (keycode == KEYCODE_LeftShift) {
+            mUILeftShift = e->pressed;
+          } else if (keycode == KEYCODE_RightShift) {
+            mUIRightShift = e->pressed;
+          }
+
+          if (keycode == KEYCODE_Right && (mUILeftShift || mUIRightShift)) {
+            keycode = KEYCODE_Left;
+          } else if (keycode == KEYCODE_Down &&
+                     (mUILeftShift || mUIRightShift)) {
+            keycode = KEYCODE_Up;
+          }
+        }
+        // TODO: Need to watch out for key combos here.  Hook into
+        // the handle functions directly in kbd.c so we can invoke the
+        // same hotkey funcs.
+        if (e->pressed) {
+          emu_key_pressed(keycode);
+        } else {
+          emu_key_released(keycode);
+        }
+        break;
+      case GPIO_EVENT_KEY:
+        if (e->pressed) {
+          emu_key_pressed(keycode);
+        } else {
+          emu_key_released(keycode);
+        }
+        break;
+      case GPIO_EVENT_RESTORE:
+        // For restore, there is no public API that triggers it so we will
+        // pass the keycode that will.  NOTE: On the plus/4, this key sym
+        // will be the CLR key according to the keymap.
+        if (e->pressed) {
+          emu_key_pressed(restore_key_sym);
+        } else {
+          emu_key_released(restore_key_sym);
+        }
+        break;
+      case GPIO_EVENT_QUICK_FUNC:
+        emu_quick_func_interrupt(keycode);
+        break;
+      case GPIO_EVENT_JOY:
+        mJoyBits[e->device] = e->bits;
+        // Pot values are not used for ui
+        if (ui_activated && keycode <= JOY_FIRE) {
+          emu_ui_key_interrupt(joyUIKeyCodes[keycode], e->pressed);
+        }
+        break;
+      default:
+        break;
+    }
+    tail++;
+  }
+  __sync_synchronize();
+  mEventTail = tail;
+
+  if (ui_activated) {
+    // Make sure the emulator gets the current state when the ui
+    // goes away.
+    mJoyPort[0] = -1;
+    mJoyPort[1] = -1;
+    return;
+  }
+
+  switch (gpioConfig) {
+    case GPIO_CONFIG_NAV_JOY:
+    case GPIO_CONFIG_KYB_JOY:
+    case GPIO_CONFIG_USERPORT:
+      DispatchJoystick(0);
+      DispatchJoystick(1);
+      break;
+    case GPIO_CONFIG_WAVESHARE:
+      DispatchJoystick(0);
+      break;
+    default:
+      break;
+  }
+}
+
+void GPIOScanner::DispatchJoystick(int device) {
+  int devd = device == 0 ? JOYDEV_GPIO_0 : JOYDEV_GPIO_1;
+  int port;
+  if (joydevs[0].device == devd) {
+    port = joydevs[0].port;
+  } else if (joydevs[1].device == devd) {
+    port = joydevs[1].port;
+  } else {
+    mJoyPort[device] = -1;
+    return;
+  }
+
+  int bits = mJoyBits[device];
+  if (port == mJoyPort[device] && devd == mJoyDev[device] &&
+      bits == mJoySentBits[device]) {
+    return;
+  }
+  mJoyPort[device] = port;
+  mJoyDev[device] = devd;
+  mJoySentBits[device] = bits;
+
+  emu_joy_interrupt_abs(port, devd,
+                        (bits >> JOY_UP) & 1,
+                        (bits >> JOY_DOWN) & 1,
+                        (bits >> JOY_LEFT) & 1,
+                        (bits >> JOY_RIGHT) & 1,
+                        (bits >> JOY_FIRE) & 1,
+                        (bits >> JOY_POTX) & 1,
+                        (bits >> JOY_POTY) & 1);
+}
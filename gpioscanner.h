@@ -0,0 +1,155 @@
+//
+// gpioscanner.h
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef _gpioscanner_h
+#define _gpioscanner_h
+
+extern "C" {
+#include "third_party/common/circle.h"
+}
+
+#include "gpiopins.h"
+
+#define GPIO_PIN_LOW  0
+#define GPIO_PIN_HIGH 1
+
+// After an edge is accepted, further changes on the same input are
+// ignored for this long (usec).
+#define GPIO_DEBOUNCE_US 5000
+
+// How long to wait for lines we drive low to settle before reading
+// (usec).
+#define GPIO_SETTLE_US 10
+
+// Pin access by index into the master gpio array. The scanner only
+// talks to the hardware through this.
+class GPIOPinIO {
+public:
+  virtual ~GPIOPinIO() {}
+
+  virtual int Read(int pinIndex) = 0;
+
+  // Make the pin an output and drive it low.
+  virtual void DriveLow(int pinIndex) = 0;
+
+  // Make the pin an input with pull up again.
+  virtual void Release(int pinIndex) = 0;
+
+  virtual void Settle(unsigned usec) = 0;
+};
+
+// Time based debounce. An edge is reported on the first sample that
+// sees it. The input is then ignored until GPIO_DEBOUNCE_US has passed
+// so contact bounce can't produce more edges. Never sleeps.
+class GPIODebouncer {
+public:
+  GPIODebouncer() { Reset(); }
+
+  void Reset();
+
+  // Returns BTN_PRESS or BTN_RELEASE once per edge, BTN_DOWN or BTN_UP
+  // otherwise.
+  int Update(int level, unsigned long now);
+
+  bool IsDown() const { return mState == BTN_PRESS || mState == BTN_DOWN; }
+
+private:
+  int mState;
+  unsigned long mEdgeTime;
+  bool mSettling;
+};
+
+// What a scan found, waiting to be handed to the emulator.
+#define GPIO_EVENT_KEY        0 // code is a keycode
+#define GPIO_EVENT_MATRIX_KEY 1 // keycode from the real keyboard
+#define GPIO_EVENT_RESTORE    2 // the restore key, code unused
+#define GPIO_EVENT_QUICK_FUNC 3 // code is a BTN_ASSIGN_ value
+#define GPIO_EVENT_JOY        4 // code is a JOY_ bit index
+
+// Must be a power of 2.
+#define GPIO_EVENT_QUEUE_SIZE 128
+
+struct GPIOEvent {
+  int type;
+  long code;
+  int pressed;
+  // GPIO_EVENT_JOY only. Which gpio joystick and the state of all its
+  // lines after this change.
+  int device;
+  int bits;
+};
+
+// Samples nav buttons, joysticks and the real keyboard matrix for the
+// fixed gpio configs. Scan runs on one core and only touches the pins
+// and its own debounce state. The changes it finds are posted to a
+// single producer/consumer queue. Dispatch runs on the emulation core
+// and is what looks at emulator state (ui, joystick port assignments,
+// keymap) before handing the events over.
+class GPIOScanner {
+public:
+  GPIOScanner(GPIOPinIO *pins);
+
+  void Reset();
+
+  // Returns true if Scan does anything for this config. Custom configs
+  // and the userport lines are left to the emulation core.
+  static bool Handles(int gpioConfig);
+
+  // One pass over the pins for the given config. now is in usec.
+  void Scan(int gpioConfig, unsigned long now);
+
+  // Send what Scan has posted since the last call to the emulator.
+  // Must only be called from the emulation core.
+  void Dispatch(int gpioConfig);
+
+private:
+  bool ButtonPressed(int pinIndex, unsigned long now);
+  void ScanNavButtons(unsigned long now);
+  void ScanWaveshareButtons(unsigned long now);
+  void ScanKeyboard(unsigned long now);
+  void ReadJoystick(int device, int gpioConfig, unsigned long now);
+
+  void Post(int type, long code, int pressed, int device = 0, int bits = 0);
+  void PostKeyTap(long keycode);
+  void DispatchJoystick(int device);
+
+  GPIOPinIO *mPins;
+
+  // Scan side.
+  int mLastConfig;
+  GPIODebouncer mButtons[NUM_GPIO_PINS];
+  GPIODebouncer mMatrix[8][8];
+  GPIODebouncer mRestore;
+  int mJoyLines[2];
+
+  // Written by Scan only / Dispatch only.
+  GPIOEvent mEvents[GPIO_EVENT_QUEUE_SIZE];
+  volatile unsigned mEventHead;
+  volatile unsigned mEventTail;
+
+  // Dispatch side.
+  int mDispatchConfig;
+  bool mUILeftShift;
+  bool mUIRightShift;
+  int mJoyBits[2];
+
+  // What was last sent with emu_joy_interrupt_abs for each device.
+  // Only resent when something changes.
+  int mJoyPort[2];
+  int mJoyDev[2];
+  int mJoySentBits[2];
+};
+
+#endif
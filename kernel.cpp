@@ -22,6 +22,9 @@
 #include <string.h>
 
 #include <circle/gpiopin.h>
+#include <circle/multicore.h>
+#include <circle/synchronize.h>
+#include <reent.h>
 
 CKernel *static_kernel = NULL;
 
@@ -43,33 +46,37 @@ static int vol_percent_to_vchiq(int percent) {
   return range * ((float)percent)/100.0 + (-2720);
 }
 
-// Real keyboard matrix states
-static bool kbdMatrixStates[8][8];
-// These for translating row/col scans into equivalent keycodes.
-#if defined(RASPI_PLUS4) | defined(RASPI_PLUS4EMU)
-static long kbdMatrixKeyCodes[8][8] = {
- {KEYCODE_Backspace,  KEYCODE_3,         KEYCODE_5, KEYCODE_7, KEYCODE_9, KEYCODE_Left,         KEYCODE_Up,           KEYCODE_1},
- {KEYCODE_Return,     KEYCODE_w,         KEYCODE_r, KEYCODE_y, KEYCODE_i, KEYCODE_p,            KEYCODE_Dash,         KEYCODE_BackQuote},
- {KEYCODE_BackSlash,  KEYCODE_a,         KEYCODE_d, KEYCODE_g, KEYCODE_j, KEYCODE_l,            KEYCODE_SingleQuote,  KEYCODE_Tab},
- {KEYCODE_F7,         KEYCODE_4,         KEYCODE_6, KEYCODE_8, KEYCODE_0, KEYCODE_Right,        KEYCODE_Down,         KEYCODE_2},
- {KEYCODE_F1,         KEYCODE_z,         KEYCODE_c, KEYCODE_b, KEYCODE_m, KEYCODE_Period,       KEYCODE_RightShift,   KEYCODE_Space},
- {KEYCODE_F3,         KEYCODE_s,         KEYCODE_f, KEYCODE_h, KEYCODE_k, KEYCODE_SemiColon,    KEYCODE_RightBracket, KEYCODE_LeftControl},
- {KEYCODE_F5,         KEYCODE_e,         KEYCODE_t, KEYCODE_u, KEYCODE_o, KEYCODE_LeftBracket,  KEYCODE_Equals,       KEYCODE_q},
- {KEYCODE_Insert,     KEYCODE_LeftShift, KEYCODE_x, KEYCODE_v, KEYCODE_n, KEYCODE_Comma,        KEYCODE_Slash,        KEYCODE_Escape},
-};
+// newlib's malloc calls these around every heap operation but does
+// nothing in them on its own. Core 0 preloads boot files while core 1
+// initializes the emulator, so both allocate at the same time. The lock
+// is recursive since realloc takes it again inside malloc. IRQs are
+// off while it is held so an interrupt on the owning core can't walk
+// into a half updated heap.
+static volatile int malloc_owner = -1;
+static int malloc_depth;
+
+extern "C" void __malloc_lock(struct _reent *reent) {
+  EnterCritical(IRQ_LEVEL);
+#ifdef ARM_ALLOW_MULTI_CORE
+  int core = CMultiCoreSupport::ThisCore();
 #else
-static long kbdMatrixKeyCodes[8][8] = {
- {KEYCODE_Backspace, KEYCODE_3,         KEYCODE_5, KEYCODE_7, KEYCODE_9, KEYCODE_Dash,        KEYCODE_Insert,       KEYCODE_1},
- {KEYCODE_Return,    KEYCODE_w,         KEYCODE_r, KEYCODE_y, KEYCODE_i, KEYCODE_p,           KEYCODE_RightBracket, KEYCODE_BackQuote},
- {KEYCODE_Right,     KEYCODE_a,         KEYCODE_d, KEYCODE_g, KEYCODE_j, KEYCODE_l,           KEYCODE_SingleQuote,  KEYCODE_Tab},
- {KEYCODE_F7,        KEYCODE_4,         KEYCODE_6, KEYCODE_8, KEYCODE_0, KEYCODE_Equals,      KEYCODE_Home,         KEYCODE_2},
- {KEYCODE_F1,        KEYCODE_z,         KEYCODE_c, KEYCODE_b, KEYCODE_m, KEYCODE_Period,      KEYCODE_RightShift,   KEYCODE_Space},
- {KEYCODE_F3,        KEYCODE_s,         KEYCODE_f, KEYCODE_h, KEYCODE_k, KEYCODE_SemiColon,   KEYCODE_BackSlash,    KEYCODE_LeftControl},
- {KEYCODE_F5,        KEYCODE_e,         KEYCODE_t, KEYCODE_u, KEYCODE_o, KEYCODE_LeftBracket, KEYCODE_Delete,       KEYCODE_q},
- {KEYCODE_Down,      KEYCODE_LeftShift, KEYCODE_x, KEYCODE_v, KEYCODE_n, KEYCODE_Comma,       KEYCODE_Slash,        KEYCODE_Escape},
-};
+  int core = 0;
 #endif
-static int kbdRestoreState;
+  if (malloc_owner != core) {
+    while (!__sync_bool_compare_and_swap(&malloc_owner, -1, core)) {
+    }
+  }
+  malloc_depth++;
+}
+
+extern "C" void __malloc_unlock(struct _reent *reent) {
+  if (--malloc_depth == 0) {
+    __sync_synchronize();
+    malloc_owner = -1;
+  }
+  LeaveCritical();
+}
+
 
 extern "C" {
 int circle_get_machine_timing() {
@@ -150,6 +157,21 @@ void circle_boot_complete() {
   static_kernel->circle_boot_complete();
 }
 
+void circle_boot_phase(const char *name) {
+  // Always ok
+  static_kernel->circle_boot_phase(name);
+}
+
+void circle_prefetch_file(const char *path) {
+  // Emulator core only, like every other file call
+  static_kernel->circle_prefetch_file(path);
+}
+
+int circle_prefetch_step(unsigned max_bytes) {
+  // Emulator core only, like every other file call
+  return static_kernel->circle_prefetch_step(max_bytes);
+}
+
 int circle_cycles_per_sec() {
   // Always ok
   return static_kernel->circle_cycles_per_second();
@@ -164,6 +186,10 @@ int circle_realloc_fbl(int layer, int shader) {
   return static_kernel->circle_realloc_fbl(layer, shader);
 }
 
+int circle_set_pal_filter_fbl(int layer, int enable) {
+  return static_kernel->circle_set_pal_filter_fbl(layer, enable);
+}
+
 void circle_free_fbl(int layer) {
   static_kernel->circle_free_fbl(layer);
 }
@@ -252,6 +278,10 @@ unsigned circle_get_arm_clock() {
   return static_kernel->circle_get_arm_clock();
 }
 
+void circle_get_sd_cache_stats(struct sd_cache_stats *stats) {
+  static_kernel->circle_get_sd_cache_stats(stats);
+}
+
 int circle_gpio_enabled() {
   return static_kernel->circle_gpio_enabled();
 }
@@ -260,6 +290,10 @@ int circle_gpio_outputs_enabled() {
   return static_kernel->circle_gpio_outputs_enabled();
 }
 
+int circle_instant_boot_enabled() {
+  return static_kernel->circle_instant_boot_enabled();
+}
+
 void circle_kernel_core_init_complete(int core) {
   static_kernel->circle_kernel_core_init_complete(core);
 }
@@ -347,7 +381,9 @@ CKernel::CKernel(void)
     : ViceStdioApp("vice"), mViceSound(nullptr),
       mNumJoy(emu_get_num_joysticks()),
       mVolume(100), mNumCoresComplete(0),
-      mNeedSoundInit(false), mNumSoundChannels(1) {
+      mNeedSoundInit(false), mNumSoundChannels(1),
+      mGPIOLock(TASK_LEVEL), mGPIOScanReady(false), mGPIOScanConfig(-1),
+      mGPIOPinIO(gpioPins), mGPIOScanner(&mGPIOPinIO), mUserportDDR(0) {
   static_kernel = this;
   mod_states = 0;
   memset(key_states, 0, MAX_KEY_CODES * sizeof(bool));
@@ -358,13 +394,6 @@ CKernel::CKernel(void)
     gpio_prev_state[i] = HIGH;
   }
 
-  kbdRestoreState = HIGH;
-  for (int i = 0; i < 8; i++) {
-    for (int j = 0; j < 8; j++) {
-      kbdMatrixStates[i][j] = HIGH;
-    }
-  }
-
   fbl[FB_LAYER_VIC].SetLayer(0);
   fbl[FB_LAYER_VIC].SetTransparency(false);
 
@@ -740,234 +769,36 @@ ViceApp::TShutdownMode CKernel::Run(void) {
 #ifndef ARM_ALLOW_MULTI_CORE
   mEmulatorCore->LaunchEmulator(mTimingOption);
 #else
-  // This core will do nothing but service interrupts from
-  // usb or gpio.
-  printf("Core 0 idle\n");
-
-  asm("dsb\n\t"
-      "1: wfi\n\t"
-      "b 1b\n\t");
-#endif
-  return ShutdownHalt;
-}
-
-void CKernel::ScanKeyboard() {
-  int ui_activated = emu_is_ui_activated();
-
-  int restore = gpioPins[GPIO_KBD_RESTORE_INDEX]->Read();
-  // For restore, there is no public API that triggers it so we will
-  // pass the keycode that will.  NOTE: On the plus/4, this key sym
-  // will be the CLR key according to the keymap.
-  if (restore == LOW && kbdRestoreState == HIGH) {
-     emu_key_pressed(restore_key_sym);
-  } else if (restore == HIGH && kbdRestoreState == LOW) {
-     emu_key_released(restore_key_sym);
-  }
-  kbdRestoreState = restore;
-
-  // Keyboard scan
-  for (int kbdPA = 0; kbdPA < 8; kbdPA++) {
-    gpioPins[kbdPA]->SetMode(GPIOModeOutput);
-    gpioPins[kbdPA]->Write(LOW);
-    circle_sleep(10);
-    for (int kbdPB = 0; kbdPB < 8; kbdPB++) {
-      // Read PB line
-      int val = gpioPins[kbdPB + 8]->Read();
-
-      // My PA/PB to keycode matrix is transposed and I'm too lazy to fix
-      // it. Just swap PB and PA here for the keycode lookup.
-      long keycode = kbdMatrixKeyCodes[kbdPB][kbdPA];
-
-      if (ui_activated) {
-        if (val == LOW && kbdMatrixStates[kbdPA][kbdPB] == HIGH) {
-          if (keycode == KEYCODE_LeftShift) {
-             uiLeftShift = true;
-          } else if (keycode == KEYCODE_RightShift) {
-             uiRightShift = true;
-          }
-
-          if (keycode == KEYCODE_Right && (uiLeftShift || uiRightShift)) {
-             emu_key_pressed(KEYCODE_Left);
-          } else if (keycode == KEYCODE_Down && (uiLeftShift || uiRightShift)) {
-             emu_key_pressed(KEYCODE_Up);
-          } else {
-             emu_key_pressed(keycode);
-          }
-        } else if (val == HIGH && kbdMatrixStates[kbdPA][kbdPB] == LOW) {
-          if (keycode == KEYCODE_LeftShift) {
-             uiLeftShift = false;
-          } else if (keycode == KEYCODE_RightShift) {
-             uiRightShift = false;
-          }
-          if (keycode == KEYCODE_Right && (uiLeftShift || uiRightShift)) {
-             emu_key_released(KEYCODE_Left);
-          } else if (keycode == KEYCODE_Down && (uiLeftShift || uiRightShift)) {
-             emu_key_released(KEYCODE_Up);
-          } else {
-             emu_key_released(keycode);
-          }
-        }
-      } else {
-        // TODO: Need to watch out for key combos here.  Hook into
-        // the handle functions directly in kbd.c so we can invoke the
-        // same hotkey funcs.
-        if (val == LOW && kbdMatrixStates[kbdPA][kbdPB] == HIGH) {
-          emu_key_pressed(keycode);
-        } else if (val == HIGH && kbdMatrixStates[kbdPA][kbdPB] == LOW) {
-          emu_key_released(keycode);
-        }
+  // This core services interrupts from usb and samples the gpio pins
+  // so the emulation core never waits on them.
+  printf("Core 0 scanning gpio\n");
+
+  unsigned long last_scan = 0;
+  for (;;) {
+    if (mGPIOScanReady && userport_bridge_enabled()) {
+      // User port writes are replayed at their emulated time so poll
+      // without sleeping while the bridge is up.
+      ServiceUserport(true);
+      unsigned long now = mTimer.GetClockTicks();
+      if (now - last_scan >= GPIO_SCAN_INTERVAL_US) {
+        ScanGPIO();
+        last_scan = now;
       }
-      kbdMatrixStates[kbdPA][kbdPB] = val;
+      continue;
     }
-    gpioPins[kbdPA]->SetMode(GPIOModeInputPullUp);
-  }
-}
-
-// Read joystick state.
-// If gpioConfig is 0, the NavButtons+Joys config is used where pins can
-// be grounded.
-// If gpioConfig is 1, the Keyboard+Joys PCB config is used (where
-// selector is used to drive pins low instead of GND).
-// If gpioConfig is 2, the Waveshare HAT layout is used.
-void CKernel::ReadJoystick(int device, int gpioConfig) {
-  // For remembering button states for UI only
-  static int js_prev_0[5] = {HIGH, HIGH, HIGH, HIGH, HIGH};
-  static int js_prev_1[5] = {HIGH, HIGH, HIGH, HIGH, HIGH};
-
-  int *js_prev;
-  CGPIOPin **js_pins = NULL;
-  CGPIOPin *js_selector = NULL;
-  int port = 0;
-  int devd = 0;
-  int ui_activated = emu_is_ui_activated();
-
-  // If ui is activated, don't bail if port assignment can't be done
-  // since the event will always go to the ui. We want the joystick to
-  // function in the ui even if the control port is not assigned to be
-  // gpio.
-  if (device == 0) {
-    if (joydevs[0].device == JOYDEV_GPIO_0) {
-      port = joydevs[0].port;
-      devd = JOYDEV_GPIO_0;
-    } else if (joydevs[1].device == JOYDEV_GPIO_0) {
-      port = joydevs[1].port;
-      devd = JOYDEV_GPIO_0;
-    } else if (!ui_activated) {
-      return;
-    }
-
-    js_prev = js_prev_0;
-    switch (gpioConfig) {
-       case GPIO_CONFIG_NAV_JOY:
-          js_pins = config_0_joystickPins1;
-          break;
-       case GPIO_CONFIG_KYB_JOY:
-          js_selector = gpioPins[GPIO_JS1_SELECT_INDEX];
-          js_pins = config_1_joystickPins1;
-          break;
-       case GPIO_CONFIG_WAVESHARE:
-          js_pins = config_2_joystickPins;
-          break;
-       case GPIO_CONFIG_USERPORT:
-          js_pins = config_3_joystickPins1;
-          break;
-       default:
-         assert(false);
-    }
-  } else {
-    if (joydevs[0].device == JOYDEV_GPIO_1) {
-      port = joydevs[0].port;
-      devd = JOYDEV_GPIO_1;
-    } else if (joydevs[1].device == JOYDEV_GPIO_1) {
-      port = joydevs[1].port;
-      devd = JOYDEV_GPIO_1;
-    } else if (!ui_activated) {
-      return;
-    }
-
-    js_prev = js_prev_1;
-    switch (gpioConfig) {
-       case GPIO_CONFIG_NAV_JOY:
-         js_pins = config_0_joystickPins2;
-         break;
-       case GPIO_CONFIG_KYB_JOY:
-         js_selector = gpioPins[GPIO_JS2_SELECT_INDEX];
-         js_pins = config_1_joystickPins2;
-         break;
-       case GPIO_CONFIG_USERPORT:
-          js_pins = config_3_joystickPins2;
-          break;
-       default:
-         assert(false);
+    if (mGPIOScanReady) {
+      ScanGPIO();
     }
+    CTimer::SimpleusDelay(GPIO_SCAN_INTERVAL_US);
   }
+#endif
+  return ShutdownHalt;
+}
 
-  if (gpioConfig == 1) {
-    // Drive the select pin low. Don't leave this routine
-    // before setting it as input-pullup again.
-    js_selector->SetMode(GPIOModeOutput);
-    js_selector->Write(LOW);
-    circle_sleep(10);
-  }
-
-  int js_up = js_pins[JOY_UP]->Read();
-  int js_down = js_pins[JOY_DOWN]->Read();
-  int js_left = js_pins[JOY_LEFT]->Read();
-  int js_right = js_pins[JOY_RIGHT]->Read();
-  int js_fire = js_pins[JOY_FIRE]->Read();
-  int js_potx = gpioConfig == 2 ? js_pins[JOY_POTX]->Read() : HIGH;
-  int js_poty = gpioConfig == 2 ? js_pins[JOY_POTY]->Read() : HIGH;
-
-  if (ui_activated) {
-    if (js_up == LOW && js_prev[JOY_UP] != LOW) {
-      emu_ui_key_interrupt(KEYCODE_Up, 1);
-    } else if (js_up != LOW && js_prev[JOY_UP] == LOW) {
-      emu_ui_key_interrupt(KEYCODE_Up, 0);
-    }
-
-    if (js_down == LOW && js_prev[JOY_DOWN] != LOW) {
-      emu_ui_key_interrupt(KEYCODE_Down, 1);
-    } else if (js_down != LOW && js_prev[JOY_DOWN] == LOW) {
-      emu_ui_key_interrupt(KEYCODE_Down, 0);
-    }
-
-    if (js_left == LOW && js_prev[JOY_LEFT] != LOW) {
-      emu_ui_key_interrupt(KEYCODE_Left, 1);
-    } else if (js_left != LOW && js_prev[JOY_LEFT] == LOW) {
-      emu_ui_key_interrupt(KEYCODE_Left, 0);
-    }
-
-    if (js_right == LOW && js_prev[JOY_RIGHT] != LOW) {
-      emu_ui_key_interrupt(KEYCODE_Right, 1);
-    } else if (js_right != LOW && js_prev[JOY_RIGHT] == LOW) {
-      emu_ui_key_interrupt(KEYCODE_Right, 0);
-    }
-
-    if (js_fire == LOW && js_prev[JOY_FIRE] != LOW) {
-      emu_ui_key_interrupt(KEYCODE_Return, 1);
-    } else if (js_fire != LOW && js_prev[JOY_FIRE] == LOW) {
-      emu_ui_key_interrupt(KEYCODE_Return, 0);
-    }
-    js_prev[JOY_UP] = js_up;
-    js_prev[JOY_DOWN] = js_down;
-    js_prev[JOY_LEFT] = js_left;
-    js_prev[JOY_RIGHT] = js_right;
-    js_prev[JOY_FIRE] = js_fire;
-    // not necessary to remember pot values as they are not used for ui
-  } else {
-    emu_joy_interrupt_abs(port, devd,
-                          js_up == LOW,
-                          js_down == LOW,
-                          js_left == LOW,
-                          js_right == LOW,
-                          js_fire == LOW,
-                          js_potx == LOW,
-                          js_poty == LOW);
-  }
-
-  if (gpioConfig == 1) {
-     js_selector->SetMode(GPIOModeInputPullUp);
-  }
+void CKernel::ScanGPIO() {
+  mGPIOLock.Acquire();
+  mGPIOScanner.Scan(mGPIOScanConfig, mTimer.GetClockTicks());
+  mGPIOLock.Release();
 }
 
 void CKernel::ReadCustomGPIO() {
@@ -1110,45 +941,50 @@ void CKernel::ReadCustomGPIO() {
    }
 }
 
-// Configure user port DDR
-void CKernel::SetupUserport() {
-  // Unless enable_gpio_outputs is true, this will have no effect. Menu item
-  // should reflect this.
-  if (circle_gpio_outputs_enabled()) {
-    uint8_t ddr = circle_get_userport_ddr();
-    for (int i = 0; i < 8; i++) {
-      uint8_t bit_pos = 1<<i;
-      uint8_t ddr_value = ddr & bit_pos;
-      config_3_userportPins[i]->SetMode(ddr_value ? GPIOModeOutput : GPIOModeInputPullUp);
+// Drive the user port pins. Called by the userport bridge with the
+// emulated port state.
+void CKernel::WriteUserport(uint8_t value, uint8_t ddr) {
+  for (int i = 0; i < 8; i++) {
+    uint8_t bit_pos = 1<<i;
+    if ((ddr ^ mUserportDDR) & bit_pos) {
+      config_3_userportPins[i]->SetMode(
+          (ddr & bit_pos) ? GPIOModeOutput : GPIOModeInputPullUp);
+    }
+    if (ddr & bit_pos) {
+      config_3_userportPins[i]->Write((value & bit_pos) ? HIGH : LOW);
     }
   }
+  mUserportDDR = ddr;
 }
 
-// Read input pins and send to output pins
-void CKernel::ReadWriteUserport() {
-  // Unless enable_gpio_outputs is true, this will have no effect. Menu item
-  // should reflect this.
-  if (circle_gpio_outputs_enabled()) {
-    uint8_t ddr = circle_get_userport_ddr();
-    uint8_t value = circle_get_userport();
-    uint8_t new_value = 0;
-    for (int i = 0; i < 8; i++) {
-      uint8_t bit_pos = 1<<i;
-      uint8_t ddr_value = ddr & bit_pos;
-      uint8_t data_value = value & bit_pos;
-      if (ddr_value) {
-        // output bit
-        config_3_userportPins[i]->Write(data_value ? HIGH : LOW);
-        new_value |= data_value;
-      } else {
-        // input bit
-        if (config_3_userportPins[i]->Read() == HIGH) {
-          new_value |= bit_pos;
-        }
-      }
+uint8_t CKernel::ReadUserport() {
+  uint8_t value = 0;
+  for (int i = 0; i < 8; i++) {
+    if (config_3_userportPins[i]->Read() == HIGH) {
+      value |= 1<<i;
     }
-    circle_set_userport(new_value);
   }
+  return value;
+}
+
+static void userport_apply(uint8_t value, uint8_t ddr) {
+  static_kernel->WriteUserport(value, ddr);
+}
+
+static uint8_t userport_read(void) {
+  return static_kernel->ReadUserport();
+}
+
+static const struct userport_bridge_pins userport_pins = {
+  userport_apply, userport_read
+};
+
+// Replay queued user port writes and sample the inputs. If paced, writes
+// are held until their emulated time comes up.
+void CKernel::ServiceUserport(bool paced) {
+  mGPIOLock.Acquire();
+  userport_bridge_service(&userport_pins, mTimer.GetClockTicks(), paced);
+  mGPIOLock.Release();
 }
 
 void CKernel::circle_sleep(long delay) { mTimer.SimpleusDelay(delay); }
@@ -1373,8 +1209,9 @@ int CKernel::ReadDebounced(int pinIndex) {
 
 // Called from main emulation loop before pending event queues are
 // drained. Checks whether any of our gpio pins have triggered some
-// function. Also scans a real C64 keyboard and joysticks if enabled.
-// Otherwise, just scans gpio joysticks.
+// function. The fixed configs (nav buttons, real keyboard, joysticks)
+// are sampled by GPIOScanner, from core 0 on multi-core builds.
+// Custom configs and the userport are still handled here.
 void CKernel::circle_check_gpio() {
 
   // TODO: Find a better place for this. Piggy back on emulation loop
@@ -1392,81 +1229,32 @@ void CKernel::circle_check_gpio() {
 
   int gpio_config = emu_get_gpio_config();
 
+  if (GPIOScanner::Handles(gpio_config)) {
+    // The scanner only sees the config we hand it. Everything else it
+    // needs from the emulator is applied here by Dispatch.
+    mGPIOScanConfig = gpio_config;
+#ifdef ARM_ALLOW_MULTI_CORE
+    // Core 0 does the sampling. Let it start now that the emulator
+    // is ready to take events.
+    mGPIOScanReady = true;
+#else
+    ScanGPIO();
+#endif
+    mGPIOScanner.Dispatch(gpio_config);
+  }
+
   switch(gpio_config) {
-    case GPIO_CONFIG_NAV_JOY:
-     // Nav Buttons + Real Joys
-     if (ReadDebounced(GPIO_CONFIG_0_MENU_INDEX) == BTN_PRESS) {
-      emu_key_pressed(KEYCODE_F12);
-      emu_key_released(KEYCODE_F12);
-     }
-     if (ReadDebounced(GPIO_CONFIG_0_MENU_BACK_INDEX) == BTN_PRESS) {
-      emu_key_pressed(KEYCODE_Escape);
-      emu_key_released(KEYCODE_Escape);
-     }
-     if (ReadDebounced(GPIO_CONFIG_0_MENU_UP_INDEX) == BTN_PRESS) {
-      emu_key_pressed(KEYCODE_Up);
-      emu_key_released(KEYCODE_Up);
-     }
-     if (ReadDebounced(GPIO_CONFIG_0_MENU_DOWN_INDEX) == BTN_PRESS) {
-      emu_key_pressed(KEYCODE_Down);
-      emu_key_released(KEYCODE_Down);
-     }
-     if (ReadDebounced(GPIO_CONFIG_0_MENU_LEFT_INDEX) == BTN_PRESS) {
-      emu_key_pressed(KEYCODE_Left);
-      emu_key_released(KEYCODE_Left);
-     }
-     if (ReadDebounced(GPIO_CONFIG_0_MENU_RIGHT_INDEX) == BTN_PRESS) {
-      emu_key_pressed(KEYCODE_Right);
-      emu_key_released(KEYCODE_Right);
-     }
-     if (ReadDebounced(GPIO_CONFIG_0_MENU_ENTER_INDEX) == BTN_PRESS) {
-      emu_key_pressed(KEYCODE_Return);
-      emu_key_released(KEYCODE_Return);
-     }
-     if (ReadDebounced(GPIO_CONFIG_0_MENU_VKBD_INDEX) == BTN_PRESS) {
-      emu_quick_func_interrupt(BTN_ASSIGN_VKBD_TOGGLE);
-     }
-     ReadJoystick(0, GPIO_CONFIG_NAV_JOY);
-     ReadJoystick(1, GPIO_CONFIG_NAV_JOY);
-     break;
-    case GPIO_CONFIG_KYB_JOY:
-     // Real Kyb + Joys
-     ScanKeyboard();
-     ReadJoystick(0, GPIO_CONFIG_KYB_JOY);
-     ReadJoystick(1, GPIO_CONFIG_KYB_JOY);
-     break;
-    case GPIO_CONFIG_WAVESHARE:
-     // Waveshare Hat
-     if (ReadDebounced(GPIO_CONFIG_2_WAVESHARE_START_INDEX) == BTN_PRESS) {
-       emu_key_pressed(KEYCODE_F12);
-       emu_key_released(KEYCODE_F12);
-     }
-     if (ReadDebounced(GPIO_CONFIG_2_WAVESHARE_TL_INDEX) == BTN_PRESS) {
-       emu_key_pressed(KEYCODE_Escape);
-       emu_key_released(KEYCODE_Escape);
-     }
-     if (ReadDebounced(GPIO_CONFIG_2_WAVESHARE_TR_INDEX) == BTN_PRESS) {
-       emu_quick_func_interrupt(BTN_ASSIGN_WARP);
-     }
-     if (ReadDebounced(GPIO_CONFIG_2_WAVESHARE_X_INDEX) == BTN_PRESS) {
-       emu_quick_func_interrupt(BTN_ASSIGN_VKBD_TOGGLE);
-     }
-     if (ReadDebounced(GPIO_CONFIG_2_WAVESHARE_SELECT_INDEX) == BTN_PRESS) {
-       emu_quick_func_interrupt(BTN_ASSIGN_STATUS_TOGGLE);
-     }
-     ReadJoystick(0, GPIO_CONFIG_WAVESHARE);
-     break;
+#ifndef ARM_ALLOW_MULTI_CORE
     case GPIO_CONFIG_USERPORT:
-     SetupUserport();
-     ReadWriteUserport();
-     ReadJoystick(0, GPIO_CONFIG_USERPORT);
-     ReadJoystick(1, GPIO_CONFIG_USERPORT);
+     // Without a spare core, the user port only gets serviced once per
+     // frame.
+     ServiceUserport(false);
      break;
+#endif
     case GPIO_CONFIG_CUSTOM:
      ReadCustomGPIO();
      break;
     default:
-     // Disabled
      break;
   }
 }
@@ -1474,6 +1262,9 @@ void CKernel::circle_check_gpio() {
 // Reset the state of the GPIO pins.
 // Needed when switching to and from GPIO_CONFIG_USERPORT
 void CKernel::circle_reset_gpio(int gpio_config) {
+  // Don't pull pins out from under a scan in progress on core 0.
+  mGPIOLock.Acquire();
+  userport_bridge_enable(0, 0, 0xff, 0);
   switch (gpio_config) {
     case GPIO_CONFIG_NAV_JOY:
     case GPIO_CONFIG_KYB_JOY:
@@ -1490,12 +1281,22 @@ void CKernel::circle_reset_gpio(int gpio_config) {
         config_3_joystickPins1[i]->SetMode(GPIOModeInputPullUp);
         config_3_joystickPins2[i]->SetMode(GPIOModeInputPullUp);
       }
-      SetupUserport();
+      for (int i = 0; i < 8; i++) {
+        config_3_userportPins[i]->SetMode(GPIOModeInputPullUp);
+      }
+      mUserportDDR = 0;
+      // Unless enable_gpio_outputs is true, this will have no effect. Menu
+      // item should reflect this.
+      userport_bridge_enable(circle_gpio_outputs_enabled(),
+                             circle_cycles_per_second(),
+                             circle_get_userport(),
+                             circle_get_userport_ddr());
       break;
     default:
       // Disabled
       break;
   }
+  mGPIOLock.Release();
 }
 
 void CKernel::circle_lock_acquire() { m_Lock.Acquire(); }
@@ -1530,6 +1331,16 @@ void CKernel::circle_boot_complete() {
   DisableBootStat();
 }
 
+void CKernel::circle_boot_phase(const char *name) { BootPhase(name); }
+
+void CKernel::circle_prefetch_file(const char *path) {
+  CGlueStdioPrefetch(path);
+}
+
+int CKernel::circle_prefetch_step(unsigned max_bytes) {
+  return CGlueStdioPrefetchStep(max_bytes);
+}
+
 int CKernel::circle_alloc_fbl(int layer, int pixelmode, uint8_t **pixels,
                               int width, int height, int *pitch) {
   return fbl[layer].Allocate(pixelmode, pixels, width, height, pitch);
@@ -1539,6 +1350,10 @@ int CKernel::circle_realloc_fbl(int layer, int shader) {
   return fbl[layer].ReAllocate(shader);
 }
 
+int CKernel::circle_set_pal_filter_fbl(int layer, int enable) {
+  return fbl[layer].SetPALFilter(enable);
+}
+
 void CKernel::circle_free_fbl(int layer) {
   fbl[layer].Free();
 }
@@ -1628,6 +1443,18 @@ unsigned CKernel::circle_get_arm_clock() {
   return mMachineInfo.GetClockRate(CLOCK_ID_ARM);
 }
 
+void CKernel::circle_get_sd_cache_stats(struct sd_cache_stats *stats) {
+  TSDCacheStats cache;
+  mSDCache.GetStats(&cache);
+  stats->hits = cache.hits;
+  stats->misses = cache.misses;
+  stats->reads = cache.reads;
+  stats->prefetched = cache.prefetched;
+  stats->pinned = cache.pinned;
+  stats->used = cache.used;
+  stats->size = SD_CACHE_SECTORS;
+}
+
 int CKernel::circle_gpio_enabled() {
   // When DPI is enabled, GPIO scanning must be disabled.
   return mViceOptions.DPIEnabled() == 0;
@@ -1637,6 +1464,10 @@ int CKernel::circle_gpio_outputs_enabled() {
   return !mViceOptions.DPIEnabled() && mViceOptions.GPIOOutputsEnabled();
 }
 
+int CKernel::circle_instant_boot_enabled() {
+  return mViceOptions.InstantBootEnabled();
+}
+
 // Called by cores 1 and 2 after they are done initializing
 // sid tables.  Used to know whether volume should be set to
 // 0 or requested initial volume after boot.
@@ -1644,6 +1475,7 @@ void CKernel::circle_kernel_core_init_complete(int core) {
   circle_lock_acquire();
   mNumCoresComplete++;
   circle_lock_release();
+  BootPhase(core == 2 ? "core 2 sid tables" : "core 3 sid tables");
 }
 
 void CKernel::circle_get_fbl_dimensions(int layer,
@@ -38,13 +38,40 @@
 #include <vc4/vchiq/vchiqdevice.h>
 
 #include "fbl.h"
+#include "gpioscanner.h"
 
 extern "C" {
 #include "third_party/common/circle.h"
 #include "third_party/common/keycodes.h"
+#include "third_party/common/userport_bridge.h"
 #include "third_party/vice-3.3/src/main.h"
 }
 
+// How often core 0 samples the gpio pins (usec).
+#define GPIO_SCAN_INTERVAL_US 1000
+
+// GPIOScanner pin access backed by the master gpio array.
+class CircleGPIOPinIO : public GPIOPinIO {
+public:
+  CircleGPIOPinIO(CGPIOPin **pins) : mPins(pins) {}
+
+  int Read(int pinIndex) override { return mPins[pinIndex]->Read(); }
+
+  void DriveLow(int pinIndex) override {
+    mPins[pinIndex]->SetMode(GPIOModeOutput);
+    mPins[pinIndex]->Write(LOW);
+  }
+
+  void Release(int pinIndex) override {
+    mPins[pinIndex]->SetMode(GPIOModeInputPullUp);
+  }
+
+  void Settle(unsigned usec) override { CTimer::SimpleusDelay(usec); }
+
+private:
+  CGPIOPin **mPins;
+};
+
 class CKernel : public ViceStdioApp {
 public:
   CKernel(void);
@@ -73,6 +100,7 @@ public:
   int circle_alloc_fbl(int layer, int pixelmode, uint8_t **pixels,
                        int width, int height, int *pitch);
   int circle_realloc_fbl(int layer, int shader);
+  int circle_set_pal_filter_fbl(int layer, int enable);
   void circle_free_fbl(int layer);
   void circle_clear_fbl(int layer);
   void circle_show_fbl(int layer);
@@ -103,12 +131,17 @@ public:
   void circle_lock_acquire();
   void circle_lock_release();
   void circle_boot_complete();
+  void circle_boot_phase(const char *name);
+  void circle_prefetch_file(const char *path);
+  int circle_prefetch_step(unsigned max_bytes);
   void circle_set_volume(int value);
   int circle_get_model();
   int circle_gpio_enabled();
   int circle_gpio_outputs_enabled();
+  int circle_instant_boot_enabled();
   void circle_kernel_core_init_complete(int core);
   unsigned circle_get_arm_clock();
+  void circle_get_sd_cache_stats(struct sd_cache_stats *stats);
   void circle_get_fbl_dimensions(int layer, int *display_w, int *display_h,
                                  int *fb_w, int *fb_h,
                                  int *src_w, int *src_h,
@@ -118,6 +151,9 @@ public:
                                  int *sx, int *sy);
   void circle_set_interpolation(int enable);
   void circle_set_use_shader(int enable);
+  void WriteUserport(uint8_t value, uint8_t ddr);
+  uint8_t ReadUserport();
+
   void circle_set_shader_params(
 		    int curvature,
 			float curvature_x,
@@ -142,11 +178,9 @@ private:
   void SetupUSBMouse();
   void SetupUSBGamepads();
   int ReadDebounced(int pinIndex);
-  void ScanKeyboard();
-  void ReadJoystick(int device, int gpioConfig);
+  void ScanGPIO();
   void ReadCustomGPIO();
-  void SetupUserport();
-  void ReadWriteUserport();
+  void ServiceUserport(bool paced);
 
   ViceSound *mViceSound;
   CCPUThrottle mCPUThrottle;
@@ -162,6 +196,17 @@ private:
   // Used for custom gpio configs that have joy assignments
   int gpio_prev_state[NUM_GPIO_PINS];
 
+  // Held while pins are being scanned or reconfigured.
+  CSpinLock mGPIOLock;
+  volatile bool mGPIOScanReady;
+  // Config the scanner samples for. Set by the emulation core.
+  volatile int mGPIOScanConfig;
+  CircleGPIOPinIO mGPIOPinIO;
+  GPIOScanner mGPIOScanner;
+
+  // Pins currently configured as user port outputs.
+  uint8_t mUserportDDR;
+
   FrameBufferLayer fbl[FB_NUM_LAYERS];
 };
 
@@ -3,6 +3,7 @@
 #include <_syslist.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <stdint.h>
 #include <string.h>
 #include <sys/dirent.h>
 #include <sys/stat.h>
@@ -17,6 +18,8 @@ extern int errno;
 #include <malloc.h>
 #include <sys/unistd.h>
 #include <circle/serial.h>
+#include <circle/spinlock.h>
+#include <circle/timer.h>
 
 #include <ff.h>
 
@@ -50,14 +53,61 @@ extern int errno;
 // When a file is opened for READ_WRITE, fat fs is used to
 // immediately load the contents of the existing file into ram.
 // The input fat fs file is immediatly closed in this case.
-// Writes & seeks use the ram copy. Only when the file is closed
-// will the fatfs system be used to create a new file from the ram.
+// Writes & seeks use the ram copy. Writes mark the sectors they touch
+// dirty. When the file is closed, only the dirty sectors are written
+// back in place, so the file is never truncated and a power loss can at
+// worst leave a mix of old and new sectors. With the write journal
+// enabled, the dirty sectors are first saved to a journal file which is
+// replayed on the next boot if the write back did not complete.
 // Again, seeking past the file's current length is not supported.
+//
+// While booting, the result of every open and stat is recorded in a
+// boot manifest together with the time it took. On later boots the
+// manifest answers the same opens and stats without going to the card,
+// and the files that were read, as many as the read cache (see below)
+// holds, are preloaded in one sequential pass, each checked against the
+// size and checksum that were recorded. The same pass stats every path
+// recorded as missing or as a directory. If anything doesn't match, the
+// manifest is deleted and recorded again on the next boot. The preload
+// runs on core 0 while the emulator core is already initializing; calls
+// that take a path wait until it is done.
+//
+// Slurped READ ONLY files up to READ_CACHE_MAX_FILE bytes are kept in a
+// small cache after they are closed, so ROMs and images that get loaded
+// again (machine reset, drive type change, image probing) don't go back
+// to the card. Handles of the same file share one copy. Opening a file
+// for writing, renaming or unlinking it drops it from the cache.
+//
+// Files up to PREFETCH_MAX_FILE bytes can be put in the read cache
+// ahead of time with CGlueStdioPrefetch. They are read a slice at a time
+// by CGlueStdioPrefetchStep so the emulator core can do it between
+// frames.
+// Opening a prefetched file O_RDWR takes its buffer out of the cache
+// instead of reading the card again.
 
 #define MAX_OPEN_FILES 10
 #define MAX_OPEN_DIRS 10
 #define READ_BUF_SIZE 1024
 
+#define READ_CACHE_ENTRIES 16
+#define READ_CACHE_MAX_FILE (256 * 1024)
+#define READ_CACHE_MAX_TOTAL (2 * 1024 * 1024)
+// Prefetched files are disk images about to be attached, so they may
+// be bigger. This fits a D81.
+#define PREFETCH_MAX_FILE (1024 * 1024)
+
+// Granularity of dirty tracking for O_RDWR files.
+#define DIRTY_SECTOR_SIZE 512
+
+// Only files on the default volume are journaled since the journal has
+// to be replayed before any other volume is mounted.
+#define JOURNAL_PATH "/bmc64.jnl"
+#define JOURNAL_MAGIC 0x4a434d42 // BMCJ
+#define JOURNAL_VERSION 1
+
+#define MANIFEST_MAX_ENTRIES 128
+#define MANIFEST_HASH_SIZE 256 // power of 2, > MANIFEST_MAX_ENTRIES
+
 static const char *pattern = "*";
 
 static char currentDir[256];
@@ -124,6 +174,20 @@ static void logi(int i) {
    }
 }
 
+// Told when fatfs is about to walk directories (1) and when it's done
+// (0) so the block layer below can tell directory sectors from file data.
+static void (*g_metadataHook)(int);
+
+void CGlueStdioSetMetadataHook(void (*hook)(int)) {
+   g_metadataHook = hook;
+}
+
+static void metadata_hint(int metadata) {
+   if (g_metadataHook) {
+      g_metadataHook(metadata);
+   }
+}
+
 struct CirclePath {
    CirclePath(const char* p) {
       path[0] = '\0';
@@ -171,7 +235,6 @@ struct CircleFile {
   int in_use;
   char fname[256];
 
-  char readBuf[READ_BUF_SIZE]; // tmp read buffer
   char *contents; // bytes for file in memory
   int allocated; // total bytes allocated for in memory file
   unsigned size; // total size of file in memory file
@@ -179,6 +242,36 @@ struct CircleFile {
   int mode; // remembers mode this file was opened under
   int written_to; // at least one write was performed on this file
   int fopen_called; // f_open was called and thus f_close needs to be called
+  unsigned char *dirty; // one bit per DIRTY_SECTOR_SIZE bytes of contents
+  unsigned dirty_len; // bytes allocated for dirty
+  int cached; // contents belong to this read cache entry, -1 if none
+  int traced; // boot manifest entry being recorded, -1 if none
+};
+
+struct CachedFile {
+  char fname[256];
+  char *contents; // nullptr if the entry is free
+  unsigned size;
+  int refs; // open handles using contents
+  int stale; // dropped from the cache, free once refs is 0
+  unsigned last_use;
+};
+
+// The journal file is a header followed by num_runs runs, each a
+// JournalRun followed by len bytes of data. The header is rewritten
+// with committed set once everything else is on the card.
+struct JournalHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t committed;
+  uint32_t num_runs;
+  uint32_t checksum; // of all runs including their data
+  char fname[256];
+};
+
+struct JournalRun {
+  uint32_t offset;
+  uint32_t len;
 };
 
 struct CircleDir {
@@ -194,7 +287,73 @@ struct CircleDir {
   struct dirent mEntry;
 };
 
+enum {
+  MANIFEST_OFF,
+  MANIFEST_RECORD,
+  MANIFEST_REPLAY,
+};
+
+enum {
+  MANIFEST_FILE,
+  MANIFEST_DIR,
+  MANIFEST_MISSING,
+  MANIFEST_DROPPED, // changed during boot, always ask the card
+};
+
+struct ManifestEntry {
+  char path[256];
+  int what;
+  unsigned size;
+  unsigned long mtime;
+  int cached; // read cache entry pinned while replaying, -1 if none
+
+  // Only used while recording.
+  unsigned ops;
+  unsigned ticks;
+  unsigned read_bytes;
+};
+
 CircleFile fileTab[MAX_OPEN_FILES];
+static CachedFile readCache[READ_CACHE_ENTRIES];
+static unsigned readCacheTotal;
+static unsigned readCacheClock;
+
+// Files waiting for CGlueStdioPrefetchStep. The first one is being read
+// once prefetchContents is set.
+#define PREFETCH_QUEUE 4
+static char prefetchQueue[PREFETCH_QUEUE][256];
+static int prefetchNum;
+static FIL prefetchFile;
+static char *prefetchContents;
+static unsigned prefetchSize;
+static unsigned prefetchPos;
+
+static int g_manifestMode = MANIFEST_OFF;
+static char g_manifestPath[256];
+static int g_manifestStale;
+// Boot is over but the manifest on the card still says which files
+// were missing. Creating one of them makes it wrong.
+static int g_manifestWatch;
+static ManifestEntry g_manifest[MANIFEST_MAX_ENTRIES];
+static int g_manifestNum;
+static short g_manifestHash[MANIFEST_HASH_SIZE]; // entry + 1, 0 if empty
+// Set while the boot manifest is loaded on another core, which holds
+// bootPreloadLock for as long.
+static volatile int g_bootPreloading;
+static CSpinLock bootPreloadLock(TASK_LEVEL);
+
+static const char *const manifestWhat[] = { "file", "dir", "missing" };
+
+static uint32_t fnv1a(uint32_t h, const void *buf, unsigned len) {
+  // FNV-1a
+  const unsigned char *p = (const unsigned char *)buf;
+  for (unsigned i = 0; i < len; i++) {
+    h ^= p[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
 CircleDir dirTab[MAX_OPEN_DIRS];
 
 static const char* const VolumeStr[FF_VOLUMES] = {FF_VOLUME_STRS};
@@ -217,21 +376,7 @@ void CGlueStdioInit(CSerialDevice *serial) {
   strcpy (currentDir, "/");
 }
 
-static int g_bootStatNum = 0;
-static int *g_bootStatWhat;
-static const char **g_bootStatFile;
-static int *g_bootStatSize;
-
-// Set global vars pointing to bootstat info
-void CGlueStdioInitBootStat (int num,
-        int *bootStatWhat,
-        const char **bootStatFile,
-        int *bootStatSize) {
-   g_bootStatNum = num;
-   g_bootStatWhat = bootStatWhat;
-   g_bootStatFile = bootStatFile;
-   g_bootStatSize = bootStatSize;
-}
+static int g_journalEnabled = 0;
 
 void CGlueStdioSetPartitionForVolume (const char* volume, int part, unsigned int ss) {
   for (int pd = 0; pd < FF_VOLUMES; pd++) {
@@ -244,6 +389,10 @@ void CGlueStdioSetPartitionForVolume (const char* volume, int part, unsigned int
   }
 }
 
+void CGlueStdioEnableJournal(int enable) {
+  g_journalEnabled = enable;
+}
+
 static int FindFreeFileSlot(void) {
   int slotNr = -1;
 
@@ -288,48 +437,893 @@ static CircleDir *FindCircleDirFromDIR(DIR *dir) {
   return nullptr;
 }
 
+static void cache_free_entry(CachedFile &entry) {
+  free(entry.contents);
+  readCacheTotal -= entry.size;
+  entry.contents = nullptr;
+  entry.fname[0] = '\0';
+  entry.size = 0;
+  entry.refs = 0;
+  entry.stale = 0;
+}
+
+static ManifestEntry *manifest_find(const char *path, int create) {
+  uint32_t h = fnv1a(2166136261u, path, strlen(path));
+  for (unsigned i = 0; i < MANIFEST_HASH_SIZE; i++) {
+    unsigned slot = (h + i) & (MANIFEST_HASH_SIZE - 1);
+    int index = g_manifestHash[slot];
+    if (index == 0) {
+      if (!create || g_manifestNum == MANIFEST_MAX_ENTRIES ||
+          strlen(path) >= sizeof(g_manifest[0].path)) {
+        return nullptr;
+      }
+      ManifestEntry &entry = g_manifest[g_manifestNum];
+      memset(&entry, 0, sizeof(entry));
+      strcpy(entry.path, path);
+      entry.what = MANIFEST_MISSING;
+      entry.cached = -1;
+      g_manifestHash[slot] = ++g_manifestNum;
+      return &entry;
+    }
+    if (strcmp(g_manifest[index - 1].path, path) == 0) {
+      return &g_manifest[index - 1];
+    }
+  }
+  return nullptr;
+}
+
+static void manifest_unpin(ManifestEntry &entry) {
+  if (entry.cached >= 0) {
+    CachedFile &cached = readCache[entry.cached];
+    cached.refs--;
+    if (cached.stale && cached.refs == 0) {
+      cache_free_entry(cached);
+    }
+    entry.cached = -1;
+  }
+}
+
+static void manifest_reset(void) {
+  for (int i = 0; i < g_manifestNum; i++) {
+    manifest_unpin(g_manifest[i]);
+  }
+  g_manifestNum = 0;
+  g_manifestStale = 0;
+  g_manifestWatch = 0;
+  memset(g_manifestHash, 0, sizeof(g_manifestHash));
+}
+
+// The recorded answer for path would be wrong from now on.
+static void manifest_drop(const char *path) {
+  if (g_manifestMode == MANIFEST_OFF) {
+    if (g_manifestWatch) {
+      ManifestEntry *entry = manifest_find(path, 0);
+      if (entry && entry->what == MANIFEST_MISSING) {
+        logm("Boot manifest is stale\r\n");
+        f_unlink(g_manifestPath);
+        manifest_reset();
+      }
+    }
+    return;
+  }
+  ManifestEntry *entry = manifest_find(path, g_manifestMode == MANIFEST_RECORD);
+  if (entry) {
+    if (g_manifestMode == MANIFEST_REPLAY && entry->what == MANIFEST_MISSING) {
+      // Nothing on the card would tell the next boot.
+      g_manifestStale = 1;
+    }
+    manifest_unpin(*entry);
+    entry->what = MANIFEST_DROPPED;
+  }
+}
+
+// Records the time an operation on entry took while recording.
+static void manifest_trace(ManifestEntry *entry, unsigned start,
+                           unsigned read_bytes) {
+  if (entry) {
+    entry->ops++;
+    entry->ticks += CTimer::GetClockTicks() - start;
+    entry->read_bytes += read_bytes;
+  }
+}
+
+static void prefetch_remove(int i) {
+  if (i == 0 && prefetchContents) {
+    f_close(&prefetchFile);
+    free(prefetchContents);
+    prefetchContents = nullptr;
+  }
+  prefetchNum--;
+  memmove(prefetchQueue[i], prefetchQueue[i + 1],
+          (prefetchNum - i) * sizeof(prefetchQueue[0]));
+}
+
+// The file is about to change. Entries still in use keep their
+// contents until the last handle is closed.
+static void cache_drop(const char *fname) {
+  manifest_drop(fname);
+  for (int i = prefetchNum - 1; i >= 0; i--) {
+    if (strcmp(prefetchQueue[i], fname) == 0) {
+      prefetch_remove(i);
+    }
+  }
+  for (CachedFile &entry : readCache) {
+    if (entry.contents && !entry.stale && strcmp(entry.fname, fname) == 0) {
+      if (entry.refs) {
+        entry.stale = 1;
+      } else {
+        cache_free_entry(entry);
+      }
+    }
+  }
+}
+
+static int cache_lookup(const char *fname, unsigned size) {
+  for (CachedFile &entry : readCache) {
+    if (entry.contents && !entry.stale && entry.size == size &&
+        strcmp(entry.fname, fname) == 0) {
+      return &entry - readCache;
+    }
+  }
+  return -1;
+}
+
+// Takes ownership of contents if it is no bigger than max_size and
+// there is room. Returns the entry or -1.
+static int cache_insert(const char *fname, char *contents, unsigned size,
+                        unsigned max_size) {
+  if (size == 0 || size > max_size) {
+    return -1;
+  }
+
+  while (true) {
+    CachedFile *free_entry = nullptr;
+    CachedFile *lru = nullptr;
+    for (CachedFile &entry : readCache) {
+      if (entry.contents == nullptr) {
+        free_entry = &entry;
+      } else if (entry.refs == 0 &&
+                 (lru == nullptr || entry.last_use < lru->last_use)) {
+        lru = &entry;
+      }
+    }
+
+    if (free_entry && readCacheTotal + size <= READ_CACHE_MAX_TOTAL) {
+      strcpy(free_entry->fname, fname);
+      free_entry->contents = contents;
+      free_entry->size = size;
+      free_entry->refs = 0;
+      free_entry->stale = 0;
+      readCacheTotal += size;
+      return free_entry - readCache;
+    }
+
+    if (lru == nullptr) {
+      return -1;
+    }
+    cache_free_entry(*lru);
+  }
+}
+
+// Takes fname out of the cache if no handle is using it. The caller
+// owns the returned contents.
+static char *cache_claim(const char *fname, unsigned *size) {
+  for (CachedFile &entry : readCache) {
+    if (entry.contents && !entry.stale && entry.refs == 0 &&
+        strcmp(entry.fname, fname) == 0) {
+      char *contents = entry.contents;
+      *size = entry.size;
+      entry.contents = nullptr;
+      cache_free_entry(entry);
+      return contents;
+    }
+  }
+  return nullptr;
+}
+
 // Returns non zero value on any failure. Any memory will be
 // freed on error and file.contents nulled.
 static int slurp_file(CircleFile &file) {
   if (file.contents == nullptr) {
     // Read the entire contents of the file into memory.
     file.size = 0;
-    unsigned total = 0;
+    unsigned size = f_size(&file.file);
+
+    if (file.mode == O_RDONLY) {
+      int cached = cache_lookup(file.fname, size);
+      if (cached >= 0) {
+        readCache[cached].refs++;
+        readCache[cached].last_use = ++readCacheClock;
+        file.cached = cached;
+        file.contents = readCache[cached].contents;
+        file.size = size;
+        file.allocated = size;
+        return 0;
+      }
+    }
+
+    if (size == 0) {
+      return 0;
+    }
+
     if (f_lseek(&file.file, 0) != FR_OK) {
        return -1;
     }
-    while (true) {
-      unsigned int num_read;
-      if (f_read(&file.file, file.readBuf, READ_BUF_SIZE, &num_read) != FR_OK) {
-        if (file.contents) {
-           free(file.contents);
-           file.contents = nullptr;
-        }  
-        return -1;
+
+    // Room for the whole file up front so we can read straight into it
+    // with one request. fatfs transfers whole sectors directly into the
+    // buffer without going through its own sector buffer.
+    file.allocated = size < READ_BUF_SIZE ? READ_BUF_SIZE : size;
+    file.contents = (char *)malloc(file.allocated);
+    if (file.contents == nullptr) {
+      file.allocated = 0;
+      return -1;
+    }
+
+    unsigned int num_read;
+    if (f_read(&file.file, file.contents, size, &num_read) != FR_OK) {
+      free(file.contents);
+      file.contents = nullptr;
+      file.allocated = 0;
+      return -1;
+    }
+    file.size = num_read;
+
+    if (file.mode == O_RDONLY && num_read == size) {
+      int cached = cache_insert(file.fname, file.contents, size,
+                                READ_CACHE_MAX_FILE);
+      if (cached >= 0) {
+        readCache[cached].refs = 1;
+        readCache[cached].last_use = ++readCacheClock;
+        file.cached = cached;
       }
+    }
+  }
+  return 0;
+}
+
+// Marks the sectors of [start, start+len) dirty. The bitmap grows with
+// the file.
+static int mark_dirty(CircleFile &file, unsigned start, unsigned len) {
+  if (len == 0) {
+    return 0;
+  }
+
+  unsigned first = start / DIRTY_SECTOR_SIZE;
+  unsigned last = (start + len - 1) / DIRTY_SECTOR_SIZE;
+  unsigned need = last / 8 + 1;
+  if (need > file.dirty_len) {
+    unsigned dirty_len = file.dirty_len ? file.dirty_len : 64;
+    while (dirty_len < need) {
+      dirty_len *= 2;
+    }
+    unsigned char *dirty = (unsigned char *)realloc(file.dirty, dirty_len);
+    if (dirty == nullptr) {
+      return -1;
+    }
+    memset(dirty + file.dirty_len, 0, dirty_len - file.dirty_len);
+    file.dirty = dirty;
+    file.dirty_len = dirty_len;
+  }
+
+  for (unsigned i = first; i <= last; i++) {
+    file.dirty[i / 8] |= 1 << (i & 7);
+  }
+  return 0;
+}
+
+// Finds the next run of dirty sectors at or after sector. Returns zero
+// once there are no more.
+static int next_dirty_run(CircleFile &file, unsigned *sector,
+                          unsigned *offset, unsigned *len) {
+  unsigned num_sectors = (file.size + DIRTY_SECTOR_SIZE - 1) / DIRTY_SECTOR_SIZE;
+  if (num_sectors > file.dirty_len * 8) {
+    num_sectors = file.dirty_len * 8;
+  }
+
+  unsigned i = *sector;
+  while (i < num_sectors && !(file.dirty[i / 8] & (1 << (i & 7)))) {
+    i++;
+  }
+  if (i >= num_sectors) {
+    return 0;
+  }
+
+  unsigned end = i;
+  while (end < num_sectors && (file.dirty[end / 8] & (1 << (end & 7)))) {
+    end++;
+  }
+
+  *offset = i * DIRTY_SECTOR_SIZE;
+  *len = end * DIRTY_SECTOR_SIZE;
+  if (*len > file.size) {
+    *len = file.size;
+  }
+  *len -= *offset;
+  *sector = end;
+  return 1;
+}
+
+static int write_fully(FIL *fil, const void *buf, unsigned len) {
+  unsigned int num_written;
+  if (f_write(fil, buf, len, &num_written) != FR_OK || num_written != len) {
+    return -1;
+  }
+  return 0;
+}
+
+// Saves the dirty runs of file to the journal. The journal only counts
+// once its header says committed.
+static int write_journal(CircleFile &file) {
+  FIL jnl;
+  if (f_open(&jnl, JOURNAL_PATH, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK) {
+    return -1;
+  }
+
+  JournalHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic = JOURNAL_MAGIC;
+  header.version = JOURNAL_VERSION;
+  strcpy(header.fname, file.fname);
+  uint32_t h = 2166136261u;
+
+  int err = write_fully(&jnl, &header, sizeof(header));
+
+  unsigned sector = 0;
+  JournalRun run;
+  while (!err && next_dirty_run(file, &sector, &run.offset, &run.len)) {
+    err = write_fully(&jnl, &run, sizeof(run)) ||
+          write_fully(&jnl, file.contents + run.offset, run.len);
+    h = fnv1a(h, &run, sizeof(run));
+    h = fnv1a(h, file.contents + run.offset, run.len);
+    header.num_runs++;
+  }
+
+  if (!err) {
+    err = f_sync(&jnl) != FR_OK;
+  }
+
+  if (!err) {
+    header.committed = 1;
+    header.checksum = h;
+    err = f_lseek(&jnl, 0) != FR_OK ||
+          write_fully(&jnl, &header, sizeof(header));
+  }
+
+  if (f_close(&jnl) != FR_OK) {
+    err = 1;
+  }
+
+  if (err) {
+    f_unlink(JOURNAL_PATH);
+    return -1;
+  }
+  return 0;
+}
+
+// Writes the dirty sectors of an O_RDWR file back in place. Falls back
+// to rewriting the whole file if it can't be opened anymore.
+static int write_back(CircleFile &file) {
+  int journaled = g_journalEnabled && strchr(file.fname, ':') == nullptr &&
+                  write_journal(file) == 0;
+
+  int err = 0;
+  if (f_open(&file.file, file.fname, FA_WRITE | FA_OPEN_EXISTING) == FR_OK) {
+    unsigned sector = 0;
+    unsigned offset;
+    unsigned len;
+    while (!err && next_dirty_run(file, &sector, &offset, &len)) {
+      err = f_lseek(&file.file, offset) != FR_OK ||
+            write_fully(&file.file, file.contents + offset, len);
+    }
+  } else if (f_open(&file.file, file.fname,
+                    FA_WRITE | FA_CREATE_ALWAYS) == FR_OK) {
+    err = write_fully(&file.file, file.contents, file.size);
+  } else {
+    return -1;
+  }
+
+  if (f_close(&file.file) != FR_OK) {
+    err = 1;
+  }
+
+  // On failure the journal stays around to be replayed on the next boot.
+  if (journaled && !err) {
+    f_unlink(JOURNAL_PATH);
+  }
+  return err ? -1 : 0;
+}
+
+// Finishes a write back that was interrupted, e.g. by a power loss.
+// Must be called after the default volume is mounted but before any
+// file is opened for writing.
+void CGlueStdioReplayJournal(void) {
+  FIL jnl;
+  if (f_open(&jnl, JOURNAL_PATH, FA_READ) != FR_OK) {
+    return;
+  }
 
-      if (num_read == 0) {
-        break;
+  JournalHeader header;
+  unsigned int num_read;
+  int valid = f_read(&jnl, &header, sizeof(header), &num_read) == FR_OK &&
+              num_read == sizeof(header) &&
+              header.magic == JOURNAL_MAGIC &&
+              header.version == JOURNAL_VERSION && header.committed &&
+              memchr(header.fname, '\0', sizeof(header.fname)) != nullptr;
+
+  // Verify everything before touching the target file.
+  uint32_t h = 2166136261u;
+  for (uint32_t i = 0; valid && i < header.num_runs; i++) {
+    JournalRun run;
+    valid = f_read(&jnl, &run, sizeof(run), &num_read) == FR_OK &&
+            num_read == sizeof(run);
+    h = fnv1a(h, &run, sizeof(run));
+    for (uint32_t done = 0; valid && done < run.len; done += num_read) {
+      char buf[READ_BUF_SIZE];
+      unsigned chunk = run.len - done;
+      if (chunk > READ_BUF_SIZE) {
+        chunk = READ_BUF_SIZE;
       }
-      
-      if (file.contents == nullptr) {
-        file.allocated = READ_BUF_SIZE;
-        file.contents = (char *)malloc(file.allocated);
-      } else if (file.allocated < total + num_read) {
-        file.allocated *= 2;
-        file.contents = (char *)realloc(file.contents, file.allocated);
+      valid = f_read(&jnl, buf, chunk, &num_read) == FR_OK &&
+              num_read == chunk;
+      h = fnv1a(h, buf, chunk);
+    }
+  }
+  valid = valid && h == header.checksum;
+
+  if (!valid) {
+    // Never committed, or damaged. Nothing in it can be replayed.
+    f_close(&jnl);
+    f_unlink(JOURNAL_PATH);
+    return;
+  }
+
+  logm("Replaying write journal for ");
+  logm(header.fname);
+  logm("\r\n");
+
+  FIL target;
+  int err = f_lseek(&jnl, sizeof(header)) != FR_OK ||
+            f_open(&target, header.fname, FA_WRITE | FA_OPEN_ALWAYS) != FR_OK;
+  if (!err) {
+    for (uint32_t i = 0; !err && i < header.num_runs; i++) {
+      JournalRun run;
+      err = f_read(&jnl, &run, sizeof(run), &num_read) != FR_OK ||
+            num_read != sizeof(run) ||
+            f_lseek(&target, run.offset) != FR_OK;
+      for (uint32_t done = 0; !err && done < run.len; done += num_read) {
+        char buf[READ_BUF_SIZE];
+        unsigned chunk = run.len - done;
+        if (chunk > READ_BUF_SIZE) {
+          chunk = READ_BUF_SIZE;
+        }
+        err = f_read(&jnl, buf, chunk, &num_read) != FR_OK ||
+              num_read != chunk ||
+              write_fully(&target, buf, chunk);
       }
+    }
+    if (!err) {
+      err = f_sync(&target) != FR_OK;
+    }
+    if (f_close(&target) != FR_OK) {
+      err = 1;
+    }
+  }
+
+  f_close(&jnl);
+  // Only done with the journal once all of it is on the card. Otherwise
+  // it is replayed again on the next boot.
+  if (err) {
+    logm("Write journal replay failed\r\n");
+  } else {
+    f_unlink(JOURNAL_PATH);
+  }
+}
 
-      memcpy(file.contents + total, file.readBuf, num_read);
-      total += num_read;
-      file.size = total;
+// Reads all of path into a new buffer. Returns nullptr on failure or if
+// the size isn't the expected one.
+static char *read_whole_file(const char *path, unsigned expected_size) {
+  FIL fil;
+  if (f_open(&fil, path, FA_READ) != FR_OK) {
+    return nullptr;
+  }
+
+  char *buf = nullptr;
+  unsigned int num_read;
+  if (f_size(&fil) == expected_size && expected_size > 0) {
+    buf = (char *)malloc(expected_size);
+    if (buf && (f_read(&fil, buf, expected_size, &num_read) != FR_OK ||
+                num_read != expected_size)) {
+      free(buf);
+      buf = nullptr;
+    }
+  }
+  f_close(&fil);
+  return buf;
+}
+
+// Between these two calls, file calls from other cores wait. The calling
+// core is the only one allowed to touch files. Must be called before the
+// other cores are let near a file.
+void CGlueStdioBeginBootPreload(void) {
+  bootPreloadLock.Acquire();
+  g_bootPreloading = 1;
+}
+
+void CGlueStdioEndBootPreload(void) {
+  // Release orders everything the preload wrote before the flag.
+  bootPreloadLock.Release();
+  g_bootPreloading = 0;
+}
+
+static void boot_preload_wait(void) {
+  if (g_bootPreloading) {
+    bootPreloadLock.Acquire();
+    bootPreloadLock.Release();
+  }
+  __sync_synchronize();
+}
+
+// Queues path to be read into the read cache.
+void CGlueStdioPrefetch(const char *path) {
+  CirclePath circlePath(path);
+  if (circlePath.path[0] == '\0') {
+    return;
+  }
+  for (int i = 0; i < prefetchNum; i++) {
+    if (strcmp(prefetchQueue[i], circlePath.path) == 0) {
+      return;
+    }
+  }
+  if (prefetchNum == PREFETCH_QUEUE) {
+    // Make room by dropping the oldest one not being read yet.
+    prefetch_remove(prefetchNum > 1 ? 1 : 0);
+  }
+  strcpy(prefetchQueue[prefetchNum++], circlePath.path);
+}
+
+// Whether a handle open for writing could change fname behind the cache.
+static int open_for_writing(const char *fname) {
+  for (CircleFile &file : fileTab) {
+    if (file.in_use && file.mode != O_RDONLY &&
+        strcmp(file.fname, fname) == 0) {
+      return 1;
     }
   }
   return 0;
 }
 
+// Reads up to max_bytes of the queued files. Returns non-zero while
+// there is more to do.
+int CGlueStdioPrefetchStep(unsigned max_bytes) {
+  boot_preload_wait();
+  while (prefetchNum > 0 && max_bytes > 0) {
+    const char *fname = prefetchQueue[0];
+    if (prefetchContents == nullptr) {
+      if (open_for_writing(fname) ||
+          f_open(&prefetchFile, fname, FA_READ) != FR_OK) {
+        prefetch_remove(0);
+        continue;
+      }
+      prefetchSize = f_size(&prefetchFile);
+      prefetchPos = 0;
+      if (prefetchSize > 0 && prefetchSize <= PREFETCH_MAX_FILE &&
+          cache_lookup(fname, prefetchSize) < 0) {
+        prefetchContents = (char *)malloc(prefetchSize);
+      }
+      if (prefetchContents == nullptr) {
+        f_close(&prefetchFile);
+        prefetch_remove(0);
+        continue;
+      }
+    }
+
+    unsigned len = prefetchSize - prefetchPos;
+    if (len > max_bytes) {
+      len = max_bytes;
+    }
+    unsigned int num_read;
+    if (f_read(&prefetchFile, prefetchContents + prefetchPos, len,
+               &num_read) != FR_OK || num_read != len) {
+      prefetch_remove(0);
+      continue;
+    }
+    prefetchPos += len;
+    max_bytes -= len;
+
+    if (prefetchPos == prefetchSize) {
+      f_close(&prefetchFile);
+      int cached = cache_insert(fname, prefetchContents, prefetchSize,
+                                PREFETCH_MAX_FILE);
+      if (cached >= 0) {
+        readCache[cached].last_use = ++readCacheClock;
+      } else {
+        free(prefetchContents);
+      }
+      prefetchContents = nullptr;
+      prefetch_remove(0);
+    }
+  }
+  return prefetchNum > 0;
+}
+
+// FAT timestamps have no timezone and 2 second resolution. Treat them as
+// UTC since we have no RTC anyway.
+static time_t fat_time_to_time_t(WORD fdate, WORD ftime) {
+  static const int days_before_month[12] =
+     { 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334 };
+  int year = 1980 + ((fdate >> 9) & 0x7f);
+  int month = (fdate >> 5) & 0xf;
+  int day = fdate & 0x1f;
+  if (month < 1 || month > 12 || day < 1) {
+    return 0;
+  }
+
+  long days = (year - 1970) * 365 + (year - 1969) / 4;
+  days += days_before_month[month - 1] + day - 1;
+  if (month > 2 && (year % 4) == 0) {
+    days++;
+  }
+  return (time_t)days * 86400 + ((ftime >> 11) & 0x1f) * 3600 +
+         ((ftime >> 5) & 0x3f) * 60 + (ftime & 0x1f) * 2;
+}
+
+// Loads the manifest at path and preloads the files it lists. Returns
+// zero if there is no usable manifest.
+int CGlueStdioLoadBootManifest(const char *path) {
+  manifest_reset();
+  g_manifestMode = MANIFEST_OFF;
+
+  FIL fil;
+  if (f_open(&fil, path, FA_READ) != FR_OK) {
+    return 0;
+  }
+  unsigned size = f_size(&fil);
+  char *text = (char *)malloc(size + 1);
+  unsigned int num_read = 0;
+  if (text && f_read(&fil, text, size, &num_read) != FR_OK) {
+    num_read = 0;
+  }
+  f_close(&fil);
+  if (text == nullptr || num_read != size) {
+    free(text);
+    return 0;
+  }
+  text[size] = '\0';
+
+  strcpy(g_manifestPath, path);
+  g_manifestMode = MANIFEST_REPLAY;
+
+  // Fields are what,size,mtime,checksum,path. The path goes last since
+  // it may contain commas.
+  int loaded = 0;
+  int preloaded = 0;
+  unsigned preloaded_bytes = 0;
+  char *line = text;
+  while (line && *line) {
+    char *eol = strchr(line, '\n');
+    if (eol) {
+      *eol++ = '\0';
+    }
+
+    char what_str[16];
+    unsigned file_size;
+    unsigned long mtime;
+    unsigned long checksum;
+    int path_pos;
+    if (line[0] == '#' ||
+        sscanf(line, "%15[^,],%u,%lu,%lx,%n", what_str, &file_size, &mtime,
+               &checksum, &path_pos) != 4) {
+      line = eol;
+      continue;
+    }
+
+    int what = -1;
+    for (int i = 0; i < 3; i++) {
+      if (strcmp(what_str, manifestWhat[i]) == 0) {
+        what = i;
+      }
+    }
+    char *file_path = line + path_pos;
+    if (what < 0 || manifest_find(file_path, 0) != nullptr) {
+      line = eol;
+      continue;
+    }
+
+    int cached = -1;
+    if (what == MANIFEST_FILE) {
+      // Preloaded files stay pinned until boot is over. Whatever doesn't
+      // fit in the cache is left to the card.
+      if (preloaded == READ_CACHE_ENTRIES || file_size > READ_CACHE_MAX_FILE ||
+          preloaded_bytes + file_size > READ_CACHE_MAX_TOTAL) {
+        line = eol;
+        continue;
+      }
+
+      // Preload, making sure the file is still what it was.
+      char *contents = read_whole_file(file_path, file_size);
+      if (contents == nullptr ||
+          fnv1a(2166136261u, contents, file_size) != checksum) {
+        free(contents);
+        g_manifestStale = 1;
+        line = eol;
+        continue;
+      }
+      cached = cache_insert(file_path, contents, file_size,
+                            READ_CACHE_MAX_FILE);
+      if (cached < 0) {
+        free(contents);
+        line = eol;
+        continue;
+      }
+      preloaded++;
+      preloaded_bytes += file_size;
+      readCache[cached].refs = 1;
+      readCache[cached].last_use = ++readCacheClock;
+    } else {
+      // A file copied onto the card from elsewhere never goes through
+      // manifest_drop, so make sure the card still gives the same answer.
+      FILINFO fno;
+      metadata_hint(1);
+      FRESULT res = f_stat(file_path, &fno);
+      metadata_hint(0);
+      int same;
+      if (what == MANIFEST_MISSING) {
+        same = res != FR_OK;
+      } else {
+        same = res == FR_OK && (fno.fattrib & AM_DIR) &&
+               (unsigned long)fat_time_to_time_t(fno.fdate, fno.ftime) == mtime;
+      }
+      if (!same) {
+        g_manifestStale = 1;
+        line = eol;
+        continue;
+      }
+    }
+
+    ManifestEntry *entry = manifest_find(file_path, 1);
+    if (entry == nullptr) {
+      if (cached >= 0) {
+        readCache[cached].refs = 0;
+      }
+      break;
+    }
+    entry->what = what;
+    entry->size = file_size;
+    entry->mtime = mtime;
+    entry->cached = cached;
+    loaded++;
+    line = eol;
+  }
+  free(text);
+
+  if (loaded == 0) {
+    manifest_reset();
+    g_manifestMode = MANIFEST_OFF;
+    return 0;
+  }
+
+  logm("Boot manifest: ");
+  logi(loaded);
+  logm(" entries\r\n");
+  return 1;
+}
+
+// Traces opens and stats until CGlueStdioFinishBootManifest writes the
+// manifest to path.
+void CGlueStdioRecordBootManifest(const char *path) {
+  manifest_reset();
+  strcpy(g_manifestPath, path);
+  g_manifestMode = MANIFEST_RECORD;
+}
+
+static int manifest_save(void) {
+  FIL fil;
+  if (f_open(&fil, g_manifestPath, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK) {
+    return -1;
+  }
+
+  char line[320];
+  snprintf(line, sizeof(line),
+           "# BMC64 boot manifest, recorded automatically.\n"
+           "# Delete this file or boot with record_boot=true to refresh.\n"
+           "# what,size,mtime,checksum,path\n");
+  int err = write_fully(&fil, line, strlen(line));
+
+  // Only list as many files as the read cache can hold pinned at once,
+  // in the order the boot first opened them.
+  int files = 0;
+  unsigned file_bytes = 0;
+  for (int i = 0; !err && i < g_manifestNum; i++) {
+    ManifestEntry &entry = g_manifest[i];
+    if (entry.what == MANIFEST_DROPPED) {
+      continue;
+    }
+
+    // Opens don't see the timestamp and the file may have been
+    // written since, so take both from the card now.
+    FILINFO fno;
+    if (entry.what != MANIFEST_MISSING) {
+      if (f_stat(entry.path, &fno) != FR_OK) {
+        continue;
+      }
+      entry.size = fno.fsize;
+      entry.mtime = fat_time_to_time_t(fno.fdate, fno.ftime);
+    }
+
+    uint32_t checksum = 0;
+    if (entry.what == MANIFEST_FILE) {
+      // Too big to preload or no room left, leave it to the card.
+      if (entry.size == 0 || entry.size > READ_CACHE_MAX_FILE ||
+          files == READ_CACHE_ENTRIES ||
+          file_bytes + entry.size > READ_CACHE_MAX_TOTAL) {
+        continue;
+      }
+      char *contents = read_whole_file(entry.path, entry.size);
+      if (contents == nullptr) {
+        continue;
+      }
+      checksum = fnv1a(2166136261u, contents, entry.size);
+      free(contents);
+      files++;
+      file_bytes += entry.size;
+    }
+
+    snprintf(line, sizeof(line), "# %u ops, %u bytes read, %u us\n",
+             entry.ops, entry.read_bytes, entry.ticks);
+    err = write_fully(&fil, line, strlen(line));
+    snprintf(line, sizeof(line), "%s,%u,%lu,%lx,%s\n",
+             manifestWhat[entry.what], entry.size, entry.mtime,
+             (unsigned long)checksum, entry.path);
+    err = err || write_fully(&fil, line, strlen(line));
+  }
+
+  if (f_close(&fil) != FR_OK) {
+    err = 1;
+  }
+  if (err) {
+    f_unlink(g_manifestPath);
+  }
+  return err ? -1 : 0;
+}
+
+// Boot is complete. Saves the manifest when recording, releases the
+// preloaded files when replaying. The entries are kept to watch for
+// missing files being created.
+void CGlueStdioFinishBootManifest(void) {
+  int valid = 0;
+  if (g_manifestMode == MANIFEST_RECORD) {
+    g_manifestMode = MANIFEST_OFF;
+    if (manifest_save() == 0) {
+      logm("Boot manifest recorded: ");
+      logi(g_manifestNum);
+      logm(" entries\r\n");
+      valid = 1;
+    }
+  } else if (g_manifestMode == MANIFEST_REPLAY) {
+    g_manifestMode = MANIFEST_OFF;
+    if (g_manifestStale) {
+      // Something changed. Record a fresh one next time.
+      logm("Boot manifest is stale\r\n");
+      f_unlink(g_manifestPath);
+    } else {
+      valid = 1;
+    }
+  }
+
+  if (!valid) {
+    manifest_reset();
+    return;
+  }
+  for (int i = 0; i < g_manifestNum; i++) {
+    manifest_unpin(g_manifest[i]);
+  }
+  g_manifestWatch = 1;
+}
+
 extern "C" int _DEFUN(_open, (file, flags, mode),
                       char *file _AND int flags _AND int mode) {
+  boot_preload_wait();
   int const masked_flags = flags & 7;
   if (masked_flags != O_RDONLY && masked_flags != O_WRONLY &&
       masked_flags != O_RDWR) {
@@ -337,24 +1331,71 @@ extern "C" int _DEFUN(_open, (file, flags, mode),
     return -1;
   }
 
-  // Handle fast fail here
-  for (int i=0;i<g_bootStatNum;i++) {
-     if (g_bootStatWhat[i] == BOOTSTAT_WHAT_FAIL) {
-        if (strend(file, g_bootStatFile[i])) {
-          errno = EACCES;
-          return -1;
-        }
-     }
+  CirclePath circlePath(file);
+  ManifestEntry *traced = nullptr;
+  if (g_manifestMode == MANIFEST_REPLAY) {
+    ManifestEntry *entry = manifest_find(circlePath.path, 0);
+    if (entry && entry->what == MANIFEST_MISSING &&
+        masked_flags != O_WRONLY) {
+      errno = EACCES;
+      return -1;
+    }
+  } else if (g_manifestMode == MANIFEST_RECORD && masked_flags == O_RDONLY) {
+    traced = manifest_find(circlePath.path, 1);
+    if (traced && traced->what == MANIFEST_DROPPED) {
+      traced = nullptr;
+    }
   }
+  unsigned start = CTimer::GetClockTicks();
+
   int slot = FindFreeFileSlot();
 
   if (slot != -1) {
-    CirclePath circlePath(file);
     CircleFile &newFile = fileTab[slot];
 
+    // A prefetched copy becomes the in memory file as it is.
+    char *claimed = nullptr;
+    unsigned claimed_size = 0;
+    if (masked_flags == O_RDWR) {
+      claimed = cache_claim(circlePath.path, &claimed_size);
+    }
+    if (masked_flags != O_RDONLY) {
+      cache_drop(circlePath.path);
+    }
+
+    if (g_manifestMode == MANIFEST_REPLAY && masked_flags == O_RDONLY) {
+      ManifestEntry *entry = manifest_find(circlePath.path, 0);
+      if (entry && entry->what == MANIFEST_FILE && entry->cached >= 0) {
+        // Preloaded. No need to open it at all.
+        CachedFile &cached = readCache[entry->cached];
+        cached.refs++;
+        cached.last_use = ++readCacheClock;
+        newFile.fopen_called = 0;
+        newFile.contents = cached.contents;
+        newFile.position = 0;
+        newFile.size = cached.size;
+        newFile.allocated = cached.size;
+        newFile.mode = O_RDONLY;
+        newFile.written_to = 0;
+        newFile.dirty = nullptr;
+        newFile.dirty_len = 0;
+        newFile.cached = entry->cached;
+        newFile.traced = -1;
+        strcpy(newFile.fname, circlePath.path);
+        newFile.in_use = 1;
+        return slot;
+      }
+    }
+
     int result;
+    metadata_hint(1);
     if (masked_flags == O_RDONLY) {
       result = f_open(&newFile.file, circlePath.path, FA_READ);
+      if (traced) {
+        traced->what = result == FR_OK ? MANIFEST_FILE : MANIFEST_MISSING;
+        traced->size = result == FR_OK ? f_size(&newFile.file) : 0;
+        manifest_trace(traced, start, 0);
+      }
     } else if (masked_flags == O_WRONLY) {
       result = f_open(&newFile.file, circlePath.path, 
          FA_WRITE | FA_CREATE_ALWAYS);
@@ -364,8 +1405,10 @@ extern "C" int _DEFUN(_open, (file, flags, mode),
       // in memory.
       result = f_open(&newFile.file, circlePath.path, FA_READ);
     }
+    metadata_hint(0);
 
     if (result != FR_OK) {
+      free(claimed);
       errno = EACCES;
       return -1;
     }
@@ -377,10 +1420,21 @@ extern "C" int _DEFUN(_open, (file, flags, mode),
     newFile.allocated = 0;
     newFile.mode = masked_flags;
     newFile.written_to = 0;
+    newFile.dirty = nullptr;
+    newFile.dirty_len = 0;
+    newFile.cached = -1;
+    newFile.traced = traced ? traced - g_manifest : -1;
     strcpy(newFile.fname, circlePath.path);
 
     // When file is opened O_RDWR, slurp it into memory.
     if (masked_flags == O_RDWR) {
+       if (claimed && f_size(&newFile.file) == claimed_size) {
+          newFile.contents = claimed;
+          newFile.size = claimed_size;
+          newFile.allocated = claimed_size;
+          claimed = nullptr;
+       }
+       free(claimed);
        if (slurp_file(newFile)) {
           errno = ENFILE;
           return -1;
@@ -411,29 +1465,23 @@ extern "C" int _DEFUN(_close, (fildes), int fildes) {
     return -1;
   }
 
+  int write_back_failed = 0;
   if (file.contents) {
-     // Only open if something was actually written to memory
      if (file.mode == O_RDWR && file.written_to) {
-        // Assert FIL is not used
-        file.fopen_called = 1;
-        if (f_open(&file.file, file.fname,
-                      FA_WRITE | FA_CREATE_ALWAYS) != FR_OK) {
-           // We won't be able to flush in memory changes back to disk.
-        }
-     }
-
-     // Always flush to disk for WRONLY but only if written to for RDRW
-     if ((file.mode == O_RDWR && file.written_to) || file.mode == O_WRONLY) {
+        // Only the sectors that were written to. This opens and closes
+        // the fatfs file itself.
+        write_back_failed = write_back(file);
+     } else if (file.mode == O_WRONLY) {
         // Dump contents of memory buffer to actual file.
         unsigned int num_written;
         if (f_write(&file.file, file.contents,
                       file.size, &num_written) != FR_OK) {
-           // Can't write new file or modified file contents back to disk.
+           // Can't write new file contents to disk.
         }
      }
   }
 
-  int need_close = file.fopen_called;
+  int need_close = file.fopen_called && file.mode != O_RDWR;
 
   file.allocated = 0;
   file.size = 0;
@@ -443,17 +1491,33 @@ extern "C" int _DEFUN(_close, (fildes), int fildes) {
   file.fopen_called = 0;
   file.fname[0] = '\0';
 
-  if (file.contents) {
+  if (file.cached >= 0) {
+    CachedFile &entry = readCache[file.cached];
+    entry.refs--;
+    if (entry.stale && entry.refs == 0) {
+      cache_free_entry(entry);
+    }
+    file.cached = -1;
+    file.contents = nullptr;
+  } else if (file.contents) {
     free(file.contents);
     file.contents = nullptr;
   } 
-  
-  // If we opened for RDWR but never wrote, nothing do to.
+  free(file.dirty);
+  file.dirty = nullptr;
+  file.dirty_len = 0;
+
+  // RDWR files were closed right after slurping (or by write_back).
   if (need_close && f_close(&file.file) != FR_OK) {
     errno = EIO;
     return -1;
   }
 
+  if (write_back_failed) {
+    errno = EIO;
+    return -1;
+  }
+
   return 0;
 }
 
@@ -476,10 +1540,14 @@ extern "C" int _DEFUN(_read, (fildes, ptr, len),
      // else EBADF -1
 
      // Read data from the file
+     unsigned start = CTimer::GetClockTicks();
      if (f_read(&file.file, ptr, len, &num_read) != FR_OK) {
        errno = EIO;
        return -1;
      }
+     if (file.traced >= 0 && g_manifestMode == MANIFEST_RECORD) {
+       manifest_trace(&g_manifest[file.traced], start, num_read);
+     }
 
      file.position += num_read;
      return static_cast<int>(num_read);
@@ -515,7 +1583,7 @@ extern "C" int _DEFUN(_write, (fildes, ptr, len),
   }
 
   CircleFile &file = fileTab[fildes];
-  if (!file.in_use) {
+  if (!file.in_use || file.mode == O_RDONLY) {
     errno = EBADF;
     return -1;
   }
@@ -536,6 +1604,11 @@ extern "C" int _DEFUN(_write, (fildes, ptr, len),
      file.contents = (char *)realloc(file.contents, file.allocated);
   }
 
+  if (file.mode == O_RDWR && mark_dirty(file, file.position, len)) {
+    errno = ENOMEM;
+    return -1;
+  }
+
   // Do the write.
   memcpy(file.contents + file.position, ptr, len);
   file.position += len;
@@ -547,6 +1620,7 @@ extern "C" int _DEFUN(_write, (fildes, ptr, len),
 }
 
 extern "C" DIR *opendir(const char *name) {
+  boot_preload_wait();
   CirclePath circlePath(name); 
   
   int const slotNum = FindFreeDirSlot();
@@ -556,7 +1630,10 @@ extern "C" DIR *opendir(const char *name) {
   }
 
   CircleDir &slot = dirTab[slotNum];
-  if (f_opendir(&slot.dir, circlePath.path) != FR_OK) {
+  metadata_hint(1);
+  FRESULT res = f_opendir(&slot.dir, circlePath.path);
+  metadata_hint(0);
+  if (res != FR_OK) {
     errno = ENFILE;
     return 0;
   }
@@ -572,7 +1649,9 @@ static struct dirent *do_readdir(CircleDir *dir, struct dirent *de) {
   FILINFO fno;
   struct dirent *result = nullptr;
 
+  metadata_hint(1);
   FRESULT res = f_findnext(&dir->dir, &fno);
+  metadata_hint(0);
   if (res == FR_OK && fno.fname[0] != 0) {
     strcpy(de->d_name, fno.fname);
     de->d_ino = 0;
@@ -637,28 +1716,39 @@ extern "C" int closedir(DIR *dir) {
 
 extern "C" int _DEFUN(_stat, (file, st),
                       const char *file _AND struct stat *st) {
+  boot_preload_wait();
   CirclePath circlePath(file);
   memset(st, 0, sizeof(struct stat));
 
-  // Fastfail or fastsucceed
-  for (int i=0;i<g_bootStatNum;i++) {
-     if (g_bootStatWhat[i] == BOOTSTAT_WHAT_STAT) {
-        if (strend(circlePath.path, g_bootStatFile[i])) {
-           st->st_mode = S_IFREG | S_IREAD | S_IWRITE;
-           st->st_size = g_bootStatSize[i];
-        }
-        return 0;
-     }
-     else if (g_bootStatWhat[i] == BOOTSTAT_WHAT_FAIL) {
-        if (strend(circlePath.path, g_bootStatFile[i])) {
-          errno = EBADF;
-          return -1;
-        }
-     }
+  ManifestEntry *traced = nullptr;
+  if (g_manifestMode == MANIFEST_REPLAY) {
+    ManifestEntry *entry = manifest_find(circlePath.path, 0);
+    if (entry && entry->what == MANIFEST_MISSING) {
+      errno = EBADF;
+      return -1;
+    } else if (entry && entry->what == MANIFEST_DIR) {
+      st->st_mode = S_IFDIR | S_IREAD | S_IWRITE;
+      st->st_mtime = entry->mtime;
+      return 0;
+    } else if (entry && entry->what == MANIFEST_FILE) {
+      st->st_mode = S_IFREG | S_IREAD | S_IWRITE;
+      st->st_size = entry->size;
+      st->st_mtime = entry->mtime;
+      return 0;
+    }
+  } else if (g_manifestMode == MANIFEST_RECORD) {
+    traced = manifest_find(circlePath.path, 1);
+    if (traced && traced->what == MANIFEST_DROPPED) {
+      traced = nullptr;
+    }
   }
+  unsigned start = CTimer::GetClockTicks();
 
   FILINFO fno;
-  if (f_stat(circlePath.path, &fno) == FR_OK) {
+  metadata_hint(1);
+  FRESULT res = f_stat(circlePath.path, &fno);
+  metadata_hint(0);
+  if (res == FR_OK) {
     if (fno.fattrib & AM_DIR) {
       st->st_mode |= S_IFDIR;
     } else {
@@ -671,9 +1761,24 @@ extern "C" int _DEFUN(_stat, (file, st),
     }
 
     st->st_size = fno.fsize;
+    st->st_mtime = fat_time_to_time_t(fno.fdate, fno.ftime);
+
+    // Read only files always go to the card.
+    if (traced && !(fno.fattrib & AM_RDO)) {
+      traced->what = (fno.fattrib & AM_DIR) ? MANIFEST_DIR : MANIFEST_FILE;
+      traced->size = fno.fsize;
+      traced->mtime = st->st_mtime;
+      manifest_trace(traced, start, 0);
+    } else if (traced) {
+      traced->what = MANIFEST_DROPPED;
+    }
     return 0;
   }
 
+  if (traced) {
+    traced->what = MANIFEST_MISSING;
+    manifest_trace(traced, start, 0);
+  }
   errno = EBADF;
   return -1;
 }
@@ -705,10 +1810,15 @@ extern "C" int _DEFUN(_lseek, (fildes, ptr, dir),
 
   if (file.mode == O_RDONLY) {
     // Assert FIL has been opened
+    unsigned start = CTimer::GetClockTicks();
+    int slurped = file.contents == nullptr;
     if (slurp_file(file)) {
        errno = EACCES;
        return -1;
     }
+    if (slurped && file.traced >= 0 && g_manifestMode == MANIFEST_RECORD) {
+       manifest_trace(&g_manifest[file.traced], start, file.size);
+    }
   }
 
   if (dir == SEEK_SET) {
@@ -732,6 +1842,7 @@ int chdir (const char *path)
 {
   int i;
 
+  boot_preload_wait();
   if (path == nullptr) {
      errno = EIO;
      return -1;
@@ -779,6 +1890,7 @@ int chdir (const char *path)
 }
 
 char *getwd(char *buf) {
+   boot_preload_wait();
    if (buf) {
       strcpy(buf, currentDir);
       if (strlen(buf) > 1 && buf[strlen(buf)-1] == '/') {
@@ -792,6 +1904,9 @@ extern "C" int
 _DEFUN (_link, (existing, newname),
         char *existing _AND char *newname)
 {
+  boot_preload_wait();
+  cache_drop(CirclePath(existing).path);
+  cache_drop(CirclePath(newname).path);
   int result = f_rename(existing, newname);
   if (result != FR_OK) {
      if (result == FR_EXIST) errno = EEXIST;
@@ -805,6 +1920,8 @@ extern "C" int
 _DEFUN (_unlink, (name),
         char *name)
 {
+  boot_preload_wait();
+  cache_drop(CirclePath(name).path);
   f_unlink(name);
   return 0;
 }
@@ -0,0 +1,259 @@
+//
+// palfilter.cpp
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "palfilter.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define PAL_FILTER_NEON
+#endif
+
+extern "C" {
+#include "third_party/common/semaphore.h"
+}
+
+#define ALIGN_UP(x, y) (((x) + (y)-1) & ~((y)-1))
+
+// Rows of scratch per band and padding at the end of each row so the
+// vector loop never needs to worry about the tail.
+#define SCRATCH_ROWS 5
+#define SCRATCH_PAD 8
+
+struct PALFilterBand {
+  PALFilter *filter;
+  const uint8_t *src;
+  int pitch;
+  int first;
+  int last;
+};
+
+static PALFilterBand bands[PAL_FILTER_MAX_HELPERS];
+static volatile int band_pending[PAL_FILTER_MAX_HELPERS];
+static uint32_t *volatile helper_wake[PAL_FILTER_MAX_HELPERS];
+static int next_helper;
+static uint32_t bands_done;
+
+PALFilter::PALFilter()
+    : width_(0), height_(0), out_pitch_(0), out_(nullptr),
+      scratch_(nullptr) {
+  memset(y_, 0, sizeof(y_));
+  memset(u_, 0, sizeof(u_));
+  memset(v_, 0, sizeof(v_));
+}
+
+PALFilter::~PALFilter() { Free(); }
+
+int PALFilter::Allocate(int width, int height) {
+  Free();
+
+  width_ = width;
+  height_ = height;
+  out_pitch_ = ALIGN_UP(width * 2, 32);
+  out_ = (uint16_t *)malloc(out_pitch_ * height * 2);
+
+  int stride = width + SCRATCH_PAD;
+  scratch_ = (int16_t *)malloc(PAL_FILTER_MAX_HELPERS * SCRATCH_ROWS *
+                               stride * sizeof(int16_t));
+  if (out_ == nullptr || scratch_ == nullptr) {
+    Free();
+    return -1;
+  }
+  memset(out_, 0, out_pitch_ * height * 2);
+  memset(scratch_, 0,
+         PAL_FILTER_MAX_HELPERS * SCRATCH_ROWS * stride * sizeof(int16_t));
+  return 0;
+}
+
+void PALFilter::Free() {
+  free(out_);
+  free(scratch_);
+  out_ = nullptr;
+  scratch_ = nullptr;
+  width_ = 0;
+  height_ = 0;
+}
+
+void PALFilter::SetPalette(const uint16_t *pal565) {
+  for (int i = 0; i < 256; i++) {
+    int r = (pal565[i] >> 11) & 0x1f;
+    int g = (pal565[i] >> 5) & 0x3f;
+    int b = pal565[i] & 0x1f;
+    r = (r << 3) | (r >> 2);
+    g = (g << 2) | (g >> 4);
+    b = (b << 3) | (b >> 2);
+
+    // Color difference form so R and B come back exactly when nothing
+    // is blended. G = Y - 0.194U - 0.509V.
+    int y = (77 * r + 150 * g + 29 * b) >> 8;
+    y_[i] = y;
+    u_[i] = b - y;
+    v_[i] = r - y;
+  }
+}
+
+// Luma of every pixel and the chroma of every pixel summed with the one
+// to its left.
+void PALFilter::PrepareRow(const uint8_t *line, int16_t *luma, int16_t *u,
+                           int16_t *v) {
+  uint8_t prev = line[0];
+  for (int x = 0; x < width_; x++) {
+    uint8_t c = line[x];
+    luma[x] = y_[c];
+    u[x] = u_[c] + u_[prev];
+    v[x] = v_[c] + v_[prev];
+    prev = c;
+  }
+}
+
+static inline int clamp255(int c) { return c < 0 ? 0 : (c > 255 ? 255 : c); }
+
+static inline void filter_pixel(int y, int u, int v, uint16_t *out,
+                                uint16_t *scan) {
+  int r = clamp255(y + v);
+  int g = clamp255(y - ((25 * u + 65 * v) >> 7));
+  int b = clamp255(y + u);
+  *out = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+  r = (r * PAL_FILTER_SCANLINE_WEIGHT) >> 8;
+  g = (g * PAL_FILTER_SCANLINE_WEIGHT) >> 8;
+  b = (b * PAL_FILTER_SCANLINE_WEIGHT) >> 8;
+  *scan = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+}
+
+#ifdef PAL_FILTER_NEON
+static inline uint16x8_t pack565(uint8x8_t r, uint8x8_t g, uint8x8_t b) {
+  uint16x8_t p = vshll_n_u8(r, 8);
+  p = vsriq_n_u16(p, vshll_n_u8(g, 8), 5);
+  return vsriq_n_u16(p, vshll_n_u8(b, 8), 11);
+}
+#endif
+
+void PALFilter::RenderBand(const uint8_t *src, int pitch, int first,
+                           int last, int band) {
+  int stride = width_ + SCRATCH_PAD;
+  int16_t *luma = scratch_ + band * SCRATCH_ROWS * stride;
+  int16_t *cu = luma + stride;
+  int16_t *cv = cu + stride;
+  int16_t *pu = cv + stride;
+  int16_t *pv = pu + stride;
+
+  // Bands overlap by one line so each can start its delay line alone.
+  int above = first > 0 ? first - 1 : 0;
+  PrepareRow(src + above * pitch, luma, pu, pv);
+
+  for (int line = first; line < last; line++) {
+    PrepareRow(src + line * pitch, luma, cu, cv);
+    // Output line 2 * line, out_pitch_ being in bytes.
+    uint16_t *out = out_ + line * out_pitch_;
+    uint16_t *scan = out + out_pitch_ / 2;
+
+    int x = 0;
+#ifdef PAL_FILTER_NEON
+    const uint8x8_t weight = vdup_n_u8(PAL_FILTER_SCANLINE_WEIGHT);
+    for (; x + 8 <= width_; x += 8) {
+      int16x8_t y = vld1q_s16(luma + x);
+      int16x8_t u = vshrq_n_s16(vaddq_s16(vld1q_s16(cu + x),
+                                          vld1q_s16(pu + x)), 2);
+      int16x8_t v = vshrq_n_s16(vaddq_s16(vld1q_s16(cv + x),
+                                          vld1q_s16(pv + x)), 2);
+      int16x8_t gd = vshrq_n_s16(vmlaq_n_s16(vmulq_n_s16(u, 25), v, 65), 7);
+
+      uint8x8_t r = vqmovun_s16(vaddq_s16(y, v));
+      uint8x8_t g = vqmovun_s16(vsubq_s16(y, gd));
+      uint8x8_t b = vqmovun_s16(vaddq_s16(y, u));
+      vst1q_u16(out + x, pack565(r, g, b));
+
+      r = vshrn_n_u16(vmull_u8(r, weight), 8);
+      g = vshrn_n_u16(vmull_u8(g, weight), 8);
+      b = vshrn_n_u16(vmull_u8(b, weight), 8);
+      vst1q_u16(scan + x, pack565(r, g, b));
+    }
+#endif
+    for (; x < width_; x++) {
+      filter_pixel(luma[x], (cu[x] + pu[x]) >> 2, (cv[x] + pv[x]) >> 2,
+                   out + x, scan + x);
+    }
+
+    int16_t *t = pu;
+    pu = cu;
+    cu = t;
+    t = pv;
+    pv = cv;
+    cv = t;
+  }
+}
+
+void PALFilter::Render(const uint8_t *src, int pitch) {
+  if (out_ == nullptr) {
+    return;
+  }
+
+  int helpers[PAL_FILTER_MAX_HELPERS];
+  int n = 0;
+  for (int h = 0; h < PAL_FILTER_MAX_HELPERS; h++) {
+    if (helper_wake[h]) {
+      helpers[n++] = h;
+    }
+  }
+
+  if (n == 0) {
+    RenderBand(src, pitch, 0, height_, 0);
+    return;
+  }
+
+  for (int i = 0; i < n; i++) {
+    PALFilterBand &band = bands[helpers[i]];
+    band.filter = this;
+    band.src = src;
+    band.pitch = pitch;
+    band.first = height_ * i / n;
+    band.last = height_ * (i + 1) / n;
+  }
+  __sync_synchronize();
+  for (int i = 0; i < n; i++) {
+    band_pending[helpers[i]] = 1;
+    __sync_synchronize();
+    sem_inc(helper_wake[helpers[i]]);
+  }
+  for (int i = 0; i < n; i++) {
+    sem_dec(&bands_done);
+  }
+}
+
+int PALFilterAddHelper(uint32_t *wake) {
+  int helper = __sync_fetch_and_add(&next_helper, 1);
+  if (helper >= PAL_FILTER_MAX_HELPERS) {
+    return -1;
+  }
+  __sync_synchronize();
+  helper_wake[helper] = wake;
+  return helper;
+}
+
+int PALFilterBandPending(int helper) {
+  return helper >= 0 && band_pending[helper];
+}
+
+void PALFilterRunBand(int helper) {
+  PALFilterBand &band = bands[helper];
+  __sync_synchronize();
+  band.filter->RenderBand(band.src, band.pitch, band.first, band.last,
+                          helper);
+  __sync_synchronize();
+  band_pending[helper] = 0;
+  sem_inc(&bands_done);
+}
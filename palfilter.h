@@ -0,0 +1,85 @@
+//
+// palfilter.h
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef _palfilter_h
+#define _palfilter_h
+
+#include <stdint.h>
+
+// Brightness of the scanline gaps out of 256.
+#define PAL_FILTER_SCANLINE_WEIGHT 160
+
+// Most helper cores a frame is split across.
+#define PAL_FILTER_MAX_HELPERS 2
+
+// Software PAL look for 8-bit indexed frame buffers. Chroma is blended
+// with the pixel to the left and with the line above (the PAL delay
+// line), luma is left sharp. The output is RGB565 with twice the lines
+// of the source, every second line being a darker scanline. The frame
+// is split into horizontal bands rendered in parallel by the helper
+// cores that registered with PALFilterAddHelper, or on the calling core
+// if there are none.
+class PALFilter {
+public:
+  PALFilter();
+  ~PALFilter();
+
+  int Allocate(int width, int height);
+  void Free();
+
+  // Rebuild the color tables from an RGB565 palette.
+  void SetPalette(const uint16_t *pal565);
+
+  // Filters the whole frame. src is width x height indexed pixels.
+  void Render(const uint8_t *src, int pitch);
+
+  uint16_t *GetPixels() { return out_; }
+  // Pitch of the output in bytes.
+  int GetPitch() { return out_pitch_; }
+
+  // Renders source lines [first, last) using scratch rows number band.
+  void RenderBand(const uint8_t *src, int pitch, int first, int last,
+                  int band);
+
+private:
+  void PrepareRow(const uint8_t *line, int16_t *luma, int16_t *u,
+                  int16_t *v);
+
+  int width_;
+  int height_;
+  int out_pitch_;
+  uint16_t *out_;
+
+  // Per band: luma, horizontal U/V pair sums for this line and the
+  // line above.
+  int16_t *scratch_;
+
+  int16_t y_[256];
+  int16_t u_[256];
+  int16_t v_[256];
+};
+
+// Helper cores call this once before entering their job loop. wake is
+// the semaphore the core sleeps on; every sem_inc on it is one job.
+// Returns the helper number to pass to the functions below.
+int PALFilterAddHelper(uint32_t *wake);
+
+// Whether a band is waiting for this helper.
+int PALFilterBandPending(int helper);
+
+// Renders the waiting band and signals the core that posted it.
+void PALFilterRunBand(int helper);
+
+#endif
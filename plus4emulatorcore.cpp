@@ -21,6 +21,7 @@
 
 extern "C" {
 #include "third_party/plus4emu/main.h"
+#include "third_party/common/semaphore.h"
 }
 
 #include "third_party/plus4emu/resid/filter.hpp"
@@ -52,6 +53,10 @@ void Plus4EmulatorCore::RunMainPlus4(bool wait) {
   int argc = 0;
   char *argv[] = {};
   emu_machine_init(m_options->GetRasterSkip(), false /* no vdc */);
+#ifdef ARM_ALLOW_MULTI_CORE
+  // Core 2 runs the floppy drives once its filter data is done.
+  floppy_thread_available = 1;
+#endif
   main_program(argc, argv);
   emu_exit();
 }
@@ -72,7 +77,8 @@ void Plus4EmulatorCore::Run(unsigned nCore) {
     RunMainPlus4(true);
     break;
   case 2:
-    // Core 2 will initialize 6581 filter data. Then sleep.
+    // Core 2 will initialize 6581 filter data. Then run the floppy
+    // drive emulation.
     ComputeResidFilter(0);
     break;
   case 3:
@@ -82,6 +88,15 @@ void Plus4EmulatorCore::Run(unsigned nCore) {
   }
 
 #ifdef ARM_ALLOW_MULTI_CORE
+  if (nCore == 2) {
+     while (true) {
+        sem_dec(&floppy_job);
+        run_floppy_job();
+        __sync_synchronize();
+        sem_inc(&floppy_done);
+     }
+  }
+
   printf("Core %d idle\n", nCore);
   asm("dsb\n\t"
       "1: wfi\n\t"
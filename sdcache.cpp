@@ -0,0 +1,350 @@
+//
+// sdcache.cpp
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "sdcache.h"
+
+#include <circle/devicenameservice.h>
+#include <circle/multicore.h>
+#include <string.h>
+
+#define NO_SECTOR 0xffffffff
+
+// Enough for the biggest cached read plus its read ahead.
+#define STAGING_SECTORS (SD_CACHE_MAX_CACHED_READ + SD_CACHE_MAX_READAHEAD)
+
+CSDCache *CSDCache::s_pThis = 0;
+
+CSDCache::CSDCache(CDevice *pDevice)
+    : mDevice(pDevice), mLock(TASK_LEVEL), mHead(-1), mTail(-1), mFree(-1),
+      mMetadataFirst(0), mMetadataEnd(0), mNextSequential(NO_SECTOR),
+      mReadAhead(0) {
+  for (int i = 0; i < CORES; i++) {
+    mOffset[i] = 0;
+    mMetadataHint[i] = FALSE;
+  }
+  mData = new u8[SD_CACHE_SECTORS * SD_CACHE_SECTOR_SIZE];
+  mStaging = new u8[STAGING_SECTORS * SD_CACHE_SECTOR_SIZE];
+
+  for (int i = 0; i < SD_CACHE_HASH_SIZE; i++) {
+    mHash[i] = -1;
+  }
+  for (int i = SD_CACHE_SECTORS - 1; i >= 0; i--) {
+    mSector[i] = NO_SECTOR;
+    mPinned[i] = FALSE;
+    mNext[i] = mFree;
+    mFree = i;
+  }
+  memset(&mStats, 0, sizeof(mStats));
+
+  s_pThis = this;
+}
+
+CSDCache::~CSDCache(void) {
+  delete[] mData;
+  delete[] mStaging;
+  s_pThis = 0;
+}
+
+CSDCache *CSDCache::Get(void) { return s_pThis; }
+
+unsigned CSDCache::ThisCore(void) {
+#ifdef ARM_ALLOW_MULTI_CORE
+  return CMultiCoreSupport::ThisCore();
+#else
+  return 0;
+#endif
+}
+
+boolean CSDCache::Initialize(const char *pName) {
+  if (mData == 0 || mStaging == 0) {
+    return FALSE;
+  }
+  // The name service hands out the most recently added device with a
+  // given name, so fatfs gets us from now on.
+  CDeviceNameService::Get()->AddDevice(pName, this, TRUE);
+  return TRUE;
+}
+
+void CSDCache::SetMetadataRange(u32 nFirst, u32 nEnd) {
+  mLock.Acquire();
+  mMetadataFirst = nFirst;
+  mMetadataEnd = nEnd;
+  mLock.Release();
+}
+
+void CSDCache::SetMetadataHint(boolean bMetadata) {
+  mMetadataHint[ThisCore()] = bMetadata;
+}
+
+void CSDCache::GetStats(TSDCacheStats *pStats) {
+  mLock.Acquire();
+  *pStats = mStats;
+  mLock.Release();
+}
+
+int CSDCache::Lookup(u32 nSector) const {
+  int nSlot = mHash[nSector & (SD_CACHE_HASH_SIZE - 1)];
+  while (nSlot >= 0 && mSector[nSlot] != nSector) {
+    nSlot = mHashNext[nSlot];
+  }
+  return nSlot;
+}
+
+void CSDCache::Unlink(int nSlot) {
+  if (mPrev[nSlot] >= 0) {
+    mNext[mPrev[nSlot]] = mNext[nSlot];
+  } else {
+    mHead = mNext[nSlot];
+  }
+  if (mNext[nSlot] >= 0) {
+    mPrev[mNext[nSlot]] = mPrev[nSlot];
+  } else {
+    mTail = mPrev[nSlot];
+  }
+}
+
+void CSDCache::LinkFront(int nSlot) {
+  mPrev[nSlot] = -1;
+  mNext[nSlot] = mHead;
+  if (mHead >= 0) {
+    mPrev[mHead] = nSlot;
+  } else {
+    mTail = nSlot;
+  }
+  mHead = nSlot;
+}
+
+void CSDCache::Touch(int nSlot) {
+  if (!mPinned[nSlot] && mHead != nSlot) {
+    Unlink(nSlot);
+    LinkFront(nSlot);
+  }
+}
+
+// Removes nSector from the cache if it is there.
+void CSDCache::Invalidate(u32 nSector) {
+  int *pLink = &mHash[nSector & (SD_CACHE_HASH_SIZE - 1)];
+  while (*pLink >= 0 && mSector[*pLink] != nSector) {
+    pLink = &mHashNext[*pLink];
+  }
+  int nSlot = *pLink;
+  if (nSlot < 0) {
+    return;
+  }
+  *pLink = mHashNext[nSlot];
+
+  if (mPinned[nSlot]) {
+    mPinned[nSlot] = FALSE;
+    mStats.pinned--;
+  } else {
+    Unlink(nSlot);
+  }
+  mSector[nSlot] = NO_SECTOR;
+  mNext[nSlot] = mFree;
+  mFree = nSlot;
+  mStats.used--;
+}
+
+// Returns a slot that is on no list, evicting the least recently used
+// sector if the cache is full.
+int CSDCache::Allocate(void) {
+  if (mFree < 0) {
+    // Pinned sectors are limited so there is always something to evict.
+    Invalidate(mSector[mTail]);
+  }
+  int nSlot = mFree;
+  mFree = mNext[nSlot];
+  return nSlot;
+}
+
+void CSDCache::Insert(u32 nSector, const u8 *pData, boolean bPin) {
+  int nSlot = Lookup(nSector);
+  if (nSlot >= 0) {
+    memcpy(mData + nSlot * SD_CACHE_SECTOR_SIZE, pData, SD_CACHE_SECTOR_SIZE);
+    Touch(nSlot);
+    return;
+  }
+
+  nSlot = Allocate();
+  mSector[nSlot] = nSector;
+  memcpy(mData + nSlot * SD_CACHE_SECTOR_SIZE, pData, SD_CACHE_SECTOR_SIZE);
+  int nBucket = nSector & (SD_CACHE_HASH_SIZE - 1);
+  mHashNext[nSlot] = mHash[nBucket];
+  mHash[nBucket] = nSlot;
+  mStats.used++;
+
+  if (bPin && mStats.pinned < SD_CACHE_MAX_PINNED) {
+    mPinned[nSlot] = TRUE;
+    mStats.pinned++;
+  } else {
+    LinkFront(nSlot);
+  }
+}
+
+int CSDCache::ReadDevice(u32 nSector, void *pBuffer, unsigned nSectors) {
+  mStats.reads++;
+  u64 ullOffset = (u64)nSector * SD_CACHE_SECTOR_SIZE;
+  if (mDevice->Seek(ullOffset) != ullOffset) {
+    return -1;
+  }
+  int nBytes = nSectors * SD_CACHE_SECTOR_SIZE;
+  return mDevice->Read(pBuffer, nBytes) == nBytes ? 0 : -1;
+}
+
+int CSDCache::Read(void *pBuffer, size_t nCount) {
+  unsigned nCore = ThisCore();
+  mLock.Acquire();
+  int nResult = ReadLocked(pBuffer, nCount, mOffset[nCore],
+                           mMetadataHint[nCore]);
+  mLock.Release();
+  if (nResult > 0) {
+    mOffset[nCore] += nResult;
+  }
+  return nResult;
+}
+
+int CSDCache::ReadLocked(void *pBuffer, size_t nCount, u64 ullOffset,
+                         boolean bMetadataHint) {
+  if (ullOffset % SD_CACHE_SECTOR_SIZE || nCount % SD_CACHE_SECTOR_SIZE) {
+    // Not something fatfs does. Just pass it on.
+    if (mDevice->Seek(ullOffset) != ullOffset) {
+      return -1;
+    }
+    return mDevice->Read(pBuffer, nCount);
+  }
+
+  u32 nSector = ullOffset / SD_CACHE_SECTOR_SIZE;
+  unsigned nSectors = nCount / SD_CACHE_SECTOR_SIZE;
+  u8 *pDest = (u8 *)pBuffer;
+
+  boolean bPin = bMetadataHint ||
+                 (nSector >= mMetadataFirst && nSector < mMetadataEnd);
+  if (!bPin) {
+    // FAT lookups in between don't break a sequential run.
+    if (nSector == mNextSequential) {
+      mReadAhead = mReadAhead == 0 ? SD_CACHE_MIN_READAHEAD : mReadAhead * 2;
+      if (mReadAhead > SD_CACHE_MAX_READAHEAD) {
+        mReadAhead = SD_CACHE_MAX_READAHEAD;
+      }
+    } else {
+      mReadAhead = 0;
+    }
+    mNextSequential = nSector + nSectors;
+  }
+
+  if (nSectors > SD_CACHE_MAX_CACHED_READ) {
+    // Safe to bypass since writes go through, the card is never behind
+    // the cache.
+    mStats.misses += nSectors;
+    if (ReadDevice(nSector, pDest, nSectors)) {
+      return -1;
+    }
+    return nCount;
+  }
+
+  unsigned i = 0;
+  while (i < nSectors) {
+    int nSlot = Lookup(nSector + i);
+    if (nSlot >= 0) {
+      memcpy(pDest + i * SD_CACHE_SECTOR_SIZE,
+             mData + nSlot * SD_CACHE_SECTOR_SIZE, SD_CACHE_SECTOR_SIZE);
+      if (bPin && !mPinned[nSlot] && mStats.pinned < SD_CACHE_MAX_PINNED) {
+        Unlink(nSlot);
+        mPinned[nSlot] = TRUE;
+        mStats.pinned++;
+      }
+      Touch(nSlot);
+      mStats.hits++;
+      i++;
+      continue;
+    }
+
+    // Read the whole run of missing sectors in one go, plus the read
+    // ahead if the run goes to the end of the request.
+    unsigned nEnd = i + 1;
+    while (nEnd < nSectors && Lookup(nSector + nEnd) < 0) {
+      nEnd++;
+    }
+    unsigned nRun = nEnd - i;
+    unsigned nAhead = (nEnd == nSectors && !bPin) ? mReadAhead : 0;
+
+    if (ReadDevice(nSector + i, mStaging, nRun + nAhead)) {
+      // Might have run off the end of the card.
+      nAhead = 0;
+      if (ReadDevice(nSector + i, mStaging, nRun)) {
+        return -1;
+      }
+    }
+
+    memcpy(pDest + i * SD_CACHE_SECTOR_SIZE, mStaging,
+           nRun * SD_CACHE_SECTOR_SIZE);
+    for (unsigned n = 0; n < nRun + nAhead; n++) {
+      if (n >= nRun && Lookup(nSector + i + n) >= 0) {
+        continue;
+      }
+      Insert(nSector + i + n, mStaging + n * SD_CACHE_SECTOR_SIZE,
+             n < nRun && bPin);
+    }
+    mStats.misses += nRun;
+    mStats.prefetched += nAhead;
+    i = nEnd;
+  }
+
+  return nCount;
+}
+
+int CSDCache::Write(const void *pBuffer, size_t nCount) {
+  unsigned nCore = ThisCore();
+  u64 ullOffset = mOffset[nCore];
+  u32 nFirst = ullOffset / SD_CACHE_SECTOR_SIZE;
+  u32 nEnd = (ullOffset + nCount + SD_CACHE_SECTOR_SIZE - 1) /
+             SD_CACHE_SECTOR_SIZE;
+  boolean bAligned = ullOffset % SD_CACHE_SECTOR_SIZE == 0 &&
+                     nCount % SD_CACHE_SECTOR_SIZE == 0;
+
+  mLock.Acquire();
+  int nResult = -1;
+  if (mDevice->Seek(ullOffset) == ullOffset) {
+    nResult = mDevice->Write(pBuffer, nCount);
+  }
+
+  // Keep cached copies in step with the card, or drop them if we can't
+  // be sure what the card has now.
+  const u8 *pSrc = (const u8 *)pBuffer;
+  for (u32 nSector = nFirst; nSector < nEnd; nSector++) {
+    int nSlot = Lookup(nSector);
+    if (nSlot < 0) {
+      continue;
+    }
+    if (bAligned && nResult == (int)nCount) {
+      memcpy(mData + nSlot * SD_CACHE_SECTOR_SIZE,
+             pSrc + (nSector - nFirst) * SD_CACHE_SECTOR_SIZE,
+             SD_CACHE_SECTOR_SIZE);
+    } else {
+      Invalidate(nSector);
+    }
+  }
+  mLock.Release();
+
+  if (nResult > 0) {
+    mOffset[nCore] += nResult;
+  }
+  return nResult;
+}
+
+u64 CSDCache::Seek(u64 ullOffset) {
+  mOffset[ThisCore()] = ullOffset;
+  return ullOffset;
+}
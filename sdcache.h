@@ -0,0 +1,131 @@
+//
+// sdcache.h
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef _sdcache_h
+#define _sdcache_h
+
+#include <circle/device.h>
+#include <circle/spinlock.h>
+#include <circle/sysconfig.h>
+#include <circle/types.h>
+
+#define SD_CACHE_SECTOR_SIZE 512
+
+// 1MB worth of sectors.
+#define SD_CACHE_SECTORS 2048
+#define SD_CACHE_HASH_SIZE 1024 // power of 2
+
+// At most this many sectors can be pinned. The rest is LRU.
+#define SD_CACHE_MAX_PINNED (SD_CACHE_SECTORS / 4)
+
+// Read ahead window for sequential reads (sectors). Starts at the min
+// and doubles with every read that continues where the last one ended.
+#define SD_CACHE_MIN_READAHEAD 8
+#define SD_CACHE_MAX_READAHEAD 64
+
+// Reads bigger than this go straight to the device without being cached
+// so that one big file can't flush everything else out.
+#define SD_CACHE_MAX_CACHED_READ (SD_CACHE_SECTORS / 4)
+
+struct TSDCacheStats {
+  unsigned hits;        // sectors served from the cache
+  unsigned misses;      // sectors that had to be read from the card
+  unsigned reads;       // read requests sent to the card
+  unsigned prefetched;  // sectors read ahead
+  unsigned pinned;      // FAT/directory sectors currently pinned
+  unsigned used;        // sectors currently cached
+};
+
+// Sector cache between fatfs and the SD card. Registers itself under the
+// card's device name so fatfs finds it instead of the card. FAT and
+// directory sectors are pinned, everything else is LRU. Reads that
+// continue where the last one ended get a growing read ahead. Writes go
+// straight through to the card.
+//
+// fatfs is used from more than one core (boot preload on core 0, the
+// emulator on core 1). Plus4Emu's drive thread on core 2 has the
+// emulator core do its disk image access. The seek offset and
+// metadata hint are kept per core since fatfs sets them in a separate
+// call before each read or write. Everything else is under mLock.
+class CSDCache : public CDevice {
+public:
+  CSDCache(CDevice *pDevice);
+  ~CSDCache(void);
+
+  static CSDCache *Get(void);
+
+  // Register in place of the device under pName. Must be done before
+  // the volume is mounted.
+  boolean Initialize(const char *pName);
+
+  // Sectors in [nFirst, nEnd) hold the FAT (and the root directory on
+  // FAT12/16). Known after the volume was mounted.
+  void SetMetadataRange(u32 nFirst, u32 nEnd);
+
+  // While set, sectors read are directory sectors and get pinned.
+  void SetMetadataHint(boolean bMetadata);
+
+  void GetStats(TSDCacheStats *pStats);
+
+  int Read(void *pBuffer, size_t nCount);
+  int Write(const void *pBuffer, size_t nCount);
+  u64 Seek(u64 ullOffset);
+
+private:
+  int Lookup(u32 nSector) const;
+  void Unlink(int nSlot);
+  void LinkFront(int nSlot);
+  void Touch(int nSlot);
+  int Allocate(void);
+  void Insert(u32 nSector, const u8 *pData, boolean bPin);
+  void Invalidate(u32 nSector);
+  int ReadDevice(u32 nSector, void *pBuffer, unsigned nSectors);
+  int ReadLocked(void *pBuffer, size_t nCount, u64 ullOffset,
+                 boolean bMetadataHint);
+
+  static unsigned ThisCore(void);
+
+  CDevice *mDevice;
+  CSpinLock mLock;
+  u64 mOffset[CORES];
+
+  u8 *mData;
+  u8 *mStaging;
+  u32 mSector[SD_CACHE_SECTORS];
+  int mHashNext[SD_CACHE_SECTORS];
+  int mHash[SD_CACHE_HASH_SIZE];
+
+  // LRU list of unpinned slots, most recent first. Pinned slots are
+  // not on it.
+  int mPrev[SD_CACHE_SECTORS];
+  int mNext[SD_CACHE_SECTORS];
+  int mHead;
+  int mTail;
+  boolean mPinned[SD_CACHE_SECTORS];
+  int mFree;
+
+  u32 mMetadataFirst;
+  u32 mMetadataEnd;
+  boolean mMetadataHint[CORES];
+
+  u32 mNextSequential;
+  unsigned mReadAhead;
+
+  TSDCacheStats mStats;
+
+  static CSDCache *s_pThis;
+};
+
+#endif
@@ -0,0 +1,197 @@
+/*
+ * autowarp.c
+ *
+ * Written by
+ *  Randy Rossi <randy.rossi@gmail.com>
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+#include "autowarp.h"
+
+#include <stdint.h>
+
+// RASPI includes
+#include "circle.h"
+#include "emux_api.h"
+#include "overlay.h"
+
+// I/O has to be going on this long before we warp. Filters out the odd
+// directory read or status check.
+#define AUTOWARP_ENGAGE_DELAY 250000
+
+// I/O has to stop for this long before we drop back. Loaders pause
+// between files and the drive led blinks between blocks.
+#define AUTOWARP_RELEASE_DELAY 1000000
+
+// No auto warp for this long after the user pressed something, so
+// typing the LOAD command doesn't warp the first keystrokes after it.
+#define AUTOWARP_INPUT_HOLDOFF 1000000
+
+#define DRIVE_NUM 4
+
+static int enabled;
+static int engaged;
+
+static unsigned int drive_busy; // bit per drive
+static int tape_motor;
+static int tape_control;
+static int tape_block = -1;
+
+static int input_pending;
+static unsigned long last_input;
+static int had_input;
+
+// Set when the user cancels auto warp (input or warp toggled off while
+// engaged). Holds until the I/O has gone idle.
+static int suppressed;
+
+static int active;
+static unsigned long active_since;
+static unsigned long idle_since;
+
+// Real time saved while engaged.
+static unsigned long last_frame;
+static uint64_t saved_us;
+
+static void disengage(void) {
+  emux_set_warp(0);
+  overlay_warp_changed(0);
+  engaged = 0;
+}
+
+void autowarp_set_enabled(int enable) {
+  enabled = enable;
+  if (!enabled && engaged) {
+    disengage();
+  }
+}
+
+int autowarp_enabled(void) {
+  return enabled;
+}
+
+void autowarp_drive_led(int drive, unsigned int pwm) {
+  if (drive < 0 || drive >= DRIVE_NUM) {
+    return;
+  }
+  if (pwm) {
+    drive_busy |= 1 << drive;
+  } else {
+    drive_busy &= ~(1 << drive);
+  }
+}
+
+void autowarp_tape_motor(int motor) {
+  tape_motor = motor;
+}
+
+void autowarp_tape_control(int control) {
+  tape_control = control;
+}
+
+void autowarp_tape_block(int block) {
+  tape_block = block;
+}
+
+void autowarp_user_input(void) {
+  input_pending = 1;
+}
+
+void autowarp_check(void) {
+  if (!enabled) {
+    return;
+  }
+
+  unsigned long now = circle_get_ticks();
+
+  if (input_pending) {
+    input_pending = 0;
+    had_input = 1;
+    last_input = now;
+    if (engaged) {
+      disengage();
+      suppressed = 1;
+    }
+  }
+
+  // With a map of the tape only warp through the blocks themselves, not
+  // the pauses in between.
+  int tape_busy = tape_motor && tape_control == EMUX_TAPE_PLAY &&
+                  tape_block != 0;
+  int busy = drive_busy != 0 || tape_busy;
+  if (busy && !active) {
+    active_since = now;
+  } else if (!busy && active) {
+    idle_since = now;
+  }
+  active = busy;
+
+  if (engaged) {
+    int warp;
+    emux_get_int(Setting_WarpMode, &warp);
+    if (!warp) {
+      // Someone else (menu, hotkey, autostart) turned it off.
+      engaged = 0;
+      suppressed = 1;
+      return;
+    }
+
+    long frame_us = is_ntsc() ? 1000000 / 60 : 1000000 / 50;
+    long real_us = now - last_frame;
+    if (real_us < frame_us) {
+      saved_us += frame_us - real_us;
+    }
+    last_frame = now;
+
+    if (!active && now - idle_since >= AUTOWARP_RELEASE_DELAY) {
+      disengage();
+    }
+    return;
+  }
+
+  if (!active) {
+    if (suppressed && now - idle_since >= AUTOWARP_RELEASE_DELAY) {
+      suppressed = 0;
+    }
+    return;
+  }
+  if (suppressed || now - active_since < AUTOWARP_ENGAGE_DELAY) {
+    return;
+  }
+  if (had_input && now - last_input < AUTOWARP_INPUT_HOLDOFF) {
+    return;
+  }
+
+  int warp;
+  emux_get_int(Setting_WarpMode, &warp);
+  if (warp) {
+    // Already warping by hand or by autostart. Leave it alone.
+    return;
+  }
+
+  emux_set_warp(1);
+  overlay_warp_changed(1);
+  engaged = 1;
+  last_frame = now;
+}
+
+unsigned long autowarp_time_saved(void) {
+  return (unsigned long)(saved_us / 1000);
+}
@@ -0,0 +1,58 @@
+/*
+ * autowarp.h
+ *
+ * Written by
+ *  Randy Rossi <randy.rossi@gmail.com>
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef RASPI_AUTOWARP_H
+#define RASPI_AUTOWARP_H
+
+// Turns warp on by itself while a drive or the datasette is busy loading
+// and nobody is at the controls, and back off once the I/O is done or
+// the user touches a key or joystick. Warp the user turned on by hand is
+// never touched.
+
+void autowarp_set_enabled(int enable);
+int autowarp_enabled(void);
+
+// Activity reports. Fed from the status bar hooks in overlay.c so they
+// work for every emulator.
+void autowarp_drive_led(int drive, unsigned int pwm);
+void autowarp_tape_motor(int motor);
+void autowarp_tape_control(int control);
+
+// Whether the datasette is playing through a block of data (1) or not
+// (0), for emulators that map out tape images. -1 (the default) means
+// unknown and any tape motor activity counts.
+void autowarp_tape_block(int block);
+
+// Called when a key or joystick event reaches the emulator.
+void autowarp_user_input(void);
+
+// Called once per emulated frame on the emulator thread.
+void autowarp_check(void);
+
+// Total real time saved by auto warp so far (msec).
+unsigned long autowarp_time_saved(void);
+
+#endif
@@ -177,6 +177,17 @@ struct joydev_config {
 
 extern struct joydev_config joydevs[MAX_JOY_PORTS];
 
+// Counters of the SD card sector cache.
+struct sd_cache_stats {
+  unsigned hits;
+  unsigned misses;
+  unsigned reads;
+  unsigned prefetched;
+  unsigned pinned;
+  unsigned used;
+  unsigned size;
+};
+
 extern int custom_gpio_pins[NUM_GPIO_PINS];
 
 // Lower byte is BTN_ASSIGN_ constant. Upper byte can be bank or other arg.
@@ -195,6 +206,7 @@ extern void circle_reset_gpio(int gpio_config);
 extern int circle_alloc_fbl(int pixelmode, int layer, uint8_t **pixels,
                             int width, int height, int *pitch);
 extern int circle_realloc_fbl(int layer, int shader);
+extern int circle_set_pal_filter_fbl(int layer, int enable);
 extern void circle_free_fbl(int layer);
 extern void circle_clear_fbl(int layer);
 extern void circle_show_fbl(int layer);
@@ -215,14 +227,19 @@ extern int circle_get_zlayer_fbl(int layer);
 extern void circle_lock_acquire();
 extern void circle_lock_release();
 extern void circle_boot_complete();
+extern void circle_boot_phase(const char *name);
+extern void circle_prefetch_file(const char *path);
+extern int circle_prefetch_step(unsigned max_bytes);
 extern void circle_find_usb(int (*usb)[3]);
 extern int circle_mount_usb(int usb);
 extern int circle_unmount_usb(int usb);
 extern void circle_set_volume(int value);
 extern int circle_get_model();
 extern unsigned circle_get_arm_clock();
+extern void circle_get_sd_cache_stats(struct sd_cache_stats *stats);
 extern int circle_gpio_enabled();
 extern int circle_gpio_outputs_enabled();
+extern int circle_instant_boot_enabled();
 
 extern int circle_sound_init(const char *param, int *speed, int *fragsize,
                         int *fragnr, int *channels);
@@ -316,6 +316,9 @@ void emux_set_joy_pot_y(int port, int value);
 void emux_add_tape_options(struct menu_item* parent);
 void emux_add_sound_options(struct menu_item* parent);
 
+// Add emulator specific lines to the diagnostics page.
+void emux_add_diagnostics(struct menu_item* parent);
+
 void emux_video_color_setting_changed(int display_num);
 
 void emux_set_color_brightness(int display_num, int value);
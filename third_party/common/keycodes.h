@@ -147,6 +147,9 @@ extern int ctrl_key_sym_set;
 #define KEYCODE_LeftSuper 0x106
 #define KEYCODE_RightSuper 0x107
 
+// One past the highest keycode. Keycodes index tables of this size.
+#define KEYCODE_MAX 0x108
+
 // If not 0, will intercept all usb key events and
 // forward to this function.  Used to listen to keys
 // during keyset or key binding assignments.
@@ -36,6 +36,7 @@
 
 // RASPI Includes
 #include "emux_api.h"
+#include "autowarp.h"
 #include "demo.h"
 #include "joy.h"
 #include "kbd.h"
@@ -50,6 +51,7 @@
 #include "menu_gpio.h"
 #include "overlay.h"
 #include "raspi_util.h"
+#include "settings_store.h"
 #include "ui.h"
 
 extern void reboot(void);
@@ -135,6 +137,7 @@ struct menu_item *tint_item[2];
 struct menu_item *saturation_item[2];
 
 struct menu_item *warp_item;
+struct menu_item *auto_warp_item;
 struct menu_item *reset_confirm_item;
 struct menu_item *gpio_config_item;
 struct menu_item *active_display_item;
@@ -159,6 +162,7 @@ struct menu_item *c40_80_column_item;
 struct menu_item *dir_convention_item;
 
 struct menu_item *scaling_interp_item;
+struct menu_item *pal_filter_item;
 
 struct menu_item* s_enable_shader_item;
 struct menu_item* s_curvature_item;
@@ -257,34 +261,6 @@ TEST_FILTER_MACRO(test_cart_name, num_cart_ext, cart_filt_ext);
 TEST_FILTER_MACRO(test_snap_name, num_snap_ext, snap_filt_ext);
 TEST_FILTER_MACRO(test_prg_name, num_prg_ext, prg_filt_ext);
 
-static void rtrim(char *txt) {
-  if (!txt) return;
-  int p=strlen(txt)-1;
-  while (isspace(txt[p])) { txt[p] = '\0'; p--; }
-}
-
-static char* ltrim(char *txt) {
-  if (!txt) return NULL;
-  int p=0;
-  while (isspace(txt[p])) { p++; }
-  return txt+p;
-}
-
-static void get_key_and_value(char *line, char **key, char **value) {
-   for (int i=0;i<strlen(line);i++) {
-      if (line[i] == '=') {
-         line[i] = '\0';
-         *key = ltrim(&line[0]);
-         rtrim(*key);
-         *value = ltrim(&line[i+1]);
-         rtrim(*value);
-         return;
-      }
-   }
-   *key = 0;
-   *value = 0;
-}
-
 static char *fullpath(DirType dir_type, char *name) {
   strcpy(full_path_str, current_volume_name);
   strcat(full_path_str, current_dir_names[dir_type]);
@@ -514,6 +490,35 @@ static void show_license() {
   }
 }
 
+static void show_diagnostics() {
+  struct menu_item *diag_root = ui_push_menu(32, 10);
+  struct sd_cache_stats stats;
+  char line[32];
+
+  circle_get_sd_cache_stats(&stats);
+  unsigned total = stats.hits + stats.misses;
+
+  ui_menu_add_button(MENU_TEXT, diag_root, "SD card sector cache");
+  ui_menu_add_divider(diag_root);
+  snprintf(line, sizeof(line), "Hits       %u", stats.hits);
+  ui_menu_add_button(MENU_TEXT, diag_root, line);
+  snprintf(line, sizeof(line), "Misses     %u", stats.misses);
+  ui_menu_add_button(MENU_TEXT, diag_root, line);
+  snprintf(line, sizeof(line), "Hit rate   %u%%",
+           total ? (unsigned)((uint64_t)stats.hits * 100 / total) : 0);
+  ui_menu_add_button(MENU_TEXT, diag_root, line);
+  snprintf(line, sizeof(line), "Card reads %u", stats.reads);
+  ui_menu_add_button(MENU_TEXT, diag_root, line);
+  snprintf(line, sizeof(line), "Read ahead %u", stats.prefetched);
+  ui_menu_add_button(MENU_TEXT, diag_root, line);
+  snprintf(line, sizeof(line), "Pinned     %u", stats.pinned);
+  ui_menu_add_button(MENU_TEXT, diag_root, line);
+  snprintf(line, sizeof(line), "Used       %u/%u", stats.used, stats.size);
+  ui_menu_add_button(MENU_TEXT, diag_root, line);
+
+  emux_add_diagnostics(diag_root);
+}
+
 static void configure_usb(int dev) {
   struct menu_item *usb_root = ui_push_menu(-1, -1);
   build_usb_menu(dev, usb_root);
@@ -877,37 +882,17 @@ static void next_integer_scaling(int layer,
 }
 
 static int save_settings() {
-  FILE *fp;
-  switch (emux_machine_class) {
-  case BMC64_MACHINE_CLASS_C64:
-    fp = fopen("/settings.txt", "w");
-    break;
-  case BMC64_MACHINE_CLASS_C128:
-    fp = fopen("/settings-c128.txt", "w");
-    break;
-  case BMC64_MACHINE_CLASS_VIC20:
-    fp = fopen("/settings-vic20.txt", "w");
-    break;
-  case BMC64_MACHINE_CLASS_PLUS4:
-    fp = fopen("/settings-plus4.txt", "w");
-    break;
-  case BMC64_MACHINE_CLASS_PLUS4EMU:
-    fp = fopen("/settings-plus4emu.txt", "w");
-    break;
-  case BMC64_MACHINE_CLASS_PET:
-    fp = fopen("/settings-pet.txt", "w");
-    break;
-  default:
-    printf("ERROR: Unhandled machine\n");
-    return 1;
-  }
-
+  // Emulator resources are saved right away so that later changes the
+  // user did not save can't end up in them. Our own settings are rendered
+  // to memory here and written to the card later by settings_store_poll/
+  // flush, so repeated saves cost a single write.
   int r = emux_save_settings();
   if (r < 0) {
     printf("resource_save failed with %d\n", r);
     return 1;
   }
 
+  FILE *fp = settings_store_begin();
   if (fp == NULL)
     return 1;
 
@@ -956,7 +941,9 @@ static int save_settings() {
   fprintf(fp, "vkbd_trans=%d\n", vkbd_transparency_item->value);
   fprintf(fp, "tapereset=%d\n", tape_reset_with_machine_item->value);
   fprintf(fp, "reset_confirm=%d\n", reset_confirm_item->value);
+  fprintf(fp, "auto_warp=%d\n", auto_warp_item->value);
   fprintf(fp, "scaling_interp=%d\n", scaling_interp_item->value);
+  fprintf(fp, "pal_filter=%d\n", pal_filter_item->value);
   fprintf(fp, "gpio_config=%d\n", gpio_config_item->choice_ints[gpio_config_item->value]);
   fprintf(fp, "h_center_0=%d\n", h_center_item[0]->value);
   fprintf(fp, "v_center_0=%d\n", v_center_item[0]->value);
@@ -1040,9 +1027,7 @@ static int save_settings() {
 
   emux_save_additional_settings(fp);
 
-  fclose(fp);
-
-  return 0;
+  return settings_store_end(fp);
 }
 
 // Make joydev reflect menu choice
@@ -1064,6 +1049,281 @@ static void ui_set_joy_devs() {
   }
 }
 
+static void load_setting(char *name, char *value_str, void *data) {
+  int *usb_btn_i = (int *)data;
+  int value = atoi(value_str);
+
+  if (emux_handle_loaded_setting(name, value_str, value)) {
+     return;
+  }
+
+  if (port_1_menu_item && strcmp(name, "port_1") == 0) {
+    port_1_menu_item->value = value;
+  } else if (port_2_menu_item && strcmp(name, "port_2") == 0) {
+    port_2_menu_item->value = value;
+  } else if (port_3_menu_item && strcmp(name, "port_3") == 0) {
+    port_3_menu_item->value = value;
+  } else if (port_4_menu_item && strcmp(name, "port_4") == 0) {
+    port_4_menu_item->value = value;
+  } else if (strcmp(name, "palette") == 0) {
+    palette_item[0]->value = value;
+    if (value >= palette_item[0]->num_choices) {
+       palette_item[1]->value = palette_item[0]->num_choices - 1;
+    }
+  } else if (strcmp(name, "palette2") == 0 && emux_machine_class == BMC64_MACHINE_CLASS_C128) {
+    palette_item[1]->value = value;
+    if (value >= palette_item[1]->num_choices) {
+       palette_item[1]->value = palette_item[1]->num_choices - 1;
+    }
+  } else if (strcmp(name, "alt_f12") == 0) {
+    // Old. Equivalent to cf7 = Menu
+    hotkey_cf7_item->value = HOTKEY_CHOICE_MENU;
+  } else if (strcmp(name, "overlay") == 0) { // legacy name
+    statusbar_item->value = value;
+  } else if (strcmp(name, "overlay_padding") == 0) { // legacy name
+    statusbar_padding_item->value = value;
+  } else if (strcmp(name, "vkbd_trans") == 0) {
+    vkbd_transparency_item->value = value;
+  } else if (strcmp(name, "tapereset") == 0) {
+    tape_reset_with_machine_item->value = value;
+  } else if (strcmp(name, "pot_x_high") == 0) {
+    pot_x_high_value = value;
+  } else if (strcmp(name, "pot_x_low") == 0) {
+    pot_x_low_value = value;
+  } else if (strcmp(name, "pot_y_high") == 0) {
+    pot_y_high_value = value;
+  } else if (strcmp(name, "pot_y_low") == 0) {
+    pot_y_low_value = value;
+  } else if (strcmp(name, "hotkey_cf1") == 0) {
+    hotkey_cf1_item->value = value;
+  } else if (strcmp(name, "hotkey_cf3") == 0) {
+    hotkey_cf3_item->value = value;
+  } else if (strcmp(name, "hotkey_cf5") == 0) {
+    hotkey_cf5_item->value = value;
+  } else if (strcmp(name, "hotkey_cf7") == 0) {
+    hotkey_cf7_item->value = value;
+  } else if (strcmp(name, "hotkey_tf1") == 0) {
+    hotkey_tf1_item->value = value;
+  } else if (strcmp(name, "hotkey_tf3") == 0) {
+    hotkey_tf3_item->value = value;
+  } else if (strcmp(name, "hotkey_tf5") == 0) {
+    hotkey_tf5_item->value = value;
+  } else if (strcmp(name, "hotkey_tf7") == 0) {
+    hotkey_tf7_item->value = value;
+  } else if (strcmp(name, "reset_confirm") == 0) {
+    reset_confirm_item->value = value;
+  } else if (strcmp(name, "auto_warp") == 0) {
+    auto_warp_item->value = value;
+    autowarp_set_enabled(value);
+  } else if (strcmp(name, "scaling_interp") == 0) {
+    scaling_interp_item->value = value;
+  } else if (strcmp(name, "pal_filter") == 0) {
+    pal_filter_item->value = value;
+  } else if (strcmp(name, "gpio_config") == 0) {
+    // We save/restore the choice int and map back to
+    // the value as index into the choices for this
+    // param.
+    switch(value) {
+      case GPIO_CONFIG_NAV_JOY:
+         gpio_config_item->value = 1;
+         break;
+      case GPIO_CONFIG_KYB_JOY:
+         gpio_config_item->value = 2;
+         break;
+      case GPIO_CONFIG_WAVESHARE:
+         gpio_config_item->value = 3;
+         break;
+      case GPIO_CONFIG_USERPORT:
+         gpio_config_item->value = 4;
+         break;
+      case GPIO_CONFIG_CUSTOM:
+         gpio_config_item->value = 5;
+         break;
+      default:
+         // Disabled
+         gpio_config_item->value = 0;
+         break;
+    }
+
+    // Force disabled if kernel options says so.
+    if (!circle_gpio_enabled()) {
+       gpio_config_item->value = 0;
+    }
+
+    // Make sure pins are configured properly after load
+    circle_reset_gpio(emu_get_gpio_config());
+  } else if (strcmp(name, "keyset_1_up") == 0) {
+    keyset_codes[0][KEYSET_UP] = value;
+  } else if (strcmp(name, "keyset_1_down") == 0) {
+    keyset_codes[0][KEYSET_DOWN] = value;
+  } else if (strcmp(name, "keyset_1_left") == 0) {
+    keyset_codes[0][KEYSET_LEFT] = value;
+  } else if (strcmp(name, "keyset_1_right") == 0) {
+    keyset_codes[0][KEYSET_RIGHT] = value;
+  } else if (strcmp(name, "keyset_1_fire") == 0) {
+    keyset_codes[0][KEYSET_FIRE] = value;
+  } else if (strcmp(name, "keyset_1_potx") == 0) {
+    keyset_codes[0][KEYSET_POTX] = value;
+  } else if (strcmp(name, "keyset_1_poty") == 0) {
+    keyset_codes[0][KEYSET_POTY] = value;
+  } else if (strcmp(name, "keyset_2_up") == 0) {
+    keyset_codes[1][KEYSET_UP] = value;
+  } else if (strcmp(name, "keyset_2_down") == 0) {
+    keyset_codes[1][KEYSET_DOWN] = value;
+  } else if (strcmp(name, "keyset_2_left") == 0) {
+    keyset_codes[1][KEYSET_LEFT] = value;
+  } else if (strcmp(name, "keyset_2_right") == 0) {
+    keyset_codes[1][KEYSET_RIGHT] = value;
+  } else if (strcmp(name, "keyset_2_fire") == 0) {
+    keyset_codes[1][KEYSET_FIRE] = value;
+  } else if (strcmp(name, "keyset_2_potx") == 0) {
+    keyset_codes[1][KEYSET_POTX] = value;
+  } else if (strcmp(name, "keyset_2_poty") == 0) {
+    keyset_codes[1][KEYSET_POTY] = value;
+  } else if (strcmp(name, "key_binding_1") == 0) {
+    key_bindings[0] = value;
+  } else if (strcmp(name, "key_binding_2") == 0) {
+    key_bindings[1] = value;
+  } else if (strcmp(name, "key_binding_3") == 0) {
+    key_bindings[2] = value;
+  } else if (strcmp(name, "key_binding_4") == 0) {
+    key_bindings[3] = value;
+  } else if (strcmp(name, "key_binding_5") == 0) {
+    key_bindings[4] = value;
+  } else if (strcmp(name, "key_binding_6") == 0) {
+    key_bindings[5] = value;
+  } else if (strcmp(name, "h_center_0") == 0) {
+    h_center_item[0]->value = value;
+  } else if (strcmp(name, "v_center_0") == 0) {
+    v_center_item[0]->value = value;
+  } else if (strcmp(name, "h_border_trim_0") == 0) {
+    // LEGACY NAME : menu value = max_border_w * value / 100.
+    h_border_item[0]->value =
+       h_border_item[0]->max * (1.0d - (value / 100.0d));
+    // If this exists, we're going to default use_scaling_params to
+    // 0 so we don't clobber user settings. This will never happen
+    // again after the user saves at least once.
+    use_scaling_params_item[0]->value = 0;
+  } else if (strcmp(name, "v_border_trim_0") == 0) {
+    // LEGACY NAME : menu value = max_border_h * value / 100.
+    v_border_item[0]->value =
+       v_border_item[0]->max * (1.0d - (value / 100.0d));
+    // If this exists, we're going to default use_scaling_params to
+    // 0 so we don't clobber user settings. This will never happen
+    // again after the user saves at least once.
+    use_scaling_params_item[0]->value = 0;
+  } else if (strcmp(name, "aspect_0") == 0) {
+    // LEGACY NAME : aspect * 10 = h_stretch
+    h_stretch_item[0]->value = value * 10;
+  } else if (strcmp(name, "h_border_0") == 0) {
+    h_border_item[0]->value = value;
+  } else if (strcmp(name, "v_border_0") == 0) {
+    v_border_item[0]->value = value;
+  } else if (strcmp(name, "h_stretch_0") == 0) {
+    h_stretch_item[0]->value = value;
+  } else if (strcmp(name, "v_stretch_0") == 0) {
+    v_stretch_item[0]->value = value;
+  } else if (strcmp(name, "h_center_1") == 0 && emux_machine_class == BMC64_MACHINE_CLASS_C128) {
+    h_center_item[1]->value = value;
+  } else if (strcmp(name, "v_center_1") == 0 && emux_machine_class == BMC64_MACHINE_CLASS_C128) {
+    v_center_item[1]->value = value;
+  } else if (strcmp(name, "h_border_trim_1") == 0 && emux_machine_class == BMC64_MACHINE_CLASS_C128) {
+    // LEGACY NAME : menu value = max_border_w * value / 100.
+    h_border_item[1]->value = h_border_item[1]->max * (1.0d - (value / 100.0d));
+    // If this exists, we're going to default use_scaling_params to
+    // 0 so we don't clobber user settings. This will never happen
+    // again after the user saves at least once.
+    use_scaling_params_item[1]->value = 0;
+  } else if (strcmp(name, "v_border_trim_1") == 0 && emux_machine_class == BMC64_MACHINE_CLASS_C128) {
+    // LEGACY NAME : menu value = max_border_h * value / 100.
+    v_border_item[1]->value = v_border_item[1]->max * (1.0d - (value / 100.0d));
+    // If this exists, we're going to default use_scaling_params to
+    // 0 so we don't clobber user settings. This will never happen
+    // again after the user saves at least once.
+    use_scaling_params_item[1]->value = 0;
+  } else if (strcmp(name, "aspect_1") == 0 && emux_machine_class == BMC64_MACHINE_CLASS_C128) {
+    // LEGACY NAME : aspect * 10 = h_stretch
+    h_stretch_item[1]->value = value * 10;
+  } else if (strcmp(name, "h_border_1") == 0 && emux_machine_class == BMC64_MACHINE_CLASS_C128) {
+    h_border_item[1]->value = value;
+  } else if (strcmp(name, "v_border_1") == 0 && emux_machine_class == BMC64_MACHINE_CLASS_C128) {
+    v_border_item[1]->value = value;
+  } else if (strcmp(name, "h_stretch_1") == 0 && emux_machine_class == BMC64_MACHINE_CLASS_C128) {
+    h_stretch_item[1]->value = value;
+  } else if (strcmp(name, "v_stretch_1") == 0 && emux_machine_class == BMC64_MACHINE_CLASS_C128) {
+    v_stretch_item[1]->value = value;
+  } else if (strcmp(name, "volume") == 0) {
+    volume_item->value = value;
+  } else if (strcmp(name, "dir_convention") == 0) {
+    dir_convention_item->value = value;
+  } else if (strcmp(name, "use_int_scaling_0") == 0) {
+    use_scaling_params_item[0]->value = value;
+  } else if (strcmp(name, "use_int_scaling_1") == 0 && emux_machine_class == BMC64_MACHINE_CLASS_C128) {
+    use_scaling_params_item[1]->value = value;
+  } else if (strcmp(name, "s_curvature") == 0) {
+    s_curvature_item->value = value;
+  } else if (strcmp(name, "s_curvature_x") == 0) {
+    s_curvature_x_item->value = value;
+  } else if (strcmp(name, "s_curvature_y") == 0) {
+    s_curvature_y_item->value = value;
+  } else if (strcmp(name, "s_sharper") == 0) {
+    s_sharper_item->value = value;
+  } else if (strcmp(name, "s_mask") == 0) {
+    s_mask_item->value = value;
+  } else if (strcmp(name, "s_mask_brightness") == 0) {
+    s_mask_brightness_item->value = value;
+  } else if (strcmp(name, "s_scanlines") == 0) {
+    s_scanlines_item->value = value;
+  } else if (strcmp(name, "s_multisample") == 0) {
+    s_multisample_item->value = value;
+  } else if (strcmp(name, "s_scanline_weight") == 0) {
+    s_scanline_weight_item->value = value;
+  } else if (strcmp(name, "s_scanline_gap_brightness") == 0) {
+    s_scanline_gap_brightness_item->value = value;
+  } else if (strcmp(name, "s_bloom_factor") == 0) {
+    s_bloom_factor_item->value = value;
+  } else if (strcmp(name, "s_gamma") == 0) {
+    s_gamma_item->value = value;
+  } else if (strcmp(name, "s_input_gamma") == 0) {
+    s_input_gamma_item->value = value;
+  } else if (strcmp(name, "s_output_gamma") == 0) {
+    s_output_gamma_item->value = value;
+  } else if (strcmp(name, "custom_gpio") == 0) {
+    char* token = strtok (value_str, ",");
+    if (token != NULL) {
+       int pin_index = atoi(token);
+       if (pin_index >=0 && pin_index < NUM_GPIO_PINS) {
+          token = strtok (NULL, ",");
+          unsigned int binding_value = token ? atoi(token) : 0;
+          gpio_bindings[pin_index] = binding_value;
+       }
+    }
+  } else {
+    for (int k=0; k < MAX_USB_DEVICES; k++) {
+     if (strcmp(name, usb_btn_name[k]) == 0) {
+       if (value >= NUM_BUTTON_ASSIGNMENTS) {
+          value = NUM_BUTTON_ASSIGNMENTS - 1;
+       }
+       usb_button_assignments[k][usb_btn_i[k]] = value;
+       usb_btn_i[k]++;
+       if (usb_btn_i[k] >= MAX_USB_BUTTONS) {
+         usb_btn_i[k] = 0;
+       }
+     } else if (strcmp(name, usb_pref_name[k]) == 0) {
+       usb_pref[k] = value;
+     } else if (strcmp(name, usb_x_name[k]) == 0) {
+       usb_x_axis[k] = value;
+     } else if (strcmp(name, usb_y_name[k]) == 0) {
+       usb_y_axis[k] = value;
+     } else if (strcmp(name, usb_x_t_name[k]) == 0) {
+       usb_x_thresh[k] = ((float)value) / 100.0f;
+     } else if (strcmp(name, usb_y_t_name[k]) == 0) {
+       usb_y_thresh[k] = ((float)value) / 100.0f;
+     }
+    }
+  }
+}
+
 static void load_settings() {
 
   int tmp_value;
@@ -1092,323 +1352,11 @@ static void load_settings() {
   pot_y_high_value = 192;
   pot_y_low_value = 64;
 
-  FILE *fp;
-  switch (emux_machine_class) {
-  case BMC64_MACHINE_CLASS_C64:
-    fp = fopen("/settings.txt", "r");
-    break;
-  case BMC64_MACHINE_CLASS_C128:
-    fp = fopen("/settings-c128.txt", "r");
-    break;
-  case BMC64_MACHINE_CLASS_VIC20:
-    fp = fopen("/settings-vic20.txt", "r");
-    break;
-  case BMC64_MACHINE_CLASS_PLUS4:
-    fp = fopen("/settings-plus4.txt", "r");
-    break;
-  case BMC64_MACHINE_CLASS_PLUS4EMU:
-    fp = fopen("/settings-plus4emu.txt", "r");
-    break;
-  case BMC64_MACHINE_CLASS_PET:
-    fp = fopen("/settings-pet.txt", "r");
-    break;
-  default:
-    printf("ERROR: Unhandled machine\n");
-    return;
-  }
-
-  if (fp == NULL)
-    return;
-
-  char name_value[256];
-  size_t len;
-  int value;
   int usb_btn_i[MAX_USB_DEVICES];
   memset(usb_btn_i, 0, sizeof(usb_btn_i));
 
-  while (1) {
-    char *line = fgets(name_value, 255, fp);
-    if (feof(fp) || line == NULL) break;
-
-    strcpy(name_value, line);
-
-    char *name;
-    char *value_str;
-    get_key_and_value(name_value, &name, &value_str);
-    if (!name || !value_str ||
-       strlen(name) == 0 ||
-          strlen(value_str) == 0) {
-       continue;
-    }
-
-    value = atoi(value_str);
-
-    if (emux_handle_loaded_setting(name, value_str, value)) {
-       continue;
-    }
-
-    if (port_1_menu_item && strcmp(name, "port_1") == 0) {
-      port_1_menu_item->value = value;
-    } else if (port_2_menu_item && strcmp(name, "port_2") == 0) {
-      port_2_menu_item->value = value;
-    } else if (port_3_menu_item && strcmp(name, "port_3") == 0) {
-      port_3_menu_item->value = value;
-    } else if (port_4_menu_item && strcmp(name, "port_4") == 0) {
-      port_4_menu_item->value = value;
-    } else if (strcmp(name, "palette") == 0) {
-      palette_item[0]->value = value;
-      if (value >= palette_item[0]->num_choices) {
-         palette_item[1]->value = palette_item[0]->num_choices - 1;
-      }
-    } else if (strcmp(name, "palette2") == 0 && emux_machine_class == BMC64_MACHINE_CLASS_C128) {
-      palette_item[1]->value = value;
-      if (value >= palette_item[1]->num_choices) {
-         palette_item[1]->value = palette_item[1]->num_choices - 1;
-      }
-    } else if (strcmp(name, "alt_f12") == 0) {
-      // Old. Equivalent to cf7 = Menu
-      hotkey_cf7_item->value = HOTKEY_CHOICE_MENU;
-    } else if (strcmp(name, "overlay") == 0) { // legacy name
-      statusbar_item->value = value;
-    } else if (strcmp(name, "overlay_padding") == 0) { // legacy name
-      statusbar_padding_item->value = value;
-    } else if (strcmp(name, "vkbd_trans") == 0) {
-      vkbd_transparency_item->value = value;
-    } else if (strcmp(name, "tapereset") == 0) {
-      tape_reset_with_machine_item->value = value;
-    } else if (strcmp(name, "pot_x_high") == 0) {
-      pot_x_high_value = value;
-    } else if (strcmp(name, "pot_x_low") == 0) {
-      pot_x_low_value = value;
-    } else if (strcmp(name, "pot_y_high") == 0) {
-      pot_y_high_value = value;
-    } else if (strcmp(name, "pot_y_low") == 0) {
-      pot_y_low_value = value;
-    } else if (strcmp(name, "hotkey_cf1") == 0) {
-      hotkey_cf1_item->value = value;
-    } else if (strcmp(name, "hotkey_cf3") == 0) {
-      hotkey_cf3_item->value = value;
-    } else if (strcmp(name, "hotkey_cf5") == 0) {
-      hotkey_cf5_item->value = value;
-    } else if (strcmp(name, "hotkey_cf7") == 0) {
-      hotkey_cf7_item->value = value;
-    } else if (strcmp(name, "hotkey_tf1") == 0) {
-      hotkey_tf1_item->value = value;
-    } else if (strcmp(name, "hotkey_tf3") == 0) {
-      hotkey_tf3_item->value = value;
-    } else if (strcmp(name, "hotkey_tf5") == 0) {
-      hotkey_tf5_item->value = value;
-    } else if (strcmp(name, "hotkey_tf7") == 0) {
-      hotkey_tf7_item->value = value;
-    } else if (strcmp(name, "reset_confirm") == 0) {
-      reset_confirm_item->value = value;
-    } else if (strcmp(name, "scaling_interp") == 0) {
-      scaling_interp_item->value = value;
-    } else if (strcmp(name, "gpio_config") == 0) {
-      // We save/restore the choice int and map back to
-      // the value as index into the choices for this
-      // param.
-      switch(value) {
-        case GPIO_CONFIG_NAV_JOY:
-           gpio_config_item->value = 1;
-           break;
-        case GPIO_CONFIG_KYB_JOY:
-           gpio_config_item->value = 2;
-           break;
-        case GPIO_CONFIG_WAVESHARE:
-           gpio_config_item->value = 3;
-           break;
-        case GPIO_CONFIG_USERPORT:
-           gpio_config_item->value = 4;
-           break;
-        case GPIO_CONFIG_CUSTOM:
-           gpio_config_item->value = 5;
-           break;
-        default:
-           // Disabled
-           gpio_config_item->value = 0;
-           break;
-      }
-
-      // Force disabled if kernel options says so.
-      if (!circle_gpio_enabled()) {
-         gpio_config_item->value = 0;
-      }
-
-      // Make sure pins are configured properly after load
-      circle_reset_gpio(emu_get_gpio_config());
-    } else if (strcmp(name, "keyset_1_up") == 0) {
-      keyset_codes[0][KEYSET_UP] = value;
-    } else if (strcmp(name, "keyset_1_down") == 0) {
-      keyset_codes[0][KEYSET_DOWN] = value;
-    } else if (strcmp(name, "keyset_1_left") == 0) {
-      keyset_codes[0][KEYSET_LEFT] = value;
-    } else if (strcmp(name, "keyset_1_right") == 0) {
-      keyset_codes[0][KEYSET_RIGHT] = value;
-    } else if (strcmp(name, "keyset_1_fire") == 0) {
-      keyset_codes[0][KEYSET_FIRE] = value;
-    } else if (strcmp(name, "keyset_1_potx") == 0) {
-      keyset_codes[0][KEYSET_POTX] = value;
-    } else if (strcmp(name, "keyset_1_poty") == 0) {
-      keyset_codes[0][KEYSET_POTY] = value;
-    } else if (strcmp(name, "keyset_2_up") == 0) {
-      keyset_codes[1][KEYSET_UP] = value;
-    } else if (strcmp(name, "keyset_2_down") == 0) {
-      keyset_codes[1][KEYSET_DOWN] = value;
-    } else if (strcmp(name, "keyset_2_left") == 0) {
-      keyset_codes[1][KEYSET_LEFT] = value;
-    } else if (strcmp(name, "keyset_2_right") == 0) {
-      keyset_codes[1][KEYSET_RIGHT] = value;
-    } else if (strcmp(name, "keyset_2_fire") == 0) {
-      keyset_codes[1][KEYSET_FIRE] = value;
-    } else if (strcmp(name, "keyset_2_potx") == 0) {
-      keyset_codes[1][KEYSET_POTX] = value;
-    } else if (strcmp(name, "keyset_2_poty") == 0) {
-      keyset_codes[1][KEYSET_POTY] = value;
-    } else if (strcmp(name, "key_binding_1") == 0) {
-      key_bindings[0] = value;
-    } else if (strcmp(name, "key_binding_2") == 0) {
-      key_bindings[1] = value;
-    } else if (strcmp(name, "key_binding_3") == 0) {
-      key_bindings[2] = value;
-    } else if (strcmp(name, "key_binding_4") == 0) {
-      key_bindings[3] = value;
-    } else if (strcmp(name, "key_binding_5") == 0) {
-      key_bindings[4] = value;
-    } else if (strcmp(name, "key_binding_6") == 0) {
-      key_bindings[5] = value;
-    } else if (strcmp(name, "h_center_0") == 0) {
-      h_center_item[0]->value = value;
-    } else if (strcmp(name, "v_center_0") == 0) {
-      v_center_item[0]->value = value;
-    } else if (strcmp(name, "h_border_trim_0") == 0) {
-      // LEGACY NAME : menu value = max_border_w * value / 100.
-      h_border_item[0]->value =
-         h_border_item[0]->max * (1.0d - (value / 100.0d));
-      // If this exists, we're going to default use_scaling_params to
-      // 0 so we don't clobber user settings. This will never happen
-      // again after the user saves at least once.
-      use_scaling_params_item[0]->value = 0;
-    } else if (strcmp(name, "v_border_trim_0") == 0) {
-      // LEGACY NAME : menu value = max_border_h * value / 100.
-      v_border_item[0]->value =
-         v_border_item[0]->max * (1.0d - (value / 100.0d));
-      // If this exists, we're going to default use_scaling_params to
-      // 0 so we don't clobber user settings. This will never happen
-      // again after the user saves at least once.
-      use_scaling_params_item[0]->value = 0;
-    } else if (strcmp(name, "aspect_0") == 0) {
-      // LEGACY NAME : aspect * 10 = h_stretch
-      h_stretch_item[0]->value = value * 10;
-    } else if (strcmp(name, "h_border_0") == 0) {
-      h_border_item[0]->value = value;
-    } else if (strcmp(name, "v_border_0") == 0) {
-      v_border_item[0]->value = value;
-    } else if (strcmp(name, "h_stretch_0") == 0) {
-      h_stretch_item[0]->value = value;
-    } else if (strcmp(name, "v_stretch_0") == 0) {
-      v_stretch_item[0]->value = value;
-    } else if (strcmp(name, "h_center_1") == 0 && emux_machine_class == BMC64_MACHINE_CLASS_C128) {
-      h_center_item[1]->value = value;
-    } else if (strcmp(name, "v_center_1") == 0 && emux_machine_class == BMC64_MACHINE_CLASS_C128) {
-      v_center_item[1]->value = value;
-    } else if (strcmp(name, "h_border_trim_1") == 0 && emux_machine_class == BMC64_MACHINE_CLASS_C128) {
-      // LEGACY NAME : menu value = max_border_w * value / 100.
-      h_border_item[1]->value = h_border_item[1]->max * (1.0d - (value / 100.0d));
-      // If this exists, we're going to default use_scaling_params to
-      // 0 so we don't clobber user settings. This will never happen
-      // again after the user saves at least once.
-      use_scaling_params_item[1]->value = 0;
-    } else if (strcmp(name, "v_border_trim_1") == 0 && emux_machine_class == BMC64_MACHINE_CLASS_C128) {
-      // LEGACY NAME : menu value = max_border_h * value / 100.
-      v_border_item[1]->value = v_border_item[1]->max * (1.0d - (value / 100.0d));
-      // If this exists, we're going to default use_scaling_params to
-      // 0 so we don't clobber user settings. This will never happen
-      // again after the user saves at least once.
-      use_scaling_params_item[1]->value = 0;
-    } else if (strcmp(name, "aspect_1") == 0 && emux_machine_class == BMC64_MACHINE_CLASS_C128) {
-      // LEGACY NAME : aspect * 10 = h_stretch
-      h_stretch_item[1]->value = value * 10;
-    } else if (strcmp(name, "h_border_1") == 0 && emux_machine_class == BMC64_MACHINE_CLASS_C128) {
-      h_border_item[1]->value = value;
-    } else if (strcmp(name, "v_border_1") == 0 && emux_machine_class == BMC64_MACHINE_CLASS_C128) {
-      v_border_item[1]->value = value;
-    } else if (strcmp(name, "h_stretch_1") == 0 && emux_machine_class == BMC64_MACHINE_CLASS_C128) {
-      h_stretch_item[1]->value = value;
-    } else if (strcmp(name, "v_stretch_1") == 0 && emux_machine_class == BMC64_MACHINE_CLASS_C128) {
-      v_stretch_item[1]->value = value;
-    } else if (strcmp(name, "volume") == 0) {
-      volume_item->value = value;
-    } else if (strcmp(name, "dir_convention") == 0) {
-      dir_convention_item->value = value;
-    } else if (strcmp(name, "use_int_scaling_0") == 0) {
-      use_scaling_params_item[0]->value = value;
-    } else if (strcmp(name, "use_int_scaling_1") == 0 && emux_machine_class == BMC64_MACHINE_CLASS_C128) {
-      use_scaling_params_item[1]->value = value;
-    } else if (strcmp(name, "s_curvature") == 0) {
-      s_curvature_item->value = value;
-    } else if (strcmp(name, "s_curvature_x") == 0) {
-      s_curvature_x_item->value = value;
-    } else if (strcmp(name, "s_curvature_y") == 0) {
-      s_curvature_y_item->value = value;
-    } else if (strcmp(name, "s_sharper") == 0) {
-      s_sharper_item->value = value;
-    } else if (strcmp(name, "s_mask") == 0) {
-      s_mask_item->value = value;
-    } else if (strcmp(name, "s_mask_brightness") == 0) {
-      s_mask_brightness_item->value = value;
-    } else if (strcmp(name, "s_scanlines") == 0) {
-      s_scanlines_item->value = value;
-    } else if (strcmp(name, "s_multisample") == 0) {
-      s_multisample_item->value = value;
-    } else if (strcmp(name, "s_scanline_weight") == 0) {
-      s_scanline_weight_item->value = value;
-    } else if (strcmp(name, "s_scanline_gap_brightness") == 0) {
-      s_scanline_gap_brightness_item->value = value;
-    } else if (strcmp(name, "s_bloom_factor") == 0) {
-      s_bloom_factor_item->value = value;
-    } else if (strcmp(name, "s_gamma") == 0) {
-      s_gamma_item->value = value;
-    } else if (strcmp(name, "s_input_gamma") == 0) {
-      s_input_gamma_item->value = value;
-    } else if (strcmp(name, "s_output_gamma") == 0) {
-      s_output_gamma_item->value = value;
-    } else if (strcmp(name, "custom_gpio") == 0) {
-      char* token = strtok (value_str, ",");
-      if (token != NULL) {
-         int pin_index = atoi(token);
-         if (pin_index >=0 && pin_index < NUM_GPIO_PINS) {
-            token = strtok (NULL, ",");
-            unsigned int binding_value = token ? atoi(token) : 0;
-            gpio_bindings[pin_index] = binding_value;
-         }
-      }
-    } else {
-      for (int k=0; k < MAX_USB_DEVICES; k++) {
-       if (strcmp(name, usb_btn_name[k]) == 0) {
-         if (value >= NUM_BUTTON_ASSIGNMENTS) {
-            value = NUM_BUTTON_ASSIGNMENTS - 1;
-         }
-         usb_button_assignments[k][usb_btn_i[k]] = value;
-         usb_btn_i[k]++;
-         if (usb_btn_i[k] >= MAX_USB_BUTTONS) {
-           usb_btn_i[k] = 0;
-         }
-       } else if (strcmp(name, usb_pref_name[k]) == 0) {
-         usb_pref[k] = value;
-       } else if (strcmp(name, usb_x_name[k]) == 0) {
-         usb_x_axis[k] = value;
-       } else if (strcmp(name, usb_y_name[k]) == 0) {
-         usb_y_axis[k] = value;
-       } else if (strcmp(name, usb_x_t_name[k]) == 0) {
-         usb_x_thresh[k] = ((float)value) / 100.0f;
-       } else if (strcmp(name, usb_y_t_name[k]) == 0) {
-         usb_y_thresh[k] = ((float)value) / 100.0f;
-       }
-      }
-    }
-  }
-  fclose(fp);
+  if (settings_store_load(load_setting, usb_btn_i))
+    return;
 
   emux_load_settings_done();
 
@@ -2452,6 +2400,9 @@ static void menu_value_changed(struct menu_item *item) {
   case MENU_LICENSE:
     show_license();
     return;
+  case MENU_DIAGNOSTICS:
+    show_diagnostics();
+    return;
   case MENU_USB_0_CONFIGURE:
   case MENU_USB_1_CONFIGURE:
   case MENU_USB_2_CONFIGURE:
@@ -2474,6 +2425,9 @@ static void menu_value_changed(struct menu_item *item) {
   case MENU_WARP_MODE:
     toggle_warp(item->value);
     return;
+  case MENU_AUTO_WARP:
+    autowarp_set_enabled(item->value);
+    return;
   case MENU_DEMO_MODE:
     raspi_demo_mode = item->value;
     demo_reset();
@@ -2798,6 +2752,12 @@ static void menu_value_changed(struct menu_item *item) {
   case MENU_DIR_CONVENTION:
     set_current_dir_names();
     break;
+  case MENU_PAL_FILTER:
+    ui_canvas_reveal_temp(FB_LAYER_VIC);
+    // Has no effect while the shader is on.
+    circle_set_pal_filter_fbl(FB_LAYER_VIC, item->value);
+    vic_showing = 0;
+    break;
   case MENU_SHADER_ENABLE:
     sanity_check_shader_params(item->id);
     ui_canvas_reveal_temp(FB_LAYER_VIC);
@@ -3220,6 +3180,7 @@ void build_menu(struct menu_item *root) {
 
   ui_menu_add_button(MENU_ABOUT, root, "About...");
   ui_menu_add_button(MENU_LICENSE, root, "License...");
+  ui_menu_add_button(MENU_DIAGNOSTICS, root, "Diagnostics...");
 
   ui_menu_add_divider(root);
 
@@ -3397,6 +3358,9 @@ void build_menu(struct menu_item *root) {
      MENU_USE_SCALING_PARAMS_0, parent, "Apply scaling params at boot", 1,
         "No","Yes");
 
+  pal_filter_item = ui_menu_add_toggle_labels(
+     MENU_PAL_FILTER, parent, "Software PAL Filter", 0, "Off", "On");
+
   struct menu_item *shader = ui_menu_add_folder(parent, "CRT Shader");
 
      int crt_filter;
@@ -3798,6 +3762,7 @@ void build_menu(struct menu_item *root) {
         folder_emu, emu_folder);
 
   warp_item = ui_menu_add_toggle(MENU_WARP_MODE, root, "Warp Mode", 0);
+  auto_warp_item = ui_menu_add_toggle(MENU_AUTO_WARP, root, "Auto Warp", 0);
 
   // This is an undocumented feature for now. Keep invisible unless it
   // is activated by cmdline.txt
@@ -3827,6 +3792,8 @@ void build_menu(struct menu_item *root) {
      }
   }
 
+  circle_set_pal_filter_fbl(FB_LAYER_VIC, pal_filter_item->value);
+
   // Apply shader params
   sanity_check_shader_params(s_enable_shader_item->id);
   circle_realloc_fbl(FB_LAYER_VIC, allow_shader() ? s_enable_shader_item->value : 0);
@@ -3905,6 +3872,12 @@ int statusbar_always(void) {
 // Stuff to do when menu is activated
 void menu_about_to_activate() {
   emux_get_int(Setting_WarpMode, &warp_item->value);
+
+  unsigned long saved = autowarp_time_saved() / 1000;
+  if (saved > 0) {
+    snprintf(auto_warp_item->name, MAX_MENU_STR, "Auto Warp (saved %lu:%02lu)",
+             saved / 60, saved % 60);
+  }
 }
 
 // Stuff to do before going back to emulator
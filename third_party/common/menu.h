@@ -40,6 +40,7 @@
 typedef enum {
    MENU_ABOUT,
    MENU_LICENSE,
+   MENU_DIAGNOSTICS,
    MENU_ATTACH_DISK_8,
    MENU_ATTACH_DISK_9,
    MENU_ATTACH_DISK_10,
@@ -154,6 +155,7 @@ typedef enum {
    MENU_CONFIG_GP_2,
 
    MENU_WARP_MODE,
+   MENU_AUTO_WARP,
 
    MENU_AUTOSTART,
    MENU_AUTOSTART_WARP,
@@ -231,6 +233,7 @@ typedef enum {
 
    MENU_SID_WRITE_D400,  // PLUS4EMU
    MENU_SID_DIGIBLASTER, // PLUS4EMU
+   MENU_AUDIO_STEREO, // PLUS4EMU
 
    MENU_ERROR_DIALOG,
    MENU_INFO_DIALOG,
@@ -455,6 +458,7 @@ typedef enum {
    MENU_USE_SCALING_PARAMS_1,
 
    MENU_SCALING_INTERPOLATION,
+   MENU_PAL_FILTER,
 
    MENU_SHADER_ENABLE,
    MENU_SHADER_CURVATURE,
@@ -475,7 +479,9 @@ typedef enum {
 
    MENU_VIRTUAL_DEVICES,
    MENU_REU,
-   MENU_REU_SIZE
+   MENU_REU_SIZE,
+   MENU_TRUE_DRIVE_FAST_LOAD,
+   MENU_TAPE_FAST_LOAD
 } MenuID;
 
 typedef enum {
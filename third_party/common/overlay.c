@@ -31,6 +31,7 @@
 #include <string.h>
 
 // RASPI includes
+#include "autowarp.h"
 #include "emux_api.h"
 #include "menu.h"
 #include "ui.h"
@@ -339,6 +340,7 @@ static void draw_drive_led(int drive, unsigned int pwm1, unsigned int pwm2) {
 void emux_display_drive_led(int drive, unsigned int pwm1, unsigned int pwm2) {
   drive_pwm1[drive] = pwm1;
   drive_pwm2[drive] = pwm2;
+  autowarp_drive_led(drive, pwm1 | pwm2);
 
   if (!overlay_buf)
     return;
@@ -412,6 +414,7 @@ static void draw_tape_control_status(int control) {
 // Show tape control text
 void emux_display_tape_control_status(int control) {
   tape_control = control;
+  autowarp_tape_control(control);
 
   if (!overlay_buf)
     return;
@@ -435,6 +438,7 @@ static void draw_tape_motor_status(int motor) {
 // Draw tape motor status light
 void emux_display_tape_motor_status(int motor) {
   tape_motor = motor;
+  autowarp_tape_motor(motor);
 
   if (!overlay_buf)
     return;
@@ -0,0 +1,374 @@
+/*
+ * settings_store.c
+ *
+ * Written by
+ *  Randy Rossi <randy.rossi@gmail.com>
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+#include "settings_store.h"
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// RASPI includes
+#include "circle.h"
+#include "emux_api.h"
+
+// The cache holds the already split name/value pairs of the text file as
+// consecutive nul terminated strings. It is only trusted if the text file
+// still has the size, timestamp and checksum it had when the cache was
+// built. The text is still read on every load; the cache saves parsing it.
+#define SETTINGS_CACHE_MAGIC 0x53434d42 // BMCS
+#define SETTINGS_CACHE_VERSION 1
+#define SETTINGS_CACHE_MAX_DATA 65536
+
+// Longer lines are ignored. Callers copy values into fixed size buffers.
+#define SETTINGS_MAX_LINE 255
+
+// How long to wait after the last save before writing to the card.
+#define SETTINGS_FLUSH_DELAY 1000000
+
+struct settings_cache_header {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t text_size;
+  uint32_t text_mtime;
+  uint32_t text_checksum;
+  uint32_t data_size;
+  uint32_t data_checksum;
+};
+
+// Save in progress (memory stream) and save waiting to be flushed.
+static char *stream_buf;
+static size_t stream_len;
+static char *pending_text;
+static size_t pending_len;
+static int pending;
+static unsigned long pending_ticks;
+
+// What we know is in the text file on disk. Lets us skip rewriting it
+// if the user saves the same settings again.
+static int disk_text_known;
+static uint32_t disk_text_size;
+static uint32_t disk_text_checksum;
+
+static uint32_t checksum(const char *buf, size_t len) {
+  // FNV-1a
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < len; i++) {
+    h ^= (uint8_t)buf[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+const char *settings_store_path(void) {
+  switch (emux_machine_class) {
+  case BMC64_MACHINE_CLASS_C64:
+    return "/settings.txt";
+  case BMC64_MACHINE_CLASS_C128:
+    return "/settings-c128.txt";
+  case BMC64_MACHINE_CLASS_VIC20:
+    return "/settings-vic20.txt";
+  case BMC64_MACHINE_CLASS_PLUS4:
+    return "/settings-plus4.txt";
+  case BMC64_MACHINE_CLASS_PLUS4EMU:
+    return "/settings-plus4emu.txt";
+  case BMC64_MACHINE_CLASS_PET:
+    return "/settings-pet.txt";
+  default:
+    printf("ERROR: Unhandled machine\n");
+    return NULL;
+  }
+}
+
+// Same name as the text file but with a .bin extension.
+static void cache_path(const char *text_path, char *dst, size_t dst_len) {
+  strncpy(dst, text_path, dst_len - 1);
+  dst[dst_len - 1] = '\0';
+  char *ext = strrchr(dst, '.');
+  if (ext && strlen(ext) == 4) {
+    strcpy(ext, ".bin");
+  }
+}
+
+static void trim(char **txt) {
+  char *s = *txt;
+  while (isspace((unsigned char)*s)) s++;
+  int p = strlen(s) - 1;
+  while (p >= 0 && isspace((unsigned char)s[p])) { s[p] = '\0'; p--; }
+  *txt = s;
+}
+
+// Split 'text' into name/value pairs packed into 'pairs' (at least len + 1
+// bytes). Destroys 'text'. Returns the number of bytes used in 'pairs'.
+static size_t split_text(char *text, size_t len, char *pairs) {
+  size_t used = 0;
+  char *line = text;
+  char *end = text + len;
+  while (line < end) {
+    char *eol = memchr(line, '\n', end - line);
+    if (eol) {
+      *eol = '\0';
+    } else {
+      eol = end;
+      *eol = '\0';
+    }
+
+    char *eq = strchr(line, '=');
+    if (eq) {
+      *eq = '\0';
+      char *name = line;
+      char *value = eq + 1;
+      trim(&name);
+      trim(&value);
+      size_t name_len = strlen(name);
+      size_t value_len = strlen(value);
+      if (name_len > 0 && value_len > 0 &&
+          name_len + value_len < SETTINGS_MAX_LINE) {
+        memcpy(pairs + used, name, name_len + 1);
+        used += name_len + 1;
+        memcpy(pairs + used, value, value_len + 1);
+        used += value_len + 1;
+      }
+    }
+    line = eol + 1;
+  }
+  return used;
+}
+
+static void dispatch_pairs(char *pairs, size_t len,
+                           settings_store_func func, void *data) {
+  size_t i = 0;
+  while (i < len) {
+    char *name = pairs + i;
+    i += strlen(name) + 1;
+    if (i >= len) break;
+    char *value = pairs + i;
+    i += strlen(value) + 1;
+    func(name, value, data);
+  }
+}
+
+static int write_cache(const char *text_path, uint32_t text_checksum,
+                       const char *pairs, size_t pairs_len) {
+  struct stat st;
+  if (stat(text_path, &st) != 0) {
+    return 1;
+  }
+
+  struct settings_cache_header header;
+  header.magic = SETTINGS_CACHE_MAGIC;
+  header.version = SETTINGS_CACHE_VERSION;
+  header.text_size = st.st_size;
+  header.text_mtime = st.st_mtime;
+  header.text_checksum = text_checksum;
+  header.data_size = pairs_len;
+  header.data_checksum = checksum(pairs, pairs_len);
+
+  char path[64];
+  cache_path(text_path, path, sizeof(path));
+  FILE *fp = fopen(path, "w");
+  if (fp == NULL) {
+    return 1;
+  }
+  int ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+           fwrite(pairs, 1, pairs_len, fp) == pairs_len;
+  fclose(fp);
+  return !ok;
+}
+
+// Returns the validated cache data or NULL if the cache is stale.
+static char *read_cache(const char *text_path, struct stat *st,
+                        uint32_t text_checksum, size_t *len) {
+  char path[64];
+  cache_path(text_path, path, sizeof(path));
+  FILE *fp = fopen(path, "r");
+  if (fp == NULL) {
+    return NULL;
+  }
+
+  struct settings_cache_header header;
+  char *pairs = NULL;
+  if (fread(&header, sizeof(header), 1, fp) == 1 &&
+      header.magic == SETTINGS_CACHE_MAGIC &&
+      header.version == SETTINGS_CACHE_VERSION &&
+      header.text_size == (uint32_t)st->st_size &&
+      header.text_mtime == (uint32_t)st->st_mtime &&
+      header.text_checksum == text_checksum &&
+      header.data_size <= SETTINGS_CACHE_MAX_DATA) {
+    pairs = malloc(header.data_size + 1);
+    if (pairs && (fread(pairs, 1, header.data_size, fp) != header.data_size ||
+                  checksum(pairs, header.data_size) != header.data_checksum)) {
+      free(pairs);
+      pairs = NULL;
+    }
+  }
+  fclose(fp);
+
+  if (pairs) {
+    *len = header.data_size;
+  }
+  return pairs;
+}
+
+int settings_store_load(settings_store_func func, void *data) {
+  const char *text_path = settings_store_path();
+  if (text_path == NULL) {
+    return 1;
+  }
+
+  struct stat st;
+  if (stat(text_path, &st) != 0) {
+    return 1;
+  }
+
+  FILE *fp = fopen(text_path, "r");
+  if (fp == NULL) {
+    return 1;
+  }
+  char *text = malloc(st.st_size + 1);
+  if (text == NULL) {
+    fclose(fp);
+    return 1;
+  }
+  size_t text_len = fread(text, 1, st.st_size, fp);
+  fclose(fp);
+
+  disk_text_known = 1;
+  disk_text_size = text_len;
+  disk_text_checksum = checksum(text, text_len);
+
+  size_t pairs_len;
+  char *pairs = NULL;
+  if (text_len == (size_t)st.st_size) {
+    pairs = read_cache(text_path, &st, disk_text_checksum, &pairs_len);
+  }
+  if (pairs) {
+    free(text);
+    dispatch_pairs(pairs, pairs_len, func, data);
+    free(pairs);
+    return 0;
+  }
+
+  // Cache missing or stale. Parse the text and rebuild it.
+  pairs = malloc(text_len + 1);
+  if (pairs == NULL) {
+    free(text);
+    return 1;
+  }
+  pairs_len = split_text(text, text_len, pairs);
+  free(text);
+
+  // Cache before dispatching since handlers may modify the values.
+  if (pairs_len <= SETTINGS_CACHE_MAX_DATA) {
+    write_cache(text_path, disk_text_checksum, pairs, pairs_len);
+  }
+  dispatch_pairs(pairs, pairs_len, func, data);
+  free(pairs);
+  return 0;
+}
+
+FILE *settings_store_begin(void) {
+  stream_buf = NULL;
+  stream_len = 0;
+  return open_memstream(&stream_buf, &stream_len);
+}
+
+int settings_store_end(FILE *fp) {
+  if (fclose(fp) != 0 || stream_buf == NULL) {
+    free(stream_buf);
+    stream_buf = NULL;
+    return 1;
+  }
+
+  // Coalesce with any save that has not been flushed yet.
+  free(pending_text);
+  pending_text = stream_buf;
+  pending_len = stream_len;
+  stream_buf = NULL;
+  pending = 1;
+  pending_ticks = circle_get_ticks();
+  return 0;
+}
+
+int settings_store_poll(void) {
+  if (!pending) {
+    return 0;
+  }
+  if (circle_get_ticks() - pending_ticks < SETTINGS_FLUSH_DELAY) {
+    return 0;
+  }
+  return settings_store_flush();
+}
+
+int settings_store_flush(void) {
+  if (!pending) {
+    return 0;
+  }
+  pending = 0;
+
+  int err = 0;
+  const char *text_path = settings_store_path();
+  uint32_t text_checksum = checksum(pending_text, pending_len);
+  if (text_path == NULL) {
+    err = 1;
+  } else if (!disk_text_known || disk_text_size != pending_len ||
+             disk_text_checksum != text_checksum) {
+    // Drop the cache first. If the text is rewritten but the new cache
+    // never makes it to the card, the next load parses the text.
+    char bin_path[64];
+    cache_path(text_path, bin_path, sizeof(bin_path));
+    unlink(bin_path);
+
+    FILE *fp = fopen(text_path, "w");
+    if (fp == NULL) {
+      err = 1;
+    } else {
+      if (fwrite(pending_text, 1, pending_len, fp) != pending_len) {
+        err = 1;
+      }
+      fclose(fp);
+
+      disk_text_known = !err;
+      disk_text_size = pending_len;
+      disk_text_checksum = text_checksum;
+
+      char *pairs = malloc(pending_len + 1);
+      if (!err && pairs) {
+        size_t pairs_len = split_text(pending_text, pending_len, pairs);
+        if (pairs_len <= SETTINGS_CACHE_MAX_DATA) {
+          write_cache(text_path, text_checksum, pairs, pairs_len);
+        }
+      }
+      free(pairs);
+    }
+  }
+
+  free(pending_text);
+  pending_text = NULL;
+  pending_len = 0;
+  return err;
+}
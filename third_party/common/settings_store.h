@@ -0,0 +1,64 @@
+/*
+ * settings_store.h
+ *
+ * Written by
+ *  Randy Rossi <randy.rossi@gmail.com>
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef RASPI_SETTINGS_STORE_H
+#define RASPI_SETTINGS_STORE_H
+
+#include <stdio.h>
+
+// Called once for every name=value pair found in the settings file. Both
+// strings are trimmed, non-empty and may be modified by the callee.
+typedef void (*settings_store_func)(char *name, char *value_str, void *data);
+
+// Returns the settings text file for the current machine class.
+const char *settings_store_path(void);
+
+// Parse the settings file. The binary cache next to the text file is used
+// instead when it was built from the same text file. Otherwise the text is
+// parsed and the cache rebuilt. Returns non-zero if there is no settings
+// file.
+int settings_store_load(settings_store_func func, void *data);
+
+// Begin a settings save. Settings should be written to the returned stream
+// which is backed by memory. Returns NULL on failure.
+FILE *settings_store_begin(void);
+
+// Finish a save started by settings_store_begin. Nothing is written to
+// disk yet; emulator resources are not covered and must be saved by the
+// caller. The flush is deferred until settings_store_poll sees no more
+// saves for a while or settings_store_flush is called. Returns non-zero on
+// failure.
+int settings_store_end(FILE *fp);
+
+// Flush a pending save if enough time has passed since the last one.
+// Should only be called when the emulator is paused. Returns non-zero if
+// a flush was attempted and failed.
+int settings_store_poll(void);
+
+// Flush a pending save immediately. Returns non-zero on failure.
+int settings_store_flush(void);
+
+#endif
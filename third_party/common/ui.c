@@ -41,6 +41,7 @@
 #include "menu.h"
 #include "font.h"
 #include "menu_timing.h"
+#include "settings_store.h"
 
 #define COLOR16(r,g,b) (((r)>>3)<<11 | ((g)>>2)<<5 | (b)>>3)
 
@@ -82,6 +83,22 @@ static int ui_transparent;
 static int ui_transparent_layer; // which layer we are revealing for adjustment
 static int ui_render_current_item_only;
 
+// What ui_render_now(-1) last drew into ui_fb. While an osd is up, only
+// rows whose signature changed since then are redrawn.
+#define OSD_MAX_ROWS 64
+static struct {
+  int valid;
+  int stack_index;
+  struct menu_item *first;
+  int left, top, width, height;
+  int window_top, window_bottom;
+  int max_index;
+  int current_item_only;
+} osd_render_state;
+static uint32_t osd_row_sig[OSD_MAX_ROWS];
+static int ui_render_incremental;
+static int ui_render_rows_changed;
+
 // Stubs for vice callbacks. Unimplemented for now.
 void ui_pause_emulation(int flag) {}
 int ui_emulation_is_paused(void) { return 0; }
@@ -180,6 +197,25 @@ void ui_init_menu(void) {
   ui_key_ticks_repeats_next = 0;
 }
 
+// Font rows pre-expanded to byte masks (0xff where a pixel is set), one
+// table per horizontal stretch. Lets us blend the color into the
+// destination a word at a time instead of a pixel at a time.
+#define GLYPH_MAX_STRETCH 4
+static uint32_t glyph_row_mask[GLYPH_MAX_STRETCH][256][2 * GLYPH_MAX_STRETCH];
+static int glyph_row_mask_ready[GLYPH_MAX_STRETCH];
+
+static void ui_init_glyph_row_mask(int stretch) {
+  for (int b = 0; b < 256; b++) {
+    uint8_t *mask = (uint8_t *)glyph_row_mask[stretch - 1][b];
+    for (int x = 0; x < 8; x++) {
+      for (int s = 0; s < stretch; s++) {
+        mask[x * stretch + s] = (b & (0x80 >> x)) ? 0xff : 0;
+      }
+    }
+  }
+  glyph_row_mask_ready[stretch - 1] = 1;
+}
+
 // Draw a single character at x,y coords into the offscreen area
 static void ui_draw_char(uint8_t c, int pos_x, int pos_y, int color,
                          uint8_t *dst, int dst_pitch, int stretch,
@@ -211,17 +247,45 @@ static void ui_draw_char(uint8_t c, int pos_x, int pos_y, int color,
   }
   draw_pos = &(dst[pos_x + pos_y * dst_pitch]);
 
-  for (y = 0; y < 8*stretch; ++y) {
-    fontchar = *font_pos;
-    for (x = 0; x < 8; ++x) {
-      if (fontchar & (0x80 >> x)) {
-        for (s = 0; s < stretch; s++) {
-           draw_pos[x*stretch+s] = color;
+  if (stretch > GLYPH_MAX_STRETCH) {
+    for (y = 0; y < 8*stretch; ++y) {
+      fontchar = *font_pos;
+      for (x = 0; x < 8; ++x) {
+        if (fontchar & (0x80 >> x)) {
+          for (s = 0; s < stretch; s++) {
+             draw_pos[x*stretch+s] = color;
+          }
         }
       }
+      if (y % stretch == stretch-1) ++font_pos;
+      draw_pos += dst_pitch;
+    }
+    return;
+  }
+
+  if (!glyph_row_mask_ready[stretch - 1]) {
+    ui_init_glyph_row_mask(stretch);
+  }
+
+  uint32_t color_word = (uint8_t)color * 0x01010101u;
+  int words = 2 * stretch;
+  for (y = 0; y < 8; ++y) {
+    fontchar = *font_pos++;
+    if (fontchar == 0) {
+      draw_pos += dst_pitch * stretch;
+      continue;
+    }
+    const uint32_t *mask = glyph_row_mask[stretch - 1][fontchar];
+    for (s = 0; s < stretch; s++) {
+      for (x = 0; x < words; x++) {
+        // Destination is not necessarily word aligned.
+        uint32_t v;
+        memcpy(&v, draw_pos + x * 4, 4);
+        v = (v & ~mask[x]) | (color_word & mask[x]);
+        memcpy(draw_pos + x * 4, &v, 4);
+      }
+      draw_pos += dst_pitch;
     }
-    if (y % stretch == stretch-1) ++font_pos;
-    draw_pos += dst_pitch;
   }
 }
 
@@ -476,6 +540,7 @@ static void ui_action_frame() {
 void ui_render_single_frame() {
   // Start with transparent
   memset(ui_fb, TRANSPARENT_COLOR, ui_fb_h * ui_fb_pitch);
+  osd_render_state.valid = 0;
 
   for (int msi=0;msi<=current_menu;msi++) {
      ui_render_now(msi);
@@ -488,6 +553,12 @@ static void ui_toggle(void) {
   ui_enabled = 1 - ui_enabled;
   if (ui_enabled) {
     emux_trap_main_loop_ui();
+  } else {
+    // Emulation is still paused here. Don't leave a save behind that
+    // would otherwise have to be written while a frame is running.
+    if (settings_store_flush()) {
+      ui_error("Problem saving");
+    }
   }
 }
 
@@ -696,6 +767,12 @@ void ui_check_key(void) {
 
   // Ui action frame tick
   ui_action_frame();
+
+  // Write out saved settings once the user has stopped saving. Not while
+  // an osd is up since emulation is running then.
+  if (!osd_active && settings_store_poll()) {
+    ui_error("Problem saving");
+  }
 }
 
 void ui_handle_toggle_or_quick_func() {
@@ -891,6 +968,71 @@ struct menu_item *ui_menu_add_text_field(int id, struct menu_item *folder,
   return new_item;
 }
 
+static uint32_t sig_add(uint32_t h, uint32_t v) {
+  // FNV-1a, a word at a time
+  return (h ^ v) * 16777619u;
+}
+
+static uint32_t sig_add_str(uint32_t h, const char *str) {
+  while (*str) {
+    h = sig_add(h, (uint8_t)*str++);
+  }
+  return h;
+}
+
+// Hash of everything that affects how a menu row looks.
+static uint32_t ui_row_signature(struct menu_item *node, int is_cursor,
+                                 int colour) {
+  uint32_t h = 2166136261u;
+  h = sig_add(h, (uint32_t)(uintptr_t)node);
+  h = sig_add(h, is_cursor);
+  h = sig_add(h, colour);
+  h = sig_add(h, node->type);
+  h = sig_add(h, node->value);
+  h = sig_add(h, node->is_expanded);
+  h = sig_add(h, node->symbol);
+  h = sig_add_str(h, node->name);
+  switch (node->type) {
+    case TOGGLE:
+      h = sig_add_str(h, node->custom_toggle_label[node->value ? 1 : 0]);
+      break;
+    case RANGE:
+      h = sig_add(h, node->divisor);
+      break;
+    case MULTIPLE_CHOICE:
+      h = sig_add_str(h, node->choices[node->value]);
+      break;
+    case BUTTON:
+      h = sig_add_str(h, get_button_display_str(node));
+      break;
+    case TEXTFIELD:
+      h = sig_add_str(h, node->str_value);
+      break;
+    default:
+      break;
+  }
+  return h;
+}
+
+// Returns whether the row needs to be drawn. When rendering incrementally,
+// a changed row is cleared first.
+static int ui_row_changed(int row, struct menu_item *node, int is_cursor,
+                          int colour, int y) {
+  if (row < 0 || row >= OSD_MAX_ROWS) {
+    return 1;
+  }
+  uint32_t sig = ui_row_signature(node, is_cursor, colour);
+  if (ui_render_incremental) {
+    if (osd_row_sig[row] == sig) {
+      return 0;
+    }
+    ui_draw_rect(node->menu_left, y, node->menu_width, 8, BG_COLOR, 1);
+  }
+  osd_row_sig[row] = sig;
+  ui_render_rows_changed++;
+  return 1;
+}
+
 static void ui_render_children(struct menu_item *node,
                                int stack_index, int *index, int indent) {
   while (node != NULL) {
@@ -901,14 +1043,19 @@ static void ui_render_children(struct menu_item *node,
     // Render a row
     if (*index >= menu_window_top[stack_index] &&
         *index < menu_window_bottom[stack_index]) {
-      int y = (*index - menu_window_top[stack_index]) * 8 + node->menu_top;
-      if (*index == menu_cursor[stack_index]) {
-        ui_draw_rect(node->menu_left, y, node->menu_width, 8, HILITE_COLOR, 1);
+      int row = *index - menu_window_top[stack_index];
+      int y = row * 8 + node->menu_top;
+      int is_cursor = *index == menu_cursor[stack_index];
+      int row_changed = ui_row_changed(row, node, is_cursor, colour, y);
+      if (is_cursor) {
+        if (row_changed) {
+          ui_draw_rect(node->menu_left, y, node->menu_width, 8, HILITE_COLOR, 1);
+        }
         menu_cursor_item[stack_index] = node;
       }
 
       // Special symbol drawn on left edge
-      if (node->symbol) {
+      if (row_changed && node->symbol) {
           ui_draw_char_raw(node->symbol,
               node->menu_left+indent*8, y, colour, NULL, 0, 1);
       }
@@ -916,8 +1063,7 @@ static void ui_render_children(struct menu_item *node,
       // Sometimes, we only want to render the current item. Like when we
       // are adjusting things that affect video and we want to see the display
       // underneath the menu while we are making changes.
-      if (!ui_render_current_item_only ||
-          *index == menu_cursor[stack_index]) {
+      if (row_changed && (!ui_render_current_item_only || is_cursor)) {
 
         ui_draw_text(node->name,
            node->menu_left + (indent + 1) * 8, y, colour);
@@ -1007,6 +1153,7 @@ static void ui_render_children(struct menu_item *node,
 // be displayed.
 void ui_make_transparent(void) {
   memset(ui_fb, TRANSPARENT_COLOR, ui_fb_h * ui_fb_pitch);
+  osd_render_state.valid = 0;
 }
 
 static void ui_draw_shadow_text(const char* txt, int *x, int *y, int col) {
@@ -1018,34 +1165,82 @@ static void ui_draw_shadow_text(const char* txt, int *x, int *y, int col) {
   *x = *x + strlen(txt) *8;
 }
 
-void ui_render_now(int menu_stack_index) {
+static int osd_render_state_matches(int stack_index, struct menu_item *ptr) {
+  return osd_render_state.valid &&
+         osd_render_state.stack_index == stack_index &&
+         osd_render_state.first == ptr &&
+         osd_render_state.left == ptr->menu_left &&
+         osd_render_state.top == ptr->menu_top &&
+         osd_render_state.width == ptr->menu_width &&
+         osd_render_state.height == ptr->menu_height &&
+         osd_render_state.window_top == menu_window_top[stack_index] &&
+         osd_render_state.window_bottom == menu_window_bottom[stack_index] &&
+         osd_render_state.current_item_only == ui_render_current_item_only;
+}
+
+int ui_render_now(int menu_stack_index) {
   int index = 0;
   int indent = 0;
+  int top_only = menu_stack_index == -1;
 
-  if (menu_stack_index == -1) {
+  if (top_only) {
     menu_stack_index = current_menu;
-    // When rendering only the top most menu, clear with transparent color
-    memset(ui_fb, TRANSPARENT_COLOR, ui_fb_h * ui_fb_pitch);
   }
 
   struct menu_item *ptr = menu_roots[menu_stack_index].first_child;
 
-  // background conditional upon mode
-  if (!ui_transparent) {
-     ui_draw_rect(ptr->menu_left, ptr->menu_top,
-                  ptr->menu_width, ptr->menu_height,
-                  BG_COLOR, 1);
-  }
+  // Rendering only the top most menu happens every frame while an osd is
+  // up. Only redraw the rows that changed if nothing else did.
+  ui_render_incremental = top_only && !ui_transparent &&
+      osd_render_state_matches(menu_stack_index, ptr);
+  ui_render_rows_changed = 0;
+
+  if (!ui_render_incremental) {
+    if (top_only) {
+      // When rendering only the top most menu, clear with transparent color
+      memset(ui_fb, TRANSPARENT_COLOR, ui_fb_h * ui_fb_pitch);
+    }
 
-  // border
-  ui_draw_rect(ptr->menu_left - 1, ptr->menu_top - 1, ptr->menu_width + 2,
-               ptr->menu_height + 2, BORDER_COLOR, 0);
+    // background conditional upon mode
+    if (!ui_transparent) {
+       ui_draw_rect(ptr->menu_left, ptr->menu_top,
+                    ptr->menu_width, ptr->menu_height,
+                    BG_COLOR, 1);
+    }
+
+    // border
+    ui_draw_rect(ptr->menu_left - 1, ptr->menu_top - 1, ptr->menu_width + 2,
+                 ptr->menu_height + 2, BORDER_COLOR, 0);
+  }
 
   // menu text
   ui_render_children(ptr, menu_stack_index, &index, indent);
 
+  int incremental = ui_render_incremental;
+  ui_render_incremental = 0;
+
+  // Items were added or removed. Rows below the last one may be stale.
+  if (incremental && index != osd_render_state.max_index) {
+    osd_render_state.valid = 0;
+    return ui_render_now(-1);
+  }
+
   max_index[menu_stack_index] = index;
 
+  if (top_only) {
+    osd_render_state.valid = 1;
+    osd_render_state.stack_index = menu_stack_index;
+    osd_render_state.first = ptr;
+    osd_render_state.left = ptr->menu_left;
+    osd_render_state.top = ptr->menu_top;
+    osd_render_state.width = ptr->menu_width;
+    osd_render_state.height = ptr->menu_height;
+    osd_render_state.window_top = menu_window_top[menu_stack_index];
+    osd_render_state.window_bottom = menu_window_bottom[menu_stack_index];
+    osd_render_state.max_index = index;
+    osd_render_state.current_item_only = ui_render_current_item_only;
+  }
+
   if (menu_cursor[menu_stack_index] >= max_index[menu_stack_index]) {
     menu_cursor[menu_stack_index] = max_index[menu_stack_index] - 1;
     cursor_pos_updated();
@@ -1117,6 +1312,8 @@ void ui_render_now(int menu_stack_index) {
     qx = cx; qy+=10;
     ui_draw_shadow_text("-/+1 increments.", &qx, &qy, 1);
   }
+
+  return !incremental || ui_render_rows_changed > 0;
 }
 
 // This function will traverse recursively all nodes in the node list
@@ -1182,6 +1379,7 @@ static void ui_clear_menu(int menu_index) {
 }
 
 struct menu_item *ui_pop_menu(void) {
+  osd_render_state.valid = 0;
   struct menu_item *menu_to_pop = &menu_roots[current_menu];
   ui_clear_menu(current_menu);
   current_menu--;
@@ -1230,6 +1428,7 @@ static int calc_root_menu_top() {
 }
 
 struct menu_item *ui_push_menu(int w_chars, int h_chars) {
+  osd_render_state.valid = 0;
 
   int menu_width = w_chars * 8;
   int menu_height = h_chars * 8;
@@ -1626,6 +1825,7 @@ void ui_geometry_changed(int dpx, int dpy,
      circle_clear_fbl(FB_LAYER_UI);
      ui_fb_w = fbw;
      ui_fb_h = fbh;
+     osd_render_state.valid = 0;
    }
    menu_roots[0].menu_top = calc_root_menu_top();
    menu_roots[0].menu_left = calc_root_menu_left();
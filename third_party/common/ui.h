@@ -199,7 +199,9 @@ void glob_osd_popped(struct menu_item *new_root,
                      struct menu_item *old_root);
 
 void ui_make_transparent(void);
-void ui_render_now(int menu_stack_index);
+// Returns non-zero if anything was drawn. When only the top most menu is
+// rendered (-1), rows that did not change since the last call are skipped.
+int ui_render_now(int menu_stack_index);
 void ui_error(const char *format, ...);
 void ui_info(const char *format, ...);
 void ui_confirm_wrapped(char *title, const char *txt, int ok_value, int ok_id);
@@ -246,6 +248,9 @@ void ui_geometry_changed(int dpx, int dpy,
 // Should acquire lock around changing.
 extern int ui_toggle_pending;
 
+// Quick function waiting to run on the main loop, 0 if none.
+extern int pending_emu_quick_func;
+
 extern uint8_t *video_font;
 extern uint16_t video_font_translate[256];
 extern uint8_t *raw_video_font;
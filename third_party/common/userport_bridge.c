@@ -0,0 +1,164 @@
+/*
+ * userport_bridge.c
+ *
+ * Written by
+ *  Randy Rossi <randy.rossi@gmail.com>
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+#include "userport_bridge.h"
+
+// Single producer (emulator core), single consumer (pin core) ring.
+#define USERPORT_QUEUE_MASK (USERPORT_QUEUE_SIZE - 1)
+
+struct userport_write {
+  uint32_t clk;
+  uint8_t value;
+  uint8_t ddr;
+};
+
+static struct userport_write queue[USERPORT_QUEUE_SIZE];
+static volatile unsigned int queue_head; // written by producer only
+static volatile unsigned int queue_tail; // written by consumer only
+
+static volatile int bridge_enabled;
+static unsigned long bridge_cycles_per_sec;
+
+// When the queue is full (or right after enable) the producer stops
+// queueing and just leaves the latest state here. The consumer applies
+// it once the queue has drained and queueing resumes after that.
+// value in the low byte, ddr in the high byte so the consumer can never
+// see one without the other.
+static volatile uint16_t latest_state;
+static volatile int latest_pending;
+
+static volatile uint8_t input_pins = 0xff;
+
+// Maps emulated clock to real time for pacing. Consumer only.
+static int timeline_valid;
+static uint32_t timeline_clk;
+static unsigned long timeline_us;
+
+void userport_bridge_enable(int enable, unsigned long cycles_per_sec,
+                            uint8_t value, uint8_t ddr) {
+  bridge_enabled = 0;
+  __sync_synchronize();
+
+  queue_head = 0;
+  queue_tail = 0;
+  timeline_valid = 0;
+  input_pins = 0xff;
+  bridge_cycles_per_sec = cycles_per_sec;
+  latest_state = value | (ddr << 8);
+  latest_pending = 1;
+
+  __sync_synchronize();
+  bridge_enabled = enable && cycles_per_sec > 0;
+}
+
+int userport_bridge_enabled(void) {
+  return bridge_enabled;
+}
+
+void userport_bridge_write(uint32_t clk, uint8_t value, uint8_t ddr) {
+  if (!bridge_enabled) {
+    return;
+  }
+
+  unsigned int head = queue_head;
+  if (latest_pending || head - queue_tail >= USERPORT_QUEUE_SIZE) {
+    latest_state = value | (ddr << 8);
+    __sync_synchronize();
+    latest_pending = 1;
+    return;
+  }
+
+  struct userport_write *w = &queue[head & USERPORT_QUEUE_MASK];
+  w->clk = clk;
+  w->value = value;
+  w->ddr = ddr;
+  __sync_synchronize();
+  queue_head = head + 1;
+}
+
+uint8_t userport_bridge_read(uint8_t latch, uint8_t ddr) {
+  return (latch & ddr) | (input_pins & ~ddr);
+}
+
+// How far ahead of now (usec) a write is due on the pins. Consumer only.
+static long write_lead(const struct userport_write *w, unsigned long now) {
+  if (!timeline_valid) {
+    timeline_clk = w->clk;
+    timeline_us = now;
+    timeline_valid = 1;
+    return 0;
+  }
+
+  uint64_t cycles = (uint32_t)(w->clk - timeline_clk);
+  unsigned long due =
+      timeline_us + (unsigned long)(cycles * 1000000 / bridge_cycles_per_sec);
+  long lead = (long)(due - now);
+  if (lead > USERPORT_MAX_DRIFT_US || lead < -USERPORT_MAX_DRIFT_US) {
+    timeline_clk = w->clk;
+    timeline_us = now;
+    return 0;
+  }
+  return lead;
+}
+
+void userport_bridge_service(const struct userport_bridge_pins *pins,
+                             unsigned long now, int paced) {
+  if (!bridge_enabled) {
+    return;
+  }
+
+  unsigned int head = queue_head;
+  __sync_synchronize();
+
+  unsigned int tail = queue_tail;
+  while (tail != head) {
+    const struct userport_write *w = &queue[tail & USERPORT_QUEUE_MASK];
+    if (paced && write_lead(w, now) > 0) {
+      break;
+    }
+    pins->apply(w->value, w->ddr);
+    tail++;
+  }
+  __sync_synchronize();
+  queue_tail = tail;
+
+  // The producer only falls back to latest_state after publishing
+  // everything it queued, so look at the head again once pending is
+  // seen. Otherwise writes queued after our snapshot would be applied
+  // after the newer latest_state.
+  if (latest_pending) {
+    __sync_synchronize();
+    if (tail == queue_head) {
+      latest_pending = 0;
+      __sync_synchronize();
+      uint16_t state = latest_state;
+      pins->apply(state & 0xff, state >> 8);
+      // Whatever comes next starts a new timeline.
+      timeline_valid = 0;
+    }
+  }
+
+  input_pins = pins->read();
+}
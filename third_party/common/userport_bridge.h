@@ -0,0 +1,77 @@
+/*
+ * userport_bridge.h
+ *
+ * Written by
+ *  Randy Rossi <randy.rossi@gmail.com>
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef RASPI_USERPORT_BRIDGE_H
+#define RASPI_USERPORT_BRIDGE_H
+
+#include <stdint.h>
+
+// Connects the emulated userport data lines to real gpio pins. The
+// emulator queues every port/ddr write with the cpu clock it happened
+// on. Whoever owns the pins drains the queue with
+// userport_bridge_service, replaying the writes with the same spacing
+// they had in emulated time, and publishes what the input pins read.
+
+// Writes that can be queued before the pin side drains them. Must be a
+// power of 2.
+#define USERPORT_QUEUE_SIZE 1024
+
+// If a write comes due further ahead or behind real time than this,
+// emulated and real time have drifted apart (e.g. the emulator was
+// paused). Start a new timeline from that write. Smaller lags are
+// caught up by applying late writes right away.
+#define USERPORT_MAX_DRIFT_US 40000
+
+// Pin access for userport_bridge_service.
+struct userport_bridge_pins {
+  // Make the pins in ddr outputs (the rest inputs) and drive the
+  // output pins from value.
+  void (*apply)(uint8_t value, uint8_t ddr);
+  // Current level of all 8 pins.
+  uint8_t (*read)(void);
+};
+
+// Turn the bridge on or off. value/ddr are the port state at the time
+// and get applied to the pins on the next service call.
+void userport_bridge_enable(int enable, unsigned long cycles_per_sec,
+                            uint8_t value, uint8_t ddr);
+
+int userport_bridge_enabled(void);
+
+// Emulator side. Called when the port latch or ddr is written.
+void userport_bridge_write(uint32_t clk, uint8_t value, uint8_t ddr);
+
+// Emulator side. Port value as the cpu should see it: latch bits for
+// outputs, pin levels for inputs.
+uint8_t userport_bridge_read(uint8_t latch, uint8_t ddr);
+
+// Pin side. Applies queued writes that are due and samples the inputs.
+// now is in usec. If paced is zero, everything queued is applied
+// immediately.
+void userport_bridge_service(const struct userport_bridge_pins *pins,
+                             unsigned long now, int paced);
+
+#endif
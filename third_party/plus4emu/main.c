@@ -10,16 +10,28 @@
 #include "../common/emux_api.h"
 #include "../common/keycodes.h"
 #include "../common/overlay.h"
+#include "../common/autowarp.h"
 #include "../common/demo.h"
 #include "../common/menu.h"
 #include "../common/kbd.h"
+#include "../common/semaphore.h"
+#include "../common/settings_store.h"
+#include "main.h"
 
 static Plus4VM            *vm = NULL;
 static Plus4VideoDecoder  *videoDecoder = NULL;
 
+// Floppy drives lag the TED by up to this many cycles on the serial bus
+// when they run on another core.
+#define FLOPPY_THREAD_TIMESLICE 16
+
+int floppy_thread_available;
+uint32_t floppy_job;
+uint32_t floppy_done;
+
 #define TEXT_LINE_LEN 80
-#define MAX_KEY_SYM 0x108
-static int keysymToP4Code[0x108];
+#define MAX_KEY_SYM KEYCODE_MAX
+static int keysymToP4Code[MAX_KEY_SYM];
 
 // Global state variables
 static uint8_t *fb_buf;
@@ -38,6 +50,21 @@ static char last_iec_dir[256];
 static int vertical_res;
 static int raster_low;
 static int time_advance;
+static int audio_channels = 1;
+static int audio_high_quality = 1;
+// Time spent blocked on audio and vsync during the current Plus4VM_Run call.
+static unsigned long emu_wait_ticks;
+static unsigned long emu_busy_ticks;
+static unsigned long emu_run_ticks;
+static int emu_run_count;
+
+// Resampler quality is picked from the measured headroom over this many
+// Plus4VM_Run calls (about half a second).
+#define AUDIO_QUALITY_PERIOD 250
+// Percentage of real time spent emulating above which we drop to low
+// quality, and below which we go back to high quality.
+#define AUDIO_QUALITY_LOW_PCT 90
+#define AUDIO_QUALITY_HIGH_PCT 70
 
 // Things that need to be saved and restored.
 int reset_tape_with_cpu = 1;
@@ -46,6 +73,7 @@ int ram_size = 64;
 int sid_model = 0;
 int sid_write_access = 0;
 int sid_digiblaster = 0;
+int audio_stereo = 1;
 int drive_model_8 = 0;
 int attach_3plus1_roms = 0;
 int keyboard_mapping = 1;
@@ -82,6 +110,7 @@ int crt_filter = 1;
 static struct menu_item *sid_model_item;
 static struct menu_item *sid_write_access_item;
 static struct menu_item *sid_digiblaster_item;
+static struct menu_item *audio_stereo_item;
 static struct menu_item *tape_feedback_item;
 static struct menu_item *ram_size_item;
 static struct menu_item *drive_model_8_item;
@@ -109,36 +138,27 @@ static int drive_led_colors[4];
 
 static void init_video(void);
 
-static int p4_isspace(char c) {
-  return (c == '\f' || c == '\n' || c == '\r' || c == '\t' || c == '\v');
+// sem_inc only has a barrier after the count is updated, so make
+// everything written before visible to the other core first.
+static void floppy_thread_start(void *userData) {
+  __sync_synchronize();
+  sem_inc(&floppy_job);
 }
 
-static void rtrim(char *txt) {
-  if (!txt) return;
-  int p=strlen(txt)-1;
-  while (p4_isspace(txt[p])) { txt[p] = '\0'; p--; }
+static void floppy_thread_wait(void *userData) {
+  sem_dec(&floppy_done);
 }
 
-static char* ltrim(char *txt) {
-  if (!txt) return NULL;
-  int p=0;
-  while (p4_isspace(txt[p])) { p++; }
-  return txt+p;
+// Called on the floppy core. Lets the emulation core do a disk image
+// access for it, since only that core may use files.
+static void floppy_thread_yield(void *userData) {
+  __sync_synchronize();
+  sem_inc(&floppy_done);
+  sem_dec(&floppy_job);
 }
 
-static void get_key_and_value(char *line, char **key, char **value) {
-   for (int i=0;i<strlen(line);i++) {
-      if (line[i] == '=') {
-         line[i] = '\0';
-         *key = ltrim(&line[0]);
-         rtrim(*key);
-         *value = ltrim(&line[i+1]);
-         rtrim(*value);
-         return;
-      }
-   }
-   *key = 0;
-   *value = 0;
+void run_floppy_job(void) {
+  Plus4VM_RunFloppyDriveThread(vm);
 }
 
 static void set_video_font(void) {
@@ -165,6 +185,48 @@ static void apply_sid_config() {
   Plus4VM_SetSIDConfiguration(vm, sid_flags, sid_digiblaster_item->value, 0);
 }
 
+static void apply_audio_config() {
+  int audioSampleRate;
+  int fragsize;
+  int fragnr;
+  int channels = audio_stereo_item->value ? 2 : 1;
+
+  // Restarts playback if the number of channels changed.
+  circle_sound_init(NULL, &audioSampleRate, &fragsize, &fragnr, &channels);
+  audio_channels = channels;
+  Plus4VM_SetAudioOutputStereo(vm, channels == 2);
+}
+
+// Switch between high and low quality resampling depending on how much of
+// each emulated period was actually spent emulating. The converter keeps
+// both resamplers allocated, so switching is cheap to do at runtime.
+static void update_audio_quality(unsigned long busy_ticks) {
+  if (ui_warp) {
+    emu_run_count = 0;
+    emu_busy_ticks = 0;
+    emu_run_ticks = 0;
+    return;
+  }
+
+  emu_busy_ticks += busy_ticks;
+  emu_run_ticks += time_advance;
+  if (++emu_run_count < AUDIO_QUALITY_PERIOD)
+    return;
+
+  unsigned long pct = emu_busy_ticks * 100 / emu_run_ticks;
+  if (audio_high_quality && pct > AUDIO_QUALITY_LOW_PCT) {
+    audio_high_quality = 0;
+    Plus4VM_SetAudioOutputQuality(vm, 0);
+  } else if (!audio_high_quality && pct < AUDIO_QUALITY_HIGH_PCT) {
+    audio_high_quality = 1;
+    Plus4VM_SetAudioOutputQuality(vm, 1);
+  }
+
+  emu_run_count = 0;
+  emu_busy_ticks = 0;
+  emu_run_ticks = 0;
+}
+
 static int apply_rom_config() {
   if (Plus4VM_LoadROM(vm, 0x00, rom_basic, 0) != PLUS4EMU_SUCCESS)
     return 1;
@@ -201,6 +263,7 @@ static int apply_settings() {
   // Here, we should make whatever calls are necessary to configure the VM
   // according to any settings that were loaded.
   apply_sid_config();
+  apply_audio_config();
   Plus4VM_SetTapeFeedbackLevel(vm, tape_feedback);
   Plus4VM_SetRAMConfiguration(vm, ram_size, 0x99999999UL);
   return apply_rom_config();
@@ -395,8 +458,12 @@ static void vmError(void)
 static void audioOutputCallback(void *userData,
                                 const int16_t *buf, size_t nFrames)
 {
-  if (!ui_warp)
-     circle_sound_write((int16_t*)buf, nFrames);
+  if (!ui_warp) {
+     unsigned long start = circle_get_ticks();
+     // nFrames are interleaved left/right pairs in stereo mode
+     circle_sound_write((int16_t*)buf, nFrames * audio_channels);
+     emu_wait_ticks += circle_get_ticks() - start;
+  }
 }
 
 static void videoLineCallback(void *userData,
@@ -414,9 +481,11 @@ static void videoLineCallback(void *userData,
 
 static void videoFrameCallback(void *userData)
 {
+  unsigned long start = circle_get_ticks();
   circle_frames_ready_fbl(FB_LAYER_VIC,
                           -1 /* no 2nd layer */,
                           !ui_warp /* sync */);
+  emu_wait_ticks += circle_get_ticks() - start;
 
   // Something is waiting for vsync, ack and return.
   if (wait_vsync) {
@@ -430,9 +499,11 @@ static void videoFrameCallback(void *userData)
   if (ui_enabled) {
     // The only way we can be here and have ui_enabled=1
     // is for an osd to be enabled.
-    ui_render_now(-1); // only render top most menu
-    circle_frames_ready_fbl(FB_LAYER_UI, -1 /* no 2nd layer */,
-       0 /* no sync */);
+    // only render top most menu, and only send it when something changed
+    if (ui_render_now(-1)) {
+      circle_frames_ready_fbl(FB_LAYER_UI, -1 /* no 2nd layer */,
+         0 /* no sync */);
+    }
     ui_check_key();
   }
 
@@ -460,7 +531,8 @@ static void videoFrameCallback(void *userData)
       // key events.
       vkbd_sync_event(pending_emu_key.key[i], pending_emu_key.pressed[i]);
     }
-    int p4code = keysymToP4Code[pending_emu_key.key[i]];
+    long key = pending_emu_key.key[i];
+    int p4code = key >= 0 && key < MAX_KEY_SYM ? keysymToP4Code[key] : -1;
     if (p4code >= 0) {
        Plus4VM_KeyboardEvent(vm, p4code, pending_emu_key.pressed[i]);
     }
@@ -575,8 +647,11 @@ static void videoFrameCallback(void *userData)
 
   if (reset_demo) {
     demo_reset_timeout();
+    autowarp_user_input();
   }
 
+  autowarp_check();
+
   if (raspi_demo_mode) {
     demo_check();
   }
@@ -722,17 +797,27 @@ int main_program(int argc, char **argv)
   int audioSampleRate;
   int fragsize;
   int fragnr;
-  int channels = 1; // Only mono for plus4emu
+  int channels = 1; // Set from settings by apply_audio_config
 
   circle_sound_init(NULL, &audioSampleRate, &fragsize, &fragnr, &channels);
   if (Plus4VM_SetAudioSampleRate(vm, audioSampleRate) != PLUS4EMU_SUCCESS)
     vmError();
 
+  Plus4VM_SetAudioOutputPan(vm, 0, -50); // TED
+  Plus4VM_SetAudioOutputPan(vm, 1, 50);  // SID
+  Plus4VM_SetAudioOutputPan(vm, 2, 50);  // DigiBlaster
+
   if (Plus4VM_SetWorkingDirectory(vm, ".") != PLUS4EMU_SUCCESS)
     vmError();
   /* enable read-write IEC level drive emulation for unit 8 */
   Plus4VM_SetIECDriveReadOnlyMode(vm, 0);
 
+  if (floppy_thread_available) {
+    Plus4VM_SetFloppyDriveThread(vm, &floppy_thread_start,
+                                 &floppy_thread_wait, &floppy_thread_yield,
+                                 NULL, FLOPPY_THREAD_TIMESLICE);
+  }
+
   emux_detach_disk(8);
 
   videoDecoder =
@@ -775,7 +860,12 @@ int main_program(int argc, char **argv)
 
   assert(time_advance > 0);
   for(;;) {
+    unsigned long start = circle_get_ticks();
+    emu_wait_ticks = 0;
     Plus4VM_Run(vm, time_advance);
+    unsigned long elapsed = circle_get_ticks() - start;
+    update_audio_quality(elapsed > emu_wait_ticks ?
+                            elapsed - emu_wait_ticks : 0);
   }
 
   Plus4VM_Destroy(vm);
@@ -1118,6 +1208,15 @@ void emux_add_sound_options(struct menu_item* parent) {
   sid_digiblaster_item =
       ui_menu_add_toggle(MENU_SID_DIGIBLASTER, parent,
           "Enable Digiblaster", sid_digiblaster);
+
+  // TED left, SID and Digiblaster right
+  audio_stereo_item =
+      ui_menu_add_toggle(MENU_AUDIO_STEREO, parent,
+          "Stereo Output", audio_stereo);
+}
+
+void emux_add_diagnostics(struct menu_item* parent) {
+  // Plus4Emu keeps no allocator stats.
 }
 
 void emux_video_color_setting_changed(int display_num) {
@@ -1422,6 +1521,9 @@ int emux_handle_menu_change(struct menu_item* item) {
     case MENU_SID_DIGIBLASTER:
       apply_sid_config();
       return 1;
+    case MENU_AUDIO_STEREO:
+      apply_audio_config();
+      return 1;
     case MENU_TAPE_FEEDBACK:
       Plus4VM_SetTapeFeedbackLevel(vm, item->value);
       return 1;
@@ -1467,6 +1569,67 @@ int emux_handle_quick_func(int button_func, fullpath_func fullpath) {
   return 0;
 }
 
+static void load_additional_setting(char *name, char *value_str,
+                                    void *data) {
+  int value = atoi(value_str);
+
+  if (strcmp(name,"sid_model") == 0) {
+     sid_model = value;
+  } else if (strcmp(name,"sid_write_access") == 0) {
+     sid_write_access = value;
+  } else if (strcmp(name,"sid_digiblaster") == 0) {
+     sid_digiblaster = value;
+  } else if (strcmp(name,"audio_stereo") == 0) {
+     audio_stereo = value;
+  } else if (strcmp(name,"reset_tape_with_cpu") == 0) {
+     reset_tape_with_cpu = value;
+  } else if (strcmp(name,"tape_feedback") == 0) {
+     tape_feedback = value;
+  } else if (strcmp(name,"ram_size") == 0) {
+     ram_size = value;
+  } else if (strcmp(name,"drive_model_8") == 0) {
+     drive_model_8 = value;
+  } else if (strcmp(name,"attach_3plus1_roms") == 0) {
+     attach_3plus1_roms = value;
+  } else if (strcmp(name,"rom_c0_lo") == 0) {
+     strcpy(rom_c0_lo, value_str);
+  } else if (strcmp(name,"rom_c0_hi") == 0) {
+     strcpy(rom_c0_hi, value_str);
+  } else if (strcmp(name,"rom_c1_lo") == 0) {
+     strcpy(rom_c1_lo, value_str);
+  } else if (strcmp(name,"rom_c1_hi") == 0) {
+     strcpy(rom_c1_hi, value_str);
+  } else if (strcmp(name,"rom_c2_lo") == 0) {
+     strcpy(rom_c2_lo, value_str);
+  } else if (strcmp(name,"rom_c2_hi") == 0) {
+     strcpy(rom_c2_hi, value_str);
+  } else if (strcmp(name,"rom_c0_lo_off") == 0) {
+     rom_c0_lo_off = value;
+  } else if (strcmp(name,"rom_c0_hi_off") == 0) {
+     rom_c0_hi_off = value;
+  } else if (strcmp(name,"rom_c1_lo_off") == 0) {
+     rom_c1_lo_off = value;
+  } else if (strcmp(name,"rom_c1_hi_off") == 0) {
+     rom_c1_hi_off = value;
+  } else if (strcmp(name,"rom_c2_lo_off") == 0) {
+     rom_c2_lo_off = value;
+  } else if (strcmp(name,"rom_c2_hi_off") == 0) {
+     rom_c2_hi_off = value;
+  } else if (strcmp(name,"color_brightness") == 0) {
+     color_brightness = value;
+  } else if (strcmp(name,"color_contrast") == 0) {
+     color_contrast = value;
+  } else if (strcmp(name,"color_gamma") == 0) {
+     color_gamma = value;
+  } else if (strcmp(name,"color_tint") == 0) {
+     color_tint = value;
+  } else if (strcmp(name,"keyboard_mapping") == 0) {
+     keyboard_mapping = value;
+  } else if (strcmp(name,"crt_filter") == 0) {
+     crt_filter = value;
+  }
+}
+
 // For Plus4emu, we grab additional settings from the same txt file.
 void emux_load_additional_settings() {
   // NOTE: This is called before any menu items have been constructed.
@@ -1478,96 +1641,14 @@ void emux_load_additional_settings() {
   strcpy(rom_c2_lo, "");
   strcpy(rom_c2_hi, "");
 
-  FILE *fp;
-  fp = fopen("/settings-plus4emu.txt", "r");
-  if (fp == NULL) {
-     return;
-  }
-
-  char name_value[256];
-  size_t len;
-  int value;
-  int usb_btn_0_i = 0;
-  int usb_btn_1_i = 0;
-  while (1) {
-    char *line = fgets(name_value, 255, fp);
-    if (feof(fp) || line == NULL) break;
-
-    strcpy(name_value, line);
-
-    char *name;
-    char *value_str;
-    get_key_and_value(name_value, &name, &value_str);
-    if (!name || !value_str ||
-       strlen(name) == 0 ||
-          strlen(value_str) == 0) {
-       continue;
-    }
-
-    value = atoi(value_str);
-
-    if (strcmp(name,"sid_model") == 0) {
-       sid_model = value;
-    } else if (strcmp(name,"sid_write_access") == 0) {
-       sid_write_access = value;
-    } else if (strcmp(name,"sid_digiblaster") == 0) {
-       sid_digiblaster = value;
-    } else if (strcmp(name,"reset_tape_with_cpu") == 0) {
-       reset_tape_with_cpu = value;
-    } else if (strcmp(name,"tape_feedback") == 0) {
-       tape_feedback = value;
-    } else if (strcmp(name,"ram_size") == 0) {
-       ram_size = value;
-    } else if (strcmp(name,"drive_model_8") == 0) {
-       drive_model_8 = value;
-    } else if (strcmp(name,"attach_3plus1_roms") == 0) {
-       attach_3plus1_roms = value;
-    } else if (strcmp(name,"rom_c0_lo") == 0) {
-       strcpy(rom_c0_lo, value_str);
-    } else if (strcmp(name,"rom_c0_hi") == 0) {
-       strcpy(rom_c0_hi, value_str);
-    } else if (strcmp(name,"rom_c1_lo") == 0) {
-       strcpy(rom_c1_lo, value_str);
-    } else if (strcmp(name,"rom_c1_hi") == 0) {
-       strcpy(rom_c1_hi, value_str);
-    } else if (strcmp(name,"rom_c2_lo") == 0) {
-       strcpy(rom_c2_lo, value_str);
-    } else if (strcmp(name,"rom_c2_hi") == 0) {
-       strcpy(rom_c2_hi, value_str);
-    } else if (strcmp(name,"rom_c0_lo_off") == 0) {
-       rom_c0_lo_off = value;
-    } else if (strcmp(name,"rom_c0_hi_off") == 0) {
-       rom_c0_hi_off = value;
-    } else if (strcmp(name,"rom_c1_lo_off") == 0) {
-       rom_c1_lo_off = value;
-    } else if (strcmp(name,"rom_c1_hi_off") == 0) {
-       rom_c1_hi_off = value;
-    } else if (strcmp(name,"rom_c2_lo_off") == 0) {
-       rom_c2_lo_off = value;
-    } else if (strcmp(name,"rom_c2_hi_off") == 0) {
-       rom_c2_hi_off = value;
-    } else if (strcmp(name,"color_brightness") == 0) {
-       color_brightness = value;
-    } else if (strcmp(name,"color_contrast") == 0) {
-       color_contrast = value;
-    } else if (strcmp(name,"color_gamma") == 0) {
-       color_gamma = value;
-    } else if (strcmp(name,"color_tint") == 0) {
-       color_tint = value;
-    } else if (strcmp(name,"keyboard_mapping") == 0) {
-       keyboard_mapping = value;
-    } else if (strcmp(name,"crt_filter") == 0) {
-       crt_filter = value;
-    }
-  }
-
-  fclose(fp);
+  settings_store_load(load_additional_setting, NULL);
 }
 
 void emux_save_additional_settings(FILE *fp) {
   fprintf (fp,"sid_model=%d\n", sid_model_item->value);
   fprintf (fp,"sid_write_access=%d\n", sid_write_access_item->value);
   fprintf (fp,"sid_digiblaster=%d\n", sid_digiblaster_item->value);
+  fprintf (fp,"audio_stereo=%d\n", audio_stereo_item->value);
   fprintf (fp,"reset_tape_with_cpu=%d\n", reset_tape_with_cpu);
   fprintf (fp,"tape_feedback=%d\n", tape_feedback_item->value);
   fprintf (fp,"ram_size=%d\n", ram_size_item->choice_ints[ram_size_item->value]);
@@ -1,6 +1,15 @@
 #ifndef PLUS4_EMU_MAIN_H
 #define PLUS4_EMU_MAIN_H
 
+#include <stdint.h>
+
 int main_program(int argc, char* argv[]);
 
+// Set by the emulator core before main_program is called if another core
+// will service floppy_job by calling run_floppy_job.
+extern int floppy_thread_available;
+extern uint32_t floppy_job;
+extern uint32_t floppy_done;
+void run_floppy_job(void);
+
 #endif
@@ -49,6 +49,8 @@ class AudioOutput_ : public Plus4Emu::AudioOutput {
   // write 'nFrames' mono samples from 'buf' (in 16 bit signed PCM format)
   // to the audio output device and file
   virtual void sendAudioData(const int16_t *buf, size_t nFrames);
+  // write 'nFrames' interleaved stereo frames from 'buf'
+  virtual void sendStereoAudioData(const int16_t *buf, size_t nFrames);
   virtual void setAudioOutputCallback(void (*func)(void *userData,
                                                    const int16_t *buf,
                                                    size_t nFrames),
@@ -71,6 +73,11 @@ void AudioOutput_::sendAudioData(const int16_t *buf, size_t nFrames)
   audioOutputCallback(audioOutputCallbackUserData, buf, nFrames);
 }
 
+void AudioOutput_::sendStereoAudioData(const int16_t *buf, size_t nFrames)
+{
+  audioOutputCallback(audioOutputCallbackUserData, buf, nFrames);
+}
+
 void AudioOutput_::setAudioOutputCallback(void (*func)(void *userData,
                                                        const int16_t *buf,
                                                        size_t nFrames),
@@ -420,6 +427,27 @@ extern "C" PLUS4EMU_EXPORT Plus4Emu_Error Plus4VM_SetAudioOutputQuality(
   return PLUS4EMU_SUCCESS;
 }
 
+extern "C" PLUS4EMU_EXPORT Plus4Emu_Error Plus4VM_SetAudioOutputStereo(
+    Plus4VM *vm, int isStereo)
+{
+  try {
+    vm->getVM().setAudioOutputStereo(bool(isStereo));
+  }
+  catch (std::exception& e) {
+    vm->setLastErrorMessage(e.what());
+    if (typeid(e) == typeid(std::bad_alloc))
+      return PLUS4EMU_BAD_ALLOC;
+    return PLUS4EMU_ERROR;
+  }
+  return PLUS4EMU_SUCCESS;
+}
+
+extern "C" PLUS4EMU_EXPORT void Plus4VM_SetAudioOutputPan(
+    Plus4VM *vm, int n, int pan)
+{
+  vm->getVM().setAudioOutputPan(n, pan);
+}
+
 extern "C" PLUS4EMU_EXPORT Plus4Emu_Error Plus4VM_SetAudioSampleRate(
     Plus4VM *vm, float sampleRate)
 {
@@ -821,6 +849,20 @@ extern "C" PLUS4EMU_EXPORT void Plus4VM_SetFloppyDriveAccuracy(
   vm->getVM().setFloppyDriveHighAccuracy(bool(isHighAccuracy));
 }
 
+extern "C" PLUS4EMU_EXPORT void Plus4VM_SetFloppyDriveThread(
+    Plus4VM *vm, void (*startFunc)(void *userData),
+    void (*waitFunc)(void *userData), void (*yieldFunc)(void *userData),
+    void *userData, int timeslice)
+{
+  vm->getVM().setFloppyDriveThread(startFunc, waitFunc, yieldFunc, userData,
+                                   timeslice);
+}
+
+extern "C" PLUS4EMU_EXPORT void Plus4VM_RunFloppyDriveThread(Plus4VM *vm)
+{
+  vm->getVM().runFloppyDriveThread();
+}
+
 extern "C" PLUS4EMU_EXPORT void Plus4VM_SetSerialBusDelayOffset(
     Plus4VM *vm, int n)
 {
@@ -89,7 +89,9 @@ PLUS4EMU_EXPORT const char * Plus4VM_GetLastErrorMessage(Plus4VM *vm);
  * Set the function to be called for playing audio output. The callback takes
  * three arguments: the void* userData parameter passed to this function, a
  * pointer to a buffer of mono 16-bit signed PCM audio data, and the number of
- * samples in the buffer.
+ * samples in the buffer. If stereo output is enabled, the buffer contains
+ * interleaved left and right samples, and the last argument is the number of
+ * stereo frames.
  */
 PLUS4EMU_EXPORT void Plus4VM_SetAudioOutputCallback(
     Plus4VM *vm, void (*func)(void *, const int16_t *, size_t), void *userData);
@@ -167,6 +169,17 @@ PLUS4EMU_EXPORT Plus4Emu_Error Plus4VM_LoadROM(
  */
 PLUS4EMU_EXPORT Plus4Emu_Error Plus4VM_SetAudioOutputQuality(
     Plus4VM *vm, int n);
+/*!
+ * Enable (1) or disable (0) stereo audio output. In stereo mode, TED, SID
+ * and DigiBlaster output are panned separately (see Plus4VM_SetAudioOutputPan).
+ */
+PLUS4EMU_EXPORT Plus4Emu_Error Plus4VM_SetAudioOutputStereo(
+    Plus4VM *vm, int isStereo);
+/*!
+ * Set stereo position of audio source 'n' (0: TED, 1: SID, 2: DigiBlaster)
+ * from -100 (left) to 100 (right).
+ */
+PLUS4EMU_EXPORT void Plus4VM_SetAudioOutputPan(Plus4VM *vm, int n, int pan);
 /*!
  * Set audio output sample rate in Hz (11025.0 to 96000.0).
  */
@@ -447,6 +460,27 @@ PLUS4EMU_EXPORT uint64_t Plus4VM_GetDriveHeadPositions(Plus4VM *vm);
  */
 PLUS4EMU_EXPORT void Plus4VM_SetFloppyDriveAccuracy(
     Plus4VM *vm, int isHighAccuracy);
+/*!
+ * Run the 1541 and 1581 floppy drive emulation on a separate thread.
+ * 'startFunc' is called by Plus4VM_Run() to make the drive thread call
+ * Plus4VM_RunFloppyDriveThread() once, and 'waitFunc' should block until
+ * that call has returned. Disk image files are only accessed on the
+ * emulation thread: to have that done, the drive thread calls 'yieldFunc',
+ * which should make 'waitFunc' return and block until 'startFunc' is called
+ * again. The drives are run for 'timeslice' (1 to 1000)
+ * single clock cycles per call in parallel with the TED, which delays
+ * changes of the serial bus lines by up to one time slice. Passing NULL
+ * for 'startFunc' runs the drives on the emulation thread (the default).
+ */
+PLUS4EMU_EXPORT void Plus4VM_SetFloppyDriveThread(
+    Plus4VM *vm, void (*startFunc)(void *userData),
+    void (*waitFunc)(void *userData), void (*yieldFunc)(void *userData),
+    void *userData, int timeslice);
+/*!
+ * Run the floppy drives for one time slice. Should be called only on the
+ * drive thread, as requested by 'startFunc' (see above).
+ */
+PLUS4EMU_EXPORT void Plus4VM_RunFloppyDriveThread(Plus4VM *vm);
 /*!
  * Set the serial bus delay offset to 'n' (-100 to 100) nanoseconds for devices
  * that support this configuration option (currently only the 1541).
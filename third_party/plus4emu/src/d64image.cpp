@@ -430,7 +430,34 @@ namespace Plus4 {
     return retval;
   }
 
+  struct D64ImageChangeTrackArgs {
+    D64Image  *image;
+    int       trackNum;
+    bool      retval;
+  };
+
+  void D64Image::changeTrackCallback(void *userData)
+  {
+    D64ImageChangeTrackArgs&  args =
+        *(reinterpret_cast<D64ImageChangeTrackArgs *>(userData));
+    args.retval = args.image->changeTrack(args.trackNum);
+  }
+
   bool D64Image::setCurrentTrack(int trackNum)
+  {
+    if (fileAccessFunc) {
+      // the image file is read and written on another thread
+      D64ImageChangeTrackArgs args;
+      args.image = this;
+      args.trackNum = trackNum;
+      args.retval = false;
+      fileAccessFunc(&changeTrackCallback, &args, fileAccessUserData);
+      return args.retval;
+    }
+    return changeTrack(trackNum);
+  }
+
+  bool D64Image::changeTrack(int trackNum)
   {
     bool    retval = true;
     trackNum = (trackNum >= 1 ? (trackNum <= 42 ? trackNum : 42) : 1);
@@ -457,7 +484,9 @@ namespace Plus4 {
       diskID(0x00),
       idCharacter1(0x41),
       idCharacter2(0x41),
-      haveBadSectorTable(false)
+      haveBadSectorTable(false),
+      fileAccessFunc((Plus4Emu::FileAccessFunc) 0),
+      fileAccessUserData((void *) 0)
   {
     // clear track buffers
     for (int i = 0; i < 8192; i++)
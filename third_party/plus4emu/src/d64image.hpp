@@ -46,6 +46,9 @@ namespace Plus4 {
     uint8_t     idCharacter1;
     uint8_t     idCharacter2;
     bool        haveBadSectorTable;
+    // if not NULL, track changes are done through this function
+    Plus4Emu::FileAccessFunc  fileAccessFunc;
+    void        *fileAccessUserData;
     // ----------------
     static void gcrEncodeFourBytes(uint8_t *outBuf, const uint8_t *inBuf);
     static bool gcrDecodeFourBytes(uint8_t *outBuf, const uint8_t *inBuf);
@@ -54,6 +57,8 @@ namespace Plus4 {
     bool readTrack(int trackNum = -1);
     bool flushTrack(int trackNum = -1);
     virtual bool setCurrentTrack(int trackNum);
+    bool changeTrack(int trackNum);
+    static void changeTrackCallback(void *userData);
     D64Image();
     virtual ~D64Image();
     void setImageFile(std::FILE *imageFile_, bool isReadOnly);
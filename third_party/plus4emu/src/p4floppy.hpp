@@ -57,6 +57,17 @@ namespace Plus4 {
      * the 1581).
      */
     virtual uint16_t getHeadPosition() const = 0;
+    /*!
+     * Access the disk image file by calling 'func' with 'userData' (see
+     * Plus4Emu::FileAccessFunc), or directly if 'func' is NULL. Used while
+     * the drive is emulated on a separate thread.
+     */
+    virtual void setFileAccessFunc(Plus4Emu::FileAccessFunc func,
+                                   void *userData)
+    {
+      (void) func;
+      (void) userData;
+    }
   };
 
 }       // namespace Plus4
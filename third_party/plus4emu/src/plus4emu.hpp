@@ -93,6 +93,12 @@ namespace Plus4Emu {
     }
   };
 
+  // calls func(funcData) on the thread that is allowed to access files, and
+  // returns when it is done; used by floppy drives that are emulated on a
+  // separate thread (see Plus4::Plus4VM::setFloppyDriveThread())
+  typedef void (*FileAccessFunc)(void (*func)(void *), void *funcData,
+                                 void *userData);
+
 }       // namespace Plus4Emu
 
 #if defined(__GNUC__) && (__GNUC__ >= 3) && defined(__i386__) && !defined(__ICC)
@@ -105,8 +105,9 @@ namespace Plus4 {
       tmp = int32_t((uint32_t(tmp * vm.sidOutputVolume)
                      + uint32_t(0x80004000UL)) >> 15) - int32_t(65536);
     }
-    vm.soundOutputSignal = tmp + int32_t(sampleValue);
-    vm.sendMonoAudioOutput(vm.soundOutputSignal);
+    vm.soundOutputSignal = tmp + int32_t(sampleValue) + vm.digiBlasterSignal;
+    // TED, SID and DigiBlaster are panned separately in stereo mode
+    vm.sendStereoAudioOutput(int32_t(sampleValue), tmp, vm.digiBlasterSignal);
   }
 
   void Plus4VM::TED7360_::videoOutputCallback(const uint8_t *buf, size_t nBytes)
@@ -181,7 +182,7 @@ namespace Plus4 {
     if (regNum == 0x1E) {
       ted.vm.digiBlasterOutput = value;
       if (ted.vm.digiBlasterEnabled)
-        ted.vm.sid_->input((int(value) << 8) - 32768);
+        ted.vm.updateDigiBlasterInput();
     }
     ted.vm.sid_->write(regNum, value);
   }
@@ -302,8 +303,14 @@ namespace Plus4 {
         if (ted.vm.serialDevices[4] != (SerialDevice *) 0)
           ted.vm.serialDevices[4]->atnStateChangeCallback(atnState);
         for (int i = 8; i < 12; i++) {
-          if (ted.vm.serialDevices[i] != (SerialDevice *) 0)
-            ted.vm.serialDevices[i]->atnStateChangeCallback(atnState);
+          if (ted.vm.serialDevices[i] != (SerialDevice *) 0) {
+            // drives on the drive thread are notified at the end of the
+            // current time slice
+            if (ted.vm.floppyThreadCallbacks[i & 3])
+              ted.vm.floppyThreadATNChanged = true;
+            else
+              ted.vm.serialDevices[i]->atnStateChangeCallback(atnState);
+          }
         }
       }
     }
@@ -421,23 +428,44 @@ namespace Plus4 {
   void Plus4VM::addFloppyCallback(int n)
   {
     n = (n & 3) | 8;
-    SerialDevice::ProcessCallbackPtr  func;
+    SerialDevice::ProcessCallbackPtr  func =
+        (SerialDevice::ProcessCallbackPtr) 0;
     void    *userData = serialDevices[n]->getProcessCallbackUserData();
+    bool    highAccuracy = false;
     if (is1541HighAccuracy) {
       func = serialDevices[n]->getHighAccuracyProcessCallback();
-      if (func) {
-        ted->setCallback(func, userData, 3);
-        return;
-      }
+      highAccuracy = bool(func);
     }
-    func = serialDevices[n]->getProcessCallback();
-    if (func)
-      ted->setCallback(func, userData, 1);
+    if (!func)
+      func = serialDevices[n]->getProcessCallback();
+    if (!func)
+      return;
+    FloppyDrive *drive = dynamic_cast<FloppyDrive *>(serialDevices[n]);
+    if (floppyThreadStartFunc && drive &&
+        typeid(*(serialDevices[n])) != typeid(VC1551)) {
+      waitFloppyDriveThread();
+      drive->setFileAccessFunc(&floppyThreadFileAccess, this);
+      floppyThreadCallbacks[n & 3] = func;
+      floppyThreadCallbackUserData[n & 3] = userData;
+      floppyThreadHighAccuracy[n & 3] = highAccuracy;
+      updateFloppyThreadCallback();
+      return;
+    }
+    ted->setCallback(func, userData, (highAccuracy ? 3 : 1));
   }
 
   void Plus4VM::removeFloppyCallback(int n)
   {
     n = (n & 3) | 8;
+    if (floppyThreadCallbacks[n & 3]) {
+      waitFloppyDriveThread();
+      dynamic_cast<FloppyDrive *>(serialDevices[n])->setFileAccessFunc(
+          (Plus4Emu::FileAccessFunc) 0, (void *) 0);
+      floppyThreadCallbacks[n & 3] = (SerialDevice::ProcessCallbackPtr) 0;
+      floppyThreadCallbackUserData[n & 3] = (void *) 0;
+      floppyThreadHighAccuracy[n & 3] = false;
+      updateFloppyThreadCallback();
+    }
     SerialDevice::ProcessCallbackPtr  func;
     void    *userData = serialDevices[n]->getProcessCallbackUserData();
     func = serialDevices[n]->getProcessCallback();
@@ -448,6 +476,39 @@ namespace Plus4 {
       ted->setCallback(func, userData, 0);
   }
 
+  void Plus4VM::updateFloppyThreadCallback()
+  {
+    bool    haveDrives = false;
+    for (int i = 0; i < 4; i++)
+      haveDrives = haveDrives || bool(floppyThreadCallbacks[i]);
+    floppyThreadCycleCnt = floppyThreadTimeslice;
+    ted->setCallback(&floppyThreadCallback, this, (haveDrives ? 1 : 0));
+  }
+
+  void Plus4VM::waitFloppyDriveThread()
+  {
+    while (floppyThreadBusy) {
+      floppyThreadWaitFunc(floppyThreadFuncUserData);
+      void    (*fileFunc)(void *) = floppyThreadFileFunc;
+      if (!fileFunc) {
+        floppyThreadBusy = false;
+        break;
+      }
+      // the drive thread is waiting for a disk image file access
+      floppyThreadFileFunc = (void (*)(void *)) 0;
+      fileFunc(floppyThreadFileData);
+      floppyThreadStartFunc(floppyThreadFuncUserData);
+    }
+    if (floppyThreadATNChanged) {
+      floppyThreadATNChanged = false;
+      bool    atnState = bool(ted->serialPort.getATN());
+      for (int i = 0; i < 4; i++) {
+        if (floppyThreadCallbacks[i])
+          serialDevices[i | 8]->atnStateChangeCallback(atnState);
+      }
+    }
+  }
+
   void Plus4VM::resetACIA()
   {
     acia_.reset();
@@ -624,6 +685,33 @@ namespace Plus4 {
       vm.setEnableACIACallback(false);
   }
 
+  PLUS4EMU_REGPARM1 void Plus4VM::floppyThreadCallback(void *userData)
+  {
+    Plus4VM&  vm = *(reinterpret_cast<Plus4VM *>(userData));
+    if (--vm.floppyThreadCycleCnt > 0)
+      return;
+    // wait for the previous time slice, and start the next one to run in
+    // parallel with the TED
+    vm.floppyThreadCycleCnt = vm.floppyThreadTimeslice;
+    vm.waitFloppyDriveThread();
+    vm.floppyThreadBusy = true;
+    vm.floppyThreadStartFunc(vm.floppyThreadFuncUserData);
+  }
+
+  void Plus4VM::floppyThreadFileAccess(void (*func)(void *), void *funcData,
+                                       void *userData)
+  {
+    Plus4VM&  vm = *(reinterpret_cast<Plus4VM *>(userData));
+    if (!vm.floppyThreadInSlice) {
+      // on the emulation thread, with the drive thread stopped
+      func(funcData);
+      return;
+    }
+    vm.floppyThreadFileData = funcData;
+    vm.floppyThreadFileFunc = func;
+    vm.floppyThreadYieldFunc(vm.floppyThreadFuncUserData);
+  }
+
   PLUS4EMU_REGPARM1 void Plus4VM::pasteTextCallback(void *userData)
   {
     Plus4VM&  vm = *(reinterpret_cast<Plus4VM *>(userData));
@@ -829,6 +917,7 @@ namespace Plus4 {
       sidEnabled(false),
       digiBlasterEnabled(false),
       digiBlasterOutput(0x80),
+      digiBlasterSignal(0),
       sidCycleCnt(4),
       sidFlags(0),
       is1541HighAccuracy(true),
@@ -859,6 +948,17 @@ namespace Plus4 {
       drive9Is1551(false),
       iecDrive8((ParallelIECDrive *) 0),
       iecDrive9((ParallelIECDrive *) 0),
+      floppyThreadStartFunc((void (*)(void *)) 0),
+      floppyThreadWaitFunc((void (*)(void *)) 0),
+      floppyThreadYieldFunc((void (*)(void *)) 0),
+      floppyThreadFuncUserData((void *) 0),
+      floppyThreadFileFunc((void (*)(void *)) 0),
+      floppyThreadFileData((void *) 0),
+      floppyThreadInSlice(false),
+      floppyThreadTimeslice(1),
+      floppyThreadCycleCnt(1),
+      floppyThreadBusy(false),
+      floppyThreadATNChanged(false),
       pasteTextCycleCnt(0),
       pasteTextWaitCnt(0),
       pasteTextCursorPositionX(-1),
@@ -868,6 +968,11 @@ namespace Plus4 {
   {
     for (int i = 0; i < 12; i++)
       serialDevices[i] = (SerialDevice *) 0;
+    for (int i = 0; i < 4; i++) {
+      floppyThreadCallbacks[i] = (SerialDevice::ProcessCallbackPtr) 0;
+      floppyThreadCallbackUserData[i] = (void *) 0;
+      floppyThreadHighAccuracy[i] = false;
+    }
     sid_ = new SID(soundOutputAccumulator);
     try {
       sid_->set_chip_model(MOS8580);
@@ -967,6 +1072,8 @@ namespace Plus4 {
                          - int64_t(double(tedCycles) * 4294967296000000.0
                                    / double(int32_t(tedInputClockFrequency)));
     }
+    // the drives are only accessed by other threads while the TED is running
+    waitFloppyDriveThread();
   }
 
   void Plus4VM::reset(bool isColdReset)
@@ -978,7 +1085,7 @@ namespace Plus4 {
     setTapeMotorState(false);
     sid_->reset();
     digiBlasterOutput = 0x80;
-    sid_->input(0);
+    updateDigiBlasterInput();
     if (isColdReset) {
       sidEnabled = false;
       ted->setCallback(&SID::clockCallback, sid_, 0);
@@ -1181,10 +1288,7 @@ namespace Plus4 {
     }
     digiBlasterEnabled = enableDigiBlaster;
     sid_->set_voice_mask(enableDigiBlaster ? 0x0F : 0x07);
-    if (enableDigiBlaster)
-      sid_->input((int(digiBlasterOutput) << 8) - 32768);
-    else
-      sid_->input(0);
+    updateDigiBlasterInput();
     int32_t newSIDOutputVolume =
         int32_t(std::pow(10.0, double(outputVolume) * 0.05)
                 * (65536.0 * 3.0 / 187.0) + 0.5);
@@ -1195,6 +1299,32 @@ namespace Plus4 {
     }
   }
 
+  void Plus4VM::updateDigiBlasterInput()
+  {
+    int32_t tmp = (int32_t(digiBlasterOutput) << 8) - 32768;
+    if (!digiBlasterEnabled) {
+      sid_->input(0);
+      digiBlasterSignal = 0;
+    }
+    else if (getIsAudioOutputStereo()) {
+      // mixed by the audio converter instead of the SID external input
+      // so that it can be panned separately, at about the level of one
+      // SID voice
+      sid_->input(0);
+      digiBlasterSignal = tmp >> 1;
+    }
+    else {
+      sid_->input(short(tmp));
+      digiBlasterSignal = 0;
+    }
+  }
+
+  void Plus4VM::setAudioOutputStereo(bool isStereo)
+  {
+    VirtualMachine::setAudioOutputStereo(isStereo);
+    updateDigiBlasterInput();
+  }
+
   void Plus4VM::disableSIDEmulation()
   {
     if (sidEnabled) {
@@ -1202,7 +1332,7 @@ namespace Plus4 {
       stopDemoRecording(false);
       sid_->reset();
       digiBlasterOutput = 0x80;
-      sid_->input(0);
+      updateDigiBlasterInput();
       sidEnabled = false;
       ted->setCallback(&SID::clockCallback, sid_, 0);
       ted->setCallback(&sidCallbackC64, this, 0);
@@ -1839,6 +1969,52 @@ namespace Plus4 {
     }
   }
 
+  void Plus4VM::setFloppyDriveThread(void (*startFunc)(void *userData),
+                                     void (*waitFunc)(void *userData),
+                                     void (*yieldFunc)(void *userData),
+                                     void *userData, int timeslice)
+  {
+    if (!(startFunc && waitFunc && yieldFunc)) {
+      startFunc = (void (*)(void *)) 0;
+      waitFunc = (void (*)(void *)) 0;
+      yieldFunc = (void (*)(void *)) 0;
+      userData = (void *) 0;
+    }
+    waitFloppyDriveThread();
+    for (int i = 8; i < 12; i++) {
+      if (serialDevices[i] != (SerialDevice *) 0)
+        removeFloppyCallback(i);
+    }
+    floppyThreadStartFunc = startFunc;
+    floppyThreadWaitFunc = waitFunc;
+    floppyThreadYieldFunc = yieldFunc;
+    floppyThreadFuncUserData = userData;
+    floppyThreadTimeslice = (timeslice > 1 ?
+                             (timeslice < 1000 ? timeslice : 1000) : 1);
+    for (int i = 8; i < 12; i++) {
+      if (serialDevices[i] != (SerialDevice *) 0)
+        addFloppyCallback(i);
+    }
+  }
+
+  void Plus4VM::runFloppyDriveThread()
+  {
+    floppyThreadInSlice = true;
+    for (int i = floppyThreadTimeslice; i > 0; i--) {
+      // same order as the TED callbacks: first phase for all drives, then
+      // second phase for the drives using high accuracy emulation
+      for (int j = 0; j < 4; j++) {
+        if (floppyThreadCallbacks[j])
+          floppyThreadCallbacks[j](floppyThreadCallbackUserData[j]);
+      }
+      for (int j = 0; j < 4; j++) {
+        if (floppyThreadHighAccuracy[j])
+          floppyThreadCallbacks[j](floppyThreadCallbackUserData[j]);
+      }
+    }
+    floppyThreadInSlice = false;
+  }
+
   void Plus4VM::setSerialBusDelayOffset(int n)
   {
     n = (n > -100 ? (n < 100 ? n : 100) : -100);
@@ -2492,10 +2668,7 @@ namespace Plus4 {
       else
         sid_->set_chip_model(MOS8580);
       ted->setEnableC64CompatibleSID(bool(sidFlags & 2));
-      if (digiBlasterEnabled)
-        sid_->input((int(digiBlasterOutput) << 8) - 32768);
-      else
-        sid_->input(0);
+      updateDigiBlasterInput();
       ted->setCallback(&SID::clockCallback, sid_,
                        int(sidEnabled) & int(!(sidFlags & 4)));
       ted->setCallback(&sidCallbackC64, this,
@@ -114,6 +114,8 @@ namespace Plus4 {
     bool      sidEnabled;
     bool      digiBlasterEnabled;
     uint8_t   digiBlasterOutput;
+    // DigiBlaster output sent to the audio converter in stereo mode
+    int32_t   digiBlasterSignal;
     uint8_t   sidCycleCnt;
     // bit 0 = SID model is 6581
     // bit 1 = enable write access at $D400-$D41F
@@ -149,6 +151,26 @@ namespace Plus4 {
     bool      drive9Is1551;
     ParallelIECDrive  *iecDrive8;
     ParallelIECDrive  *iecDrive9;
+    // 1541 and 1581 drives run by runFloppyDriveThread(), indexed by unit - 8
+    SerialDevice::ProcessCallbackPtr  floppyThreadCallbacks[4];
+    void      *floppyThreadCallbackUserData[4];
+    bool      floppyThreadHighAccuracy[4];
+    void      (*floppyThreadStartFunc)(void *userData);
+    void      (*floppyThreadWaitFunc)(void *userData);
+    void      (*floppyThreadYieldFunc)(void *userData);
+    void      *floppyThreadFuncUserData;
+    // disk image file access requested by the drive thread, to be done on
+    // the emulation thread
+    void      (*volatile floppyThreadFileFunc)(void *);
+    void      *floppyThreadFileData;
+    // true while runFloppyDriveThread() is running
+    volatile bool floppyThreadInSlice;
+    int       floppyThreadTimeslice;    // in single clock cycles
+    int       floppyThreadCycleCnt;
+    // true while the drive thread is running a time slice
+    bool      floppyThreadBusy;
+    // ATN has changed while the drive thread was running
+    bool      floppyThreadATNChanged;
     int       pasteTextCycleCnt;
     int       pasteTextWaitCnt;
     int       pasteTextCursorPositionX;
@@ -161,6 +183,10 @@ namespace Plus4 {
     void updateTimingParameters(bool ntscMode_);
     void addFloppyCallback(int n);
     void removeFloppyCallback(int n);
+    void updateFloppyThreadCallback();
+    // send the DigiBlaster output to the SID or the audio converter
+    void updateDigiBlasterInput();
+    void waitFloppyDriveThread();
     void resetACIA();
     M7501 * getDebugCPU();
     const M7501 * getDebugCPU() const;
@@ -173,6 +199,9 @@ namespace Plus4 {
     static PLUS4EMU_REGPARM1 void lightPenCallback(void *userData);
     static PLUS4EMU_REGPARM1 void videoCaptureCallback(void *userData);
     static PLUS4EMU_REGPARM1 void aciaCallback(void *userData);
+    static PLUS4EMU_REGPARM1 void floppyThreadCallback(void *userData);
+    static void floppyThreadFileAccess(void (*func)(void *), void *funcData,
+                                       void *userData);
     inline void setEnableACIACallback(bool isEnabled)
     {
       if (isEnabled != aciaCallbackFlag) {
@@ -252,6 +281,11 @@ namespace Plus4 {
      * any of the SID registers) to reduce CPU usage.
      */
     virtual void disableSIDEmulation();
+    /*!
+     * Enable or disable stereo audio output. In stereo mode, the
+     * DigiBlaster is mixed separately from the SID so that it can be panned.
+     */
+    virtual void setAudioOutputStereo(bool isStereo);
     /*!
      * Set state of key 'keyCode' (0 to 127).
      */
@@ -416,6 +450,30 @@ namespace Plus4 {
      * at the expense of increased CPU usage. The default is 'true'.
      */
     virtual void setFloppyDriveHighAccuracy(bool isEnabled);
+    /*!
+     * Run the 1541 and 1581 drive emulation on a separate thread. 'startFunc'
+     * is called on the emulation thread to make the drive thread call
+     * runFloppyDriveThread() once, and 'waitFunc' should block until that
+     * call has returned. Disk image files are only accessed on the emulation
+     * thread: the drive thread calls 'yieldFunc', which should make
+     * 'waitFunc' return and then block until 'startFunc' is called again,
+     * and the emulation thread does the file access in between. The drives
+     * are run for 'timeslice' (1 to 1000)
+     * single clock cycles per call in parallel with the TED, so the two
+     * sides see changes of the serial bus lines with a delay of up to one
+     * time slice. If 'startFunc' or 'waitFunc' is NULL, the drives are run
+     * on the emulation thread again (this is the default). The 1551 always
+     * runs on the emulation thread, since it is accessed directly by the TED.
+     */
+    void setFloppyDriveThread(void (*startFunc)(void *userData),
+                              void (*waitFunc)(void *userData),
+                              void (*yieldFunc)(void *userData),
+                              void *userData, int timeslice);
+    /*!
+     * Run the floppy drives for one time slice. This is called on the drive
+     * thread.
+     */
+    void runFloppyDriveThread();
     /*!
      * Set the serial bus delay offset to 'n' (-100 to 100) nanoseconds for
      * devices that support this configuration option.
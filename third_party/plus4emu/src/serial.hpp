@@ -34,26 +34,35 @@ namespace Plus4 {
     // written by the virtual machine class, and read by the serial devices.
     int64_t   timesliceLength;
    private:
-    uint16_t  clkStateMask;
-    uint16_t  dataStateMask;
-    uint8_t   atnState;
+    // bit N of element 0 is device N, bit N of element 1 is device N + 8;
+    // devices 0 to 7 and 8 to 15 are stored in separate bytes so that the
+    // floppy drives (8 to 11) can be run on a different thread than the
+    // computer and printer (see Plus4VM::setFloppyDriveThread()); they are
+    // volatile so that every access really goes to memory, and the two
+    // threads are synchronized with barriers at the end of each time slice
+    volatile uint8_t  clkStateMask[2];
+    volatile uint8_t  dataStateMask[2];
+    volatile uint8_t  atnState;
    public:
     SerialBus()
       : timesliceLength(int64_t(1) << 32),
-        clkStateMask(0x0000),
-        dataStateMask(0x0000),
         atnState(0xFF)
     {
+      clkStateMask[0] = 0x00;
+      clkStateMask[1] = 0x00;
+      dataStateMask[0] = 0x00;
+      dataStateMask[1] = 0x00;
     }
     // returns the current state of the CLK line (0: low, 0xFF: high)
     inline uint8_t getCLK() const
     {
-      return (uint8_t(bool(clkStateMask)) - uint8_t(1));
+      return (uint8_t(bool(clkStateMask[0] | clkStateMask[1])) - uint8_t(1));
     }
     // returns the current state of the DATA line (0: low, 0xFF: high)
     inline uint8_t getDATA() const
     {
-      return (uint8_t(bool(dataStateMask)) - uint8_t(1));
+      return (uint8_t(bool(dataStateMask[0] | dataStateMask[1]))
+              - uint8_t(1));
     }
     // returns the current state of the ATN line (0: low, 0xFF: high)
     inline uint8_t getATN() const
@@ -63,22 +72,30 @@ namespace Plus4 {
     // set the CLK output (false: low, true: high) for device 'n' (0 to 15)
     inline void setCLK(int n, bool newState)
     {
-      clkStateMask =
-          (clkStateMask | (uint16_t(1) << n)) ^ (uint16_t(newState) << n);
+      volatile uint8_t&  clkStateMask_ = clkStateMask[n >> 3];
+      n = n & 7;
+      clkStateMask_ =
+          (clkStateMask_ | (uint8_t(1) << n)) ^ (uint8_t(newState) << n);
     }
     // set the DATA output (false: low, true: high) for device 'n' (0 to 15)
     inline void setDATA(int n, bool newState)
     {
-      dataStateMask =
-          (dataStateMask | (uint16_t(1) << n)) ^ (uint16_t(newState) << n);
+      volatile uint8_t&  dataStateMask_ = dataStateMask[n >> 3];
+      n = n & 7;
+      dataStateMask_ =
+          (dataStateMask_ | (uint8_t(1) << n)) ^ (uint8_t(newState) << n);
     }
     // set the CLK and DATA output (false: low, true: high)
     // for device 'n' (0 to 15)
     inline void setCLKAndDATA(int n, bool newCLKState, bool newDATAState)
     {
-      uint16_t  mask_ = uint16_t(1) << n;
-      clkStateMask = (clkStateMask | mask_) ^ (uint16_t(newCLKState) << n);
-      dataStateMask = (dataStateMask | mask_) ^ (uint16_t(newDATAState) << n);
+      volatile uint8_t&  clkStateMask_ = clkStateMask[n >> 3];
+      volatile uint8_t&  dataStateMask_ = dataStateMask[n >> 3];
+      n = n & 7;
+      uint8_t   mask_ = uint8_t(1) << n;
+      clkStateMask_ = (clkStateMask_ | mask_) ^ (uint8_t(newCLKState) << n);
+      dataStateMask_ =
+          (dataStateMask_ | mask_) ^ (uint8_t(newDATAState) << n);
     }
     // set the state of the ATN line (false: low, true: high)
     inline void setATN(bool newState)
@@ -88,16 +105,19 @@ namespace Plus4 {
     // remove device 'n' (0 to 15) from the bus, setting its outputs to high
     inline void removeDevice(int n)
     {
-      uint16_t  mask_ = (uint16_t(1) << n) ^ uint16_t(0xFFFF);
-      clkStateMask &= mask_;
-      dataStateMask &= mask_;
+      uint8_t   mask_ = (uint8_t(1) << (n & 7)) ^ uint8_t(0xFF);
+      clkStateMask[n >> 3] &= mask_;
+      dataStateMask[n >> 3] &= mask_;
     }
     // remove devices defined by 'mask_' (bit N of 'mask_' corresponds to
     // device N) from the bus
     inline void removeDevices(uint16_t mask_)
     {
-      clkStateMask &= (mask_ ^ uint16_t(0xFFFF));
-      dataStateMask &= (mask_ ^ uint16_t(0xFFFF));
+      mask_ = mask_ ^ uint16_t(0xFFFF);
+      clkStateMask[0] &= uint8_t(mask_ & 0xFF);
+      clkStateMask[1] &= uint8_t(mask_ >> 8);
+      dataStateMask[0] &= uint8_t(mask_ & 0xFF);
+      dataStateMask[1] &= uint8_t(mask_ >> 8);
     }
   };
 
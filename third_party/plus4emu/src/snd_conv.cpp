@@ -358,5 +358,199 @@ namespace Plus4Emu {
     resampleRatio = outputSampleRate / inputSampleRate;
   }
 
+  // --------------------------------------------------------------------------
+
+  AudioConverterMono::AudioConverterMono(float inputSampleRate_,
+                                         float outputSampleRate_,
+                                         float dcBlockFreq1,
+                                         float dcBlockFreq2,
+                                         float ampScale_)
+    : AudioConverter(inputSampleRate_, outputSampleRate_,
+                     dcBlockFreq1, dcBlockFreq2, ampScale_),
+      lowQuality(output, inputSampleRate_, outputSampleRate_,
+                 dcBlockFreq1, dcBlockFreq2, ampScale_),
+      highQuality(output, inputSampleRate_, outputSampleRate_,
+                  dcBlockFreq1, dcBlockFreq2, ampScale_),
+      channel(&lowQuality)
+  {
+  }
+
+  AudioConverterMono::~AudioConverterMono()
+  {
+  }
+
+  void AudioConverterMono::sendInputSignal(int32_t audioInput)
+  {
+    channel->sendInputSignal(audioInput);
+    if (output.haveOutput) {
+      output.haveOutput = false;
+      audioOutput(output.outputSignal);
+    }
+  }
+
+  void AudioConverterMono::setInputSampleRate(float sampleRate_)
+  {
+    inputSampleRate = sampleRate_;
+    lowQuality.setInputSampleRate(sampleRate_);
+    highQuality.setInputSampleRate(sampleRate_);
+  }
+
+  void AudioConverterMono::setOutputSampleRate(float sampleRate_)
+  {
+    outputSampleRate = sampleRate_;
+    lowQuality.setOutputSampleRate(sampleRate_);
+    highQuality.setOutputSampleRate(sampleRate_);
+  }
+
+  void AudioConverterMono::setDCBlockFilters(float frq1, float frq2)
+  {
+    lowQuality.setDCBlockFilters(frq1, frq2);
+    highQuality.setDCBlockFilters(frq1, frq2);
+  }
+
+  void AudioConverterMono::setEqualizerParameters(int mode_, float freq_,
+                                                  float level_, float q_)
+  {
+    lowQuality.setEqualizerParameters(mode_, freq_, level_, q_);
+    highQuality.setEqualizerParameters(mode_, freq_, level_, q_);
+  }
+
+  void AudioConverterMono::setOutputVolume(float ampScale_)
+  {
+    lowQuality.setOutputVolume(ampScale_);
+    highQuality.setOutputVolume(ampScale_);
+  }
+
+  void AudioConverterMono::setHighQuality(bool highQuality_)
+  {
+    if (highQuality_)
+      channel = &highQuality;
+    else
+      channel = &lowQuality;
+  }
+
+  // --------------------------------------------------------------------------
+
+  AudioConverterStereo::AudioConverterStereo(float inputSampleRate_,
+                                             float outputSampleRate_,
+                                             float dcBlockFreq1,
+                                             float dcBlockFreq2,
+                                             float ampScale_)
+    : AudioConverter(inputSampleRate_, outputSampleRate_,
+                     dcBlockFreq1, dcBlockFreq2, ampScale_),
+      lowQualityL(outputL, inputSampleRate_, outputSampleRate_,
+                  dcBlockFreq1, dcBlockFreq2, ampScale_),
+      lowQualityR(outputR, inputSampleRate_, outputSampleRate_,
+                  dcBlockFreq1, dcBlockFreq2, ampScale_),
+      highQualityL(outputL, inputSampleRate_, outputSampleRate_,
+                   dcBlockFreq1, dcBlockFreq2, ampScale_),
+      highQualityR(outputR, inputSampleRate_, outputSampleRate_,
+                   dcBlockFreq1, dcBlockFreq2, ampScale_),
+      channelL(&lowQualityL),
+      channelR(&lowQualityR)
+  {
+    for (int i = 0; i < 3; i++)
+      setPan(i, 0);
+  }
+
+  AudioConverterStereo::~AudioConverterStereo()
+  {
+  }
+
+  void AudioConverterStereo::sendInputSignal(int32_t audioInput)
+  {
+    sendInputSignal(audioInput, 0, 0);
+  }
+
+  void AudioConverterStereo::sendInputSignal(int32_t audioInput0,
+                                             int32_t audioInput1,
+                                             int32_t audioInput2)
+  {
+    int32_t left = ((audioInput0 * gainL[0]) + (audioInput1 * gainL[1])
+                    + (audioInput2 * gainL[2])) >> 8;
+    int32_t right = ((audioInput0 * gainR[0]) + (audioInput1 * gainR[1])
+                     + (audioInput2 * gainR[2])) >> 8;
+    // the two channels are resampled in lock step, so they always
+    // produce an output sample at the same time
+    channelL->sendInputSignal(left);
+    channelR->sendInputSignal(right);
+    if (outputL.haveOutput) {
+      outputL.haveOutput = false;
+      outputR.haveOutput = false;
+      audioOutput(outputL.outputSignal, outputR.outputSignal);
+    }
+  }
+
+  void AudioConverterStereo::setInputSampleRate(float sampleRate_)
+  {
+    inputSampleRate = sampleRate_;
+    lowQualityL.setInputSampleRate(sampleRate_);
+    lowQualityR.setInputSampleRate(sampleRate_);
+    highQualityL.setInputSampleRate(sampleRate_);
+    highQualityR.setInputSampleRate(sampleRate_);
+  }
+
+  void AudioConverterStereo::setOutputSampleRate(float sampleRate_)
+  {
+    outputSampleRate = sampleRate_;
+    lowQualityL.setOutputSampleRate(sampleRate_);
+    lowQualityR.setOutputSampleRate(sampleRate_);
+    highQualityL.setOutputSampleRate(sampleRate_);
+    highQualityR.setOutputSampleRate(sampleRate_);
+  }
+
+  void AudioConverterStereo::setDCBlockFilters(float frq1, float frq2)
+  {
+    lowQualityL.setDCBlockFilters(frq1, frq2);
+    lowQualityR.setDCBlockFilters(frq1, frq2);
+    highQualityL.setDCBlockFilters(frq1, frq2);
+    highQualityR.setDCBlockFilters(frq1, frq2);
+  }
+
+  void AudioConverterStereo::setEqualizerParameters(int mode_, float freq_,
+                                                    float level_, float q_)
+  {
+    lowQualityL.setEqualizerParameters(mode_, freq_, level_, q_);
+    lowQualityR.setEqualizerParameters(mode_, freq_, level_, q_);
+    highQualityL.setEqualizerParameters(mode_, freq_, level_, q_);
+    highQualityR.setEqualizerParameters(mode_, freq_, level_, q_);
+  }
+
+  void AudioConverterStereo::setOutputVolume(float ampScale_)
+  {
+    lowQualityL.setOutputVolume(ampScale_);
+    lowQualityR.setOutputVolume(ampScale_);
+    highQualityL.setOutputVolume(ampScale_);
+    highQualityR.setOutputVolume(ampScale_);
+  }
+
+  void AudioConverterStereo::setHighQuality(bool highQuality_)
+  {
+    if (highQuality_) {
+      channelL = &highQualityL;
+      channelR = &highQualityR;
+    }
+    else {
+      channelL = &lowQualityL;
+      channelR = &lowQualityR;
+    }
+  }
+
+  void AudioConverterStereo::setPan(int n, int pan)
+  {
+    if (n < 0 || n > 2)
+      return;
+    pan = (pan > -100 ? (pan < 100 ? pan : 100) : -100);
+    // at the center both outputs get the full signal, to be as loud as
+    // the mono mix
+    gainL[n] = (pan <= 0 ? 256 : ((100 - pan) * 256 / 100));
+    gainR[n] = (pan >= 0 ? 256 : ((100 + pan) * 256 / 100));
+  }
+
+  void AudioConverterStereo::audioOutput(int16_t outputSignal_)
+  {
+    audioOutput(outputSignal_, outputSignal_);
+  }
+
 }       // namespace Plus4Emu
 
@@ -59,9 +59,10 @@ namespace Plus4Emu {
     virtual void sendInputSignal(int32_t audioInput) = 0;
     virtual void setInputSampleRate(float sampleRate_);
     virtual void setOutputSampleRate(float sampleRate_);
-    void setDCBlockFilters(float frq1, float frq2);
-    void setEqualizerParameters(int mode_, float freq_, float level_, float q_);
-    void setOutputVolume(float ampScale_);
+    virtual void setDCBlockFilters(float frq1, float frq2);
+    virtual void setEqualizerParameters(int mode_, float freq_,
+                                        float level_, float q_);
+    virtual void setOutputVolume(float ampScale_);
    protected:
     virtual void audioOutput(int16_t outputSignal_) = 0;
     inline void sendOutputSignal(float audioSignal);
@@ -114,6 +115,106 @@ namespace Plus4Emu {
     virtual void setOutputSampleRate(float sampleRate_);
   };
 
+  // Resampler that stores its output sample in 'output' instead of sending
+  // it, so that the converters below can keep both resampling methods
+  // allocated and switch between them without allocating memory.
+  struct AudioConverterChannelOutput {
+    int16_t outputSignal;
+    bool    haveOutput;
+    AudioConverterChannelOutput()
+      : outputSignal(0),
+        haveOutput(false)
+    {
+    }
+  };
+
+  template <typename T>
+  class AudioConverterChannel : public T {
+   private:
+    AudioConverterChannelOutput&  output;
+   public:
+    AudioConverterChannel(AudioConverterChannelOutput& output_,
+                          float inputSampleRate_, float outputSampleRate_,
+                          float dcBlockFreq1, float dcBlockFreq2,
+                          float ampScale_)
+      : T(inputSampleRate_, outputSampleRate_,
+          dcBlockFreq1, dcBlockFreq2, ampScale_),
+        output(output_)
+    {
+    }
+    virtual ~AudioConverterChannel()
+    {
+    }
+   protected:
+    virtual void audioOutput(int16_t outputSignal_)
+    {
+      output.outputSignal = outputSignal_;
+      output.haveOutput = true;
+    }
+  };
+
+  // Mono converter with both resampling methods allocated.
+  class AudioConverterMono : public AudioConverter {
+   private:
+    AudioConverterChannelOutput output;
+    AudioConverterChannel<AudioConverterLowQuality>   lowQuality;
+    AudioConverterChannel<AudioConverterHighQuality>  highQuality;
+    AudioConverter  *channel;
+   public:
+    AudioConverterMono(float inputSampleRate_, float outputSampleRate_,
+                       float dcBlockFreq1 = 5.0f, float dcBlockFreq2 = 15.0f,
+                       float ampScale_ = 0.7943f);
+    virtual ~AudioConverterMono();
+    virtual void sendInputSignal(int32_t audioInput);
+    virtual void setInputSampleRate(float sampleRate_);
+    virtual void setOutputSampleRate(float sampleRate_);
+    virtual void setDCBlockFilters(float frq1, float frq2);
+    virtual void setEqualizerParameters(int mode_, float freq_,
+                                        float level_, float q_);
+    virtual void setOutputVolume(float ampScale_);
+    void setHighQuality(bool highQuality_);
+  };
+
+  // Mixes three input channels, each with its own panning, to a stereo
+  // output. Both resampling methods are kept for each output channel, so
+  // that the quality can be changed without allocating memory.
+  class AudioConverterStereo : public AudioConverter {
+   private:
+    AudioConverterChannelOutput outputL;
+    AudioConverterChannelOutput outputR;
+    AudioConverterChannel<AudioConverterLowQuality>   lowQualityL;
+    AudioConverterChannel<AudioConverterLowQuality>   lowQualityR;
+    AudioConverterChannel<AudioConverterHighQuality>  highQualityL;
+    AudioConverterChannel<AudioConverterHighQuality>  highQualityR;
+    AudioConverter  *channelL;
+    AudioConverter  *channelR;
+    // gain of each input channel in the left and right output (0 to 256)
+    int32_t gainL[3];
+    int32_t gainR[3];
+   public:
+    AudioConverterStereo(float inputSampleRate_, float outputSampleRate_,
+                         float dcBlockFreq1 = 5.0f, float dcBlockFreq2 = 15.0f,
+                         float ampScale_ = 0.7943f);
+    virtual ~AudioConverterStereo();
+    // mono input, sent to both output channels
+    virtual void sendInputSignal(int32_t audioInput);
+    void sendInputSignal(int32_t audioInput0, int32_t audioInput1,
+                         int32_t audioInput2);
+    virtual void setInputSampleRate(float sampleRate_);
+    virtual void setOutputSampleRate(float sampleRate_);
+    virtual void setDCBlockFilters(float frq1, float frq2);
+    virtual void setEqualizerParameters(int mode_, float freq_,
+                                        float level_, float q_);
+    virtual void setOutputVolume(float ampScale_);
+    void setHighQuality(bool highQuality_);
+    // set the position of input channel 'n' (0 to 2) from -100 (left)
+    // to 100 (right); the default is 0 (center)
+    void setPan(int n, int pan);
+   protected:
+    virtual void audioOutput(int16_t outputSignal_);
+    virtual void audioOutput(int16_t left, int16_t right) = 0;
+  };
+
 }       // namespace Plus4Emu
 
 #endif  // PLUS4EMU_SND_CONV_HPP
@@ -152,6 +152,19 @@ namespace Plus4Emu {
     }
   }
 
+  void AudioOutput::sendStereoAudioData(const int16_t *buf, size_t nFrames)
+  {
+    int16_t tmpBuf[16];
+    while (nFrames > 0) {
+      size_t  n = (nFrames < 16 ? nFrames : 16);
+      for (size_t i = 0; i < n; i++)
+        tmpBuf[i] = int16_t((int32_t(buf[i << 1]) + buf[(i << 1) + 1]) >> 1);
+      sendAudioData(&(tmpBuf[0]), n);
+      buf = buf + (n << 1);
+      nFrames = nFrames - n;
+    }
+  }
+
   void AudioOutput::closeDevice()
   {
     // NOTE: AudioOutput::closeDevice() should be called by derived classes
@@ -62,6 +62,12 @@ namespace Plus4Emu {
      * to the audio output device and file.
      */
     virtual void sendAudioData(const int16_t *buf, size_t nFrames);
+    /*!
+     * Write 'nFrames' stereo frames (interleaved left and right samples in
+     * 16 bit signed PCM format) from 'buf'. The default implementation
+     * mixes the frames to mono and calls sendAudioData().
+     */
+    virtual void sendStereoAudioData(const int16_t *buf, size_t nFrames);
     /*!
      * Close the audio device.
      */
@@ -392,6 +392,13 @@ namespace Plus4 {
     }
   }
 
+  void VC1541::setFileAccessFunc(Plus4Emu::FileAccessFunc func,
+                                 void *userData)
+  {
+    fileAccessFunc = func;
+    fileAccessUserData = (func ? userData : (void *) 0);
+  }
+
   void VC1541::setDiskImageFile(std::FILE *imageFile_, bool isReadOnly)
   {
     headLoadedFlag = false;
@@ -240,6 +240,12 @@ namespace Plus4 {
     }
   }
 
+  void VC1581::setFileAccessFunc(Plus4Emu::FileAccessFunc func,
+                                 void *userData)
+  {
+    wd177x.setFileAccessFunc(func, userData);
+  }
+
   void VC1581::setDiskImageFile(std::FILE *imageFile_, bool isReadOnly)
   {
     try {
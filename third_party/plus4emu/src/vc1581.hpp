@@ -106,6 +106,11 @@ namespace Plus4 {
      * Use disk image file 'imageFile_' (imageFile_ == NULL means no disk).
      */
     virtual void setDiskImageFile(std::FILE *imageFile_, bool isReadOnly);
+    /*!
+     * Access the disk image file through 'func' (see FloppyDrive).
+     */
+    virtual void setFileAccessFunc(Plus4Emu::FileAccessFunc func,
+                                   void *userData);
     /*!
      * Returns true if there is a disk image file opened.
      */
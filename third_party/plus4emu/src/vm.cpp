@@ -85,6 +85,38 @@ namespace Plus4Emu {
     }
   };
 
+  class AudioConverterStereo_ : public AudioConverterStereo {
+   private:
+    AudioOutput&  audioOutput_;
+    int16_t       buf[32];
+    size_t        bufPos;
+   public:
+    AudioConverterStereo_(AudioOutput& audioOutput__,
+                          float inputSampleRate_,
+                          float outputSampleRate_,
+                          float dcBlockFreq1, float dcBlockFreq2,
+                          float ampScale_)
+      : AudioConverterStereo(inputSampleRate_, outputSampleRate_,
+                             dcBlockFreq1, dcBlockFreq2, ampScale_),
+        audioOutput_(audioOutput__),
+        bufPos(0)
+    {
+    }
+    virtual ~AudioConverterStereo_()
+    {
+    }
+    virtual void audioOutput(int16_t left, int16_t right)
+    {
+      // 16 frames, the same as AudioConverter_
+      buf[bufPos++] = left;
+      buf[bufPos++] = right;
+      if (bufPos >= 32) {
+        bufPos = 0;
+        audioOutput_.sendStereoAudioData(&(buf[0]), 16);
+      }
+    }
+  };
+
   const char * VirtualMachine::defaultRAMPatternString = "01F70000E000";
 
   VirtualMachine::VirtualMachine(VideoDisplay& display_,
@@ -95,6 +127,7 @@ namespace Plus4Emu {
       writingAudioOutput(false),
       audioOutputEnabled(true),
       audioOutputHighQuality(false),
+      audioOutputStereo(false),
       displayEnabled(true),
       audioConverterSampleRate(0.0f),
       audioOutputSampleRate(0.0f),
@@ -127,6 +160,8 @@ namespace Plus4Emu {
       fileNameCallback(&defaultFileNameCallback),
       fileNameCallbackUserData((void *) 0)
   {
+    for (int i = 0; i < 3; i++)
+      audioOutputPan[i] = 0;
   }
 
   VirtualMachine::~VirtualMachine()
@@ -149,22 +184,7 @@ namespace Plus4Emu {
         // open audio converter if needed
         audioOutputSampleRate = audioOutput.getSampleRate();
         if (audioConverterSampleRate > 0.0f && audioOutputSampleRate > 0.0f) {
-          if (audioOutputHighQuality)
-            audioConverter = new AudioConverter_<AudioConverterHighQuality>(
-                audioOutput,
-                audioConverterSampleRate, audioOutputSampleRate,
-                audioOutputFilter1Freq, audioOutputFilter2Freq,
-                audioOutputVolume);
-          else
-            audioConverter = new AudioConverter_<AudioConverterLowQuality>(
-                audioOutput,
-                audioConverterSampleRate, audioOutputSampleRate,
-                audioOutputFilter1Freq, audioOutputFilter2Freq,
-                audioOutputVolume);
-          audioConverter->setEqualizerParameters(audioOutputEQMode,
-                                                 audioOutputEQFrequency,
-                                                 audioOutputEQLevel,
-                                                 audioOutputEQ_Q);
+          createAudioConverter();
         }
       }
     }
@@ -202,6 +222,25 @@ namespace Plus4Emu {
   {
     if (useHighQualityResample != audioOutputHighQuality) {
       audioOutputHighQuality = useHighQualityResample;
+      // both resampling methods are allocated with the converter,
+      // so this only selects the other one
+      if (audioConverter) {
+        if (audioOutputStereo) {
+          static_cast<AudioConverterStereo *>(audioConverter)
+              ->setHighQuality(audioOutputHighQuality);
+        }
+        else {
+          static_cast<AudioConverterMono *>(audioConverter)
+              ->setHighQuality(audioOutputHighQuality);
+        }
+      }
+    }
+  }
+
+  void VirtualMachine::setAudioOutputStereo(bool isStereo)
+  {
+    if (isStereo != audioOutputStereo) {
+      audioOutputStereo = isStereo;
       if (audioConverter) {
         delete audioConverter;
         audioConverter = (AudioConverter *) 0;
@@ -209,28 +248,52 @@ namespace Plus4Emu {
       audioOutputSampleRate = audioOutput.getSampleRate();
       if (audioOutputEnabled &&
           audioConverterSampleRate > 0.0f && audioOutputSampleRate > 0.0f) {
-        if (audioOutputHighQuality)
-          audioConverter = new AudioConverter_<AudioConverterHighQuality>(
-              audioOutput,
-              audioConverterSampleRate, audioOutputSampleRate,
-              audioOutputFilter1Freq, audioOutputFilter2Freq,
-              audioOutputVolume);
-        else
-          audioConverter = new AudioConverter_<AudioConverterLowQuality>(
-              audioOutput,
-              audioConverterSampleRate, audioOutputSampleRate,
-              audioOutputFilter1Freq, audioOutputFilter2Freq,
-              audioOutputVolume);
-        audioConverter->setEqualizerParameters(audioOutputEQMode,
-                                               audioOutputEQFrequency,
-                                               audioOutputEQLevel,
-                                               audioOutputEQ_Q);
+        createAudioConverter();
       }
       writingAudioOutput =
           (audioConverter != (AudioConverter *) 0 && audioOutputEnabled);
     }
   }
 
+  void VirtualMachine::setAudioOutputPan(int n, int pan)
+  {
+    if (n < 0 || n > 2)
+      return;
+    audioOutputPan[n] = (pan > -100 ? (pan < 100 ? pan : 100) : -100);
+    if (audioConverter && audioOutputStereo) {
+      static_cast<AudioConverterStereo *>(audioConverter)
+          ->setPan(n, audioOutputPan[n]);
+    }
+  }
+
+  void VirtualMachine::createAudioConverter()
+  {
+    if (audioOutputStereo) {
+      AudioConverterStereo  *p = new AudioConverterStereo_(
+          audioOutput,
+          audioConverterSampleRate, audioOutputSampleRate,
+          audioOutputFilter1Freq, audioOutputFilter2Freq,
+          audioOutputVolume);
+      p->setHighQuality(audioOutputHighQuality);
+      for (int i = 0; i < 3; i++)
+        p->setPan(i, audioOutputPan[i]);
+      audioConverter = p;
+    }
+    else {
+      AudioConverterMono    *p = new AudioConverter_<AudioConverterMono>(
+          audioOutput,
+          audioConverterSampleRate, audioOutputSampleRate,
+          audioOutputFilter1Freq, audioOutputFilter2Freq,
+          audioOutputVolume);
+      p->setHighQuality(audioOutputHighQuality);
+      audioConverter = p;
+    }
+    audioConverter->setEqualizerParameters(audioOutputEQMode,
+                                           audioOutputEQFrequency,
+                                           audioOutputEQLevel,
+                                           audioOutputEQ_Q);
+  }
+
   void VirtualMachine::setAudioOutputFilters(float dcBlockFreq1_,
                                              float dcBlockFreq2_)
   {
@@ -884,22 +947,7 @@ namespace Plus4Emu {
       audioOutputSampleRate = audioOutput.getSampleRate();
       if (audioOutputEnabled &&
           audioConverterSampleRate > 0.0f && audioOutputSampleRate > 0.0f) {
-        if (audioOutputHighQuality)
-          audioConverter = new AudioConverter_<AudioConverterHighQuality>(
-              audioOutput,
-              audioConverterSampleRate, audioOutputSampleRate,
-              audioOutputFilter1Freq, audioOutputFilter2Freq,
-              audioOutputVolume);
-        else
-          audioConverter = new AudioConverter_<AudioConverterLowQuality>(
-              audioOutput,
-              audioConverterSampleRate, audioOutputSampleRate,
-              audioOutputFilter1Freq, audioOutputFilter2Freq,
-              audioOutputVolume);
-        audioConverter->setEqualizerParameters(audioOutputEQMode,
-                                               audioOutputEQFrequency,
-                                               audioOutputEQLevel,
-                                               audioOutputEQ_Q);
+        createAudioConverter();
       }
       writingAudioOutput =
           (audioConverter != (AudioConverter *) 0 && audioOutputEnabled);
@@ -39,6 +39,8 @@ namespace Plus4Emu {
     bool            writingAudioOutput;
     bool            audioOutputEnabled;
     bool            audioOutputHighQuality;
+    bool            audioOutputStereo;
+    int             audioOutputPan[3];
     bool            displayEnabled;
     float           audioConverterSampleRate;
     float           audioOutputSampleRate;
@@ -165,9 +167,20 @@ namespace Plus4Emu {
      */
     virtual void loadROMSegment(uint8_t n, const char *fileName, size_t offs);
     /*!
-     * Set audio output quality.
+     * Set audio output quality. Both resampling methods are allocated
+     * with the audio converter, so this does not allocate memory.
      */
     virtual void setAudioOutputHighQuality(bool useHighQualityResample);
+    /*!
+     * Set if the audio output is stereo (interleaved left and right samples
+     * are sent to AudioOutput::sendStereoAudioData()).
+     */
+    virtual void setAudioOutputStereo(bool isStereo);
+    /*!
+     * Set the position of stereo input channel 'n' from -100 (left) to 100
+     * (right); see sendStereoAudioOutput().
+     */
+    virtual void setAudioOutputPan(int n, int pan);
     /*!
      * Set cutoff frequencies of highpass filters used on audio output to
      * remove DC offset.
@@ -693,6 +706,26 @@ namespace Plus4Emu {
       if (this->writingAudioOutput)
         this->audioConverter->sendInputSignal(audioData);
     }
+    // send three input channels that are panned separately in stereo mode,
+    // or mixed to mono otherwise
+    inline void sendStereoAudioOutput(int32_t audioData0, int32_t audioData1,
+                                      int32_t audioData2)
+    {
+      if (this->writingAudioOutput) {
+        if (this->audioOutputStereo) {
+          static_cast<AudioConverterStereo *>(this->audioConverter)
+              ->sendInputSignal(audioData0, audioData1, audioData2);
+        }
+        else {
+          this->audioConverter->sendInputSignal(audioData0 + audioData1
+                                                + audioData2);
+        }
+      }
+    }
+    inline bool getIsAudioOutputStereo() const
+    {
+      return this->audioOutputStereo;
+    }
     /*!
      * This function is similar to the public setTapeFileName(), but allows
      * derived classes to use a different sample size than the default of
@@ -701,6 +734,8 @@ namespace Plus4Emu {
     void setTapeFileName(const std::string& fileName, int bitsPerSample);
    private:
     void setTapeMotorState_(bool newState);
+    // create audioConverter from the current audio settings
+    void createAudioConverter();
    protected:
     inline void setTapeMotorState(bool newState)
     {
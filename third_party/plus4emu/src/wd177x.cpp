@@ -46,7 +46,9 @@ namespace Plus4Emu {
       steppingIn(false),
       busyFlagHackEnabled(false),
       busyFlagHack(false),
-      bufPos(512)
+      bufPos(512),
+      fileAccessFunc((FileAccessFunc) 0),
+      fileAccessUserData((void *) 0)
   {
     buf.resize(512);
     this->reset();
@@ -79,6 +81,51 @@ namespace Plus4Emu {
     return true;
   }
 
+  // sector access operations
+  enum {
+    WD177X_READ_SECTOR = 0,
+    WD177X_WRITE_SECTOR = 1,            // seek and write
+    WD177X_WRITE_BUFFER = 2             // write at the current position
+  };
+
+  struct WD177xSectorAccessArgs {
+    WD177x    *wd177x;
+    int       op;
+    int       retval;
+  };
+
+  void WD177x::sectorAccessCallback(void *userData)
+  {
+    WD177xSectorAccessArgs& args =
+        *(reinterpret_cast<WD177xSectorAccessArgs *>(userData));
+    args.retval = args.wd177x->doSectorAccess(args.op);
+  }
+
+  // returns 0 on success, 1 if the sector is not found, and 2 on I/O error
+  int WD177x::accessSector(int op)
+  {
+    if (fileAccessFunc) {
+      WD177xSectorAccessArgs  args;
+      args.wd177x = this;
+      args.op = op;
+      args.retval = 2;
+      fileAccessFunc(&sectorAccessCallback, &args, fileAccessUserData);
+      return args.retval;
+    }
+    return doSectorAccess(op);
+  }
+
+  int WD177x::doSectorAccess(int op)
+  {
+    if (op != WD177X_WRITE_BUFFER && !setFilePosition())
+      return 1;
+    if (op == WD177X_READ_SECTOR)
+      return (std::fread(&(buf[0]), 1, 512, imageFile) == 512 ? 0 : 2);
+    size_t  bytesWritten = std::fwrite(&(buf[0]), 1, 512, imageFile);
+    std::fflush(imageFile);
+    return (bytesWritten == 512 ? 0 : 2);
+  }
+
   void WD177x::doStep(bool updateFlag)
   {
     if (steppingIn) {
@@ -300,9 +347,10 @@ namespace Plus4Emu {
       }
       bufPos = 512;
       if ((n & 0x20) == 0) {            // READ SECTOR
-        if (!setFilePosition())
+        int     err = accessSector(WD177X_READ_SECTOR);
+        if (err == 1)
           statusRegister = statusRegister | 0x10;   // record not found
-        else if (std::fread(&(buf[0]), 1, 512, imageFile) != 512)
+        else if (err != 0)
           statusRegister = statusRegister | 0x08;   // CRC error
         else {
           dataRequestFlag = true;
@@ -401,10 +449,8 @@ namespace Plus4Emu {
         if (bufPos > 0) {
           for ( ; bufPos < 512; bufPos++)
             buf[bufPos] = 0;
-          if (imageFile != (std::FILE *) 0 && !writeProtectFlag) {
-            std::fwrite(&(buf[0]), 1, 512, imageFile);
-            std::fflush(imageFile);
-          }
+          if (imageFile != (std::FILE *) 0 && !writeProtectFlag)
+            (void) accessSector(WD177X_WRITE_BUFFER);
         }
       }
       // FIXME: only immediate interrupt is implemented
@@ -471,20 +517,17 @@ namespace Plus4Emu {
         // clear data request and busy flag
         dataRequestFlag = false;
         statusRegister = statusRegister & 0xFC;
-        if (setFilePosition()) {
-          size_t  bytesWritten = std::fwrite(&(buf[0]), 1, 512, imageFile);
-          std::fflush(imageFile);
-          if (bytesWritten == 512) {
-            if (commandRegister & 0x10) {
-              // multiple sectors: continue with writing next sector
-              sectorRegister++;
-              writeCommandRegister(commandRegister);
-              return;
-            }
+        int     err = accessSector(WD177X_WRITE_SECTOR);
+        if (err == 0) {
+          if (commandRegister & 0x10) {
+            // multiple sectors: continue with writing next sector
+            sectorRegister++;
+            writeCommandRegister(commandRegister);
+            return;
           }
-          else
-            statusRegister = statusRegister | 0x20; // write error
         }
+        else if (err == 2)
+          statusRegister = statusRegister | 0x20;   // write error
         else
           statusRegister = statusRegister | 0x10;   // record not found
         commandRegister = 0x00;
@@ -578,6 +621,12 @@ namespace Plus4Emu {
     busyFlagHackEnabled = isEnabled;
   }
 
+  void WD177x::setFileAccessFunc(FileAccessFunc func, void *userData)
+  {
+    fileAccessFunc = func;
+    fileAccessUserData = (func ? userData : (void *) 0);
+  }
+
   uint16_t WD177x::calculateCRC(const uint8_t *buf_, size_t nBytes, uint16_t n)
   {
     size_t  nBits = nBytes << 3;
@@ -49,7 +49,13 @@ namespace Plus4Emu {
     bool        busyFlagHack;
     std::vector< uint8_t >  buf;
     size_t      bufPos;
+    // if not NULL, the image file is accessed through this function
+    FileAccessFunc  fileAccessFunc;
+    void        *fileAccessUserData;
     bool setFilePosition();
+    int accessSector(int op);
+    int doSectorAccess(int op);
+    static void sectorAccessCallback(void *userData);
     void doStep(bool updateFlag);
     static uint16_t calculateCRC(const uint8_t *buf_, size_t nBytes,
                                  uint16_t n = 0xFFFF);
@@ -82,6 +88,11 @@ namespace Plus4Emu {
     virtual bool haveDisk() const;
     virtual bool getIsWriteProtected() const;
     void setEnableBusyFlagHack(bool isEnabled);
+    /*!
+     * Access the image file by calling 'func' with 'userData' (see
+     * FileAccessFunc), or directly if 'func' is NULL.
+     */
+    void setFileAccessFunc(FileAccessFunc func, void *userData);
     virtual void reset();
     inline uint16_t getHeadPosition() const
     {
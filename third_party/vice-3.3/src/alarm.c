@@ -98,7 +98,27 @@ void alarm_context_time_warp(alarm_context_t *context, CLOCK warp_amount,
     } else {
         context->next_pending_alarm_clk -= warp_amount;
     }
+
+#if ALARM_USE_HEAP
+    /* Clocks that wrapped around may have changed the order.  */
+    alarm_context_rebuild_heap(context);
+#endif
+}
+
+#if ALARM_USE_HEAP
+void alarm_context_rebuild_heap(alarm_context_t *context)
+{
+    int n = (int)context->num_pending_alarms;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        alarm_heap_place(context, i, i);
+    }
+    for (i = n / 2 - 1; i >= 0; i--) {
+        alarm_heap_down(context, i);
+    }
 }
+#endif
 
 /* ------------------------------------------------------------------------ */
 
@@ -178,9 +198,21 @@ void alarm_unset(alarm_t *alarm)
 
     if (context->num_pending_alarms > 1) {
         int last;
+#if ALARM_USE_HEAP
+        int pos = context->heap_pos[idx];
+#endif
 
         last = --context->num_pending_alarms;
 
+#if ALARM_USE_HEAP
+        /* Drop `idx' from the heap by moving the last heap entry into
+           its slot.  */
+        if (pos != last) {
+            alarm_heap_place(context, pos, context->heap[last]);
+            alarm_heap_fix(context, context->heap[pos]);
+        }
+#endif
+
         if (last != idx) {
             /* Let's copy the struct by hand to make sure stupid compilers
                don't do stupid things.  */
@@ -190,6 +222,12 @@ void alarm_unset(alarm_t *alarm)
                 = context->pending_alarms[last].clk;
 
             context->pending_alarms[idx].alarm->pending_idx = idx;
+
+#if ALARM_USE_HEAP
+            /* The entry at `last' now lives at `idx'.  */
+            alarm_heap_place(context, context->heap_pos[last], idx);
+            alarm_heap_fix(context, idx);
+#endif
         }
 
         if (context->next_pending_alarm_idx == idx) {
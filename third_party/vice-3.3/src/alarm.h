@@ -32,6 +32,16 @@
 
 #define ALARM_CONTEXT_MAX_PENDING_ALARMS 0x100
 
+/* If non-zero, pending alarms are also kept in an indexed binary heap so
+   finding the next one doesn't need a scan over all of them.  Dispatch
+   order is the same either way.  The heap only pays off once a context
+   has more than about 20 alarms pending at a time, so it is off unless
+   requested with -DALARM_USE_HEAP=1.  tools/tests/alarm_test checks
+   that both give the same dispatch order.  */
+#ifndef ALARM_USE_HEAP
+#define ALARM_USE_HEAP 0
+#endif
+
 typedef void (*alarm_callback_t)(CLOCK offset, void *data);
 
 /* An alarm.  */
@@ -79,6 +89,13 @@ struct alarm_context_s {
     pending_alarms_t pending_alarms[ALARM_CONTEXT_MAX_PENDING_ALARMS];
     unsigned int num_pending_alarms;
 
+#if ALARM_USE_HEAP
+    /* Indices into `pending_alarms', heap ordered.  `heap_pos' maps an
+       index back to its position in the heap.  */
+    int heap[ALARM_CONTEXT_MAX_PENDING_ALARMS];
+    int heap_pos[ALARM_CONTEXT_MAX_PENDING_ALARMS];
+#endif
+
     /* Clock tick for the next pending alarm.  */
     CLOCK next_pending_alarm_clk;
 
@@ -99,6 +116,9 @@ extern alarm_t *alarm_new(alarm_context_t *context, const char *name,
 extern void alarm_destroy(alarm_t *alarm);
 extern void alarm_unset(alarm_t *alarm);
 extern void alarm_log_too_many_alarms(void);
+#if ALARM_USE_HEAP
+extern void alarm_context_rebuild_heap(alarm_context_t *context);
+#endif
 
 /* ------------------------------------------------------------------------- */
 
@@ -109,6 +129,89 @@ inline static CLOCK alarm_context_next_pending_clk(alarm_context_t *context)
     return context->next_pending_alarm_clk;
 }
 
+#if ALARM_USE_HEAP
+
+/* Heap order matches what the linear scan picks: the earliest clock
+   first and, for equal clocks, the higher index into `pending_alarms'.  */
+inline static int alarm_heap_before(alarm_context_t *context, int a, int b)
+{
+    CLOCK clk_a = context->pending_alarms[a].clk;
+    CLOCK clk_b = context->pending_alarms[b].clk;
+
+    return clk_a < clk_b || (clk_a == clk_b && a > b);
+}
+
+inline static void alarm_heap_place(alarm_context_t *context, int pos,
+                                    int idx)
+{
+    context->heap[pos] = idx;
+    context->heap_pos[idx] = pos;
+}
+
+inline static void alarm_heap_up(alarm_context_t *context, int pos)
+{
+    int idx = context->heap[pos];
+
+    while (pos > 0) {
+        int parent = (pos - 1) >> 1;
+
+        if (!alarm_heap_before(context, idx, context->heap[parent])) {
+            break;
+        }
+        alarm_heap_place(context, pos, context->heap[parent]);
+        pos = parent;
+    }
+    alarm_heap_place(context, pos, idx);
+}
+
+inline static void alarm_heap_down(alarm_context_t *context, int pos)
+{
+    int n = (int)context->num_pending_alarms;
+    int idx = context->heap[pos];
+
+    for (;;) {
+        int child = 2 * pos + 1;
+
+        if (child >= n) {
+            break;
+        }
+        if (child + 1 < n
+            && alarm_heap_before(context, context->heap[child + 1],
+                                 context->heap[child])) {
+            child++;
+        }
+        if (!alarm_heap_before(context, context->heap[child], idx)) {
+            break;
+        }
+        alarm_heap_place(context, pos, context->heap[child]);
+        pos = child;
+    }
+    alarm_heap_place(context, pos, idx);
+}
+
+/* Restore heap order after the key of `idx' changed.  */
+inline static void alarm_heap_fix(alarm_context_t *context, int idx)
+{
+    int pos = context->heap_pos[idx];
+
+    alarm_heap_up(context, pos);
+    alarm_heap_down(context, context->heap_pos[idx]);
+}
+
+inline static void alarm_context_update_next_pending(alarm_context_t *context)
+{
+    if (context->num_pending_alarms > 0) {
+        int idx = context->heap[0];
+
+        context->next_pending_alarm_clk = context->pending_alarms[idx].clk;
+        context->next_pending_alarm_idx = idx;
+    } else {
+        context->next_pending_alarm_clk = (CLOCK)~0L;
+    }
+}
+
+#else
+
 inline static void alarm_context_update_next_pending(alarm_context_t *context)
 {
     CLOCK next_pending_alarm_clk = (CLOCK)~0L;
@@ -130,6 +233,8 @@ inline static void alarm_context_update_next_pending(alarm_context_t *context)
     context->next_pending_alarm_idx = next_pending_alarm_idx;
 }
 
+#endif
+
 inline static void alarm_context_dispatch(alarm_context_t *context,
                                           CLOCK cpu_clk)
 {
@@ -169,6 +274,12 @@ inline static void alarm_set(alarm_t *alarm, CLOCK cpu_clk)
 
         context->num_pending_alarms++;
 
+#if ALARM_USE_HEAP
+        context->heap_pos[new_idx] = new_idx;
+        context->heap[new_idx] = new_idx;
+        alarm_heap_up(context, new_idx);
+#endif
+
         if (cpu_clk < context->next_pending_alarm_clk) {
             context->next_pending_alarm_clk = cpu_clk;
             context->next_pending_alarm_idx = new_idx;
@@ -179,6 +290,9 @@ inline static void alarm_set(alarm_t *alarm, CLOCK cpu_clk)
         /* Already pending: modify.  */
 
         context->pending_alarms[idx].clk = cpu_clk;
+#if ALARM_USE_HEAP
+        alarm_heap_fix(context, idx);
+#endif
         if (context->next_pending_alarm_clk > cpu_clk
             || idx == context->next_pending_alarm_idx) {
             alarm_context_update_next_pending(context);
@@ -57,6 +57,8 @@
 #include "sid-resources.h"
 #include "userport/userport_joystick.h"
 #include "cbmimage.h"
+#include "fliplist.h"
+#include "lib.h"
 
 // RASPI includes
 #include "circle.h"
@@ -190,8 +192,57 @@ void emux_kbd_set_latch_keyarr(int row, int col, int value) {
   keyboard_set_keyarr(row, col, value);
 }
 
+// Queues the other images of a multi disk set for prefetching so
+// flipping to them later doesn't wait for the card. These are the
+// fliplist neighbours and the files named like this one with the last
+// number one up or down (game_disk1.d64, game_disk2.d64).
+static void prefetch_disk_neighbours(int unit, const char *filename) {
+  const char *next = fliplist_get_next(unit);
+  const char *prev = fliplist_get_prev(unit);
+  if (next) {
+    circle_prefetch_file(next);
+  }
+  if (prev && prev != next) {
+    circle_prefetch_file(prev);
+  }
+
+  const char *base = strrchr(filename, '/');
+  base = base ? base + 1 : filename;
+  const char *end = strrchr(base, '.');
+  if (end == NULL) {
+    end = base + strlen(base);
+  }
+  while (end > base && !isdigit((unsigned char)end[-1])) {
+    end--;
+  }
+  const char *digits = end;
+  while (digits > base && isdigit((unsigned char)digits[-1])) {
+    digits--;
+  }
+  int width = end - digits;
+  if (width == 0 || width > 4) {
+    return;
+  }
+
+  int num = atoi(digits);
+  char name[256];
+  int delta;
+  for (delta = 1; delta >= -1; delta -= 2) {
+    if (num + delta < 0) {
+      continue;
+    }
+    snprintf(name, sizeof(name), "%.*s%0*d%s", (int)(digits - filename),
+             filename, width, num + delta, end);
+    circle_prefetch_file(name);
+  }
+}
+
 int emux_attach_disk_image(int unit, char* filename) {
-  return file_system_attach_disk(unit, filename);
+  int result = file_system_attach_disk(unit, filename);
+  if (result >= 0) {
+    prefetch_disk_neighbours(unit, filename);
+  }
+  return result;
 }
 
 void emux_detach_disk(int unit) {
@@ -371,6 +422,12 @@ void emux_add_drive_option(struct menu_item* root, int drive) {
      ui_menu_add_toggle(MENU_DRIVE_TRUE_EMULATION, root, "True Emulation", tmp);
      resources_get_int("VirtualDevices", &tmp);
      ui_menu_add_toggle(MENU_VIRTUAL_DEVICES, root, "Virtual Devices", tmp);
+     if (emux_machine_class == BMC64_MACHINE_CLASS_C64) {
+        // Needs virtual devices for the kernal trap.
+        resources_get_int("TrueDriveFastLoad", &tmp);
+        ui_menu_add_toggle(MENU_TRUE_DRIVE_FAST_LOAD, root,
+                           "Fast Load (True Emulation)", tmp);
+     }
      return;
   }
 
@@ -680,6 +737,17 @@ static int viceSidResamplingToBmcChoice(int method) {
 }
 
 void emux_add_tape_options(struct menu_item* parent) {
+  int tmp;
+
+  // The plus4 tape traps don't know about tap images.
+  if (emux_machine_class == BMC64_MACHINE_CLASS_PLUS4) {
+    return;
+  }
+
+  // Needs virtual devices for the kernal traps.
+  resources_get_int("DatasetteFastLoad", &tmp);
+  ui_menu_add_toggle(MENU_TAPE_FAST_LOAD, parent,
+                     "Fast Load Standard Blocks", tmp);
 }
 
 void emux_add_keyboard_options(struct menu_item* parent) {
@@ -834,6 +902,20 @@ void emux_add_sound_options(struct menu_item* parent) {
   }
 }
 
+static struct menu_item* diag_parent;
+
+static void add_diag_line(const char *line) {
+  ui_menu_add_button(MENU_TEXT, diag_parent, line);
+}
+
+void emux_add_diagnostics(struct menu_item* parent) {
+  ui_menu_add_divider(parent);
+  ui_menu_add_button(MENU_TEXT, parent, "Allocator");
+  ui_menu_add_divider(parent);
+  diag_parent = parent;
+  lib_alloc_stats_dump(add_diag_line);
+}
+
 void emux_set_warp(int warp) {
   resources_set_int("WarpMode", warp);
 }
@@ -1084,6 +1166,12 @@ int emux_handle_menu_change(struct menu_item* item) {
     case MENU_VIRTUAL_DEVICES:
       resources_set_int("VirtualDevices", item->value);
       return 1;
+    case MENU_TRUE_DRIVE_FAST_LOAD:
+      resources_set_int("TrueDriveFastLoad", item->value);
+      return 1;
+    case MENU_TAPE_FAST_LOAD:
+      resources_set_int("DatasetteFastLoad", item->value);
+      return 1;
     default:
       break;
   }
@@ -32,21 +32,30 @@
 #include <string.h>
 #include <strings.h>
 #include <sys/time.h>
+#include <unistd.h>
 
 // VICE includes
+#include "archdep.h"
+#include "autostart.h"
+#include "cartridge.h"
+#include "datasette.h"
+#include "interrupt.h"
 #include "joyport/joystick.h"
 #include "kbdbuf.h"
 #include "keyboard.h"
+#include "lib.h"
 #include "machine.h"
 #include "mem.h"
 #include "monitor.h"
 #include "resources.h"
 #include "sid.h"
+#include "sysfile.h"
 #include "video.h"
 #include "viewport.h"
 
 // RASPI includes
 #include "emux_api.h"
+#include "autowarp.h"
 #include "demo.h"
 #include "joy.h"
 #include "kbd.h"
@@ -55,6 +64,7 @@
 #include "menu_tape_osd.h"
 #include "overlay.h"
 #include "raspi_machine.h"
+#include "settings_store.h"
 #include "ui.h"
 
 struct video_canvas_s *vdc_canvas;
@@ -85,6 +95,24 @@ unsigned long video_frame_count;
 
 static int raspi_boot_warp = 1;
 
+// Instant boot. A clean boot (no cart, nothing autostarting, no input
+// during the boot warp) is saved as a snapshot when the boot warp ends.
+// Later boots restore it on the first frame instead of running the
+// reset. The snapshot is only used with the key it was saved with, which
+// covers the ROMs and the config files.
+#define INSTANT_BOOT_OFF 0
+#define INSTANT_BOOT_RECORD 1
+#define INSTANT_BOOT_RESTORED 2
+
+static int instant_boot_state = INSTANT_BOOT_OFF;
+static int instant_boot_tried;
+static int instant_boot_clean;
+static uint32_t instant_boot_key;
+
+// Most bytes of prefetched disk images read per frame, around a
+// millisecond of card time.
+#define PREFETCH_BYTES_PER_FRAME (16 * 1024)
+
 // Should be set only when raster_skip=true is present
 // in the kernel args.
 int raster_lines;
@@ -349,6 +377,138 @@ void vsyncarch_init(void) {
 
 void vsyncarch_presync(void) { kbdbuf_flush(); }
 
+static uint32_t instant_boot_hash(uint32_t hash, const uint8_t *buf,
+                                  size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    hash ^= buf[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+static uint32_t instant_boot_hash_file(uint32_t hash, const char *path) {
+  uint8_t buf[512];
+  size_t n;
+  FILE *fp = fopen(path, "r");
+  if (fp == NULL) {
+    return instant_boot_hash(hash, (const uint8_t *)"", 1);
+  }
+  while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+    hash = instant_boot_hash(hash, buf, n);
+  }
+  fclose(fp);
+  return hash;
+}
+
+static void instant_boot_path(char *dst, size_t len, const char *ext) {
+  snprintf(dst, len, "/%s/instantboot.%s", machine_name, ext);
+}
+
+static int instant_boot_cart_attached(void) {
+  int type;
+  if (resources_get_int("CartridgeType", &type) == 0 &&
+      type != CARTRIDGE_NONE) {
+    return 1;
+  }
+
+  static const char *plus4_carts[] = {
+    "c1loName", "c1hiName", "c2loName", "c2hiName",
+  };
+  for (int i = 0; i < 4; i++) {
+    const char *name;
+    if (resources_get_string(plus4_carts[i], &name) == 0 &&
+        name != NULL && name[0] != '\0') {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static void instant_boot_load_trap(uint16_t addr, void *data) {
+  char vsf[32];
+  instant_boot_path(vsf, sizeof(vsf), "vsf");
+  if (emux_load_state(vsf) == 0) {
+    instant_boot_state = INSTANT_BOOT_RESTORED;
+    return;
+  }
+
+  // Whatever was restored is half baked. Start over and save a good
+  // snapshot at the end of this boot.
+  char key[32];
+  instant_boot_path(key, sizeof(key), "txt");
+  unlink(key);
+  machine_trigger_reset(MACHINE_RESET_MODE_HARD);
+  video_frame_count = 1;
+}
+
+static void instant_boot_save_trap(uint16_t addr, void *data) {
+  char vsf[32];
+  char key[32];
+  instant_boot_path(vsf, sizeof(vsf), "vsf");
+  instant_boot_path(key, sizeof(key), "txt");
+
+  // The key goes last so a snapshot that was not completely written is
+  // never used.
+  unlink(key);
+  if (machine_write_snapshot(vsf, 0, 0, 0) < 0) {
+    unlink(vsf);
+    return;
+  }
+  FILE *fp = fopen(key, "w");
+  if (fp != NULL) {
+    fprintf(fp, "%08x\n", (unsigned int)instant_boot_key);
+    fclose(fp);
+  }
+}
+
+// Called on the first frame of the boot warp.
+static void instant_boot_begin(void) {
+  instant_boot_tried = 1;
+  if (!circle_instant_boot_enabled() || raspi_demo_mode ||
+      machine_class == VICE_MACHINE_PET ||
+      instant_boot_cart_attached() || autostart_in_progress()) {
+    return;
+  }
+
+  int video_standard = 0;
+  resources_get_int("MachineVideoStandard", &video_standard);
+
+  uint32_t hash = sysfile_loaded_checksum();
+  hash = instant_boot_hash(hash, (const uint8_t *)&video_standard,
+                           sizeof(video_standard));
+  char *resource_file = archdep_default_resource_file_name();
+  hash = instant_boot_hash_file(hash, resource_file);
+  lib_free(resource_file);
+  hash = instant_boot_hash_file(hash, settings_store_path());
+
+  instant_boot_key = hash;
+  instant_boot_clean = 1;
+  instant_boot_state = INSTANT_BOOT_RECORD;
+
+  char key[32];
+  unsigned int saved_key;
+  instant_boot_path(key, sizeof(key), "txt");
+  FILE *fp = fopen(key, "r");
+  if (fp == NULL) {
+    return;
+  }
+  int found = fscanf(fp, "%08x", &saved_key) == 1 && saved_key == hash;
+  fclose(fp);
+
+  if (found) {
+    interrupt_maincpu_trigger_trap(instant_boot_load_trap, 0);
+  }
+}
+
+// Called when the boot warp ends.
+static void instant_boot_end(void) {
+  if (instant_boot_state == INSTANT_BOOT_RECORD && instant_boot_clean &&
+      !instant_boot_cart_attached() && !autostart_in_progress()) {
+    interrupt_maincpu_trigger_trap(instant_boot_save_trap, 0);
+  }
+  instant_boot_state = INSTANT_BOOT_OFF;
+}
+
 void vsyncarch_postsync(void) {
   emux_ensure_video();
 
@@ -356,8 +516,11 @@ void vsyncarch_postsync(void) {
   if (ui_enabled) {
     // The only way we can be here and have ui_enabled=1
     // is for an osd to be enabled.
-    ui_render_now(-1); // only render top most menu
-    circle_frames_ready_fbl(FB_LAYER_UI, -1 /* no 2nd layer */, 0 /* no sync */);
+    // only render top most menu, and only send it when something changed
+    if (ui_render_now(-1)) {
+      circle_frames_ready_fbl(FB_LAYER_UI, -1 /* no 2nd layer */,
+                              0 /* no sync */);
+    }
     ui_check_key();
   }
 
@@ -377,8 +540,13 @@ void vsyncarch_postsync(void) {
   circle_yield();
 
   video_frame_count++;
-  if (raspi_boot_warp && video_frame_count > 120) {
+  if (raspi_boot_warp && !instant_boot_tried) {
+    instant_boot_begin();
+  }
+  if (raspi_boot_warp && (video_frame_count > 120 ||
+                          instant_boot_state == INSTANT_BOOT_RESTORED)) {
     raspi_boot_warp = 0;
+    instant_boot_end();
     circle_boot_complete();
     resources_set_int("WarpMode", 0);
   }
@@ -392,6 +560,10 @@ void vsyncarch_postsync(void) {
 
   circle_check_gpio();
 
+  if (!raspi_boot_warp) {
+    circle_prefetch_step(PREFETCH_BYTES_PER_FRAME);
+  }
+
   int reset_demo = 0;
 
   // Do key press/releases and joy latches on the main loop.
@@ -487,12 +659,21 @@ void vsyncarch_postsync(void) {
   }
   circle_lock_release();
 
+  // Anything done while booting could end up in the snapshot.
+  if (reset_demo || ui_toggle_pending || pending_emu_quick_func) {
+    instant_boot_clean = 0;
+  }
+
   ui_handle_toggle_or_quick_func();
 
   if (reset_demo) {
     demo_reset_timeout();
+    autowarp_user_input();
   }
 
+  autowarp_tape_block(datasette_get_block_state());
+  autowarp_check();
+
   if (raspi_demo_mode) {
     demo_check();
   }
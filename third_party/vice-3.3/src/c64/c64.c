@@ -190,6 +190,7 @@ static const trap_t c64_serial_traps[] = {
     { "SerialSendByte", 0xED41, 0xEDAB, { 0x20, 0x97, 0xEE }, serial_trap_send, c64memrom_trap_read, c64memrom_trap_store },
     { "SerialReceiveByte", 0xEE14, 0xEDAB, { 0xA9, 0x00, 0x85 }, serial_trap_receive, c64memrom_trap_read, c64memrom_trap_store },
     { "SerialReady", 0xEEA9, 0xEDAB, { 0xAD, 0x00, 0xDD }, serial_trap_ready, c64memrom_trap_read, c64memrom_trap_store },
+    { "SerialLoadData", 0xF4F3, 0xF528, { 0xA9, 0xFD, 0x25 }, serial_trap_load_data, c64memrom_trap_read, c64memrom_trap_store },
     { NULL, 0, 0, { 0, 0, 0 }, NULL, NULL, NULL }
 };
 
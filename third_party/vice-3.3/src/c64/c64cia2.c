@@ -62,8 +62,19 @@ static int pa_ddr_change = 0;
 
 static uint8_t cia2_cra = 0;
 
+#ifdef RASPI_COMPILE
+#include "userport_bridge.h"
+
+extern int raspi_userport_enabled;
+#endif
+
 void cia2_store(uint16_t addr, uint8_t data)
 {
+#ifdef RASPI_COMPILE
+    int pb_ddr_change;
+    uint8_t old_pb;
+#endif
+
     if ((addr & 0xf) == CIA_CRA) {
         cia2_cra = data;
     }
@@ -74,7 +85,23 @@ void cia2_store(uint16_t addr, uint8_t data)
         pa_ddr_change = 0;
     }
 
+#ifdef RASPI_COMPILE
+    pb_ddr_change = ((addr & 0xf) == CIA_DDRB) && (machine_context.cia2->c_cia[CIA_DDRB] != data);
+    old_pb = machine_context.cia2->old_pb;
+#endif
+
     ciacore_store(machine_context.cia2, addr, data);
+
+#ifdef RASPI_COMPILE
+    /* store_ciapb only sees changes of the port value. The userport
+       bridge also needs direction changes that leave it the same. */
+    if (pb_ddr_change && raspi_userport_enabled
+        && machine_context.cia2->old_pb == old_pb) {
+        userport_bridge_write(*(machine_context.cia2->clk_ptr),
+                              machine_context.cia2->c_cia[CIA_PRB],
+                              machine_context.cia2->c_cia[CIA_DDRB]);
+    }
+#endif
 }
 
 uint8_t cia2_read(uint16_t addr)
@@ -194,6 +221,12 @@ static void undump_ciapa(cia_context_t *cia_context, CLOCK rclk, uint8_t byte)
 
 static void store_ciapb(cia_context_t *cia_context, CLOCK rclk, uint8_t byte)
 {
+#ifdef RASPI_COMPILE
+    if (raspi_userport_enabled) {
+        userport_bridge_write(rclk, cia_context->c_cia[CIA_PRB],
+                              cia_context->c_cia[CIA_DDRB]);
+    }
+#endif
     store_userport_pbx(byte);
 
     /* The functions below will gradually be removed as the functionality is added to the new userport system. */
@@ -250,15 +283,17 @@ static uint8_t read_ciapa(cia_context_t *cia_context)
     return value;
 }
 
-#ifdef RASPI_COMPILE
-extern int raspi_userport_enabled;
-#endif
-
 /* read_* functions must return 0xff if nothing to read!!! */
 static uint8_t read_ciapb(cia_context_t *cia_context)
 {
 #ifdef RASPI_COMPILE
-  uint8_t byte = raspi_userport_enabled ? cia_context->c_cia[CIA_PRB] : 0xff;
+  uint8_t byte = 0xff;
+  if (raspi_userport_enabled) {
+      byte = userport_bridge_enabled()
+          ? userport_bridge_read(cia_context->c_cia[CIA_PRB],
+                                 cia_context->c_cia[CIA_DDRB])
+          : cia_context->c_cia[CIA_PRB];
+  }
 #else
   uint8_t byte = 0xff;
 #endif
@@ -1477,7 +1477,6 @@ static void magicvoice_sound_machine_store(sound_t *psid, uint16_t addr, uint8_t
 */
 static int magicvoice_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, int soc, int scc, int *delta_t)
 {
-    int i;
     int16_t *buffer;
 
     buffer = lib_malloc(nr * sizeof(int16_t));
@@ -1485,12 +1484,7 @@ static int magicvoice_sound_machine_calculate_samples(sound_t **psid, int16_t *p
     t6721_update_output(t6721, buffer, nr);
 
     /* mix generated samples to output */
-    for (i = 0; i < nr; i++) {
-        pbuf[i * soc] = sound_audio_mix(pbuf[i * soc], buffer[i]);
-        if (soc > 1) {
-            pbuf[(i * soc) + 1] = sound_audio_mix(pbuf[(i * soc) + 1], buffer[i]);
-        }
-    }
+    sound_audio_mix_buffer(pbuf, buffer, nr, soc);
 
     lib_free(buffer);
 
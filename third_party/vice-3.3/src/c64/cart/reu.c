@@ -43,7 +43,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "alarm.h"
 #include "archdep.h"
+#include "c64mem.h"
 #include "cartio.h"
 #include "cartridge.h"
 #include "cmdline.h"
@@ -1077,6 +1079,153 @@ inline static uint8_t read_from_reu(unsigned int reu_addr)
 
 /* ------------------------------------------------------------------------- */
 
+/*! \brief minimum number of bytes worth a bulk transfer */
+#define REU_DMA_FAST_MIN 8
+
+/*! \brief find out how many bytes can be transferred in bulk
+  Between two alarms, a DMA transfer on plain RAM does nothing but
+  increment maincpu_clk and copy bytes. Such a run can be done with
+  a single copy, leaving the machine in the same state as the
+  cycle-by-cycle transfer would.
+
+  \param host_addr
+    The host (computer) address where the run starts
+
+  \param reu_addr
+    The REU address where the run starts
+
+  \param host_step
+    The increment to use for the host address; must be either 0 or 1
+
+  \param reu_step
+    The increment to use for the REU address; must be either 0 or 1
+
+  \param len
+    The remaining transfer length
+
+  \param cycles
+    Cycles needed for each byte
+
+  \param host_write
+    Non-zero if the host memory is written
+
+  \return
+    The number of bytes that can be transferred in bulk, 0 if the next
+    byte must be transferred cycle by cycle.
+
+  \remark
+    Not used if the VIC-II BA line is emulated (x64sc, xscpu64) or on
+    the C128, where RAM is banked and the VIC-IIe may stretch cycles.
+*/
+static int reu_dma_fast_len(uint16_t host_addr, unsigned int reu_addr, int host_step, int reu_step, int len, int cycles, int host_write)
+{
+    CLOCK next_alarm_clk;
+    unsigned int dram_addr;
+    unsigned int wrap_around;
+    unsigned int page;
+    int n = len;
+
+    if (reu_ba.enabled || machine_class == VICE_MACHINE_C128) {
+        return 0;
+    }
+
+    /* No alarm may come due while the run is transferred. */
+    next_alarm_clk = alarm_context_next_pending_clk(maincpu_alarm_context);
+    if (next_alarm_clk <= maincpu_clk + cycles * REU_DMA_FAST_MIN) {
+        return 0;
+    }
+    if ((next_alarm_clk - maincpu_clk - 1) / cycles < (CLOCK)n) {
+        n = (int)((next_alarm_clk - maincpu_clk - 1) / cycles);
+    }
+
+    /* The REU side must be backed by DRAM and must not wrap around. */
+    dram_addr = reu_addr & (rec_options.dram_wrap_around - 1);
+    if (dram_addr >= rec_options.not_backedup_addresses) {
+        return 0;
+    }
+    if (reu_step) {
+        if (rec_options.not_backedup_addresses - dram_addr < (unsigned int)n) {
+            n = (int)(rec_options.not_backedup_addresses - dram_addr);
+        }
+        wrap_around = rec_options.wrap_around < 0x00080000 ? rec_options.wrap_around : 0x00080000;
+        if (wrap_around - (reu_addr & 0x0007ffff) <= (unsigned int)n) {
+            n = (int)(wrap_around - (reu_addr & 0x0007ffff)) - 1;
+        }
+    }
+
+    /* The host side must be plain RAM without side effects, which also
+       rules out watchpoints, the VIC-II bank and $FF00. */
+    if (host_step && 0x10000 - host_addr < (unsigned int)n) {
+        n = 0x10000 - host_addr;
+    }
+    if (n < REU_DMA_FAST_MIN) {
+        return 0;
+    }
+    for (page = host_addr >> 8; page <= (unsigned int)((host_addr + (n - 1) * host_step) >> 8); page++) {
+        if (_mem_read_tab_ptr[page] != ram_read
+            || (host_write && _mem_write_tab_ptr[page] != ram_store)) {
+            n = (int)((page << 8) - host_addr);
+            break;
+        }
+    }
+
+    return n >= REU_DMA_FAST_MIN ? n : 0;
+}
+
+/*! \brief copy a run of bytes found by reu_dma_fast_len()
+
+  \param to_reu
+    Non-zero to copy from the host to the REU, zero for the other way
+*/
+static void reu_dma_fast_copy(uint16_t host_addr, unsigned int reu_addr, int host_step, int reu_step, int n, int to_reu)
+{
+    uint8_t *host = mem_ram + host_addr;
+    uint8_t *reu = reu_ram + (reu_addr & (rec_options.dram_wrap_around - 1));
+
+    if (host_step && reu_step) {
+        if (to_reu) {
+            memcpy(reu, host, n);
+        } else {
+            memcpy(host, reu, n);
+        }
+    } else if (reu_step) {
+        /* fill from a fixed address */
+        if (to_reu) {
+            memset(reu, *host, n);
+        } else {
+            *host = reu[n - 1];
+        }
+    } else if (host_step) {
+        if (to_reu) {
+            *reu = host[n - 1];
+        } else {
+            memset(host, *reu, n);
+        }
+    } else if (to_reu) {
+        *reu = *host;
+    } else {
+        *host = *reu;
+    }
+}
+
+/*! \brief swap a run of bytes found by reu_dma_fast_len() */
+static void reu_dma_fast_swap(uint16_t host_addr, unsigned int reu_addr, int host_step, int reu_step, int n)
+{
+    uint8_t *host = mem_ram + host_addr;
+    uint8_t *reu = reu_ram + (reu_addr & (rec_options.dram_wrap_around - 1));
+    uint8_t value;
+
+    while (n--) {
+        value = *reu;
+        *reu = *host;
+        *host = value;
+        host += host_step;
+        reu += reu_step;
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
 /*! \brief update the REU registers after a DMA operation
 
   \param host_addr
@@ -1167,6 +1316,7 @@ static void reu_dma_update_regs(uint16_t host_addr, unsigned int reu_addr, int l
 static void reu_dma_host_to_reu(uint16_t host_addr, unsigned int reu_addr, int host_step, int reu_step, int len)
 {
     uint8_t value;
+    int n;
     DEBUG_LOG(DEBUG_LEVEL_TRANSFER_HIGH_LEVEL, (reu_log, "copy ext $%05X %s<= main $%04X%s, $%04X (%d) bytes.",
                                                 reu_addr, reu_step ? "" : "(fixed) ", host_addr, host_step ? "" : " (fixed)", len, len));
 
@@ -1175,6 +1325,16 @@ static void reu_dma_host_to_reu(uint16_t host_addr, unsigned int reu_addr, int h
     assert(len >= 1);
 
     while (len) {
+        n = reu_dma_fast_len(host_addr, reu_addr, host_step, reu_step, len, 1, 0);
+        if (n) {
+            reu_dma_fast_copy(host_addr, reu_addr, host_step, reu_step, n, 1);
+            maincpu_clk += n;
+            host_addr = (host_addr + host_step * n) & 0xffff;
+            reu_addr += reu_step * n;
+            len -= n;
+            continue;
+        }
+
         reu_clk_inc_pre();
         machine_handle_pending_alarms(0);
         value = mem_read(host_addr);
@@ -1210,6 +1370,7 @@ static void reu_dma_host_to_reu(uint16_t host_addr, unsigned int reu_addr, int h
 static void reu_dma_reu_to_host(uint16_t host_addr, unsigned int reu_addr, int host_step, int reu_step, int len)
 {
     uint8_t value;
+    int n;
     DEBUG_LOG(DEBUG_LEVEL_TRANSFER_HIGH_LEVEL, (reu_log, "copy ext $%05X %s=> main $%04X%s, $%04X (%d) bytes.",
                                                 reu_addr, reu_step ? "" : "(fixed) ", host_addr, host_step ? "" : " (fixed)", len, len));
 
@@ -1218,6 +1379,16 @@ static void reu_dma_reu_to_host(uint16_t host_addr, unsigned int reu_addr, int h
     assert(len >= 1);
 
     while (len) {
+        n = reu_dma_fast_len(host_addr, reu_addr, host_step, reu_step, len, 1, 1);
+        if (n) {
+            reu_dma_fast_copy(host_addr, reu_addr, host_step, reu_step, n, 0);
+            maincpu_clk += n;
+            host_addr = (host_addr + host_step * n) & 0xffff;
+            reu_addr += reu_step * n;
+            len -= n;
+            continue;
+        }
+
         DEBUG_LOG(DEBUG_LEVEL_TRANSFER_LOW_LEVEL, (reu_log, "Transferring byte: %x from ext $%05X to main $%04X.", reu_ram[reu_addr % reu_size], reu_addr, host_addr));
         reu_clk_inc_pre();
         value = read_from_reu(reu_addr);
@@ -1257,6 +1428,7 @@ static void reu_dma_swap(uint16_t host_addr, unsigned int reu_addr, int host_ste
 {
     uint8_t value_from_reu;
     uint8_t value_from_c64;
+    int n;
     DEBUG_LOG(DEBUG_LEVEL_TRANSFER_HIGH_LEVEL, (reu_log, "swap ext $%05X %s<=> main $%04X%s, $%04X (%d) bytes.",
                                                 reu_addr, reu_step ? "" : "(fixed) ", host_addr, host_step ? "" : " (fixed)", len, len));
 
@@ -1265,6 +1437,16 @@ static void reu_dma_swap(uint16_t host_addr, unsigned int reu_addr, int host_ste
     assert(len >= 1);
 
     while (len) {
+        n = reu_dma_fast_len(host_addr, reu_addr, host_step, reu_step, len, 2, 1);
+        if (n) {
+            reu_dma_fast_swap(host_addr, reu_addr, host_step, reu_step, n);
+            maincpu_clk += 2 * n;
+            host_addr = (host_addr + host_step * n) & 0xffff;
+            reu_addr += reu_step * n;
+            len -= n;
+            continue;
+        }
+
         value_from_reu = read_from_reu(reu_addr);
         reu_clk_inc_pre();
         machine_handle_pending_alarms(0);
@@ -359,7 +359,6 @@ static struct sfx_soundexpander_sound_s snd;
 
 static int sfx_soundexpander_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, int soc, int scc, int *delta_t)
 {
-    int i;
     int16_t *buffer;
 
     buffer = lib_malloc(nr * 2);
@@ -370,12 +369,7 @@ static int sfx_soundexpander_sound_machine_calculate_samples(sound_t **psid, int
         ym3526_update_one(YM3526_chip, buffer, nr);
     }
 
-    for (i = 0; i < nr; i++) {
-        pbuf[i * soc] = sound_audio_mix(pbuf[i * soc], buffer[i]);
-        if (soc > 1) {
-            pbuf[(i * soc) + 1] = sound_audio_mix(pbuf[(i * soc) + 1], buffer[i]);
-        }
-    }
+    sound_audio_mix_buffer(pbuf, buffer, nr, soc);
     lib_free(buffer);
 
     return nr;
@@ -122,6 +122,40 @@ static int datasette_tape_wobble = 0;
 /* datasette device enable */
 static int datasette_enable = 0;
 
+/* let the Kernal traps read standard blocks straight from TAP images */
+static int datasette_fast_load = 0;
+
+/* A pulse longer than this (in cycles) is a pause and ends a block.  */
+#define DATASETTE_BLOCK_PAUSE   4096
+
+/* Pulses are classified in windows of this many.  A loader switching
+   from standard to turbo encoding starts a new block.  */
+#define DATASETTE_BLOCK_WINDOW  64
+
+/* Blocks with fewer pulses than this are just noise.  */
+#define DATASETTE_BLOCK_MIN     256
+
+/* Blocks of pulses found in the TAP image when it was attached, in tape
+   order.  Positions are like current_file_seek_position.  */
+typedef struct datasette_block_s {
+    int start;
+    int end;
+    int type;
+} datasette_block_t;
+
+static datasette_block_t *datasette_blocks = NULL;
+static int datasette_blocks_num = 0;
+static int datasette_blocks_max = 0;
+
+/* Block and window being scanned.  */
+static int scan_type = -1;
+static int scan_start;
+static int scan_end;
+static int scan_pulses;
+static int scan_window_start;
+static int scan_window_pulses;
+static int scan_window_cbm;
+
 static log_t datasette_log = LOG_ERR;
 
 static void datasette_internal_reset(void);
@@ -209,6 +243,15 @@ static int set_datasette_tape_wobble(int val, void *param)
     return 0;
 }
 
+static int set_datasette_fast_load(int val, void *param)
+{
+    datasette_fast_load = val ? 1 : 0;
+
+    tape_traps_refresh();
+
+    return 0;
+}
+
 static int set_datasette_enable(int value, void *param)
 {
     int val = value ? 1 : 0;
@@ -248,6 +291,9 @@ static const resource_int_t resources_int[] = {
     { "DatasetteTapeWobble", 10, RES_EVENT_SAME, NULL,
       &datasette_tape_wobble,
       set_datasette_tape_wobble, NULL },
+    { "DatasetteFastLoad", 0, RES_EVENT_SAME, NULL,
+      &datasette_fast_load,
+      set_datasette_fast_load, NULL },
     RESOURCE_INT_LIST_END
 };
 
@@ -285,6 +331,12 @@ static const cmdline_option_t cmdline_options[] =
     { "-dstapewobble", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
       NULL, NULL, "DatasetteTapeWobble", NULL,
       "<value>", "Set maximum random number of cycles added to each gap in the tap" },
+    { "-dsfastload", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "DatasetteFastLoad", (resource_value_t)1,
+      NULL, "Read standard CBM blocks of TAP images through the Kernal traps" },
+    { "+dsfastload", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "DatasetteFastLoad", (resource_value_t)0,
+      NULL, "Always play TAP images pulse by pulse" },
     CMDLINE_LIST_END
 };
 
@@ -723,24 +775,119 @@ void datasette_init(void)
     datasette_set_tape_image(NULL);
 }
 
+static void datasette_blocks_clear(void)
+{
+    lib_free(datasette_blocks);
+    datasette_blocks = NULL;
+    datasette_blocks_num = 0;
+    datasette_blocks_max = 0;
+    scan_type = -1;
+    scan_window_pulses = 0;
+}
+
+static void datasette_scan_end_block(void)
+{
+    datasette_block_t *block;
+
+    if (scan_type >= 0 && scan_pulses >= DATASETTE_BLOCK_MIN) {
+        if (datasette_blocks_num == datasette_blocks_max) {
+            datasette_blocks_max = datasette_blocks_max ? datasette_blocks_max * 2 : 64;
+            datasette_blocks = lib_realloc(datasette_blocks,
+                                           datasette_blocks_max * sizeof(datasette_block_t));
+        }
+        block = &datasette_blocks[datasette_blocks_num++];
+        block->start = scan_start;
+        block->end = scan_end;
+        block->type = scan_type;
+    }
+    scan_type = -1;
+}
+
+static void datasette_scan_end_window(int end)
+{
+    int type;
+
+    if (scan_window_pulses == 0) {
+        return;
+    }
+
+    /* Standard encoding only has S/M/L pulses.  Turbo loaders use shorter
+       ones.  A partial window at the end goes with the block.  */
+    if (scan_window_pulses < DATASETTE_BLOCK_WINDOW && scan_type >= 0) {
+        type = scan_type;
+    } else if (scan_window_cbm * 16 >= scan_window_pulses * 15) {
+        type = DATASETTE_BLOCK_CBM;
+    } else {
+        type = DATASETTE_BLOCK_TURBO;
+    }
+
+    if (type != scan_type) {
+        datasette_scan_end_block();
+        scan_type = type;
+        scan_start = scan_window_start;
+        scan_pulses = 0;
+    }
+    scan_end = end;
+    scan_pulses += scan_window_pulses;
+    scan_window_pulses = 0;
+}
+
+/* Feed the pulse starting at `position' to the block map.  A `gap' of 0
+   marks the end of the tape.  */
+static void datasette_scan_pulse(int position, CLOCK gap)
+{
+    if (gap == 0 || gap > DATASETTE_BLOCK_PAUSE) {
+        datasette_scan_end_window(position);
+        datasette_scan_end_block();
+        return;
+    }
+
+    if (scan_window_pulses == DATASETTE_BLOCK_WINDOW) {
+        datasette_scan_end_window(position);
+    }
+    if (scan_window_pulses == 0) {
+        scan_window_start = position;
+        scan_window_cbm = 0;
+    }
+    scan_window_pulses++;
+
+    if (tap_pulse_type((int)(gap / 8)) != TAP_PULSE_TYPE_OTHER) {
+        scan_window_cbm++;
+    }
+}
+
 void datasette_set_tape_image(tap_t *image)
 {
     CLOCK gap;
+    int i, position, cbm_blocks;
 
     DBG(("datasette_set_tape_image (image present:%s)", image ? "yes" : "no"));
 
     current_image = image;
     last_tap = next_tap = 0;
     datasette_internal_reset();
+    datasette_blocks_clear();
 
     if (image != NULL) {
-        /* We need the length of tape for realistic counter. */
+        /* We need the length of tape for realistic counter.  Map out the
+           blocks on the way.  */
         current_image->cycle_counter_total = 0;
         do {
+            position = current_image->current_file_seek_position;
             gap = datasette_read_gap(1);
+            datasette_scan_pulse(position, gap);
             current_image->cycle_counter_total += gap / 8;
         } while (gap);
         current_image->current_file_seek_position = 0;
+
+        cbm_blocks = 0;
+        for (i = 0; i < datasette_blocks_num; i++) {
+            if (datasette_blocks[i].type == DATASETTE_BLOCK_CBM) {
+                cbm_blocks++;
+            }
+        }
+        log_message(datasette_log, "TAP image has %d blocks, %d standard.",
+                    datasette_blocks_num, cbm_blocks);
     }
     if (datasette_list_item) {
         tapeport_set_tape_sense(0, datasette_device.id);
@@ -753,6 +900,76 @@ void datasette_set_tape_image(tap_t *image)
 }
 
 
+/* Type of the first block that doesn't end before `position' or -1 if
+   there is none.  The block may start after `position'.  */
+int datasette_block_at(int position, int *start, int *end)
+{
+    int lo = 0, hi = datasette_blocks_num;
+
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (datasette_blocks[mid].end <= position) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    if (lo == datasette_blocks_num) {
+        return -1;
+    }
+
+    *start = datasette_blocks[lo].start;
+    *end = datasette_blocks[lo].end;
+    return datasette_blocks[lo].type;
+}
+
+/* 1 if the tape is playing through a block, 0 if not and -1 if nothing
+   is known about the image.  */
+int datasette_get_block_state(void)
+{
+    int position, start, end;
+
+    if (current_image == NULL || datasette_blocks_num == 0) {
+        return -1;
+    }
+
+    if (!datasette_motor || current_image->mode != DATASETTE_CONTROL_START) {
+        return 0;
+    }
+
+    position = current_image->current_file_seek_position;
+    return datasette_block_at(position, &start, &end) >= 0 && start <= position;
+}
+
+int datasette_get_fast_load(void)
+{
+    return datasette_fast_load;
+}
+
+/* Wind the tape forward to `position' as if it had been played.  Used
+   after the Kernal traps have read a block straight from the image.  */
+void datasette_skip_to(int position)
+{
+    CLOCK gap;
+
+    if (current_image == NULL) {
+        return;
+    }
+
+    while (current_image->current_file_seek_position < position) {
+        gap = datasette_read_gap(1);
+        if (!gap) {
+            break;
+        }
+        current_image->cycle_counter += gap / 8;
+    }
+
+    datasette_long_gap_pending = 0;
+    datasette_long_gap_elapsed = 0;
+    datasette_update_ui_counter();
+}
+
 static void datasette_forward(void)
 {
     int mode = current_image ? current_image->mode : notape_mode;
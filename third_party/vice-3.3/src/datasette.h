@@ -38,6 +38,10 @@
 #define DATASETTE_CONTROL_RESET   5
 #define DATASETTE_CONTROL_RESET_COUNTER   6
 
+/* Block types found when a TAP image is attached.  */
+#define DATASETTE_BLOCK_CBM     0
+#define DATASETTE_BLOCK_TURBO   1
+
 /* Counter is c=g*(sqrt(v*t/d*pi+r^2/d^2)-r/d)
    Some constants for the Datasette-Counter, maybe resourses in future */
 #ifndef PI
@@ -59,6 +63,11 @@ extern void datasette_reset(void);
 extern void datasette_reset_counter(void);
 extern void datasette_event_playback(CLOCK offset, void *data);
 
+extern int datasette_block_at(int position, int *start, int *end);
+extern int datasette_get_block_state(void);
+extern int datasette_get_fast_load(void);
+extern void datasette_skip_to(int position);
+
 /* Emulator specific functions.  */
 extern void machine_trigger_flux_change(unsigned int on);
 extern void machine_set_tape_sense(int sense);
@@ -156,6 +156,9 @@ int fsimage_read_dxx_image(const disk_image_t *image)
     int half_track;
     int sectors;
     long offset;
+    uint8_t *track_buffer = NULL;
+    unsigned int track_buffer_sectors = 0;
+    int first, last, converted;
 
     if (image->type == DISK_IMAGE_TYPE_D80
         || image->type == DISK_IMAGE_TYPE_D82) {
@@ -208,26 +211,52 @@ int fsimage_read_dxx_image(const disk_image_t *image)
             /* Clear track to avoid read errors.  */
             memset(ptr, 0x55, track_size);
 
-            for (sector = 0; sector < max_sector; sector++) {
-                sectors = disk_image_check_sector(image, track, sector);
-                offset = sectors * 256;
+            /* The sectors of a track are usually stored one after the
+               other. Then the whole track is read and converted at once. */
+            converted = 0;
+            first = disk_image_check_sector(image, track, 0);
+            last = disk_image_check_sector(image, track, max_sector - 1);
+            if (first >= 0 && last - first == (int)max_sector - 1) {
+                if (track_buffer_sectors < max_sector) {
+                    track_buffer = lib_realloc(track_buffer, max_sector * 256);
+                    track_buffer_sectors = max_sector;
+                }
+                offset = first * 256;
 
                 if (image->type == DISK_IMAGE_TYPE_X64) {
                     offset += X64_HEADER_LENGTH;
                 }
 
-                if (sectors >= 0) {
-                    rf = CBMDOS_FDC_ERR_DRIVE;
-                    if (util_fpread(fsimage->fd, buffer, 256, offset) >= 0) {
-                        if (fsimage->error_info.map != NULL) {
-                            rf = fsimage->error_info.map[sectors];
+                if (util_fpread(fsimage->fd, track_buffer, max_sector * 256, offset) >= 0) {
+                    header.sector = 0;
+                    gcr_convert_track_to_GCR(track_buffer, ptr, &header, max_sector, 9, 5, gap,
+                                             fsimage->error_info.map ? fsimage->error_info.map + first : NULL);
+                    converted = 1;
+                }
+            }
+
+            if (!converted) {
+                for (sector = 0; sector < max_sector; sector++) {
+                    sectors = disk_image_check_sector(image, track, sector);
+                    offset = sectors * 256;
+
+                    if (image->type == DISK_IMAGE_TYPE_X64) {
+                        offset += X64_HEADER_LENGTH;
+                    }
+
+                    if (sectors >= 0) {
+                        rf = CBMDOS_FDC_ERR_DRIVE;
+                        if (util_fpread(fsimage->fd, buffer, 256, offset) >= 0) {
+                            if (fsimage->error_info.map != NULL) {
+                                rf = fsimage->error_info.map[sectors];
+                            }
                         }
+                        header.sector = sector;
+                        gcr_convert_sector_to_GCR(buffer, ptr, &header, 9, 5, rf);
                     }
-                    header.sector = sector;
-                    gcr_convert_sector_to_GCR(buffer, ptr, &header, 9, 5, rf);
-                }
 
-                ptr += SECTOR_GCR_SIZE_WITH_HEADER + 9 + gap + 5;
+                    ptr += SECTOR_GCR_SIZE_WITH_HEADER + 9 + gap + 5;
+                }
             }
         } else {
             memset(ptr, 0x55, track_size);
@@ -241,6 +270,7 @@ int fsimage_read_dxx_image(const disk_image_t *image)
             image->gcr->tracks[half_track].size = 0;
         }
     }
+    lib_free(track_buffer);
     return 0;
 }
 
@@ -1133,13 +1133,12 @@ static int drive_snapshot_read_p64image_module(snapshot_t *s, unsigned int dnr)
         return -1;
     }
 
-    tmpbuf = lib_malloc(size);
+    tmpbuf = lib_scratch_malloc(size);
 
     if (SMR_BA(m, tmpbuf, size) < 0) {
         if (m != NULL) {
             snapshot_module_close(m);
         }
-        lib_free(tmpbuf);
         return -1;
     }
 
@@ -1151,7 +1150,6 @@ static int drive_snapshot_read_p64image_module(snapshot_t *s, unsigned int dnr)
         if (m != NULL) {
             snapshot_module_close(m);
         }
-        lib_free(tmpbuf);
         P64MemoryStreamDestroy(&P64MemoryStreamInstance);
         return -1;
     }
@@ -1161,8 +1159,6 @@ static int drive_snapshot_read_p64image_module(snapshot_t *s, unsigned int dnr)
     snapshot_module_close(m);
     m = NULL;
 
-    lib_free(tmpbuf);
-
     drive->P64_image_loaded = 1;
     drive->complicated_image_loaded = 1;
     drive->image = NULL;
@@ -31,6 +31,16 @@
 #include "drive-sound.h"
 #include "sound.h"
 
+/* On multicore BMC64 builds the sounds are rendered on the helper core
+   that also runs the second SID (see sid.c). The emulation thread only
+   queues motor/head events and mixes in what the helper rendered ahead
+   of time. */
+#if defined(RASPI_COMPILE) && !defined(RASPI_LITE)
+#define DRIVE_SOUND_HELPER
+#include "maincpu.h"
+#include "sid/sid.h"
+#endif
+
 static const signed char hum[] = {
     0, -1, -2, -3, -2, 0, 3, 5, 6, 5, 3, 0, -3, -5, -6, -4, -2, 1, 2, 3, 3, 3,
     3, 2, 0, -3, -4, -4, -1, 2, 5, 5, 3, -1, -5, -6, -6, -4, -2, -1, 0, 0, 0,
@@ -1435,10 +1445,284 @@ static int sample_rate = 22050;
 extern int drive_sound_emulation;
 extern int drive_sound_emulation_volume;
 
+static void drive_sound_apply_motor(int i, int unit)
+{
+    switch (i) {
+        case DRIVE_SOUND_MOTOR_ON:
+            motor[unit] = spinup;
+            break;
+        case DRIVE_SOUND_MOTOR_OFF:
+            motor[unit] = spindown;
+            break;
+    }
+}
+
+static void drive_sound_apply_head(int track, int dir, int unit)
+{
+    stepvol[unit] = 100 - track;
+    if (track == 2 && dir == -1) {
+        if (step[unit] == nosound) {
+            step[unit] = bump;
+        }
+    } else {
+        step[unit] = (track < 18) ? stepping : stepping2;
+    }
+}
+
+static void drive_sound_apply_stop(void)
+{
+    int i;
+    for (i = 0; i < DRIVE_NUM; i++) {
+        motor[i] = nosound;
+        step[i] = nosound;
+        stepvol[i] = 0;
+    }
+}
+
+/* Move every drive on by one output sample. *nos is set once all of
+   them have run into silence. */
+static void drive_sound_advance(int *nos)
+{
+    static int div = 0;
+    int j;
+
+    div += 44100;
+    while (div >= sample_rate) {
+        div -= sample_rate;
+        *nos = 1;
+        for (j = 0; j < DRIVE_NUM; j++) {
+            motor[j]++;
+            if (motor[j] == &spinup[sizeof(spinup)]) {
+                motor[j] = hum;
+            }
+            if (motor[j] == &hum[sizeof(hum)]) {
+                motor[j] = hum;
+            }
+            if (motor[j] == &spindown[sizeof(spindown)]) {
+                motor[j] = nosound;
+            }
+            if (motor[j] == nosound + 1) {
+                motor[j] = nosound;
+            } else {
+                *nos = 0;
+            }
+            step[j]++;
+            if (step[j] == &stepping[sizeof(stepping)]) {
+                step[j] = nosound;
+            }
+            if (step[j] == &stepping2[sizeof(stepping2)]) {
+                step[j] = nosound;
+            }
+            if (step[j] == &bump[sizeof(bump)]) {
+                step[j] = nosound;
+            }
+            if (step[j] == nosound + 1) {
+                step[j] = nosound;
+            } else {
+                *nos = 0;
+            }
+        }
+    }
+}
+
+#ifdef DRIVE_SOUND_HELPER
+
+/* Rendered samples, written by the helper core only. Must be a power of
+   2 and hold DRIVE_SOUND_LEAD plus the largest request we expect. */
+#define DRIVE_SOUND_RING 4096
+#define DRIVE_SOUND_RING_MASK (DRIVE_SOUND_RING - 1)
+
+/* How far ahead of the emulation the helper renders, and the least
+   amount of work worth waking it up for. */
+#define DRIVE_SOUND_LEAD 2048
+#define DRIVE_SOUND_CHUNK 128
+
+/* Events from the emulation thread to the helper. Power of 2. */
+#define DRIVE_SOUND_EVENTS 256
+#define DRIVE_SOUND_EVENTS_MASK (DRIVE_SOUND_EVENTS - 1)
+
+#define DRIVE_SOUND_EVENT_MOTOR 0
+#define DRIVE_SOUND_EVENT_HEAD  1
+#define DRIVE_SOUND_EVENT_STOP  2
+
+typedef struct drive_sound_event_s {
+    uint32_t sample;  /* ring position it takes effect at */
+    uint8_t type;
+    uint8_t unit;
+    int8_t dir;       /* head direction or motor on/off */
+    uint8_t track;
+} drive_sound_event_t;
+
+static int16_t ring[DRIVE_SOUND_RING];
+static volatile uint32_t rendered;  /* helper only */
+static volatile uint32_t consumed;  /* emulation only */
+static volatile uint32_t render_target;
+static volatile int render_pending;
+static volatile int helper_idle = 1;
+static volatile uint32_t sound_end;  /* ring position after the last sound */
+
+static drive_sound_event_t events[DRIVE_SOUND_EVENTS];
+static volatile uint32_t event_head;  /* emulation only */
+static volatile uint32_t event_tail;  /* helper only */
+
+/* maincpu_clk at the last mix, to place events between mixes. */
+static CLOCK mix_clk;
+
+static void drive_sound_post(int type, int unit, int dir, int track)
+{
+    uint32_t head = event_head;
+    uint32_t elapsed;
+    drive_sound_event_t *e;
+
+    if (head - event_tail >= DRIVE_SOUND_EVENTS) {
+        return;
+    }
+
+    if (!drive_sound.chip_enabled) {
+        mix_clk = maincpu_clk;
+        drive_sound.chip_enabled = 1;
+    }
+    elapsed = (uint32_t)((uint64_t)(maincpu_clk - mix_clk) * sample_rate / cycles_per_sec);
+    if (elapsed > DRIVE_SOUND_LEAD / 2) {
+        elapsed = DRIVE_SOUND_LEAD / 2;
+    }
+
+    e = &events[head & DRIVE_SOUND_EVENTS_MASK];
+    e->sample = consumed + DRIVE_SOUND_LEAD + elapsed;
+    e->type = (uint8_t)type;
+    e->unit = (uint8_t)unit;
+    e->dir = (int8_t)dir;
+    e->track = (uint8_t)track;
+    __sync_synchronize();
+    event_head = head + 1;
+    helper_idle = 0;
+}
+
+int drive_sound_render_pending(void)
+{
+    return render_pending;
+}
+
+/* Runs on the helper core. Renders up to render_target. */
+void drive_sound_render(void)
+{
+    uint32_t pos = rendered;
+    uint32_t target = render_target;
+    uint32_t tail = event_tail;
+    uint32_t head = event_head;
+    int i, nos = 0;
+    int m, s, v;
+
+    __sync_synchronize();
+
+    /* Fell too far behind, e.g. the helper was held up. What would
+       have been rendered in between has been mixed as silence. */
+    if ((int32_t)(target - pos) > DRIVE_SOUND_RING) {
+        pos = target - DRIVE_SOUND_LEAD;
+    }
+
+    while (pos != target) {
+        while (tail != head &&
+               (int32_t)(events[tail & DRIVE_SOUND_EVENTS_MASK].sample - pos) <= 0) {
+            drive_sound_event_t *e = &events[tail & DRIVE_SOUND_EVENTS_MASK];
+            switch (e->type) {
+                case DRIVE_SOUND_EVENT_MOTOR:
+                    drive_sound_apply_motor(e->dir, e->unit);
+                    break;
+                case DRIVE_SOUND_EVENT_HEAD:
+                    drive_sound_apply_head(e->track, e->dir, e->unit);
+                    break;
+                case DRIVE_SOUND_EVENT_STOP:
+                    drive_sound_apply_stop();
+                    break;
+            }
+            tail++;
+        }
+
+        v = 0;
+        for (i = 0; i < DRIVE_NUM; i++) {
+            m = (((*motor[i]) * motorvol[i]) * drive_sound_emulation_volume) >> 8;
+            s = (((*step[i]) * stepvol[i]) * drive_sound_emulation_volume) >> 8;
+            v = sound_audio_mix(v, m);
+            v = sound_audio_mix(v, s);
+        }
+        ring[pos & DRIVE_SOUND_RING_MASK] = (int16_t)v;
+        drive_sound_advance(&nos);
+        pos++;
+        if (v) {
+            sound_end = pos;
+        }
+    }
+
+    for (i = 0; i < DRIVE_NUM; i++) {
+        if (motor[i] != nosound || step[i] != nosound) {
+            break;
+        }
+    }
+
+    __sync_synchronize();
+    event_tail = tail;
+    rendered = pos;
+    helper_idle = (i == DRIVE_NUM && tail == head);
+    __sync_synchronize();
+    render_pending = 0;
+}
+
+static int drive_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, int soc, int scc, int *delta_t)
+{
+    uint32_t pos = consumed;
+    int32_t avail = (int32_t)(rendered - pos);
+    int n, off, len;
+
+    __sync_synchronize();
+
+    /* Anything the helper hasn't got to yet stays silent. */
+    n = avail < 0 ? 0 : (avail < nr ? avail : nr);
+    while (n > 0) {
+        off = pos & DRIVE_SOUND_RING_MASK;
+        len = DRIVE_SOUND_RING - off;
+        if (len > n) {
+            len = n;
+        }
+        sound_audio_mix_buffer(pbuf, ring + off, len, soc);
+        pbuf += len * soc;
+        pos += len;
+        n -= len;
+    }
+    consumed += nr;
+    mix_clk = maincpu_clk;
+
+    if (!render_pending) {
+        if (helper_idle && event_tail == event_head
+            && (int32_t)(consumed - sound_end) >= 0) {
+            drive_sound.chip_enabled = 0;
+        } else if ((int32_t)(consumed + DRIVE_SOUND_LEAD - rendered) >= DRIVE_SOUND_CHUNK) {
+            render_target = consumed + DRIVE_SOUND_LEAD;
+            render_pending = 1;
+            __sync_synchronize();
+            /* Shares the SID job semaphore, see ViceEmulatorCore::Run */
+            sem_inc(&sid_job);
+        }
+    }
+    return nr;
+}
+
+#else
+
+#ifdef RASPI_COMPILE
+int drive_sound_render_pending(void)
+{
+    return 0;
+}
+
+void drive_sound_render(void)
+{
+}
+#endif
+
 static int drive_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, int soc, int scc, int *delta_t)
 {
     int i, j, nos = 0;
-    static int div = 0;
     int m, s;
 
     for (i = 0; i < nr; i++) {
@@ -1459,43 +1743,7 @@ static int drive_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf,
                     break;
             }
         }
-        div += 44100;
-        while (div >= sample_rate) {
-            div -= sample_rate;
-            nos = 1;
-            for (j = 0; j < DRIVE_NUM; j++) {
-                motor[j]++;
-                if (motor[j] == &spinup[sizeof(spinup)]) {
-                    motor[j] = hum;
-                }
-                if (motor[j] == &hum[sizeof(hum)]) {
-                    motor[j] = hum;
-                }
-                if (motor[j] == &spindown[sizeof(spindown)]) {
-                    motor[j] = nosound;
-                }
-                if (motor[j] == nosound + 1) {
-                    motor[j] = nosound;
-                } else {
-                    nos = 0;
-                }
-                step[j]++;
-                if (step[j] == &stepping[sizeof(stepping)]) {
-                    step[j] = nosound;
-                }
-                if (step[j] == &stepping2[sizeof(stepping2)]) {
-                    step[j] = nosound;
-                }
-                if (step[j] == &bump[sizeof(bump)]) {
-                    step[j] = nosound;
-                }
-                if (step[j] == nosound + 1) {
-                    step[j] = nosound;
-                } else {
-                    nos = 0;
-                }
-            }
-        }
+        drive_sound_advance(&nos);
     }
     if (nos) {
         drive_sound.chip_enabled = 0;
@@ -1503,6 +1751,8 @@ static int drive_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf,
     return nr;
 }
 
+#endif
+
 static int drive_sound_machine_init(sound_t *psid, int speed, int cycles)
 {
     cycles_per_sec = cycles;
@@ -1552,17 +1802,16 @@ void drive_sound_update(int i, int unit)
         drive_sound.chip_enabled = 0;
         return;
     }
-    sound_store((uint16_t)drive_sound_offset, 0, 0);
-    switch (i) {
-        case DRIVE_SOUND_MOTOR_ON:
-            motor[unit] = spinup;
-            drive_sound.chip_enabled = 1;
-            break;
-        case DRIVE_SOUND_MOTOR_OFF:
-            motor[unit] = spindown;
-            drive_sound.chip_enabled = 1;
-            break;
+    if (i != DRIVE_SOUND_MOTOR_ON && i != DRIVE_SOUND_MOTOR_OFF) {
+        return;
     }
+#ifdef DRIVE_SOUND_HELPER
+    drive_sound_post(DRIVE_SOUND_EVENT_MOTOR, unit, i, 0);
+#else
+    sound_store((uint16_t)drive_sound_offset, 0, 0);
+    drive_sound_apply_motor(i, unit);
+    drive_sound.chip_enabled = 1;
+#endif
 }
 
 void drive_sound_head(int track, int dir, int unit)
@@ -1571,27 +1820,25 @@ void drive_sound_head(int track, int dir, int unit)
         drive_sound.chip_enabled = 0;
         return;
     }
+#ifdef DRIVE_SOUND_HELPER
+    drive_sound_post(DRIVE_SOUND_EVENT_HEAD, unit, dir, track);
+#else
     sound_store((uint16_t)drive_sound_offset, 0, 0);
-    stepvol[unit] = 100 - track;
-    if (track == 2 && dir == -1) {
-        if (step[unit] == nosound) {
-            drive_sound.chip_enabled = 1;
-            step[unit] = bump;
-        }
-    } else {
-        step[unit] = (track < 18) ? stepping : stepping2;
-        drive_sound.chip_enabled = 1;
-    }
+    drive_sound_apply_head(track, dir, unit);
+    drive_sound.chip_enabled = 1;
+#endif
 }
 
 void drive_sound_stop(void)
 {
-    int i;
-    for (i = 0; i < DRIVE_NUM; i++) {
-        motor[i] = nosound;
-        step[i] = nosound;
-        stepvol[i] = 0;
+#ifdef DRIVE_SOUND_HELPER
+    /* The helper owns the drive state once it has rendered anything. */
+    if (drive_sound.chip_enabled) {
+        drive_sound_post(DRIVE_SOUND_EVENT_STOP, 0, 0, 0);
+        return;
     }
+#endif
+    drive_sound_apply_stop();
     drive_sound.chip_enabled = 0;
 }
 
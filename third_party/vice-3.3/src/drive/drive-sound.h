@@ -36,4 +36,10 @@ void drive_sound_head(int track, int step, int unit);
 void drive_sound_stop(void);
 void drive_sound_init(void);
 
+#ifdef RASPI_COMPILE
+/* Helper core side, see drive-sound.c */
+int drive_sound_render_pending(void);
+void drive_sound_render(void);
+#endif
+
 #endif
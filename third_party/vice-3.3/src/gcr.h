@@ -62,6 +62,12 @@ typedef struct gcr_header_s {
 
 extern void gcr_convert_sector_to_GCR(const uint8_t *buffer, uint8_t *ptr, const gcr_header_t *header,
                                       int gap, int sync, enum fdc_err_e error_code);
+/* Converts num_sectors 256 byte sectors, starting with sector 0, into
+   a whole track. Every sector is followed by track_gap bytes that are
+   left alone. error_codes has one fdc_err_t per sector or is NULL. */
+extern void gcr_convert_track_to_GCR(const uint8_t *buffer, uint8_t *data, const gcr_header_t *header,
+                                     unsigned int num_sectors, int gap, int sync, int track_gap,
+                                     const uint8_t *error_codes);
 extern enum fdc_err_e gcr_read_sector(const disk_track_t *raw, uint8_t *data, uint8_t sector);
 extern enum fdc_err_e gcr_write_sector(disk_track_t *raw, const uint8_t *data, uint8_t sector);
 
@@ -37,6 +37,7 @@
 #include <ctype.h>
 
 #ifdef RASPI_COMPILE
+#include "keycodes.h"
 extern void raspi_keymap_changed(int, int, signed long);
 #endif
 
@@ -299,6 +300,61 @@ static int key_alternative = 0;
 
 static keyboard_conv_t *keyconvmap = NULL;
 
+#ifdef RASPI_COMPILE
+/* Dense keysym -> keyconvmap lookup so a key event doesn't scan the whole
+   table. keyconv_first[sym] is the first entry for sym and keyconv_chain[i]
+   the next entry after i with the same sym, in table order, -1 ending
+   both. Rebuilt when a keymap has been loaded, dropped whenever the table
+   changes. Syms outside the index are still looked up by scanning.  */
+static int keyconv_first[KEYCODE_MAX];
+static int *keyconv_chain = NULL;
+static int keyconv_index_valid = 0;
+
+static void keyboard_keyconv_index_build(void)
+{
+    int i, sym;
+
+    for (sym = 0; sym < KEYCODE_MAX; ++sym) {
+        keyconv_first[sym] = -1;
+    }
+    keyconv_chain = lib_realloc(keyconv_chain, (keyc_num + 1) * sizeof(int));
+    /* Backwards so every entry ends up in front of the later ones.  */
+    for (i = keyc_num - 1; i >= 0; --i) {
+        sym = keyconvmap[i].sym;
+        keyconv_chain[i] = -1;
+        if (sym >= 0 && sym < KEYCODE_MAX) {
+            keyconv_chain[i] = keyconv_first[sym];
+            keyconv_first[sym] = i;
+        }
+    }
+    keyconv_index_valid = 1;
+}
+#endif
+
+static void keyboard_keyconv_index_drop(void)
+{
+#ifdef RASPI_COMPILE
+    keyconv_index_valid = 0;
+#endif
+}
+
+/* Index of the next keyconvmap entry for key after entry i (-1 for the
+   first one), -1 if there is none.  */
+static int keyboard_keyconv_next(signed long key, int i)
+{
+#ifdef RASPI_COMPILE
+    if (keyconv_index_valid && key >= 0 && key < KEYCODE_MAX) {
+        return i < 0 ? keyconv_first[key] : keyconv_chain[i];
+    }
+#endif
+    for (++i; i < keyc_num; ++i) {
+        if (key == keyconvmap[i].sym) {
+            return i;
+        }
+    }
+    return -1;
+}
+
 static int kbd_lshiftrow;
 static int kbd_lshiftcol;
 static int kbd_rshiftrow;
@@ -485,20 +541,19 @@ void keyboard_key_pressed(signed long key)
 
     latch = 0;
 
-    for (i = 0; i < keyc_num; ++i) {
-        if (key == keyconvmap[i].sym) {
-            if ((keyconvmap[i].shift & ALT_MAP) && !key_alternative) {
-                continue;
-            }
+    for (i = keyboard_keyconv_next(key, -1); i >= 0;
+         i = keyboard_keyconv_next(key, i)) {
+        if ((keyconvmap[i].shift & ALT_MAP) && !key_alternative) {
+            continue;
+        }
 
-            if (keyboard_key_pressed_matrix(keyconvmap[i].row,
-                                            keyconvmap[i].column,
-                                            keyconvmap[i].shift)) {
-                latch = 1;
-                if (!(keyconvmap[i].shift & ALLOW_OTHER)
-                    || (right_shift_down + left_shift_down) == 0) {
-                    break;
-                }
+        if (keyboard_key_pressed_matrix(keyconvmap[i].row,
+                                        keyconvmap[i].column,
+                                        keyconvmap[i].shift)) {
+            latch = 1;
+            if (!(keyconvmap[i].shift & ALLOW_OTHER)
+                || (right_shift_down + left_shift_down) == 0) {
+                break;
             }
         }
     }
@@ -613,22 +668,21 @@ void keyboard_key_released(signed long key)
 
     latch = 0;
 
-    for (i = 0; i < keyc_num; i++) {
-        if (key == keyconvmap[i].sym) {
-            if ((keyconvmap[i].shift & ALT_MAP) && !key_alternative) {
-                continue;
-            }
+    for (i = keyboard_keyconv_next(key, -1); i >= 0;
+         i = keyboard_keyconv_next(key, i)) {
+        if ((keyconvmap[i].shift & ALT_MAP) && !key_alternative) {
+            continue;
+        }
 
-            if (keyboard_key_released_matrix(keyconvmap[i].row,
-                                             keyconvmap[i].column,
-                                             keyconvmap[i].shift)) {
-                latch = 1;
-                keyboard_set_latch_keyarr(keyconvmap[i].row,
-                                          keyconvmap[i].column, 0);
-                if (!(keyconvmap[i].shift & ALLOW_OTHER)
-                    /*|| (right_shift_down + left_shift_down) == 0*/) {
-                    break;
-                }
+        if (keyboard_key_released_matrix(keyconvmap[i].row,
+                                         keyconvmap[i].column,
+                                         keyconvmap[i].shift)) {
+            latch = 1;
+            keyboard_set_latch_keyarr(keyconvmap[i].row,
+                                      keyconvmap[i].column, 0);
+            if (!(keyconvmap[i].shift & ALLOW_OTHER)
+                /*|| (right_shift_down + left_shift_down) == 0*/) {
+                break;
             }
         }
     }
@@ -718,6 +772,7 @@ static void keyboard_keyconvmap_alloc(void)
 
 static void keyboard_keyconvmap_free(void)
 {
+    keyboard_keyconv_index_drop();
     lib_free(keyconvmap);
     keyconvmap = NULL;
 }
@@ -789,6 +844,7 @@ static void keyboard_keyword_clear(void)
 {
     int i, j;
 
+    keyboard_keyconv_index_drop();
     keyc_num = 0;
     keyconvmap[0].sym = ARCHDEP_KEYBOARD_SYM_NONE;
     key_ctrl_restore1 = -1;
@@ -817,6 +873,7 @@ static void keyboard_keysym_undef(signed long sym)
     int i;
 
     if (sym >= 0) {
+        keyboard_keyconv_index_drop();
         for (i = 0; i < keyc_num; i++) {
             if (keyconvmap[i].sym == sym) {
                 if (keyc_num) {
@@ -871,6 +928,7 @@ static void keyboard_parse_set_pos_row(signed long sym, int row, int col,
 {
     int i;
 
+    keyboard_keyconv_index_drop();
     for (i = 0; i < keyc_num; i++) {
         if (sym == keyconvmap[i].sym
             && !(keyconvmap[i].shift & ALLOW_OTHER)
@@ -1034,6 +1092,7 @@ static int keyboard_parse_keymap(const char *filename, int child)
        raspi_keymap_changed(keyconvmap[i].row, keyconvmap[i].column,
                             keyconvmap[i].sym);
     }
+    keyboard_keyconv_index_build();
 #endif
     return 0;
 }
@@ -554,6 +554,314 @@ void lib_debug_check(void)
 #endif
 }
 
+/*----------------------------------------------------------------------------*/
+
+/* On bare metal, small allocations are served from size class slabs so
+   the churn of attach/detach, snapshot loads and menu rebuilds doesn't
+   fragment the newlib heap.  The slabs live in one pool that is
+   allocated at first use and never given back.  Everything that doesn't
+   fit still goes to malloc.  */
+#if defined(RASPI_COMPILE) && !defined(LIB_DEBUG)
+#define LIB_SLAB
+#endif
+
+#ifdef LIB_SLAB
+#define LIB_SLAB_PAGE_SIZE  0x4000
+#define LIB_SLAB_POOL_SIZE  0x400000
+#define LIB_SLAB_PAGES      (LIB_SLAB_POOL_SIZE / LIB_SLAB_PAGE_SIZE)
+#define LIB_SLAB_MIN_SHIFT  4
+#define LIB_SLAB_CLASSES    6   /* 16 .. 512 bytes */
+#define LIB_SLAB_MAX_SIZE   (1 << (LIB_SLAB_MIN_SHIFT + LIB_SLAB_CLASSES - 1))
+
+typedef struct lib_slab_chunk_s {
+    struct lib_slab_chunk_s *next;
+} lib_slab_chunk_t;
+
+static char *lib_slab_pool = NULL;
+static int lib_slab_pool_failed = 0;
+static unsigned int lib_slab_pages_used = 0;
+static uint8_t lib_slab_page_class[LIB_SLAB_PAGES];
+static lib_slab_chunk_t *lib_slab_free_list[LIB_SLAB_CLASSES];
+
+/* The emulator may allocate from more than one core.  */
+static volatile int lib_slab_lock_flag = 0;
+
+static unsigned int lib_slab_in_use[LIB_SLAB_CLASSES];
+static unsigned int lib_slab_high[LIB_SLAB_CLASSES];
+static unsigned int lib_slab_pages[LIB_SLAB_CLASSES];
+static unsigned long lib_slab_fallbacks = 0;
+
+static inline void lib_slab_lock(void)
+{
+    while (__sync_lock_test_and_set(&lib_slab_lock_flag, 1)) {
+    }
+}
+
+static inline void lib_slab_unlock(void)
+{
+    __sync_lock_release(&lib_slab_lock_flag);
+}
+
+static inline int lib_slab_owns(const void *ptr)
+{
+    return lib_slab_pool != NULL && (const char *)ptr >= lib_slab_pool
+           && (const char *)ptr < lib_slab_pool + LIB_SLAB_POOL_SIZE;
+}
+
+static inline size_t lib_slab_chunk_size(const void *ptr)
+{
+    unsigned int page = (unsigned int)(((const char *)ptr - lib_slab_pool) / LIB_SLAB_PAGE_SIZE);
+
+    return (size_t)1 << (LIB_SLAB_MIN_SHIFT + lib_slab_page_class[page]);
+}
+
+/* Give size class `c' another page.  Called with the lock held.  */
+static int lib_slab_grow(int c)
+{
+    size_t chunk_size = (size_t)1 << (LIB_SLAB_MIN_SHIFT + c);
+    char *page;
+    size_t i;
+
+    if (lib_slab_pool == NULL) {
+        char *mem;
+
+        if (lib_slab_pool_failed) {
+            return 0;
+        }
+        mem = malloc(LIB_SLAB_POOL_SIZE + LIB_SLAB_PAGE_SIZE);
+        if (mem == NULL) {
+            lib_slab_pool_failed = 1;
+            return 0;
+        }
+        lib_slab_pool = (char *)(((unsigned long)mem + LIB_SLAB_PAGE_SIZE - 1)
+                                 & ~(unsigned long)(LIB_SLAB_PAGE_SIZE - 1));
+    }
+
+    if (lib_slab_pages_used == LIB_SLAB_PAGES) {
+        return 0;
+    }
+
+    lib_slab_page_class[lib_slab_pages_used] = (uint8_t)c;
+    page = lib_slab_pool + lib_slab_pages_used * LIB_SLAB_PAGE_SIZE;
+    lib_slab_pages_used++;
+    lib_slab_pages[c]++;
+
+    for (i = LIB_SLAB_PAGE_SIZE; i >= chunk_size; i -= chunk_size) {
+        lib_slab_chunk_t *chunk = (lib_slab_chunk_t *)(page + i - chunk_size);
+        chunk->next = lib_slab_free_list[c];
+        lib_slab_free_list[c] = chunk;
+    }
+    return 1;
+}
+
+static void *lib_slab_malloc(size_t size)
+{
+    lib_slab_chunk_t *chunk = NULL;
+    int c = 0;
+
+    if (size == 0 || size > LIB_SLAB_MAX_SIZE) {
+        return malloc(size);
+    }
+
+    while (((size_t)1 << (LIB_SLAB_MIN_SHIFT + c)) < size) {
+        c++;
+    }
+
+    lib_slab_lock();
+    if (lib_slab_free_list[c] != NULL || lib_slab_grow(c)) {
+        chunk = lib_slab_free_list[c];
+        lib_slab_free_list[c] = chunk->next;
+        if (++lib_slab_in_use[c] > lib_slab_high[c]) {
+            lib_slab_high[c] = lib_slab_in_use[c];
+        }
+    } else {
+        lib_slab_fallbacks++;
+    }
+    lib_slab_unlock();
+
+    return chunk != NULL ? (void *)chunk : malloc(size);
+}
+
+static void lib_slab_free(void *ptr)
+{
+    lib_slab_chunk_t *chunk;
+    unsigned int c;
+
+    if (!lib_slab_owns(ptr)) {
+        free(ptr);
+        return;
+    }
+
+    chunk = ptr;
+    c = lib_slab_page_class[((char *)ptr - lib_slab_pool) / LIB_SLAB_PAGE_SIZE];
+
+    lib_slab_lock();
+    chunk->next = lib_slab_free_list[c];
+    lib_slab_free_list[c] = chunk;
+    lib_slab_in_use[c]--;
+    lib_slab_unlock();
+}
+
+static void *lib_slab_calloc(size_t nmemb, size_t size)
+{
+    void *ptr;
+
+    if (nmemb == 0 || size == 0 || size > LIB_SLAB_MAX_SIZE / nmemb) {
+        return calloc(nmemb, size);
+    }
+
+    ptr = lib_slab_malloc(nmemb * size);
+    if (ptr != NULL) {
+        memset(ptr, 0, nmemb * size);
+    }
+    return ptr;
+}
+
+static void *lib_slab_realloc(void *ptr, size_t size)
+{
+    void *new_ptr;
+    size_t old_size;
+
+    if (ptr == NULL) {
+        return lib_slab_malloc(size);
+    }
+
+    if (!lib_slab_owns(ptr)) {
+        return realloc(ptr, size);
+    }
+
+    old_size = lib_slab_chunk_size(ptr);
+    if (size <= old_size && size > 0) {
+        return ptr;
+    }
+
+    new_ptr = lib_slab_malloc(size);
+    if (new_ptr != NULL) {
+        memcpy(new_ptr, ptr, size < old_size ? size : old_size);
+        lib_slab_free(ptr);
+    }
+    return new_ptr;
+}
+#endif
+
+/*----------------------------------------------------------------------------*/
+
+/* Scratch arena for temporary allocations that all die at the end of one
+   operation, like loading a snapshot.  lib_scratch_malloc() bumps a
+   pointer in a fixed buffer and lib_scratch_end() releases everything
+   at once.  Whatever doesn't fit is malloc'ed and freed with the rest.
+   Scopes nest, memory is only released when the outermost one ends.  */
+#define LIB_SCRATCH_SIZE    0x100000
+#define LIB_SCRATCH_ALIGN   16
+
+typedef struct lib_scratch_big_s {
+    struct lib_scratch_big_s *next;
+    /* keep the data aligned */
+    char pad[LIB_SCRATCH_ALIGN - sizeof(void *)];
+} lib_scratch_big_t;
+
+static char *lib_scratch_base = NULL;
+static size_t lib_scratch_used = 0;
+static size_t lib_scratch_big_used = 0;
+static size_t lib_scratch_high = 0;
+static int lib_scratch_depth = 0;
+static lib_scratch_big_t *lib_scratch_big = NULL;
+
+void lib_scratch_begin(void)
+{
+    lib_scratch_depth++;
+}
+
+void *lib_scratch_malloc(size_t size)
+{
+    void *ptr;
+
+    size = (size + LIB_SCRATCH_ALIGN - 1) & ~(size_t)(LIB_SCRATCH_ALIGN - 1);
+
+    if (lib_scratch_base == NULL) {
+        lib_scratch_base = malloc(LIB_SCRATCH_SIZE);
+    }
+
+    if (lib_scratch_base != NULL && size <= LIB_SCRATCH_SIZE - lib_scratch_used) {
+        ptr = lib_scratch_base + lib_scratch_used;
+        lib_scratch_used += size;
+    } else {
+        lib_scratch_big_t *big = malloc(sizeof(lib_scratch_big_t) + size);
+
+        if (big == NULL) {
+            fprintf(stderr, "error: lib_scratch_malloc failed\n");
+            archdep_vice_exit(-1);
+        }
+        big->next = lib_scratch_big;
+        lib_scratch_big = big;
+        lib_scratch_big_used += size;
+        ptr = big + 1;
+    }
+
+    if (lib_scratch_used + lib_scratch_big_used > lib_scratch_high) {
+        lib_scratch_high = lib_scratch_used + lib_scratch_big_used;
+    }
+
+    /* Without a scope the memory would never be released.  */
+    if (lib_scratch_depth == 0) {
+        fprintf(stderr, "warning: lib_scratch_malloc outside of a scratch scope\n");
+    }
+    return ptr;
+}
+
+void lib_scratch_end(void)
+{
+    if (lib_scratch_depth == 0 || --lib_scratch_depth > 0) {
+        return;
+    }
+
+    while (lib_scratch_big != NULL) {
+        lib_scratch_big_t *next = lib_scratch_big->next;
+        free(lib_scratch_big);
+        lib_scratch_big = next;
+    }
+    lib_scratch_used = 0;
+    lib_scratch_big_used = 0;
+}
+
+/* Allocator usage and high-water marks, one short line at a time.  */
+void lib_alloc_stats_dump(void (*print_line)(const char *line))
+{
+    char line[32];
+#ifdef LIB_SLAB
+    unsigned int in_use[LIB_SLAB_CLASSES];
+    unsigned int high[LIB_SLAB_CLASSES];
+    unsigned int pages[LIB_SLAB_CLASSES];
+    unsigned int pages_used;
+    unsigned long fallbacks;
+    int c;
+
+    /* Copy first, print_line may allocate.  */
+    lib_slab_lock();
+    memcpy(in_use, lib_slab_in_use, sizeof(in_use));
+    memcpy(high, lib_slab_high, sizeof(high));
+    memcpy(pages, lib_slab_pages, sizeof(pages));
+    pages_used = lib_slab_pages_used;
+    fallbacks = lib_slab_fallbacks;
+    lib_slab_unlock();
+
+    print_line("Slab  in use / max, pages");
+    for (c = 0; c < LIB_SLAB_CLASSES; c++) {
+        snprintf(line, sizeof(line), "%3uB %6u / %-6u %3u",
+                 1u << (LIB_SLAB_MIN_SHIFT + c), in_use[c], high[c], pages[c]);
+        print_line(line);
+    }
+    snprintf(line, sizeof(line), "Pool %u/%u pages",
+             pages_used, (unsigned int)LIB_SLAB_PAGES);
+    print_line(line);
+    snprintf(line, sizeof(line), "To malloc %lu", fallbacks);
+    print_line(line);
+#endif
+    snprintf(line, sizeof(line), "Scratch max %luK",
+             (unsigned long)(lib_scratch_high + 1023) / 1024);
+    print_line(line);
+}
+
 /*----------------------------------------------------------------------------*/
 /* like malloc, but abort on out of memory. */
 #ifdef LIB_DEBUG_PINPOINT
@@ -563,6 +871,8 @@ void *lib_malloc(size_t size)
 {
 #ifdef LIB_DEBUG
     void *ptr = lib_debug_libc_malloc(size);
+#elif defined(LIB_SLAB)
+    void *ptr = lib_slab_malloc(size);
 #else
     void *ptr = malloc(size);
 #endif
@@ -650,6 +960,8 @@ void *lib_calloc(size_t nmemb, size_t size)
 {
 #ifdef LIB_DEBUG
     void *ptr = lib_debug_libc_calloc(nmemb, size);
+#elif defined(LIB_SLAB)
+    void *ptr = lib_slab_calloc(nmemb, size);
 #else
     void *ptr = calloc(nmemb, size);
 #endif
@@ -675,6 +987,8 @@ void *lib_realloc(void *ptr, size_t size)
 {
 #ifdef LIB_DEBUG
     void *new_ptr = lib_debug_libc_realloc(ptr, size);
+#elif defined(LIB_SLAB)
+    void *new_ptr = lib_slab_realloc(ptr, size);
 #else
     void *new_ptr = realloc(ptr, size);
 #endif
@@ -706,6 +1020,8 @@ void lib_free(const void *constptr)
 
 #ifdef LIB_DEBUG
     lib_debug_libc_free(ptr);
+#elif defined(LIB_SLAB)
+    lib_slab_free(ptr);
 #else
     free(ptr);
 #endif
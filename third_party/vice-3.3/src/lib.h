@@ -50,6 +50,12 @@ extern char *lib_mvsprintf(const char *fmt, va_list args);
 
 extern void lib_debug_check(void);
 
+extern void lib_scratch_begin(void);
+extern void *lib_scratch_malloc(size_t size);
+extern void lib_scratch_end(void);
+
+extern void lib_alloc_stats_dump(void (*print_line)(const char *line));
+
 #if defined(__CYGWIN32__) || defined(__CYGWIN__) || defined(WIN32_COMPILE)
 
 extern size_t lib_tcstostr(char *str, const char *tcs, size_t len);
@@ -70,6 +70,13 @@
 #define DBG(x)
 #endif
 
+#ifdef RASPI_COMPILE
+extern void circle_boot_phase(const char *name);
+#define BOOT_PHASE(x) circle_boot_phase(x)
+#else
+#define BOOT_PHASE(x)
+#endif
+
 #ifdef __OS2__
 const
 #endif
@@ -153,6 +160,7 @@ int main_program(int argc, char **argv)
         archdep_startup_log_error("Cannot set defaults.\n");
         return -1;
     }
+    BOOT_PHASE("vice resources");
 
     /* Initialize the user interface.  `ui_init()' might need to handle the
        command line somehow, so we call it before parsing the options.
@@ -174,6 +182,7 @@ int main_program(int argc, char **argv)
             }
         }
     }
+    BOOT_PHASE("vice.ini loaded");
 
     if (log_init() < 0) {
         archdep_startup_log_error("Cannot startup logging system.\n");
@@ -255,6 +264,7 @@ int main_program(int argc, char **argv)
     if (init_main() < 0) {
         return -1;
     }
+    BOOT_PHASE("machine init");
 
     initcmdline_check_attach();
 
@@ -92,9 +92,22 @@ static void undump_pra(via_context_t *via_context, uint8_t byte)
     store_userport_pbx(byte);
 }
 
+#ifdef RASPI_COMPILE
+#include "userport_bridge.h"
+
+extern int raspi_userport_enabled;
+#endif
+
 static void store_pra(via_context_t *via_context, uint8_t byte, uint8_t myoldpa,
                       uint16_t addr)
 {
+#ifdef RASPI_COMPILE
+    if (raspi_userport_enabled) {
+        userport_bridge_write(*(via_context->clk_ptr),
+                              via_context->via[VIA_PRA_NHS],
+                              via_context->via[VIA_DDRA]);
+    }
+#endif
     store_userport_pbx(byte);
 }
 
@@ -194,14 +207,16 @@ static void reset(via_context_t *via_context)
     store_userport_pa2(1);
 }
 
-#ifdef RASPI_COMPILE
-extern int raspi_userport_enabled;
-#endif
-
 inline static uint8_t read_pra(via_context_t *via_context, uint16_t addr)
 {
 #ifdef RASPI_COMPILE
-  uint8_t byte = raspi_userport_enabled ? via_context->via[VIA_PRA_NHS] : 0xff;
+  uint8_t byte = 0xff;
+  if (raspi_userport_enabled) {
+      byte = userport_bridge_enabled()
+          ? userport_bridge_read(via_context->via[VIA_PRA_NHS],
+                                 via_context->via[VIA_DDRA])
+          : via_context->via[VIA_PRA_NHS];
+  }
 #else
   uint8_t byte = 0xff;
 #endif
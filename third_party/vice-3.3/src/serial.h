@@ -82,6 +82,7 @@ extern int serial_trap_attention(void);
 extern int serial_trap_send(void);
 extern int serial_trap_receive(void);
 extern int serial_trap_ready(void);
+extern int serial_trap_load_data(void);
 extern void serial_traps_reset(void);
 extern void serial_trap_eof_callback_set(void (*func)(void));
 extern void serial_trap_attention_callback_set(void (*func)(void));
@@ -28,14 +28,21 @@
 
 #include <stdio.h>
 
+#include "attach.h"
+#include "drive.h"
+#include "lib.h"
 #include "maincpu.h"
 #include "mem.h"
+#include "resources.h"
 #include "serial-iec-bus.h"
 /* Will be removed once serial.c is clean */
 #include "serial-iec-device.h"
 #include "serial-trap.h"
 #include "serial.h"
 #include "types.h"
+#include "vdrive.h"
+#include "vdrive-bam.h"
+#include "vdrive-iec.h"
 
 
 /* Warning: these are only valid for the VIC20, C64 and C128, but *not* for
@@ -67,6 +74,20 @@ static void (*attention_callback_func)(void);
 
 static unsigned int serial_truedrive;
 
+/* Resource: let the load data trap read files straight from the image
+   while true drive emulation is on.  */
+static int true_drive_fast_load;
+
+/* State of the last load data trap that fell back to the true drive.
+   The trap sits on the top of the Kernal byte loop, so it is hit once
+   per byte for the rest of that load.  */
+static int load_declined;
+static uint16_t load_declined_addr;
+static CLOCK load_declined_clk;
+
+/* Two hits further apart than this can't be the same byte loop.  */
+#define LOAD_DECLINED_MAX_CLK 200000
+
 #define IS_PRINTER(d)   (((d) & DEVNR_MASK) >= 4 && ((d) & DEVNR_MASK) <= 7)
 
 static void serial_set_st(uint8_t st)
@@ -236,10 +257,145 @@ int serial_trap_ready(void)
     return 1;
 }
 
+/* Kernal LOAD byte loop (C64 $F4F3), entered after the load address has
+   been received and "LOADING" printed.  With true drive emulation, read
+   the rest of the file through the virtual drive that shares the image
+   and leave the loop as if EOI had been seen.  The Kernal then sends
+   UNTALK and CLOSE to the emulated drive as usual.  Returns 0 to let the
+   true drive do the transfer.  */
+int serial_trap_load_data(void)
+{
+    vdrive_t *vdrive;
+    uint8_t name[17];
+    uint8_t *data;
+    unsigned int unit, length, i, size;
+    uint16_t addr, start, relocate, name_addr;
+    uint8_t lo, hi;
+    int status;
+
+    if (!serial_truedrive || !true_drive_fast_load) {
+        return 0;
+    }
+
+    addr = (uint16_t)(mem_read(0xae) | (mem_read(0xaf) << 8));
+
+    if (load_declined) {
+        if ((addr == load_declined_addr
+             || addr == (uint16_t)(load_declined_addr + 1))
+            && maincpu_clk - load_declined_clk < LOAD_DECLINED_MAX_CLK) {
+            load_declined_addr = addr;
+            load_declined_clk = maincpu_clk;
+            return 0;
+        }
+        load_declined = 0;
+    }
+
+    /* Assume we fall back until the file has been read.  */
+    load_declined = 1;
+    load_declined_addr = addr;
+    load_declined_clk = maincpu_clk;
+
+    unit = mem_read(0xba);
+    length = mem_read(0xb7);
+
+    /* Leave VERIFY to the drive.  */
+    if (mem_read(0x93) != 0 || unit < 8 || unit > 11
+        || length == 0 || length > 16) {
+        return 0;
+    }
+
+    vdrive = file_system_get_vdrive(unit);
+    if (vdrive == NULL || vdrive->image == NULL) {
+        return 0;
+    }
+
+    /* A pattern can match a different file on the virtual drive than
+       the one the true drive picked (e.g. LOAD"*" after a directory
+       load), so only take exact names.  */
+    name_addr = (uint16_t)(mem_read(0xbb) | (mem_read(0xbc) << 8));
+    for (i = 0; i < length; i++) {
+        name[i] = mem_read((uint16_t)(name_addr + i));
+        if (name[i] == '*' || name[i] == '?') {
+            return 0;
+        }
+    }
+    name[length] = 0;
+
+    /* The true drive may have written to the image since the virtual
+       drive last looked at it.  */
+    drive_gcr_data_writeback_all();
+    vdrive_bam_read_bam(vdrive);
+
+    if (vdrive_iec_open(vdrive, name, length, 0, NULL) != SERIAL_OK) {
+        return 0;
+    }
+
+    if (vdrive_iec_read(vdrive, &lo, 0) != SERIAL_OK
+        || vdrive_iec_read(vdrive, &hi, 0) != SERIAL_OK) {
+        vdrive_iec_close(vdrive, 0);
+        return 0;
+    }
+
+    /* The drive sent the same load address moments ago.  If the
+       virtual drive picked a different file, don't trust it.  */
+    start = (uint16_t)(lo | (hi << 8));
+    relocate = (uint16_t)(mem_read(0xc3) | (mem_read(0xc4) << 8));
+    if (addr != start && addr != relocate) {
+        vdrive_iec_close(vdrive, 0);
+        return 0;
+    }
+
+    /* Read everything before touching memory so a bad sector can
+       still fall back to the true drive.  */
+    data = lib_malloc(0x10000);
+    size = 0;
+    do {
+        status = vdrive_iec_read(vdrive, &data[size], 0);
+        if (status != SERIAL_OK && status != SERIAL_EOF) {
+            break;
+        }
+        size++;
+    } while (status == SERIAL_OK && size < 0x10000);
+    vdrive_iec_close(vdrive, 0);
+
+    if (status != SERIAL_EOF) {
+        lib_free(data);
+        return 0;
+    }
+
+    for (i = 0; i < size; i++) {
+        mem_store(addr++, data[i]);
+    }
+    lib_free(data);
+
+    mem_store(0xae, (uint8_t)(addr & 0xff));
+    mem_store(0xaf, (uint8_t)(addr >> 8));
+    mem_store(0x90, (uint8_t)((serial_get_st() & 0xfd) | 0x40));
+
+    load_declined = 0;
+    return 1;
+}
+
 /* Initializing the IEC bus and IEC device will move once serial.c is not
    referenced by PET and CBM2 anymore. */
+static int set_true_drive_fast_load(int val, void *param)
+{
+    true_drive_fast_load = val ? 1 : 0;
+    load_declined = 0;
+    return 0;
+}
+
+static const resource_int_t resources_int[] = {
+    { "TrueDriveFastLoad", 0, RES_EVENT_NO, NULL,
+      &true_drive_fast_load, set_true_drive_fast_load, NULL },
+    RESOURCE_INT_LIST_END
+};
+
 int serial_resources_init(void)
 {
+    if (resources_register_int(resources_int) < 0) {
+        return -1;
+    }
     return serial_iec_device_resources_init();
 }
 
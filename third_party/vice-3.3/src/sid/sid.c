@@ -480,9 +480,7 @@ int sid_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, i
         tmp_buf1 = getbuf1(2 * nr);
         tmp_nr = sid_engine.calculate_samples(psid[0], tmp_buf1, nr, 1, &tmp_delta_t);
         tmp_nr = sid_engine.calculate_samples(psid[1], pbuf, nr, 1, delta_t);
-        for (i = 0; i < tmp_nr; i++) {
-            pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf1[i]);
-        }
+        sound_audio_mix_buffer(pbuf, tmp_buf1, tmp_nr, 1);
         return tmp_nr;
     }
     if (soc == 1 && scc == 3) {
@@ -492,10 +490,8 @@ int sid_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, i
         tmp_delta_t = *delta_t;
         tmp_nr = sid_engine.calculate_samples(psid[2], tmp_buf2, nr, 1, &tmp_delta_t);
         tmp_nr = sid_engine.calculate_samples(psid[1], pbuf, nr, 1, delta_t);
-        for (i = 0; i < tmp_nr; i++) {
-            pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf1[i]);
-            pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf2[i]);
-        }
+        sound_audio_mix_buffer(pbuf, tmp_buf1, tmp_nr, 1);
+        sound_audio_mix_buffer(pbuf, tmp_buf2, tmp_nr, 1);
         return tmp_nr;
     }
     if (soc == 1 && scc == 4) {
@@ -508,11 +504,9 @@ int sid_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, i
         tmp_delta_t = *delta_t;
         tmp_nr = sid_engine.calculate_samples(psid[3], tmp_buf3, nr, 1, &tmp_delta_t);
         tmp_nr = sid_engine.calculate_samples(psid[1], pbuf, nr, 1, delta_t);
-        for (i = 0; i < tmp_nr; i++) {
-            pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf1[i]);
-            pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf2[i]);
-            pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf3[i]);
-        }
+        sound_audio_mix_buffer(pbuf, tmp_buf1, tmp_nr, 1);
+        sound_audio_mix_buffer(pbuf, tmp_buf2, tmp_nr, 1);
+        sound_audio_mix_buffer(pbuf, tmp_buf3, tmp_nr, 1);
         return tmp_nr;
     }
     if (soc == 2 && scc == 1) {
@@ -549,10 +543,7 @@ int sid_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, i
         tmp_delta_t = *delta_t;
         tmp_nr = sid_engine.calculate_samples(psid[0], pbuf, nr, 2, &tmp_delta_t);
         tmp_nr = sid_engine.calculate_samples(psid[1], pbuf + 1, nr, 2, delta_t);
-        for (i = 0; i < tmp_nr; i++) {
-            pbuf[i * 2] = sound_audio_mix(pbuf[i * 2], tmp_buf1[i]);
-            pbuf[(i * 2) + 1] = sound_audio_mix(pbuf[(i * 2) + 1], tmp_buf1[i]);
-        }
+        sound_audio_mix_buffer(pbuf, tmp_buf1, tmp_nr, 2);
     }
     if (soc == 2 && scc == 4) {
         tmp_buf1 = getbuf1(2 * nr);
@@ -562,10 +553,8 @@ int sid_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, i
         tmp_delta_t = *delta_t;
         tmp_nr = sid_engine.calculate_samples(psid[0], pbuf, nr, 2, &tmp_delta_t);
         tmp_nr = sid_engine.calculate_samples(psid[1], pbuf + 1, nr, 2, delta_t);
-        for (i = 0; i < tmp_nr; i++) {
-            pbuf[i * 2] = sound_audio_mix(pbuf[i * 2], tmp_buf1[i * 2]);
-            pbuf[(i * 2) + 1] = sound_audio_mix(pbuf[(i * 2) + 1], tmp_buf1[(i * 2) + 1]);
-        }
+        /* Both buffers are interleaved stereo, mix them as one long lane. */
+        sound_audio_mix_buffer(pbuf, tmp_buf1, tmp_nr * 2, 1);
     }
     return tmp_nr;
 }
@@ -810,6 +810,10 @@ snapshot_t *snapshot_open(const char *filename, uint8_t *major_version_return, u
     s->first_module_offset = ftell(f);
     s->write_mode = 0;
 
+    /* Temporary buffers of the modules being read are released in one go
+       when the snapshot is closed.  */
+    lib_scratch_begin();
+
     vsync_suspend_speed_eval();
     return s;
 
@@ -829,6 +833,7 @@ int snapshot_close(snapshot_t *s)
         } else {
             retval = 0;
         }
+        lib_scratch_end();
     } else {
         if (fclose(s->file) == EOF) {
             snapshot_error = SNAPSHOT_WRITE_CLOSE_EOF_ERROR;
@@ -40,6 +40,14 @@
 #include <strings.h>
 #endif
 
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SOUND_MIX_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SOUND_MIX_SSE2
+#endif
+
 #include "archdep.h"
 #include "clkguard.h"
 #include "cmdline.h"
@@ -1680,6 +1688,89 @@ void sound_dac_init(sound_dac_t *dac, int speed)
     dac->output = 0.0;
 }
 
+/* ------------------------------------------------------------------------- */
+
+/* Vector versions of sound_audio_mix(). They give exactly the same result:
+   with both inputs of the same sign, a + b - a * b / 32768 never leaves the
+   16 bit range and with opposite signs a + b can't overflow, so everything
+   can be done in wrapping 16 bit lanes. Only the correction term needs the
+   full 32 bit product. */
+
+#if defined(SOUND_MIX_NEON)
+static inline int16x8_t sound_audio_mix_vec(int16x8_t a, int16x8_t b)
+{
+    int16x8_t zero = vdupq_n_s16(0);
+    int32x4_t p_lo = vmull_s16(vget_low_s16(a), vget_low_s16(b));
+    int32x4_t p_hi = vmull_s16(vget_high_s16(a), vget_high_s16(b));
+    int16x8_t corr = vcombine_s16(vshrn_n_s32(p_lo, 15), vshrn_n_s32(p_hi, 15));
+    uint16x8_t pos = vandq_u16(vcgtq_s16(a, zero), vcgtq_s16(b, zero));
+    uint16x8_t neg = vandq_u16(vcltq_s16(a, zero), vcltq_s16(b, zero));
+    int16x8_t sum = vaddq_s16(a, b);
+
+    sum = vsubq_s16(sum, vandq_s16(corr, vreinterpretq_s16_u16(pos)));
+    return vaddq_s16(sum, vandq_s16(corr, vreinterpretq_s16_u16(neg)));
+}
+#elif defined(SOUND_MIX_SSE2)
+static inline __m128i sound_audio_mix_vec(__m128i a, __m128i b)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i lo = _mm_mullo_epi16(a, b);
+    __m128i hi = _mm_mulhi_epi16(a, b);
+    __m128i corr = _mm_or_si128(_mm_slli_epi16(hi, 1), _mm_srli_epi16(lo, 15));
+    __m128i pos = _mm_and_si128(_mm_cmpgt_epi16(a, zero), _mm_cmpgt_epi16(b, zero));
+    __m128i neg = _mm_and_si128(_mm_cmplt_epi16(a, zero), _mm_cmplt_epi16(b, zero));
+    __m128i sum = _mm_add_epi16(a, b);
+
+    sum = _mm_sub_epi16(sum, _mm_and_si128(corr, pos));
+    return _mm_add_epi16(sum, _mm_and_si128(corr, neg));
+}
+#endif
+
+/* Mix nr mono samples from src into pbuf, which holds nr frames of soc
+   channels. The sample goes to the first two channels, like the per sample
+   loops of the chips did. */
+void sound_audio_mix_buffer(int16_t *pbuf, const int16_t *src, int nr, int soc)
+{
+    int i = 0;
+
+#if defined(SOUND_MIX_NEON)
+    if (soc == 1) {
+        for (; i + 8 <= nr; i += 8) {
+            vst1q_s16(pbuf + i, sound_audio_mix_vec(vld1q_s16(pbuf + i), vld1q_s16(src + i)));
+        }
+    } else if (soc == 2) {
+        for (; i + 8 <= nr; i += 8) {
+            int16x8x2_t frames = vld2q_s16(pbuf + i * 2);
+            int16x8_t s = vld1q_s16(src + i);
+            frames.val[0] = sound_audio_mix_vec(frames.val[0], s);
+            frames.val[1] = sound_audio_mix_vec(frames.val[1], s);
+            vst2q_s16(pbuf + i * 2, frames);
+        }
+    }
+#elif defined(SOUND_MIX_SSE2)
+    if (soc == 1) {
+        for (; i + 8 <= nr; i += 8) {
+            __m128i d = _mm_loadu_si128((const __m128i *)(pbuf + i));
+            __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+            _mm_storeu_si128((__m128i *)(pbuf + i), sound_audio_mix_vec(d, s));
+        }
+    } else if (soc == 2) {
+        for (; i + 4 <= nr; i += 4) {
+            __m128i d = _mm_loadu_si128((const __m128i *)(pbuf + i * 2));
+            __m128i s = _mm_loadl_epi64((const __m128i *)(src + i));
+            _mm_storeu_si128((__m128i *)(pbuf + i * 2), sound_audio_mix_vec(d, _mm_unpacklo_epi16(s, s)));
+        }
+    }
+#endif
+
+    for (; i < nr; i++) {
+        pbuf[i * soc] = sound_audio_mix(pbuf[i * soc], src[i]);
+        if (soc > 1) {
+            pbuf[(i * soc) + 1] = sound_audio_mix(pbuf[(i * soc) + 1], src[i]);
+        }
+    }
+}
+
 /* FIXME: this should use bandlimited step synthesis. Sadly, VICE does not
  * have an easy-to-use infrastructure for blep generation. We should write
  * this code. */
@@ -248,6 +248,10 @@ typedef struct sound_chip_s {
 
 extern uint16_t sound_chip_register(sound_chip_t *chip);
 
+/* Same as calling sound_audio_mix() for every sample, but vectorized where
+   the cpu allows. src is mono, pbuf has soc channels per frame. */
+extern void sound_audio_mix_buffer(int16_t *pbuf, const int16_t *src, int nr, int soc);
+
 typedef struct sound_dac_s {
     float output;
     float alpha;
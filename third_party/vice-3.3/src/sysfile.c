@@ -55,6 +55,21 @@ static char *default_path = NULL;
 static char *system_path = NULL;
 static char *expanded_system_path = NULL;
 
+/* FNV-1a over the names and contents of all system files loaded so far.
+   BMC64 uses it to tell whether a saved machine state was made with the
+   same ROMs. */
+static uint32_t loaded_checksum = 2166136261u;
+
+static void update_loaded_checksum(const uint8_t *buf, size_t len)
+{
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        loaded_checksum ^= buf[i];
+        loaded_checksum *= 16777619u;
+    }
+}
+
 static int set_system_path(const char *val, void *param)
 {
     char *tmp_path, *tmp_path_save, *p, *s, *current_dir;
@@ -213,6 +228,11 @@ int sysfile_locate(const char *name, char **complete_path_return)
 
 /* ------------------------------------------------------------------------- */
 
+uint32_t sysfile_loaded_checksum(void)
+{
+    return loaded_checksum;
+}
+
 /*
  * If minsize >= 0, and the file is smaller than maxsize, load the data
  * into the end of the memory range.
@@ -295,6 +315,9 @@ int sysfile_load(const char *name, uint8_t *dest, int minsize, int maxsize)
         goto fail;
     }
 
+    update_loaded_checksum((const uint8_t *)name, strlen(name) + 1);
+    update_loaded_checksum(dest, rsize);
+
     fclose(fp);
     lib_free(complete_path);
     return (int)rsize;  /* return ok */
@@ -39,5 +39,6 @@ extern int sysfile_cmdline_options_init(void);
 extern FILE *sysfile_open(const char *name, char **complete_path_return, const char *open_mode);
 extern int sysfile_locate(const char *name, char **complete_path_return);
 extern int sysfile_load(const char *name, uint8_t *dest, int minsize, int maxsize);
+extern uint32_t sysfile_loaded_checksum(void);
 
 #endif
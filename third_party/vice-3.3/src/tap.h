@@ -38,6 +38,14 @@
 #define TAP_HDR_SYSTEM       13
 #define TAP_HDR_LEN          16
 
+/* Size of a standard CBM tape header block, without the checksum.  */
+#define TAP_CBM_HEADER_SIZE  192
+
+#define TAP_PULSE_TYPE_OTHER  0
+#define TAP_PULSE_TYPE_SHORT  1
+#define TAP_PULSE_TYPE_MIDDLE 2
+#define TAP_PULSE_TYPE_LONG   3
+
 
 struct tape_init_s;
 struct tape_file_record_s;
@@ -110,4 +118,8 @@ extern struct tape_file_record_s *tap_get_current_file_record(tap_t *tap);
 
 extern int tap_read(tap_t *tap, uint8_t *buf, size_t size);
 
+extern int tap_pulse_type(int pulse);
+extern int tap_cbm_read_block_at(tap_t *tap, int position, int limit,
+                                 uint8_t *buffer, int size);
+
 #endif
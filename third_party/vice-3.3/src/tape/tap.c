@@ -1498,6 +1498,79 @@ void tap_get_header(tap_t *tap, uint8_t *name)
 }
 
 
+/* ------------------------------------------------------------------------- */
+
+/* Classify a pulse (in cycles/8) against the standard CBM encoding.  */
+int tap_pulse_type(int pulse)
+{
+    if (TAP_PULSE_SHORT(pulse)) {
+        return TAP_PULSE_TYPE_SHORT;
+    } else if (TAP_PULSE_MIDDLE(pulse)) {
+        return TAP_PULSE_TYPE_MIDDLE;
+    } else if (TAP_PULSE_LONG(pulse)) {
+        return TAP_PULSE_TYPE_LONG;
+    }
+    return TAP_PULSE_TYPE_OTHER;
+}
+
+/* Decode the standard CBM block whose pilot starts at or after `position'
+   (relative to the start of the pulse data) but before `limit'.  `buffer'
+   must hold `size' + 1 bytes, the last one being the checksum.  The
+   repeat of the block is skipped as well.  Returns the position right
+   after the block, or -1 if there is no readable block.  */
+int tap_cbm_read_block_at(tap_t *tap, int position, int limit,
+                          uint8_t *buffer, int size)
+{
+    int pass, rsize, pos_advance, error_count, error_buf[MAX_ERRORS];
+    uint8_t *repeat;
+    long fpos;
+
+    if (machine_tape_behaviour() != TAPE_BEHAVIOUR_NORMAL) {
+        return -1;
+    }
+
+    if (fseek(tap->fd, tap->offset + position, SEEK_SET) != 0) {
+        return -1;
+    }
+
+    while (1) {
+        if (tap_find_pilot(tap, PILOT_TYPE_CBM) < 0) {
+            return -1;
+        }
+        fpos = ftell(tap->fd);
+        if (fpos - tap->offset >= limit) {
+            return -1;
+        }
+
+        if (tap_cbm_read_block(tap, buffer, size + 1) >= 0) {
+            break;
+        }
+
+        /* Probably the trailer of the previous block.  Try the next run
+           of short pulses.  */
+        fseek(tap->fd, fpos, SEEK_SET);
+        while (TAP_PULSE_SHORT(tap_get_pulse(tap, &pos_advance))) {
+        }
+    }
+
+    /* If the first copy was read, we're at the sync of the repeat now.
+       Consume it, but only if the countdown says it really is one.  */
+    fpos = ftell(tap->fd);
+    repeat = lib_malloc(size + 1);
+    pass = 2;
+    rsize = size + 1;
+    error_count = 0;
+    error_buf[0] = -1;
+    if (tap_cbm_read_block_once(tap, &pass, repeat, &rsize, error_buf,
+                                &error_count) < 0 || pass != 2) {
+        fseek(tap->fd, fpos, SEEK_SET);
+    }
+    lib_free(repeat);
+
+    return (int)(ftell(tap->fd) - tap->offset);
+}
+
+
 void tap_init(const tape_init_t *init)
 {
     tap_pulse_short_min = init->pulse_short_min / 8;
@@ -165,7 +165,7 @@ static int tape_snapshot_read_tapimage_module(snapshot_t *s)
 
     SMR_DW_UL(m, (unsigned long *)&tap_size);
 
-    buffer = lib_malloc(tap_size);
+    buffer = lib_scratch_malloc(tap_size);
 
     SMR_BA(m, buffer, tap_size);
 
@@ -177,7 +177,6 @@ static int tape_snapshot_read_tapimage_module(snapshot_t *s)
         goto fail;
     }
 
-    lib_free(buffer);
     fclose(ftap);
     tape_image_attach(1, filename);
     lib_free(filename);
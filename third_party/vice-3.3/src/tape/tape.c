@@ -76,6 +76,13 @@ static int tape_is_initialized = 0;
 /* Tape traps to be installed.  */
 static const trap_t *tape_traps;
 
+/* Are the traps in `tape_traps' currently installed?  */
+static int tape_traps_installed = 0;
+
+/* Where the data block belonging to the last header the traps read from a
+   TAP image starts, -1 if there is none.  */
+static int tap_data_position = -1;
+
 /* Logging goes here.  */
 static log_t tape_log = LOG_ERR;
 
@@ -95,10 +102,11 @@ void tape_traps_install(void)
 {
     const trap_t *p;
 
-    if (tape_traps != NULL) {
+    if (tape_traps != NULL && !tape_traps_installed) {
         for (p = tape_traps; p->func != NULL; p++) {
             traps_add(p);
         }
+        tape_traps_installed = 1;
     }
 }
 
@@ -106,10 +114,27 @@ void tape_traps_deinstall(void)
 {
     const trap_t *p;
 
-    if (tape_traps != NULL) {
+    if (tape_traps != NULL && tape_traps_installed) {
         for (p = tape_traps; p->func != NULL; p++) {
             traps_remove(p);
         }
+        tape_traps_installed = 0;
+    }
+}
+
+/* With a TAP image attached the traps are only wanted if the datasette
+   lets them read standard blocks from the image.  Otherwise they would
+   just get in the way of loaders that look at the Kernal.  */
+void tape_traps_refresh(void)
+{
+    if (!tape_is_initialized) {
+        return;
+    }
+
+    if (tape_tap_attached() && !datasette_get_fast_load()) {
+        tape_traps_deinstall();
+    } else {
+        tape_traps_install();
     }
 }
 
@@ -201,6 +226,93 @@ int tape_deinstall(void)
    install its own ones, by passing an appropriate `trap_list' to
    `tape_init()'.  */
 
+/* End of the standard block at or after `position' according to the
+   datasette's block map, -1 if a turbo block or the end of the tape
+   comes first.  */
+static int tap_cbm_block_limit(int position)
+{
+    int start, end;
+
+    if (datasette_block_at(position, &start, &end) != DATASETTE_BLOCK_CBM) {
+        return -1;
+    }
+    return end;
+}
+
+/* Read the next header block of the TAP image into the tape buffer and
+   wind the tape past it.  Returns -1 if the tape isn't at a standard
+   header, the Kernal then reads the pulses itself.  */
+static int tap_find_header(uint8_t *cassette_buffer)
+{
+    tap_t *tap = (tap_t *)tape_image_dev1->data;
+    uint8_t header[TAP_CBM_HEADER_SIZE + 1];
+    int position, limit, end;
+
+    tap_data_position = -1;
+
+    position = tap->current_file_seek_position;
+    limit = tap_cbm_block_limit(position);
+    if (limit < 0) {
+        return -1;
+    }
+
+    end = tap_cbm_read_block_at(tap, position, limit, header, TAP_CBM_HEADER_SIZE);
+    if (end < 0) {
+        return -1;
+    }
+
+    switch (header[0]) {
+        case TAPE_CAS_TYPE_BAS:
+        case TAPE_CAS_TYPE_PRG:
+        case TAPE_CAS_TYPE_DATA:
+        case TAPE_CAS_TYPE_EOF:
+            break;
+        default:
+            return -1;
+    }
+
+    /* The whole block, loaders like to hide code in the rest of it.  */
+    memcpy(cassette_buffer, header, TAP_CBM_HEADER_SIZE);
+    datasette_skip_to(end);
+    tap_data_position = end;
+
+    return 0;
+}
+
+/* Read the data block following the last header into memory and wind
+   the tape past it.  Returns -1 if the Kernal has to read the pulses.  */
+static int tap_receive(uint16_t start, uint16_t end)
+{
+    tap_t *tap = (tap_t *)tape_image_dev1->data;
+    uint8_t *data;
+    int position, limit, len, block_end;
+
+    position = tap_data_position;
+    tap_data_position = -1;
+
+    /* The tape must not have moved since the header.  */
+    if (position < 0 || position != tap->current_file_seek_position
+        || mem_read(verify_flag_addr)) {
+        return -1;
+    }
+
+    limit = tap_cbm_block_limit(position);
+    len = (int)end - (int)start;
+    if (limit < 0 || len <= 0) {
+        return -1;
+    }
+
+    data = lib_malloc(len + 1);
+    block_end = tap_cbm_read_block_at(tap, position, limit, data, len);
+    if (block_end >= 0) {
+        memcpy(mem_ram + start, data, len);
+        datasette_skip_to(block_end);
+    }
+    lib_free(data);
+
+    return block_end < 0 ? -1 : 0;
+}
+
 /* Find the next Tape Header and load it onto the Tape Buffer.  */
 int tape_find_header_trap(void)
 {
@@ -209,7 +321,13 @@ int tape_find_header_trap(void)
 
     cassette_buffer = mem_ram + (mem_read(buffer_pointer_addr) | (mem_read((uint16_t)(buffer_pointer_addr + 1)) << 8));
 
-    if (tape_image_dev1->name == NULL
+    if (tape_image_dev1->name != NULL
+        && tape_image_dev1->type == TAPE_TYPE_TAP) {
+        if (tap_find_header(cassette_buffer) < 0) {
+            return 0;
+        }
+        err = 0;
+    } else if (tape_image_dev1->name == NULL
         || tape_image_dev1->type != TAPE_TYPE_T64) {
         err = 1;
     } else {
@@ -274,6 +392,12 @@ int tape_find_header_trap_plus4(void)
     int err;
     uint8_t *cassette_buffer;
 
+    /* Standard blocks are only read from TAP images for the other
+       machines.  */
+    if (tape_tap_attached()) {
+        return 0;
+    }
+
     cassette_buffer = mem_ram + buffer_pointer_addr;
 
     if (tape_image_dev1->name == NULL
@@ -353,28 +477,36 @@ int tape_receive_trap(void)
     start = (mem_read(stal_addr) | (mem_read((uint16_t)(stal_addr + 1)) << 8));
     end = (mem_read(eal_addr) | (mem_read((uint16_t)(eal_addr + 1)) << 8));
 
-    switch (maincpu_get_x()) {
-        case 0x0e:
-            {
-                int amount;
-
-                len = (int)(end - start);
-                amount = t64_read((t64_t *)tape_image_dev1->data, mem_ram + (int)start, len);
-                if (amount == len) {
-                    st = 0x40;  /* EOF */
-                } else {
-                    st = 0x10;
-
-                    log_warning(tape_log,
-                                "Unexpected end of tape: file may be truncated.");
+    if (tape_image_dev1->type == TAPE_TYPE_TAP) {
+        /* Writes and anything non standard go through the datasette.  */
+        if (maincpu_get_x() != 0x0e || tap_receive(start, end) < 0) {
+            return 0;
+        }
+        st = 0x40;      /* EOF */
+    } else {
+        switch (maincpu_get_x()) {
+            case 0x0e:
+                {
+                    int amount;
+
+                    len = (int)(end - start);
+                    amount = t64_read((t64_t *)tape_image_dev1->data, mem_ram + (int)start, len);
+                    if (amount == len) {
+                        st = 0x40;  /* EOF */
+                    } else {
+                        st = 0x10;
+
+                        log_warning(tape_log,
+                                    "Unexpected end of tape: file may be truncated.");
+                    }
                 }
-            }
-            break;
-        default:
-            log_error(tape_log, "Kernal command %x not supported.",
-                      maincpu_get_x());
-            st = 0x40;
-            break;
+                break;
+            default:
+                log_error(tape_log, "Kernal command %x not supported.",
+                          maincpu_get_x());
+                st = 0x40;
+                break;
+        }
     }
 
     /* Set registers and flags like the Kernal routine does.  */
@@ -396,6 +528,10 @@ int tape_receive_trap_plus4(void)
     uint16_t start, end, len;
     uint8_t st;
 
+    if (tape_tap_attached()) {
+        return 0;
+    }
+
     start = (mem_read(stal_addr) | (mem_read((uint16_t)(stal_addr + 1)) << 8));
     end = (mem_read(eal_addr) | (mem_read((uint16_t)(eal_addr + 1)) << 8));
 
@@ -548,7 +684,8 @@ static int tape_image_attach_internal(unsigned int unit, const char *name)
             log_message(tape_log, "TAP image version: %i, system: %i.",
                         ((tap_t *)tape_image_dev1->data)->version,
                         ((tap_t *)tape_image_dev1->data)->system);
-            tape_traps_deinstall();
+            tap_data_position = -1;
+            tape_traps_refresh();
             break;
         default:
             log_error(tape_log, "Unknown tape type %i.",
@@ -146,9 +146,22 @@ static void undump_prb(via_context_t *via_context, uint8_t byte)
     store_userport_pbx(byte);
 }
 
+#ifdef RASPI_COMPILE
+#include "userport_bridge.h"
+
+extern int raspi_userport_enabled;
+#endif
+
 static void store_prb(via_context_t *via_context, uint8_t byte, uint8_t myoldpb,
                       uint16_t addr)
 {
+#ifdef RASPI_COMPILE
+    if (raspi_userport_enabled) {
+        userport_bridge_write(*(via_context->clk_ptr), via_context->via[VIA_PRB],
+                              via_context->via[VIA_DDRB]);
+    }
+#endif
+
     /* for mike's VFLI hack, PB0-PB3 are used as A10-A13 of the color ram */
     vic20_vflihack_userport = byte & 0x0f;
 
@@ -250,15 +263,18 @@ inline static uint8_t read_pra(via_context_t *via_context, uint16_t addr)
     return byte;
 }
 
-#ifdef RASPI_COMPILE
-extern int raspi_userport_enabled;
-#endif
-
 inline static uint8_t read_prb(via_context_t *via_context)
 {
     uint8_t byte = 0xff;
 #ifdef RASPI_COMPILE
-    byte = raspi_userport_enabled ? via_context->via[VIA_PRB] : (via_context->via[VIA_PRB] | ~(via_context->via[VIA_DDRB]));
+    if (!raspi_userport_enabled) {
+        byte = via_context->via[VIA_PRB] | ~(via_context->via[VIA_DDRB]);
+    } else if (userport_bridge_enabled()) {
+        byte = userport_bridge_read(via_context->via[VIA_PRB],
+                                    via_context->via[VIA_DDRB]);
+    } else {
+        byte = via_context->via[VIA_PRB];
+    }
 #else
     byte = via_context->via[VIA_PRB] | ~(via_context->via[VIA_DDRB]);
 #endif
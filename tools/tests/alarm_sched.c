@@ -0,0 +1,141 @@
+/*
+ * alarm_sched.c
+ *
+ * VICE's alarm.c and the workloads alarm_test runs on it. The Makefile
+ * builds this twice, with ALARM_USE_HEAP off and on, and SCHED gives
+ * each build's functions their own names so both can be linked into
+ * one program.
+ */
+#define SCHED_CAT(name, suffix) name##_##suffix
+#define SCHED_NAME(name, suffix) SCHED_CAT(name, suffix)
+#define SCHED(name) SCHED_NAME(name, SCHED_SUFFIX)
+
+#define alarm_context_new SCHED(alarm_context_new)
+#define alarm_context_init SCHED(alarm_context_init)
+#define alarm_context_destroy SCHED(alarm_context_destroy)
+#define alarm_context_time_warp SCHED(alarm_context_time_warp)
+#define alarm_context_rebuild_heap SCHED(alarm_context_rebuild_heap)
+#define alarm_new SCHED(alarm_new)
+#define alarm_destroy SCHED(alarm_destroy)
+#define alarm_unset SCHED(alarm_unset)
+#define alarm_log_too_many_alarms SCHED(alarm_log_too_many_alarms)
+
+#include "alarm.c"
+#include "check.h"
+
+#define MAX_ALARMS ALARM_CONTEXT_MAX_PENDING_ALARMS
+
+static alarm_context_t *context;
+static alarm_t *alarms[MAX_ALARMS];
+static int num_alarms;
+static CLOCK clk;
+static unsigned trace;
+
+static void set_random(int spread) {
+  alarm_set(alarms[rnd() % num_alarms], clk + rnd() % spread);
+}
+
+static void unset_random(void) {
+  alarm_unset(alarms[rnd() % num_alarms]);
+}
+
+// Re-arms itself, usually to a clock other alarms share, or goes away.
+// Sometimes moves another alarm too, from inside the dispatch.
+static void trace_callback(CLOCK offset, void *data) {
+  int id = (int)(long)data;
+
+  trace = trace * 31 + id;
+  trace = trace * 31 + (unsigned)offset;
+  trace = trace * 31 + (unsigned)clk;
+
+  if (rnd() % 8) {
+    alarm_set(alarms[id], clk + 1 + rnd() % 4);
+  } else {
+    alarm_unset(alarms[id]);
+  }
+  switch (rnd() % 8) {
+    case 0:
+      set_random(4);
+      break;
+    case 1:
+      unset_random();
+      break;
+  }
+}
+
+static void run(int steps) {
+  int i;
+
+  for (i = 0; i < steps; i++) {
+    clk += rnd() % 4;
+    while (clk >= alarm_context_next_pending_clk(context)) {
+      alarm_context_dispatch(context, clk);
+    }
+    switch (rnd() % 16) {
+      case 0:
+      case 1:
+      case 2:
+        set_random(8);
+        break;
+      case 3:
+        unset_random();
+        break;
+      case 4:
+        // What a machine reset or a snapshot does to the main clock.
+        if (rnd() % 64 == 0) {
+          alarm_context_time_warp(context, 1000, -1);
+          clk -= 1000;
+        }
+        break;
+    }
+  }
+}
+
+static void setup(int count, alarm_callback_t callback) {
+  int i;
+
+  context = alarm_context_new("test");
+  num_alarms = count;
+  for (i = 0; i < count; i++) {
+    alarms[i] = alarm_new(context, "test", callback, (void *)(long)i);
+  }
+  clk = 1000000;
+}
+
+// Hash of every dispatch a random workload on count alarms makes: which
+// alarm, at what clock and how late.
+unsigned SCHED(alarm_trace)(unsigned seed, int count) {
+  rng_state = seed;
+  trace = 0;
+  setup(count, trace_callback);
+  run(200000);
+  alarm_context_destroy(context);
+  return trace;
+}
+
+// Every alarm stays pending and re-arms itself somewhere in the next
+// few hundred cycles, like the chip alarms of a busy machine.
+static void bench_callback(CLOCK offset, void *data) {
+  alarm_set(alarms[(int)(long)data], clk + 1 + rnd() % 256);
+}
+
+// Nanoseconds per dispatch, with count alarms pending.
+double SCHED(alarm_bench)(int count) {
+  const int dispatches = 2000000;
+  double start_time;
+  int i;
+
+  rng_state = 12345;
+  setup(count, bench_callback);
+  for (i = 0; i < count; i++) {
+    alarm_set(alarms[i], clk + 1 + rnd() % 256);
+  }
+  start_time = seconds();
+  for (i = 0; i < dispatches; i++) {
+    clk = alarm_context_next_pending_clk(context);
+    alarm_context_dispatch(context, clk);
+  }
+  start_time = (seconds() - start_time) * 1e9 / dispatches;
+  alarm_context_destroy(context);
+  return start_time;
+}
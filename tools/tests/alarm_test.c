@@ -0,0 +1,44 @@
+/*
+ * alarm_test.c
+ *
+ * Checks that VICE's alarm scheduler dispatches the same alarms in the
+ * same order with ALARM_USE_HEAP on as with the linear scan, and times
+ * a dispatch both ways. alarm_sched.c is built once for each.
+ */
+#include "check.h"
+
+#include <stdio.h>
+
+unsigned alarm_trace_list(unsigned seed, int count);
+unsigned alarm_trace_heap(unsigned seed, int count);
+double alarm_bench_list(int count);
+double alarm_bench_heap(int count);
+
+static void test_traces(void) {
+  static const int counts[] = { 1, 2, 4, 16, 64, 250 };
+  unsigned i, seed;
+
+  for (i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+    for (seed = 1; seed <= 4; seed++) {
+      CHECK(alarm_trace_list(seed, counts[i]) ==
+            alarm_trace_heap(seed, counts[i]));
+    }
+  }
+}
+
+static void bench(void) {
+  static const int counts[] = { 4, 16, 32, 64, 128 };
+  unsigned i;
+
+  for (i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+    printf("alarm_test: %3d pending, %.0f ns linear, %.0f ns heap\n",
+           counts[i], alarm_bench_list(counts[i]),
+           alarm_bench_heap(counts[i]));
+  }
+}
+
+int main(void) {
+  test_traces();
+  bench();
+  return check_report("alarm_test");
+}
@@ -0,0 +1,50 @@
+/*
+ * check.h
+ *
+ * Shared by the host tests. CHECK counts a failure and carries on, so
+ * one run shows every check that is off. check_report prints the
+ * result line and gives main its exit status. rnd gives the same
+ * sequence on every run, so a failure can be replayed. seconds is a
+ * wall clock for the timings some tests print.
+ */
+#ifndef TOOLS_TESTS_CHECK_H
+#define TOOLS_TESTS_CHECK_H
+
+#include <stdio.h>
+#include <time.h>
+
+static int failures;
+
+#define CHECK(cond)                                                      \
+  do {                                                                   \
+    if (!(cond)) {                                                       \
+      printf("%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond);     \
+      failures++;                                                        \
+    }                                                                    \
+  } while (0)
+
+static inline int check_report(const char *name) {
+  if (failures) {
+    printf("%s: %d failures\n", name, failures);
+    return 1;
+  }
+  printf("%s: ok\n", name);
+  return 0;
+}
+
+static unsigned rng_state = 12345;
+
+static inline unsigned rnd(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+static inline double seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+#endif
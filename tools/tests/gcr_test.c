@@ -0,0 +1,165 @@
+/*
+ * gcr_test.c
+ *
+ * Checks VICE's table driven GCR conversion against a plain bit by bit
+ * encoder and decoder built from the 1541 nybble codes, and whole track
+ * conversion against converting one sector at a time. gcr.c is built
+ * into the test.
+ */
+#include "gcr.c"
+#include "check.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const uint8_t nybble_to_gcr[16] = {
+  0x0a, 0x0b, 0x12, 0x13, 0x0e, 0x0f, 0x16, 0x17,
+  0x09, 0x19, 0x1a, 0x1b, 0x0d, 0x1d, 0x1e, 0x15
+};
+
+// 4 bytes to 8 five bit groups, most significant bit first.
+static void ref_encode(const uint8_t *source, uint8_t *dest) {
+  int bit = 0;
+  int i, j;
+
+  memset(dest, 0, 5);
+  for (i = 0; i < 8; i++) {
+    uint8_t nybble = i & 1 ? source[i / 2] & 0x0f : source[i / 2] >> 4;
+    for (j = 4; j >= 0; j--, bit++) {
+      if (nybble_to_gcr[nybble] & (1 << j)) {
+        dest[bit / 8] |= 0x80 >> (bit % 8);
+      }
+    }
+  }
+}
+
+// Groups that are not a GCR code decode as 0, like VICE always did.
+static void ref_decode(const uint8_t *source, uint8_t *dest) {
+  int bit = 0;
+  int i, j;
+
+  memset(dest, 0, 4);
+  for (i = 0; i < 8; i++) {
+    uint8_t code = 0;
+    uint8_t nybble = 0;
+    for (j = 0; j < 5; j++, bit++) {
+      code = (code << 1) | ((source[bit / 8] >> (7 - bit % 8)) & 1);
+    }
+    for (j = 0; j < 16; j++) {
+      if (nybble_to_gcr[j] == code) {
+        nybble = j;
+      }
+    }
+    dest[i / 2] |= i & 1 ? nybble : nybble << 4;
+  }
+}
+
+static void test_bytes(void) {
+  uint8_t bytes[4], gcr[5], expected[5], decoded[4], ref[4];
+  int i, k;
+
+  // Every byte value in every position.
+  for (i = 0; i < 256 * 4; i++) {
+    for (k = 0; k < 4; k++) {
+      bytes[k] = (uint8_t)rnd();
+    }
+    bytes[i / 256] = (uint8_t)i;
+    gcr_convert_4bytes_to_GCR(bytes, gcr);
+    ref_encode(bytes, expected);
+    CHECK(memcmp(gcr, expected, 5) == 0);
+    gcr_convert_GCR_to_4bytes(gcr, decoded);
+    CHECK(memcmp(decoded, bytes, 4) == 0);
+  }
+
+  // Random bits, most of them not valid GCR.
+  for (i = 0; i < 1000000 && !failures; i++) {
+    for (k = 0; k < 5; k++) {
+      gcr[k] = (uint8_t)rnd();
+    }
+    gcr_convert_GCR_to_4bytes(gcr, decoded);
+    ref_decode(gcr, ref);
+    CHECK(memcmp(decoded, ref, 4) == 0);
+  }
+}
+
+#define MAX_SECTORS 21
+#define TRACK_BYTES 8192
+
+static const uint8_t error_code_list[] = {
+  CBMDOS_FDC_ERR_OK, CBMDOS_FDC_ERR_HEADER, CBMDOS_FDC_ERR_SYNC,
+  CBMDOS_FDC_ERR_NOBLOCK, CBMDOS_FDC_ERR_DCHECK, CBMDOS_FDC_ERR_HCHECK,
+  CBMDOS_FDC_ERR_ID
+};
+
+static void test_track(void) {
+  static uint8_t sectors[MAX_SECTORS * 256];
+  static uint8_t track[TRACK_BYTES], expected[TRACK_BYTES];
+  uint8_t error_codes[MAX_SECTORS];
+  uint8_t data[256], new_data[256];
+  gcr_header_t header;
+  disk_track_t raw;
+  int i, k;
+
+  for (i = 0; i < 2000 && !failures; i++) {
+    unsigned num_sectors = 17 + rnd() % 5;
+    int gap = 9, sync = 5;
+    int track_gap = rnd() % 12;
+    int with_errors = i & 1;
+    int step = SECTOR_GCR_SIZE_WITH_HEADER + gap + sync + track_gap;
+    unsigned s;
+
+    for (k = 0; k < (int)sizeof(sectors); k++) {
+      sectors[k] = (uint8_t)rnd();
+    }
+    for (s = 0; s < num_sectors; s++) {
+      error_codes[s] = with_errors
+          ? error_code_list[rnd() % sizeof(error_code_list)]
+          : CBMDOS_FDC_ERR_OK;
+    }
+    header.track = 1 + rnd() % 40;
+    header.id1 = (uint8_t)rnd();
+    header.id2 = (uint8_t)rnd();
+    header.sector = (uint8_t)rnd();
+
+    // The track gap bytes must be left as they were.
+    memset(track, 0x55, sizeof(track));
+    memset(expected, 0x55, sizeof(expected));
+    for (s = 0; s < num_sectors; s++) {
+      gcr_header_t sector_header = header;
+      sector_header.sector = s;
+      gcr_convert_sector_to_GCR(sectors + s * 256, expected + s * step,
+                                &sector_header, gap, sync, error_codes[s]);
+    }
+    gcr_convert_track_to_GCR(sectors, track, &header, num_sectors, gap, sync,
+                             track_gap, with_errors ? error_codes : NULL);
+    CHECK(memcmp(track, expected, sizeof(track)) == 0);
+
+    // Sectors that were written without errors read back as they were.
+    raw.data = track;
+    raw.size = num_sectors * step;
+    for (s = 0; s < num_sectors; s++) {
+      if (error_codes[s] == CBMDOS_FDC_ERR_OK) {
+        CHECK(gcr_read_sector(&raw, data, s) == CBMDOS_FDC_ERR_OK);
+        CHECK(memcmp(data, sectors + s * 256, 256) == 0);
+      }
+    }
+
+    // And can be written and read again.
+    if (!with_errors) {
+      s = rnd() % num_sectors;
+      for (k = 0; k < 256; k++) {
+        new_data[k] = (uint8_t)rnd();
+      }
+      CHECK(gcr_write_sector(&raw, new_data, s) == CBMDOS_FDC_ERR_OK);
+      CHECK(gcr_read_sector(&raw, data, s) == CBMDOS_FDC_ERR_OK);
+      CHECK(memcmp(data, new_data, 256) == 0);
+    }
+  }
+}
+
+int main(void) {
+  test_bytes();
+  test_track();
+  return check_report("gcr_test");
+}
@@ -0,0 +1,340 @@
+//
+// gpioscanner_test.cpp
+//
+// Host test for GPIOScanner against a simulated keyboard matrix and
+// joysticks. Scan and Dispatch run on the same thread here; the test
+// checks what each of them is allowed to touch.
+
+#include "gpioscanner.h"
+#include "check.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+extern "C" {
+#include "third_party/common/keycodes.h"
+}
+
+// ---------------------------------------------------------------------
+// Emulator side stubs.
+
+struct joydev_config joydevs[MAX_JOY_PORTS];
+signed long restore_key_sym = KEYCODE_Delete;
+
+struct Call {
+  char what; // 'p'ress, 'r'elease, 'u'i key, 'q'uick func, 'j'oy
+  long code;
+  int arg;
+};
+
+static std::vector<Call> calls;
+static int ui_activated;
+static int ui_queries;
+
+extern "C" {
+void emu_key_pressed(long key) { calls.push_back({'p', key, 1}); }
+void emu_key_released(long key) { calls.push_back({'r', key, 0}); }
+void emu_ui_key_interrupt(long key, int pressed) {
+  calls.push_back({'u', key, pressed});
+}
+void emu_quick_func_interrupt(int button_assignment) {
+  calls.push_back({'q', button_assignment, 0});
+}
+void emu_joy_interrupt_abs(int port, int device, int js_up, int js_down,
+                           int js_left, int js_right, int js_fire,
+                           int pot_x, int pot_y) {
+  int bits = js_up | (js_down << 1) | (js_left << 2) | (js_right << 3) |
+             (js_fire << 4) | (pot_x << 5) | (pot_y << 6);
+  calls.push_back({'j', (long)(port * 100 + device), bits});
+}
+int emu_is_ui_activated(void) {
+  ui_queries++;
+  return ui_activated;
+}
+}
+
+// ---------------------------------------------------------------------
+// Simulated wiring. A closed matrix switch connects PA line a (pin
+// index a) to PB line b (pin index b + 8). A joystick switch connects
+// its pin to the select line on the keyboard PCB, or to ground
+// otherwise.
+
+class SimPins : public GPIOPinIO {
+public:
+  bool matrix[8][8];
+  bool closed[NUM_GPIO_PINS];
+  bool useSelect;
+  int settles;
+
+  SimPins() : useSelect(false), settles(0) {
+    memset(matrix, 0, sizeof(matrix));
+    memset(closed, 0, sizeof(closed));
+    memset(driven, 0, sizeof(driven));
+  }
+
+  int Read(int pinIndex) override {
+    if (pinIndex >= 8 && pinIndex < 16) {
+      for (int a = 0; a < 8; a++) {
+        if (driven[a] && matrix[a][pinIndex - 8]) {
+          return GPIO_PIN_LOW;
+        }
+      }
+    }
+    if (closed[pinIndex]) {
+      if (!useSelect) {
+        return GPIO_PIN_LOW;
+      }
+      if (driven[GPIO_JS1_SELECT_INDEX] && pinIndex >= 8) {
+        return GPIO_PIN_LOW;
+      }
+      if (driven[GPIO_JS2_SELECT_INDEX] && pinIndex < 8) {
+        return GPIO_PIN_LOW;
+      }
+    }
+    return GPIO_PIN_HIGH;
+  }
+
+  void DriveLow(int pinIndex) override { driven[pinIndex] = true; }
+  void Release(int pinIndex) override { driven[pinIndex] = false; }
+  void Settle(unsigned usec) override { settles++; }
+
+  bool AnyDriven() const {
+    for (int i = 0; i < NUM_GPIO_PINS; i++) {
+      if (driven[i]) return true;
+    }
+    return false;
+  }
+
+private:
+  bool driven[NUM_GPIO_PINS];
+};
+
+static bool Called(char what, long code, int arg) {
+  for (size_t i = 0; i < calls.size(); i++) {
+    if (calls[i].what == what && calls[i].code == code &&
+        calls[i].arg == arg) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void Reset(SimPins *pins) {
+  *pins = SimPins();
+  calls.clear();
+  ui_activated = 0;
+  ui_queries = 0;
+  joydevs[0].port = 0;
+  joydevs[0].device = JOYDEV_NONE;
+  joydevs[1].port = 1;
+  joydevs[1].device = JOYDEV_NONE;
+}
+
+// Scan never looks at emulator state and only posts. Nothing reaches
+// the emulator until Dispatch.
+static void TestScanOnlyPosts() {
+  SimPins pins;
+  Reset(&pins);
+  GPIOScanner scanner(&pins);
+
+  pins.matrix[1][1] = true;
+  scanner.Scan(GPIO_CONFIG_KYB_JOY, 1000);
+  CHECK(calls.empty());
+  CHECK(ui_queries == 0);
+  CHECK(!pins.AnyDriven());
+  CHECK(pins.settles > 0);
+
+  scanner.Dispatch(GPIO_CONFIG_KYB_JOY);
+  CHECK(calls.size() == 1);
+  CHECK(Called('p', KEYCODE_w, 1));
+}
+
+// One press and one release per edge. Bounces inside the debounce
+// window are dropped.
+static void TestMatrixDebounce() {
+  SimPins pins;
+  Reset(&pins);
+  GPIOScanner scanner(&pins);
+
+  // PA 2, PB 7 is x.
+  unsigned long now = 1000;
+  pins.matrix[2][7] = true;
+  scanner.Scan(GPIO_CONFIG_KYB_JOY, now);
+  for (int i = 1; i < 5; i++) {
+    pins.matrix[2][7] = (i & 1) == 0;
+    scanner.Scan(GPIO_CONFIG_KYB_JOY, now + i * 1000);
+  }
+  pins.matrix[2][7] = true;
+  scanner.Scan(GPIO_CONFIG_KYB_JOY, now + GPIO_DEBOUNCE_US + 1000);
+  pins.matrix[2][7] = false;
+  scanner.Scan(GPIO_CONFIG_KYB_JOY, now + GPIO_DEBOUNCE_US + 2000);
+  scanner.Dispatch(GPIO_CONFIG_KYB_JOY);
+
+  CHECK(calls.size() == 2);
+  CHECK(calls.size() == 2 && calls[0].what == 'p' &&
+        calls[0].code == KEYCODE_x);
+  CHECK(calls.size() == 2 && calls[1].what == 'r' &&
+        calls[1].code == KEYCODE_x);
+}
+
+// Several keys in one pass keep their scan order. Restore goes through
+// the keymap's symbol, looked up at dispatch time.
+static void TestOrderAndRestore() {
+  SimPins pins;
+  Reset(&pins);
+  GPIOScanner scanner(&pins);
+
+  pins.closed[GPIO_KBD_RESTORE_INDEX] = true;
+  pins.matrix[1][0] = true; // 3
+  pins.matrix[1][1] = true; // w
+  pins.matrix[1][2] = true; // a
+  scanner.Scan(GPIO_CONFIG_KYB_JOY, 1000);
+  restore_key_sym = KEYCODE_Home;
+  scanner.Dispatch(GPIO_CONFIG_KYB_JOY);
+
+  CHECK(calls.size() == 4);
+  if (calls.size() == 4) {
+    CHECK(calls[0].what == 'p' && calls[0].code == KEYCODE_Home);
+    CHECK(calls[1].code == KEYCODE_3);
+    CHECK(calls[2].code == KEYCODE_w);
+    CHECK(calls[3].code == KEYCODE_a);
+  }
+  restore_key_sym = KEYCODE_Delete;
+}
+
+// Shifted cursor keys are swapped only while the ui is up, and that is
+// decided when the events are dispatched.
+static void TestUIShift() {
+  SimPins pins;
+  Reset(&pins);
+  GPIOScanner scanner(&pins);
+
+  // Left shift is PA 1 / PB 7, cursor right is PA 0 / PB 2.
+  pins.matrix[1][7] = true;
+  scanner.Scan(GPIO_CONFIG_KYB_JOY, 1000);
+  pins.matrix[0][2] = true;
+  scanner.Scan(GPIO_CONFIG_KYB_JOY, 2000);
+  ui_activated = 1;
+  scanner.Dispatch(GPIO_CONFIG_KYB_JOY);
+  CHECK(Called('p', KEYCODE_LeftShift, 1));
+  CHECK(Called('p', KEYCODE_Left, 1));
+  CHECK(!Called('p', KEYCODE_Right, 1));
+
+  calls.clear();
+  pins.matrix[0][2] = false;
+  scanner.Scan(GPIO_CONFIG_KYB_JOY, 2000 + GPIO_DEBOUNCE_US);
+  ui_activated = 0;
+  scanner.Dispatch(GPIO_CONFIG_KYB_JOY);
+  CHECK(Called('r', KEYCODE_Right, 0));
+}
+
+// Joystick state goes to whatever port the device is assigned to when
+// dispatched, and is only resent on change.
+static void TestJoystick() {
+  SimPins pins;
+  Reset(&pins);
+  pins.useSelect = true;
+  GPIOScanner scanner(&pins);
+
+  pins.closed[GPIO_CONFIG_1_JOY_1_FIRE_INDEX] = true;
+  pins.closed[GPIO_CONFIG_1_JOY_1_UP_INDEX] = true;
+  scanner.Scan(GPIO_CONFIG_KYB_JOY, 1000);
+  CHECK(calls.empty());
+  CHECK(!pins.AnyDriven());
+
+  // Not assigned yet.
+  scanner.Dispatch(GPIO_CONFIG_KYB_JOY);
+  CHECK(calls.empty());
+
+  joydevs[1].device = JOYDEV_GPIO_0;
+  scanner.Dispatch(GPIO_CONFIG_KYB_JOY);
+  CHECK(calls.size() == 1);
+  CHECK(Called('j', 1 * 100 + JOYDEV_GPIO_0,
+               (1 << JOY_UP) | (1 << JOY_FIRE)));
+
+  calls.clear();
+  scanner.Scan(GPIO_CONFIG_KYB_JOY, 2000);
+  scanner.Dispatch(GPIO_CONFIG_KYB_JOY);
+  CHECK(calls.empty());
+
+  // Moving the device to another port resends without a pin change.
+  joydevs[1].device = JOYDEV_NONE;
+  joydevs[0].device = JOYDEV_GPIO_0;
+  scanner.Dispatch(GPIO_CONFIG_KYB_JOY);
+  CHECK(calls.size() == 1);
+  CHECK(Called('j', 0 * 100 + JOYDEV_GPIO_0,
+               (1 << JOY_UP) | (1 << JOY_FIRE)));
+
+  // While the ui is up, edges go to the ui even though the state is
+  // not sent to the port.
+  calls.clear();
+  ui_activated = 1;
+  pins.closed[GPIO_CONFIG_1_JOY_1_UP_INDEX] = false;
+  scanner.Scan(GPIO_CONFIG_KYB_JOY, 1000 + GPIO_DEBOUNCE_US);
+  scanner.Dispatch(GPIO_CONFIG_KYB_JOY);
+  CHECK(calls.size() == 1);
+  CHECK(Called('u', KEYCODE_Up, 0));
+
+  // Current state is sent once the ui goes away.
+  calls.clear();
+  ui_activated = 0;
+  scanner.Dispatch(GPIO_CONFIG_KYB_JOY);
+  CHECK(calls.size() == 1);
+  CHECK(Called('j', 0 * 100 + JOYDEV_GPIO_0, 1 << JOY_FIRE));
+}
+
+// Nav buttons tap keys and quick functions.
+static void TestNavButtons() {
+  SimPins pins;
+  Reset(&pins);
+  GPIOScanner scanner(&pins);
+
+  pins.closed[GPIO_CONFIG_0_MENU_INDEX] = true;
+  pins.closed[GPIO_CONFIG_0_MENU_VKBD_INDEX] = true;
+  scanner.Scan(GPIO_CONFIG_NAV_JOY, 1000);
+  scanner.Dispatch(GPIO_CONFIG_NAV_JOY);
+  CHECK(calls.size() == 3);
+  if (calls.size() == 3) {
+    CHECK(calls[0].what == 'p' && calls[0].code == KEYCODE_F12);
+    CHECK(calls[1].what == 'r' && calls[1].code == KEYCODE_F12);
+    CHECK(calls[2].what == 'q' && calls[2].code == BTN_ASSIGN_VKBD_TOGGLE);
+  }
+}
+
+// If the emulator stops draining, the queue drops new events instead of
+// overwriting ones it has not read yet.
+static void TestQueueFull() {
+  SimPins pins;
+  Reset(&pins);
+  GPIOScanner scanner(&pins);
+
+  unsigned long now = 1000;
+  int presses = 0;
+  while (presses < GPIO_EVENT_QUEUE_SIZE) {
+    for (int i = 0; i < 8; i++) {
+      pins.matrix[i][3] = (presses / 8) % 2 == 0;
+    }
+    scanner.Scan(GPIO_CONFIG_KYB_JOY, now);
+    now += GPIO_DEBOUNCE_US;
+    presses += 8;
+  }
+  for (int i = 0; i < 8; i++) {
+    pins.matrix[i][3] = !pins.matrix[i][3];
+  }
+  scanner.Scan(GPIO_CONFIG_KYB_JOY, now);
+  scanner.Dispatch(GPIO_CONFIG_KYB_JOY);
+  CHECK(calls.size() == GPIO_EVENT_QUEUE_SIZE);
+  CHECK(calls.size() > 0 && calls[0].what == 'p');
+}
+
+int main() {
+  TestScanOnlyPosts();
+  TestMatrixDebounce();
+  TestOrderAndRestore();
+  TestUIShift();
+  TestJoystick();
+  TestNavButtons();
+  TestQueueFull();
+  return check_report("gpioscanner_test");
+}
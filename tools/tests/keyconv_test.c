@@ -0,0 +1,253 @@
+/*
+ * keyconv_test.c
+ *
+ * Checks the keysym index of VICE's keyboard.c against scanning the
+ * keymap table. keyboard.c is built into the test. Every sym must see
+ * its entries in table order, and key presses and releases must leave
+ * the same matrix and shift state whether the index is used or not,
+ * which is what ALT_MAP and ALLOW_OTHER entries rely on. Also times a
+ * lookup both ways.
+ */
+#include "keyboard.c"
+#include "check.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_ENTRIES 512
+#define EVENTS_PER_MAP 400
+
+// The rest of the machine a key event reaches.
+
+int joystick_port_map[JOYSTICK_NUM];
+
+int event_playback_active(void) { return 0; }
+int network_connected(void) { return 0; }
+int machine_has_restore_key(void) { return 0; }
+long machine_get_cycles_per_frame(void) { return 19656; }
+
+// No joystick port is mapped to keys and the single alarm is always
+// pending, so these are never reached.
+int joystick_check_set(signed long key, int keysetnum, unsigned int joyport) {
+  abort();
+}
+int joystick_check_clr(signed long key, int keysetnum, unsigned int joyport) {
+  abort();
+}
+void alarm_log_too_many_alarms(void) { abort(); }
+void network_event_record(unsigned int type, void *data, unsigned int size) {
+  abort();
+}
+
+static alarm_context_t alarm_context;
+static alarm_t alarm;
+
+static keyboard_conv_t table[MAX_ENTRIES];
+
+// Syms come from a small pool so most have several entries. Some are
+// outside the index and go through the scan either way.
+static signed long pick_sym(void) {
+  switch (rnd() % 16) {
+    case 0:
+      return KEYCODE_MAX + rnd() % 4;
+    case 1:
+      return ARCHDEP_KEYBOARD_SYM_NONE;
+    default:
+      return 'a' + rnd() % 24;
+  }
+}
+
+static enum shift_type pick_shift(void) {
+  static const enum shift_type flags[] = {
+    NO_SHIFT, VIRTUAL_SHIFT, LEFT_SHIFT, RIGHT_SHIFT, ALLOW_SHIFT,
+    DESHIFT_SHIFT, SHIFT_LOCK
+  };
+  enum shift_type shift = flags[rnd() % 7];
+
+  if (rnd() % 3 == 0) {
+    shift |= ALLOW_OTHER;
+  }
+  if (rnd() % 3 == 0) {
+    shift |= ALT_MAP;
+  }
+  return shift;
+}
+
+static void make_map(int entries) {
+  int i;
+
+  for (i = 0; i < entries; i++) {
+    table[i].sym = pick_sym();
+    table[i].row = (int)(rnd() % (KBD_ROWS + 2)) - 2;
+    table[i].column = rnd() % KBD_COLS;
+    table[i].shift = pick_shift();
+  }
+  keyconvmap = table;
+  keyc_num = entries;
+}
+
+// Entry indices for sym, in the order keyboard_keyconv_next gives them.
+static int list_entries(signed long sym, int *out) {
+  int n = 0;
+  int i;
+
+  for (i = keyboard_keyconv_next(sym, -1); i >= 0;
+       i = keyboard_keyconv_next(sym, i)) {
+    out[n++] = i;
+  }
+  return n;
+}
+
+static void test_order(void) {
+  static int indexed[MAX_ENTRIES], scanned[MAX_ENTRIES];
+  signed long sym;
+
+  for (sym = -2; sym < KEYCODE_MAX + 4; sym++) {
+    int n_indexed, n_scanned;
+
+    keyboard_keyconv_index_build();
+    n_indexed = list_entries(sym, indexed);
+    keyboard_keyconv_index_drop();
+    n_scanned = list_entries(sym, scanned);
+
+    CHECK(n_indexed == n_scanned);
+    CHECK(memcmp(indexed, scanned, n_scanned * sizeof(int)) == 0);
+  }
+}
+
+// Everything a key event can change.
+struct state {
+  int latch_keyarr[KBD_ROWS];
+  int latch_rev_keyarr[KBD_COLS];
+  int left_shift_down, right_shift_down, virtual_shift_down;
+  int keyboard_shiftlock;
+  int key_latch_row, key_latch_column;
+  CLOCK alarm_clk;
+};
+
+static void reset_state(void) {
+  memset(latch_keyarr, 0, sizeof(latch_keyarr));
+  memset(latch_rev_keyarr, 0, sizeof(latch_rev_keyarr));
+  left_shift_down = right_shift_down = virtual_shift_down = 0;
+  keyboard_shiftlock = 0;
+  key_latch_row = key_latch_column = 0;
+  key_alternative = 0;
+  alarm_context.pending_alarms[0].clk = 0;
+}
+
+static void save_state(struct state *s) {
+  memset(s, 0, sizeof(*s));
+  memcpy(s->latch_keyarr, latch_keyarr, sizeof(latch_keyarr));
+  memcpy(s->latch_rev_keyarr, latch_rev_keyarr, sizeof(latch_rev_keyarr));
+  s->left_shift_down = left_shift_down;
+  s->right_shift_down = right_shift_down;
+  s->virtual_shift_down = virtual_shift_down;
+  s->keyboard_shiftlock = keyboard_shiftlock;
+  s->key_latch_row = key_latch_row;
+  s->key_latch_column = key_latch_column;
+  s->alarm_clk = alarm_context.pending_alarms[0].clk;
+}
+
+static struct state indexed_states[EVENTS_PER_MAP];
+static struct state scanned_states[EVENTS_PER_MAP];
+
+static void play(unsigned seed, struct state *states) {
+  unsigned saved_rng = rng_state;
+  int i;
+
+  rng_state = seed;
+  reset_state();
+  for (i = 0; i < EVENTS_PER_MAP; i++) {
+    signed long sym = pick_sym();
+
+    maincpu_clk = i * 100;
+    if (rnd() % 16 == 0) {
+      key_alternative = !key_alternative;
+    }
+    if (rnd() % 2) {
+      keyboard_key_pressed(sym);
+    } else {
+      keyboard_key_released(sym);
+    }
+    save_state(&states[i]);
+  }
+  rng_state = saved_rng;
+}
+
+static void test_events(void) {
+  unsigned seed = rnd() | 1;
+
+  vshift = rnd() % 3;
+  shiftl = rnd() % 3;
+
+  keyboard_keyconv_index_build();
+  play(seed, indexed_states);
+  keyboard_keyconv_index_drop();
+  play(seed, scanned_states);
+
+  CHECK(memcmp(indexed_states, scanned_states, sizeof(indexed_states)) == 0);
+}
+
+static void test_maps(void) {
+  int i;
+
+  for (i = 0; i < 400 && !failures; i++) {
+    make_map(1 + rnd() % MAX_ENTRIES);
+    test_order();
+    test_events();
+  }
+}
+
+// How long finding every entry for a key takes, with and without the
+// index, on a map about the size of the stock C64 ones.
+static double lookups_per_second(int indexed) {
+  const int lookups = 2000000;
+  volatile int sink = 0;
+  double start_time;
+  int i, j;
+
+  if (indexed) {
+    keyboard_keyconv_index_build();
+  } else {
+    keyboard_keyconv_index_drop();
+  }
+  start_time = seconds();
+  for (i = 0; i < lookups; i++) {
+    signed long sym = 'a' + i % 24;
+    for (j = keyboard_keyconv_next(sym, -1); j >= 0;
+         j = keyboard_keyconv_next(sym, j)) {
+      sink += j;
+    }
+  }
+  return lookups / (seconds() - start_time);
+}
+
+static void bench(void) {
+  double indexed, scanned;
+
+  make_map(150);
+  indexed = lookups_per_second(1);
+  scanned = lookups_per_second(0);
+  printf("keyconv_test: %.1fM lookups/s indexed, %.1fM scanned\n",
+         indexed / 1e6, scanned / 1e6);
+}
+
+int main(void) {
+  alarm.context = &alarm_context;
+  alarm.pending_idx = 0;
+  alarm_context.pending_alarms[0].alarm = &alarm;
+  alarm_context.num_pending_alarms = 1;
+  keyboard_alarm = &alarm;
+
+  kbd_lshiftrow = 1;
+  kbd_lshiftcol = 7;
+  kbd_rshiftrow = 6;
+  kbd_rshiftcol = 4;
+
+  test_maps();
+  bench();
+
+  keyconvmap = NULL;
+  return check_report("keyconv_test");
+}
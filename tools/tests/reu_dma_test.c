@@ -0,0 +1,265 @@
+/*
+ * reu_dma_test.c
+ *
+ * Checks the bulk REU DMA transfers against the byte by byte ones.
+ * reu.c is built into the test. Every transfer runs once as a C64,
+ * where bulk copies are allowed, and once as a C128, where they are
+ * not. Memory, REU, clock, alarm and register state must come out
+ * the same.
+ */
+#include "c64/cart/reu.c"
+#include "check.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CASES_PER_SIZE 400
+
+// The rest of the machine reu.c reaches. lib, log and util come from
+// vice_stubs.c.
+
+int machine_class;
+interrupt_cpu_status_t *maincpu_int_status;
+uint8_t mem_ram[0x10000];
+
+void interrupt_fixup_int_clk(interrupt_cpu_status_t *cs, CLOCK cpu_clk,
+                             CLOCK *int_clk) {}
+
+// Never reached by the transfers the test makes.
+void interrupt_log_wrong_nirq(void) { abort(); }
+
+static uint8_t *io_mem;
+static unsigned io_read_log;
+
+uint8_t ram_read(uint16_t addr) { return mem_ram[addr]; }
+void ram_store(uint16_t addr, uint8_t value) { mem_ram[addr] = value; }
+
+static uint8_t basic_kernal_read(uint16_t addr) {
+  return (uint8_t)(addr ^ (addr >> 8));
+}
+
+// Reads have a side effect, so they must happen exactly as often and
+// in the same order on both paths.
+static uint8_t io_read(uint16_t addr) {
+  io_read_log = io_read_log * 31 + addr;
+  return io_mem[addr];
+}
+
+static void io_store(uint16_t addr, uint8_t value) { io_mem[addr] = value; }
+
+// RAM under a store watchpoint: reads are plain, stores are seen.
+static unsigned watch_log;
+
+static void watch_store(uint16_t addr, uint8_t value) {
+  watch_log = watch_log * 31 + addr;
+  mem_ram[addr] = value;
+}
+
+static read_func_ptr_t read_tab[0x101];
+static store_func_ptr_t write_tab[0x101];
+read_func_ptr_t *_mem_read_tab_ptr = read_tab;
+store_func_ptr_t *_mem_write_tab_ptr = write_tab;
+
+uint8_t mem_read(uint16_t addr) { return _mem_read_tab_ptr[addr >> 8](addr); }
+
+void mem_store(uint16_t addr, uint8_t value) {
+  _mem_write_tab_ptr[addr >> 8](addr, value);
+}
+
+// A periodic alarm that writes into host RAM, so a bulk copy running
+// past it shows up in memory as well as in the dispatch clocks.
+static alarm_context_t alarm_context;
+alarm_context_t *maincpu_alarm_context = &alarm_context;
+static CLOCK alarm_period;
+static uint16_t alarm_addr;
+static unsigned alarm_log;
+static unsigned alarm_polls;
+
+// Alarm polls on each path, to see that bulk copies did happen.
+static unsigned long fast_polls, slow_polls;
+
+void machine_handle_pending_alarms(int num_write_cycles) {
+  alarm_polls++;
+  while (maincpu_clk >= alarm_context.next_pending_alarm_clk) {
+    alarm_log = alarm_log * 31 + (unsigned)maincpu_clk;
+    mem_ram[alarm_addr] = (uint8_t)alarm_log;
+    alarm_context.next_pending_alarm_clk += alarm_period;
+  }
+}
+
+static void fill(uint8_t *p, unsigned n) {
+  unsigned i;
+  for (i = 0; i < n; i++) {
+    p[i] = (uint8_t)rnd();
+  }
+}
+
+// One copy of everything a transfer can touch.
+struct world {
+  uint8_t ram[0x10000];
+  uint8_t io[0x10000];
+  uint8_t *reu;
+  CLOCK clk;
+  CLOCK next_alarm;
+  unsigned alarm_log;
+  unsigned io_read_log;
+  unsigned watch_log;
+  struct rec_s rec;
+};
+
+static struct world fast_world, slow_world;
+
+static void run(struct world *w, int mc, const struct rec_s *regs,
+                CLOCK clk, CLOCK next_alarm) {
+  memcpy(mem_ram, w->ram, sizeof(mem_ram));
+  io_mem = w->io;
+  reu_ram = w->reu;
+  maincpu_clk = clk;
+  alarm_context.next_pending_alarm_clk = next_alarm;
+  alarm_log = 0;
+  io_read_log = 0;
+  watch_log = 0;
+  rec = *regs;
+  machine_class = mc;
+
+  reu_dma_start();
+
+  memcpy(w->ram, mem_ram, sizeof(mem_ram));
+  w->clk = maincpu_clk;
+  w->next_alarm = alarm_context.next_pending_alarm_clk;
+  w->alarm_log = alarm_log;
+  w->io_read_log = io_read_log;
+  w->watch_log = watch_log;
+  w->rec = rec;
+}
+
+// Start addresses are drawn close to the edges often enough to cover
+// the host address wrap, the REU wrap and the end of the DRAM.
+static unsigned pick_reu_addr(void) {
+  unsigned bank = rnd() & 0xff;
+  switch (rnd() % 4) {
+    case 0:
+      return (bank << 16 & 0xf80000) | (rec_options.wrap_around - 1 - rnd() % 64);
+    case 1:
+      if (rec_options.not_backedup_addresses < rec_options.dram_wrap_around) {
+        return rec_options.not_backedup_addresses - 1 - rnd() % 64;
+      }
+      /* fall through */
+    default:
+      return (bank << 16) | (rnd() & 0xffff);
+  }
+}
+
+static void run_case(void) {
+  struct rec_s regs;
+  unsigned reu_addr = pick_reu_addr();
+  CLOCK clk = 1000 + rnd() % 100000;
+  CLOCK next_alarm;
+
+  memset(&regs, 0, sizeof(regs));
+  regs.command = REU_REG_RW_COMMAND_EXECUTE | rnd() % 3;
+  if (rnd() % 4 == 0) {
+    regs.command |= REU_REG_RW_COMMAND_AUTOLOAD;
+  }
+  regs.address_control_reg = rnd() & (REU_REG_RW_ADDR_CONTROL_FIX_C64
+                                      | REU_REG_RW_ADDR_CONTROL_FIX_REC);
+  regs.base_computer = (uint16_t)(rnd() % 4 ? rnd() : 0x10000 - 1 - rnd() % 64);
+  regs.base_reu = reu_addr & 0xffff;
+  regs.bank_reu = (reu_addr >> 16) & 0xff;
+  switch (rnd() % 4) {
+    case 0:
+      regs.transfer_length = rnd() % 32;
+      break;
+    case 1:
+      regs.transfer_length = 0;
+      break;
+    default:
+      regs.transfer_length = (uint16_t)rnd();
+      break;
+  }
+  regs.base_computer_shadow = regs.base_computer;
+  regs.base_reu_shadow = regs.base_reu;
+  regs.bank_reu_shadow = regs.bank_reu;
+  regs.transfer_length_shadow = regs.transfer_length;
+
+  alarm_period = 1 + rnd() % (rnd() % 2 ? 300 : 20000);
+  alarm_addr = (uint16_t)(regs.base_computer + rnd() % 256);
+  next_alarm = clk + 1 + rnd() % alarm_period;
+
+  alarm_polls = 0;
+  run(&fast_world, VICE_MACHINE_C64, &regs, clk, next_alarm);
+  fast_polls += alarm_polls;
+  alarm_polls = 0;
+  run(&slow_world, VICE_MACHINE_C128, &regs, clk, next_alarm);
+  slow_polls += alarm_polls;
+
+  CHECK(fast_world.clk == slow_world.clk);
+  CHECK(fast_world.next_alarm == slow_world.next_alarm);
+  CHECK(fast_world.alarm_log == slow_world.alarm_log);
+  CHECK(fast_world.io_read_log == slow_world.io_read_log);
+  CHECK(fast_world.watch_log == slow_world.watch_log);
+  CHECK(fast_world.rec.status == slow_world.rec.status);
+  CHECK(fast_world.rec.command == slow_world.rec.command);
+  CHECK(fast_world.rec.base_computer == slow_world.rec.base_computer);
+  CHECK(fast_world.rec.base_reu == slow_world.rec.base_reu);
+  CHECK(fast_world.rec.bank_reu == slow_world.rec.bank_reu);
+  CHECK(fast_world.rec.transfer_length == slow_world.rec.transfer_length);
+  CHECK(memcmp(fast_world.ram, slow_world.ram, 0x10000) == 0);
+  CHECK(memcmp(fast_world.io, slow_world.io, 0x10000) == 0);
+  CHECK(memcmp(fast_world.reu, slow_world.reu, reu_size) == 0);
+}
+
+static void test_size(int size_kb) {
+  int i;
+
+  CHECK(set_reu_size(size_kb, NULL) == 0);
+  fast_world.reu = malloc(reu_size);
+  slow_world.reu = malloc(reu_size);
+  fill(fast_world.reu, reu_size);
+  memcpy(slow_world.reu, fast_world.reu, reu_size);
+
+  for (i = 0; i < CASES_PER_SIZE && !failures; i++) {
+    run_case();
+  }
+
+  free(fast_world.reu);
+  free(slow_world.reu);
+}
+
+int main(void) {
+  unsigned page;
+
+  // RAM with BASIC ROM, I/O and the KERNAL ROM mapped in, and a
+  // watchpoint on $4000-$47FF.
+  for (page = 0; page <= 0x100; page++) {
+    read_tab[page] = ram_read;
+    write_tab[page] = ram_store;
+  }
+  for (page = 0x40; page < 0x48; page++) {
+    write_tab[page] = watch_store;
+  }
+  for (page = 0xa0; page < 0xc0; page++) {
+    read_tab[page] = basic_kernal_read;
+  }
+  for (page = 0xd0; page < 0xe0; page++) {
+    read_tab[page] = io_read;
+    write_tab[page] = io_store;
+  }
+  for (page = 0xe0; page < 0x100; page++) {
+    read_tab[page] = basic_kernal_read;
+  }
+
+  fill(fast_world.ram, 0x10000);
+  fill(fast_world.io, 0x10000);
+  memcpy(slow_world.ram, fast_world.ram, 0x10000);
+  memcpy(slow_world.io, fast_world.io, 0x10000);
+
+  test_size(128);    // 1700, wraps at 128k
+  test_size(256);    // 1764, no DRAM above 256k
+  test_size(512);    // 1750
+  test_size(2048);   // 1750XL, bank bits above the REC
+  CHECK(fast_polls < slow_polls);
+
+  return check_report("reu_dma_test");
+}
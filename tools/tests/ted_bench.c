@@ -0,0 +1,100 @@
+/*
+ * ted_bench.c
+ *
+ * Host benchmark for Plus4Emu's TED run loop. The whole emulator is
+ * built into the program and run headless from the Plus/4 ROMs for a
+ * number of emulated seconds in the setups the Pi uses most: TED only,
+ * with SID, and with one or two 1541 drives. Prints how many times
+ * faster than real time each one runs.
+ *
+ * Run from this directory with 'make bench'.
+ */
+#include "plus4emu.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define ROMS "../../third_party/plus4emu/roms/"
+#define DISK "ted_bench.d64"
+#define D64_SIZE 174848
+
+// Emulated seconds per setup.
+#define SECONDS 20
+
+// The video and audio data is only looked at enough to keep it from
+// being optimized away.
+static unsigned long output_sum;
+
+static void video_output(void *data, const uint8_t *buf, size_t size) {
+  output_sum += size + buf[0];
+}
+
+static void audio_output(void *data, const int16_t *buf, size_t size) {
+  output_sum += size;
+}
+
+static void check(Plus4VM *vm, Plus4Emu_Error err) {
+  if (err != PLUS4EMU_SUCCESS) {
+    printf("ted_bench: %s\n", Plus4VM_GetLastErrorMessage(vm));
+    exit(1);
+  }
+}
+
+static void make_disk(void) {
+  static char blank[D64_SIZE];
+  FILE *fp = fopen(DISK, "wb");
+
+  if (!fp || fwrite(blank, 1, sizeof(blank), fp) != sizeof(blank)) {
+    printf("ted_bench: can't write " DISK "\n");
+    exit(1);
+  }
+  fclose(fp);
+}
+
+static void run(const char *name, int sid, int drives) {
+  Plus4VM *vm = Plus4VM_Create();
+  clock_t start;
+  double elapsed;
+  int i;
+
+  Plus4VM_SetAudioOutputCallback(vm, &audio_output, NULL);
+  Plus4VM_SetVideoOutputCallback(vm, &video_output, NULL);
+  check(vm, Plus4VM_SetAudioOutputQuality(vm, 1));
+  check(vm, Plus4VM_SetAudioSampleRate(vm, 48000));
+  check(vm, Plus4VM_LoadROM(vm, 0x00, ROMS "p4_basic.rom", 0));
+  check(vm, Plus4VM_LoadROM(vm, 0x01, ROMS "p4kernal.rom", 0));
+  check(vm, Plus4VM_LoadROM(vm, 0x10, ROMS "dos1541.rom", 0));
+  check(vm, Plus4VM_SetRAMConfiguration(vm, 64, 0x99999999UL));
+  if (sid) {
+    Plus4VM_SetSIDConfiguration(vm, 0, 0, 0);
+    Plus4VM_SetEnableSIDEmulation(vm, 1);
+  }
+  for (i = 0; i < drives; i++) {
+    check(vm, Plus4VM_SetDiskImageFile(vm, i, DISK, 0));
+  }
+
+  // Get past the boot screen first.
+  check(vm, Plus4VM_Run(vm, 3000000));
+
+  start = clock();
+  for (i = 0; i < SECONDS * 50; i++) {
+    check(vm, Plus4VM_Run(vm, 20000));
+  }
+  elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+  printf("ted_bench: %-16s %.2fs for %ds emulated, %.1fx real time\n",
+         name, elapsed, SECONDS, SECONDS / elapsed);
+
+  Plus4VM_Destroy(vm);
+}
+
+int main(void) {
+  make_disk();
+  run("TED", 0, 0);
+  run("TED+SID", 1, 0);
+  run("TED+SID+1541", 1, 1);
+  run("TED+SID+2x1541", 1, 2);
+  remove(DISK);
+  return output_sum == 0;
+}
@@ -0,0 +1,228 @@
+/*
+ * userport_bridge_test.c
+ *
+ * Host loopback test for the userport bridge queue. The emulator side
+ * and the pin side are driven directly, or from two threads for the
+ * ordering and throughput check.
+ */
+#include "userport_bridge.h"
+#include "check.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CYCLES_PER_SEC 1000000
+
+// Everything the pin side was asked to do, as value | ddr << 8.
+#define MAX_APPLIED 4096
+static unsigned applied[MAX_APPLIED];
+static int num_applied;
+static uint8_t pin_levels = 0xff;
+
+static void record_apply(uint8_t value, uint8_t ddr) {
+  if (num_applied < MAX_APPLIED) {
+    applied[num_applied] = value | (ddr << 8);
+  }
+  num_applied++;
+}
+
+static uint8_t read_pins(void) { return pin_levels; }
+
+static const struct userport_bridge_pins record_pins = {
+  record_apply, read_pins
+};
+
+// Enable and drain the initial state.
+static void start(void) {
+  userport_bridge_enable(1, CYCLES_PER_SEC, 0x00, 0x00);
+  userport_bridge_service(&record_pins, 0, 0);
+  num_applied = 0;
+}
+
+// Writes come out in order, including after the ring indices wrap
+// around many times.
+static void test_order_and_wrap(void) {
+  start();
+  unsigned seq = 0;
+  unsigned expect = 0;
+  int ok = 1;
+  for (int round = 0; round < 20; round++) {
+    for (int i = 0; i < USERPORT_QUEUE_SIZE / 2 + 7; i++) {
+      userport_bridge_write(seq, seq & 0xff, (seq >> 8) & 0xff);
+      seq++;
+    }
+    num_applied = 0;
+    userport_bridge_service(&record_pins, 0, 0);
+    for (int i = 0; i < num_applied; i++) {
+      if (applied[i] != (expect & 0xffff)) ok = 0;
+      expect++;
+    }
+  }
+  CHECK(ok);
+  CHECK(expect == seq);
+}
+
+// A full queue falls back to the latest state, which is applied after
+// everything that was queued before it.
+static void test_overflow(void) {
+  start();
+  for (unsigned i = 0; i < USERPORT_QUEUE_SIZE + 100; i++) {
+    userport_bridge_write(i, i & 0xff, 0xff);
+  }
+  userport_bridge_service(&record_pins, 0, 0);
+  CHECK(num_applied == USERPORT_QUEUE_SIZE + 1);
+  CHECK(applied[0] == 0xff00);
+  CHECK(applied[USERPORT_QUEUE_SIZE - 1] ==
+        (((USERPORT_QUEUE_SIZE - 1) & 0xff) | 0xff00));
+  CHECK(applied[USERPORT_QUEUE_SIZE] ==
+        (((USERPORT_QUEUE_SIZE + 99) & 0xff) | 0xff00));
+
+  // Queueing resumes once the latest state was applied.
+  num_applied = 0;
+  userport_bridge_write(5000, 0x55, 0xff);
+  userport_bridge_write(5001, 0xaa, 0xff);
+  userport_bridge_service(&record_pins, 0, 0);
+  CHECK(num_applied == 2);
+  CHECK(applied[0] == 0xff55 && applied[1] == 0xffaa);
+}
+
+// Paced writes keep their emulated spacing.
+static void test_pacing(void) {
+  start();
+  unsigned long t0 = 1000000;
+  userport_bridge_write(0, 1, 0xff);
+  userport_bridge_write(100, 2, 0xff);
+  userport_bridge_write(300, 3, 0xff);
+
+  userport_bridge_service(&record_pins, t0, 1);
+  CHECK(num_applied == 1);
+  userport_bridge_service(&record_pins, t0 + 99, 1);
+  CHECK(num_applied == 1);
+  userport_bridge_service(&record_pins, t0 + 100, 1);
+  CHECK(num_applied == 2);
+  // Late by a little: caught up right away, still in order.
+  userport_bridge_service(&record_pins, t0 + 2000, 1);
+  CHECK(num_applied == 3);
+  CHECK(applied[2] == 0xff03);
+}
+
+// More than 40ms between emulated and real time starts a new timeline
+// instead of holding writes back (or rushing them).
+static void test_resync(void) {
+  start();
+  unsigned long t0 = 5000000;
+  userport_bridge_write(0, 1, 0xff);
+  userport_bridge_service(&record_pins, t0, 1);
+  CHECK(num_applied == 1);
+
+  // A write due just inside the drift limit is held back...
+  uint32_t clk = (USERPORT_MAX_DRIFT_US - 10) * (CYCLES_PER_SEC / 1000000);
+  userport_bridge_write(clk, 2, 0xff);
+  userport_bridge_service(&record_pins, t0, 1);
+  CHECK(num_applied == 1);
+  userport_bridge_service(&record_pins, t0 + USERPORT_MAX_DRIFT_US - 10, 1);
+  CHECK(num_applied == 2);
+
+  // ...past it, the write is applied now and becomes the new origin.
+  unsigned long t1 = t0 + USERPORT_MAX_DRIFT_US;
+  clk += 100000;
+  userport_bridge_write(clk, 3, 0xff);
+  userport_bridge_write(clk + 500, 4, 0xff);
+  userport_bridge_service(&record_pins, t1, 1);
+  CHECK(num_applied == 3);
+  userport_bridge_service(&record_pins, t1 + 499, 1);
+  CHECK(num_applied == 3);
+  userport_bridge_service(&record_pins, t1 + 500, 1);
+  CHECK(num_applied == 4);
+
+  // Same when the emulator was stopped for a while (writes far behind).
+  unsigned long t2 = t1 + 10000000;
+  userport_bridge_write(clk + 600, 5, 0xff);
+  userport_bridge_write(clk + 700, 6, 0xff);
+  userport_bridge_service(&record_pins, t2, 1);
+  CHECK(num_applied == 5);
+  userport_bridge_service(&record_pins, t2 + 100, 1);
+  CHECK(num_applied == 6);
+}
+
+// Inputs come from the pins, outputs from the latch.
+static void test_read(void) {
+  start();
+  pin_levels = 0x5a;
+  userport_bridge_service(&record_pins, 0, 0);
+  CHECK(userport_bridge_read(0xff, 0x00) == 0x5a);
+  CHECK(userport_bridge_read(0x0f, 0x0f) == 0x5f);
+  CHECK(userport_bridge_read(0x00, 0xff) == 0x00);
+  pin_levels = 0xff;
+}
+
+// Two threads, as on the real thing. The pin side must never see the
+// sequence go backwards, even when the producer overflows the queue.
+// Each write's sequence number is carried in its value and ddr.
+#define THREAD_WRITES 2000000u
+
+static volatile int producer_done;
+static volatile unsigned last_seen;
+static unsigned backwards;
+static unsigned long seen;
+
+static void thread_apply(uint8_t value, uint8_t ddr) {
+  unsigned seq = value | (ddr << 8);
+  if (seen && (uint16_t)(seq - last_seen) >= 0x8000) {
+    backwards++;
+  }
+  last_seen = seq;
+  seen++;
+}
+
+static const struct userport_bridge_pins thread_pins = {
+  thread_apply, read_pins
+};
+
+static void *producer(void *arg) {
+  (void)arg;
+  for (unsigned i = 1; i <= THREAD_WRITES; i++) {
+    // Sequence numbers are 16 bits. Don't get so far ahead that the
+    // pin side can't tell forward from backward.
+    while ((uint16_t)(i - last_seen) >= 0x4000) {
+    }
+    userport_bridge_write(i, i & 0xff, (i >> 8) & 0xff);
+  }
+  producer_done = 1;
+  return NULL;
+}
+
+static void test_threads(void) {
+  userport_bridge_enable(1, CYCLES_PER_SEC, 0x00, 0x00);
+  userport_bridge_service(&thread_pins, 0, 0);
+  seen = 0;
+  backwards = 0;
+  producer_done = 0;
+
+  pthread_t thread;
+  double start_time = seconds();
+  pthread_create(&thread, NULL, producer, NULL);
+  while (!producer_done) {
+    userport_bridge_service(&thread_pins, 0, 0);
+  }
+  pthread_join(thread, NULL);
+  userport_bridge_service(&thread_pins, 0, 0);
+  double elapsed = seconds() - start_time;
+
+  CHECK(backwards == 0);
+  CHECK(last_seen == (THREAD_WRITES & 0xffff));
+  printf("userport_bridge_test: %lu of %u writes applied, %.1fM writes/s\n",
+         seen, THREAD_WRITES, THREAD_WRITES / elapsed / 1e6);
+}
+
+int main(void) {
+  test_order_and_wrap();
+  test_overflow();
+  test_pacing();
+  test_resync();
+  test_read();
+  test_threads();
+  userport_bridge_enable(0, 0, 0xff, 0);
+  return check_report("userport_bridge_test");
+}
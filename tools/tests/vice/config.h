@@ -0,0 +1,7 @@
+/* Minimal config.h for building VICE sources in the host tests. */
+#define HAVE_INTTYPES_H 1
+#define HAVE_STDINT_H 1
+#define HAVE_STRINGS_H 1
+#define HAVE_UNISTD_H 1
+#define SIZEOF_UNSIGNED_INT 4
+#define SIZEOF_UNSIGNED_SHORT 2
@@ -0,0 +1,59 @@
+/*
+ * vice_stubs.c
+ *
+ * The machine around the VICE sources the tests build in: the cpu
+ * clock, and lib, log and util on top of libc. Linked with
+ * --gc-sections, so each test keeps only what it reaches. Anything
+ * more specific to one test is stubbed in the test itself.
+ */
+#include "vice.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lib.h"
+#include "log.h"
+#include "types.h"
+#include "util.h"
+
+CLOCK maincpu_clk;
+
+// Fixed, so runs can be repeated.
+unsigned int lib_unsigned_rand(unsigned int min, unsigned int max) {
+  return min;
+}
+
+void *lib_malloc(size_t size) { return malloc(size); }
+void *lib_calloc(size_t nmemb, size_t size) { return calloc(nmemb, size); }
+void *lib_realloc(void *p, size_t size) { return realloc(p, size); }
+void lib_free(const void *ptr) { free((void *)ptr); }
+char *lib_stralloc(const char *str) { return strdup(str); }
+
+int log_message(log_t log, const char *format, ...) {
+  va_list ap;
+
+  va_start(ap, format);
+  vprintf(format, ap);
+  va_end(ap);
+  printf("\n");
+  return 0;
+}
+
+int log_error(log_t log, const char *format, ...) {
+  va_list ap;
+
+  va_start(ap, format);
+  vprintf(format, ap);
+  va_end(ap);
+  printf("\n");
+  return 0;
+}
+
+// Image files are never loaded or saved by the tests.
+int util_check_null_string(const char *string) { abort(); }
+int util_file_exists(const char *name) { abort(); }
+int util_file_load(const char *name, uint8_t *dest, size_t size,
+                   unsigned int load_flag) { abort(); }
+int util_file_save(const char *name, uint8_t *src, int size) { abort(); }
@@ -17,22 +17,6 @@
 
 #include "fbl.h"
 
-#if defined(RASPI_C64)
-#include "bootstat_c64.h"
-#elif defined(RASPI_C128)
-#include "bootstat_c128.h"
-#elif defined(RASPI_VIC20)
-#include "bootstat_vic20.h"
-#elif defined(RASPI_PLUS4)
-#include "bootstat_plus4.h"
-#elif defined(RASPI_PLUS4EMU)
-#include "bootstat_plus4emu.h"
-#elif defined(RASPI_PET)
-#include "bootstat_pet.h"
-#else
-  #error Unknown RASPI_ variant
-#endif
-
 //
 // ViceApp impl
 //
@@ -366,97 +350,88 @@ void ViceScreenApp::SetupGPIO() {
 // ViceStdioApp impl
 //
 
+static void SDCacheMetadataHint(int metadata) {
+  CSDCache::Get()->SetMetadataHint(metadata);
+}
+
 void ViceStdioApp::InitBootStat() {
-  FILE *fp;
+  const char *manifest;
 #if defined(RASPI_C64)
-  fp = fopen("/C64/bootstat.txt", "r");
+  manifest = "/C64/bootmanifest.txt";
+  mBootTimesPath = "/C64/boottimes.txt";
 #elif defined(RASPI_C128)
-  fp = fopen("/C128/bootstat.txt", "r");
+  manifest = "/C128/bootmanifest.txt";
+  mBootTimesPath = "/C128/boottimes.txt";
 #elif defined(RASPI_VIC20)
-  fp = fopen("/VIC20/bootstat.txt", "r");
+  manifest = "/VIC20/bootmanifest.txt";
+  mBootTimesPath = "/VIC20/boottimes.txt";
 #elif defined(RASPI_PLUS4)
-  fp = fopen("/PLUS4/bootstat.txt", "r");
+  manifest = "/PLUS4/bootmanifest.txt";
+  mBootTimesPath = "/PLUS4/boottimes.txt";
 #elif defined(RASPI_PLUS4EMU)
-  fp = NULL;
+  manifest = NULL;
 #elif defined(RASPI_PET)
-  fp = fopen("/PET/bootstat.txt", "r");
+  manifest = "/PET/bootmanifest.txt";
+  mBootTimesPath = "/PET/boottimes.txt";
 #else
   #error Unknown RASPI_ variant
 #endif
 
-  if (fp == NULL) {
-    printf("Could not find bootstat. Using default list.\n");
-
-    CGlueStdioInitBootStat(dflt_bootStatNum, dflt_bootStatWhat,
-                           dflt_bootStatFile, dflt_bootStatSize);
-
+  if (manifest == NULL) {
     return;
   }
 
-  char line[80];
-  int num = 0;
-  while (fgets(line, 79, fp)) {
-    if (feof(fp))
-      break;
-    if (strlen(line) == 0)
-      continue;
-    if (line[0] == '#')
-      continue;
-    char *what = strtok(line, ",");
-    if (what == NULL)
-      continue;
-    char *file = strtok(NULL, ",");
-    if (file == NULL)
-      continue;
-    char *size = strtok(NULL, ",");
-    if (size == NULL)
-      continue;
-    if (size[strlen(size) - 1] == '\n') {
-      size[strlen(size) - 1] = '\0';
-    }
-
-    if (num >= MAX_BOOTSTAT_LINES) {
-      printf("Warning: bootstat.txt too long, max %d entries\n",
-             MAX_BOOTSTAT_LINES);
-      break;
-    }
-
-    if (strcmp(what, "stat") == 0) {
-      if (strcmp(file, "d1541II") == 0) {
-        // Ignore legacy d1541II faking found file without a fully
-        // qualified path.
-        printf("Ignoring d1541II in bootstat.txt\n");
-        continue;
-      }
-      mBootStatWhat[num] = BOOTSTAT_WHAT_STAT;
-    } else if (strcmp(what, "fail") == 0) {
-      if (strcmp(file,"rpi_pos.vkm") == 0) {
-        // Ignore legacy mistake blocking rpi_pos.vkm
-        printf("Ignoring rpi_pos.vkm in bootstat.txt\n");
-        continue;
-      }
-      mBootStatWhat[num] = BOOTSTAT_WHAT_FAIL;
-    } else {
-      printf("Ignoring unknown bootstat.txt '%s'\n", what);
-      continue;
-    }
+  if (mViceOptions.RecordBootEnabled() ||
+      !CGlueStdioLoadBootManifest(manifest)) {
+    printf("Recording boot manifest %s\n", manifest);
+    CGlueStdioRecordBootManifest(manifest);
+  }
+}
 
-    // These never get freed...
-    mBootStatFile[num] = (char *)malloc(MAX_BOOTSTAT_FLEN);
-    strncpy(mBootStatFile[num], file, MAX_BOOTSTAT_FLEN);
-    mBootStatSize[num] = atoi(size);
+void ViceStdioApp::DisableBootStat() {
+  CGlueStdioFinishBootManifest();
+  BootPhase("boot complete");
+  WriteBootTimes();
+}
 
-    num++;
+void ViceStdioApp::BootPhase(const char *name) {
+  unsigned ticks = mTimer.GetClockTicks();
+  mBootPhaseLock.Acquire();
+  if (mNumBootPhases < MAX_BOOT_PHASES) {
+    mBootPhaseName[mNumBootPhases] = name;
+    mBootPhaseTicks[mNumBootPhases] = ticks;
+    mNumBootPhases++;
   }
+  mBootPhaseLock.Release();
+}
 
-  fclose(fp);
+// One line per phase: ms since power on, ms since the previous phase and
+// the phase name. Phases from different cores overlap so the second
+// column is only meaningful between phases of the same core.
+void ViceStdioApp::WriteBootTimes() {
+  FILE *fp = nullptr;
+  if (mBootTimesPath != nullptr) {
+    fp = fopen(mBootTimesPath, "w");
+  }
 
-  CGlueStdioInitBootStat(num, mBootStatWhat, (const char **)mBootStatFile,
-                         mBootStatSize);
-}
+  mBootPhaseLock.Acquire();
+  int num = mNumBootPhases;
+  mBootPhaseLock.Release();
+
+  unsigned prev = 0;
+  for (int i = 0; i < num; i++) {
+    unsigned ms = mBootPhaseTicks[i] / 1000;
+    printf("Boot %6u ms %+6d ms %s\n", ms, (int)(ms - prev),
+           mBootPhaseName[i]);
+    if (fp) {
+      fprintf(fp, "%u,%d,%s\n", ms, (int)(ms - prev), mBootPhaseName[i]);
+    }
+    prev = ms;
+  }
 
-void ViceStdioApp::DisableBootStat() {
-  CGlueStdioInitBootStat(0, nullptr, nullptr, nullptr);
+  if (fp) {
+    fclose(fp);
+  }
 }
 
 bool ViceStdioApp::Initialize(void) {
@@ -468,6 +443,13 @@ bool ViceStdioApp::Initialize(void) {
     return false;
   }
 
+  // fatfs looks the card up by name when the volume is mounted.
+  if (mSDCache.Initialize("emmc1")) {
+    CGlueStdioSetMetadataHook(SDCacheMetadataHint);
+  } else {
+    mLogger.Write(GetKernelName(), LogWarning, "SD cache disabled");
+  }
+
   int partition = mViceOptions.GetDiskPartition();
   int ss = 0;
   if (partition > 4) {
@@ -493,8 +475,16 @@ bool ViceStdioApp::Initialize(void) {
                   fatFsVol);
     return false;
   }
+  BootPhase("sd mounted");
 
-  InitBootStat();
+  if (strcmp(volumeName, "SD") == 0) {
+    // FAT (and root dir on FAT16) stay cached.
+    mSDCache.SetMetadataRange(mFileSystemSD.fatbase, mFileSystemSD.database);
+  }
+
+  // Finish any disk image write back a power loss interrupted.
+  CGlueStdioReplayJournal();
+  CGlueStdioEnableJournal(mViceOptions.WriteJournalEnabled());
 
   // Now that emmc is initialized, launch
   // the emulator main loop on CORE 1 before USBHCII.
@@ -509,14 +499,22 @@ bool ViceStdioApp::Initialize(void) {
     strcpy(mTimingOption, "-pal");
   }
 
+  // Resource and command line setup on core 1 needs no files, so the
+  // boot files are preloaded here in the meantime. Core 1's first file
+  // access waits for the preload to finish.
+  CGlueStdioBeginBootPreload();
 #ifdef ARM_ALLOW_MULTI_CORE
   mEmulatorCore->LaunchEmulator(mTimingOption);
 #endif
+  InitBootStat();
+  CGlueStdioEndBootPreload();
+  BootPhase("boot files preloaded");
 
   // This takes 1.5 seconds to init.
   if (!mUSBHCII.Initialize()) {
     return false;
   }
+  BootPhase("usb ready");
 
   return true;
 }
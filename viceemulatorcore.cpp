@@ -20,10 +20,12 @@
 #include <string.h>
 
 #include "defs.h"
+#include "palfilter.h"
 
 extern "C" {
 #include "third_party/vice-3.3/src/main.h"
 #include "third_party/common/semaphore.h"
+#include "third_party/vice-3.3/src/drive/drive-sound.h"
 
 extern void circle_kernel_core_init_complete(int core);
 }
@@ -37,7 +39,8 @@ ViceEmulatorCore::ViceEmulatorCore(CMemorySystem *pMemorySystem,
 #ifdef ARM_ALLOW_MULTI_CORE
        CMultiCoreSupport(pMemorySystem),
 #endif
-       launch_(false), cyclesPerSecond_(cyclesPerSecond) {
+       launch_(false), cyclesPerSecond_(cyclesPerSecond),
+       pal_filter_wake_(0) {
 
   // These calls only allocate the sampling table. Population is
   // done by cores 1 and 2 in parellel below.
@@ -197,8 +200,20 @@ void ViceEmulatorCore::Run(unsigned nCore) {
   }
 
   if (nCore == 2) {
+     int helper = PALFilterAddHelper(&sid_job);
      while (true) {
         sem_dec(&sid_job);
+        // Drive sound and the PAL filter post their jobs on the same
+        // semaphore. Every post is one job so it doesn't matter which one
+        // woke us up.
+        if (drive_sound_render_pending()) {
+           drive_sound_render();
+           continue;
+        }
+        if (PALFilterBandPending(helper)) {
+           PALFilterRunBand(helper);
+           continue;
+        }
         sid_job_func(sid_job_psid, sid_job_pbuf, sid_job_nr,
                      2, &sid_job_delta_t);
         sem_inc(&sid_done);
@@ -206,6 +221,15 @@ void ViceEmulatorCore::Run(unsigned nCore) {
   }
 
 #ifdef ARM_ALLOW_MULTI_CORE
+  if (nCore == 3) {
+     // Nothing else to do here so help with the PAL filter.
+     int helper = PALFilterAddHelper(&pal_filter_wake_);
+     while (true) {
+        sem_dec(&pal_filter_wake_);
+        PALFilterRunBand(helper);
+     }
+  }
+
   printf("Core %d idle\n", nCore);
   asm("dsb\n\t"
       "1: wfi\n\t"
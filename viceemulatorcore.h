@@ -55,6 +55,8 @@ private:
   char timing_option_[8];
   CSpinLock m_Lock;
   ViceOptions *m_options;
+  // Core 3 sleeps on this waiting for PAL filter bands.
+  uint32_t pal_filter_wake_;
 
   void RunMainVice(bool wait);
   void ComputeResidFilter(int model);
@@ -36,6 +36,8 @@ ViceOptions::ViceOptions(void)
       m_bDemoEnabled(false), m_bSerialEnabled(false),
       m_bGPIOOutputsEnabled(false), m_nCyclesPerSecond(0),
       m_audioOut(VCHIQSoundDestinationAuto), m_bDPIEnabled(false),
+      m_bWriteJournalEnabled(false),
+      m_bRecordBootEnabled(false), m_bInstantBootEnabled(false),
       m_scaling_param_fbw{0,0}, m_scaling_param_fbh{0,0},
       m_scaling_param_sx{0,0}, m_scaling_param_sy{0,0},
       m_raster_skip(false), m_raster_skip2(false) {
@@ -122,6 +124,24 @@ ViceOptions::ViceOptions(void)
       } else {
         m_bDPIEnabled = false;
       }
+    } else if (strcmp(pOption, "enable_write_journal") == 0) {
+      if (strcmp(pValue, "true") == 0 || strcmp(pValue, "1") == 0) {
+        m_bWriteJournalEnabled = true;
+      } else {
+        m_bWriteJournalEnabled = false;
+      }
+    } else if (strcmp(pOption, "record_boot") == 0) {
+      if (strcmp(pValue, "true") == 0 || strcmp(pValue, "1") == 0) {
+        m_bRecordBootEnabled = true;
+      } else {
+        m_bRecordBootEnabled = false;
+      }
+    } else if (strcmp(pOption, "instant_boot") == 0) {
+      if (strcmp(pValue, "true") == 0 || strcmp(pValue, "1") == 0) {
+        m_bInstantBootEnabled = true;
+      } else {
+        m_bInstantBootEnabled = false;
+      }
     } else if (strcmp(pOption, "scaling_params") == 0 ||
                strcmp(pOption, "scaling_params2") == 0) {
       int num = 0;
@@ -197,6 +217,18 @@ bool ViceOptions::GPIOOutputsEnabled(void) const { return m_bGPIOOutputsEnabled;
 
 bool ViceOptions::DPIEnabled(void) const { return m_bDPIEnabled; }
 
+bool ViceOptions::WriteJournalEnabled(void) const {
+  return m_bWriteJournalEnabled;
+}
+
+bool ViceOptions::RecordBootEnabled(void) const {
+  return m_bRecordBootEnabled;
+}
+
+bool ViceOptions::InstantBootEnabled(void) const {
+  return m_bInstantBootEnabled;
+}
+
 int ViceOptions::GetDiskPartition(void) const { return m_disk_partition; }
 
 void ViceOptions::GetScalingParams(int display, int *fbw, int *fbh, int *sx, int *sy) const {
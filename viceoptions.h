@@ -36,6 +36,9 @@ public:
   unsigned long GetCyclesPerSecond(void) const;
   TVCHIQSoundDestination GetAudioOut(void) const;
   bool DPIEnabled(void) const;
+  bool WriteJournalEnabled(void) const;
+  bool RecordBootEnabled(void) const;
+  bool InstantBootEnabled(void) const;
   void GetScalingParams(int display, int *fbw, int *fbh, int *sx, int *sy) const;
   bool GetRasterSkip(void) const;
   bool GetRasterSkip2(void) const;
@@ -65,6 +68,9 @@ private:
   unsigned long m_nCyclesPerSecond;
   TVCHIQSoundDestination m_audioOut;
   bool m_bDPIEnabled;
+  bool m_bWriteJournalEnabled;
+  bool m_bRecordBootEnabled;
+  bool m_bInstantBootEnabled;
   int m_scaling_param_fbw[2];
   int m_scaling_param_fbh[2];
   int m_scaling_param_sx[2];